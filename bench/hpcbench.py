@@ -0,0 +1,485 @@
+#!/usr/bin/env python3
+"""
+One benchmark driver for the norm and mmult binaries.
+
+    hpcbench.py sweep CONFIG [--output-dir DIR] [--force] [--dry-run]
+    hpcbench.py flavours CONFIG --binary NAME --flavour FLAVOUR [...]
+
+CONFIG (TOML, or JSON) lists [[benchmark]] tables whose variants x sizes x
+blocks x threads x dtypes expand into points. Every point runs in its own
+process, pinned to as many CPUs as it has threads, and writes the binary's
+--format json result into a cache keyed by the point and the SHA-256 of the
+binary. A rerun, or a sweep resumed after an interruption, only measures
+points whose configuration or binary changed.
+
+flavours runs the same points against several builds of one binary, the
+flavours of the Makefiles (O2, native, lto, pgo, ...), and prints their
+median times side by side with the speedup over the first.
+"""
+import argparse
+import hashlib
+import json
+import math
+import os
+import platform
+import subprocess
+import sys
+import time
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Per binary: where it is built, how to build it, the flag of each point
+# parameter, and which variants take a block size or a thread count.
+BINARIES = {
+    "norm": {
+        "path": os.path.join("one-norm", "bin", "norm"),
+        "build": ["make", "-C", os.path.join(REPO_ROOT, "one-norm"), "bin/norm"],
+        "flavour_path": os.path.join("one-norm", "bin", "flavours", "norm-{flavour}"),
+        "flavour_build": ["make", "-C", os.path.join(REPO_ROOT, "one-norm"), "bin/flavours/norm-{flavour}"],
+        "variant_flag": "--impl",
+        "size_flag": "--matrix-size",
+        "block_flag": "--block-size",
+        "threads_flag": "--number-of-threads",
+        "repeats_flag": "--repeats",
+        "block_variants": {"serial", "threaded", "summa"},
+        "thread_variants": {"threaded", "auto", "estimate"},
+        # These time themselves and take no harness flags like --warmup.
+        "unharnessed_variants": {"summa", "estimate"},
+        # transpose writes its own YAML and has no --format.
+        "variants": {"naive", "serial", "cblas", "threaded", "summa", "recursive",
+                     "recursive-morton", "estimate", "auto"},
+    },
+    "mmult": {
+        "path": os.path.join("mmult", "bin", f"mmult.{platform.system().lower()}"),
+        "build": ["./build-mmult.sh"],
+        "build_cwd": os.path.join(REPO_ROOT, "mmult"),
+        "flavour_path": os.path.join("mmult", "bin", "flavours", f"mmult.{platform.system().lower()}-{{flavour}}"),
+        "flavour_build": ["./build-mmult.sh", "{flavour}"],
+        "variant_flag": "--variant",
+        "size_flag": "--size",
+        "block_flag": "--block",
+        "threads_flag": None,
+        "repeats_flag": "--repeat",
+        "block_variants": {"block", "blas-block"},
+        "thread_variants": set(),
+        "unharnessed_variants": set(),
+        "variants": {"naive", "block", "blas", "blas-block"},
+    },
+}
+
+# The kernels are built for doubles only.
+SUPPORTED_DTYPES = {"float64", "double"}
+
+DEFAULTS = {
+    "repeats": 10,
+    "warmup": 1,
+    "pin": True,
+    "timeout": 3600,
+    "dtypes": ["float64"],
+    "blocks": [None],
+    "threads": [1],
+    "extra_args": [],
+}
+
+
+def load_config(path):
+    """Reads a TOML config, or JSON when the file ends in .json."""
+    if path.endswith(".json"):
+        with open(path, "r") as f:
+            return json.load(f)
+
+    try:
+        import tomllib
+    except ImportError:
+        sys.exit("TOML configs need Python 3.11+; use a .json config instead")
+    with open(path, "rb") as f:
+        return tomllib.load(f)
+
+
+def binary_path(config, binary, overrides=None):
+    """The binary of a [[benchmark]] table: --binary, then [binaries]
+    overrides, else the path the repo builds it at."""
+    override = (overrides or {}).get(binary) or config.get("binaries", {}).get(binary)
+    path = override if override else BINARIES[binary]["path"]
+    return path if os.path.isabs(path) else os.path.join(REPO_ROOT, path)
+
+
+def parse_overrides(values):
+    """NAME=PATH pairs of --binary."""
+    overrides = {}
+    for value in values:
+        name, sep, path = value.partition("=")
+        if not sep or name not in BINARIES:
+            sys.exit(f"--binary takes NAME=PATH with NAME one of {', '.join(sorted(BINARIES))}, not '{value}'")
+        overrides[name] = os.path.abspath(path)
+    return overrides
+
+
+def file_sha256(path):
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+def expand_points(config):
+    """
+    Expands every [[benchmark]] table into points. A block size or thread
+    count only varies for the variants that use it, so e.g. cblas does not
+    run once per block size.
+    """
+    defaults = dict(DEFAULTS)
+    defaults.update(config.get("defaults", {}))
+    points = []
+    seen = set()
+
+    for table in config.get("benchmark", []):
+        settings = dict(defaults)
+        settings.update(table)
+        binary = settings.get("binary")
+        if binary not in BINARIES:
+            sys.exit(f"Unknown binary '{binary}'; expected one of {', '.join(sorted(BINARIES))}")
+        spec = BINARIES[binary]
+
+        for dtype in settings["dtypes"]:
+            if dtype not in SUPPORTED_DTYPES:
+                sys.exit(f"dtype '{dtype}' is not supported: the kernels are built for float64 only")
+
+        for variant in settings["variants"]:
+            if variant not in spec["variants"]:
+                sys.exit(f"{binary} has no variant '{variant}' that writes --format json")
+            blocks = settings["blocks"] if variant in spec["block_variants"] else [None]
+            threads = settings["threads"] if variant in spec["thread_variants"] else [1]
+            if variant in spec["block_variants"] and None in blocks:
+                sys.exit(f"{binary} variant '{variant}' needs blocks")
+
+            for size in settings["sizes"]:
+                for block in blocks:
+                    if block is not None and size % block != 0:
+                        continue
+                    for num_threads in threads:
+                        for dtype in settings["dtypes"]:
+                            point = {
+                                "binary": binary,
+                                "variant": variant,
+                                "size": size,
+                                "block": block,
+                                "threads": num_threads,
+                                "dtype": "float64" if dtype == "double" else dtype,
+                                "repeats": settings["repeats"],
+                                "warmup": settings["warmup"],
+                                "extra_args": list(settings["extra_args"]),
+                            }
+                            identity = json.dumps(point, sort_keys=True)
+                            if identity not in seen:
+                                seen.add(identity)
+                                points.append((point, settings))
+    return points
+
+
+def point_command(exec_path, point):
+    spec = BINARIES[point["binary"]]
+    command = [
+        exec_path,
+        spec["variant_flag"], point["variant"],
+        spec["size_flag"], str(point["size"]),
+        spec["repeats_flag"], str(point["repeats"]),
+        "--format", "json",
+    ]
+    if point["warmup"] > 0 and point["variant"] not in spec["unharnessed_variants"]:
+        command.extend(["--warmup", str(point["warmup"])])
+    if point["block"] is not None:
+        command.extend([spec["block_flag"], str(point["block"])])
+    if spec["threads_flag"] is not None and point["variant"] in spec["thread_variants"]:
+        command.extend([spec["threads_flag"], str(point["threads"])])
+    return command + point["extra_args"]
+
+
+def cache_key(point, binary_hash):
+    identity = json.dumps({"point": point, "binary": binary_hash}, sort_keys=True)
+    return hashlib.sha256(identity.encode()).hexdigest()[:24]
+
+
+def pinned_cpus(num_threads):
+    """The first num_threads CPUs this process may run on, or None where
+    affinity is not available."""
+    if not hasattr(os, "sched_getaffinity"):
+        return None
+    allowed = sorted(os.sched_getaffinity(0))
+    return set(allowed[:max(1, min(num_threads, len(allowed)))])
+
+
+def run_point(command, cpus, timeout):
+    """Runs one point in a fresh process; returns (result, error)."""
+    preexec = (lambda: os.sched_setaffinity(0, cpus)) if cpus else None
+    try:
+        output = subprocess.run(
+            command,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            universal_newlines=True,
+            preexec_fn=preexec,
+            timeout=timeout,
+            check=False,
+        )
+    except subprocess.TimeoutExpired:
+        return None, f"timed out after {timeout}s"
+    except OSError as e:
+        return None, str(e)
+
+    if output.returncode != 0:
+        return None, (output.stderr.strip() or f"exit status {output.returncode}")
+    try:
+        return json.loads(output.stdout), None
+    except json.JSONDecodeError as e:
+        return None, f"unreadable output: {e}"
+
+
+def write_json_atomically(path, value):
+    """Writes through a temporary file, so an interrupted sweep never leaves
+    a truncated cache entry behind."""
+    tmp_path = f"{path}.tmp"
+    with open(tmp_path, "w") as f:
+        json.dump(value, f, indent=2, sort_keys=True)
+    os.replace(tmp_path, path)
+
+
+def ensure_binaries(config, points, build, overrides=None):
+    hashes = {}
+    for binary in sorted({point["binary"] for point, _ in points}):
+        path = binary_path(config, binary, overrides)
+        if not os.path.exists(path) and build:
+            spec = BINARIES[binary]
+            print(f"Building {binary}: {' '.join(spec['build'])}")
+            subprocess.run(spec["build"], cwd=spec.get("build_cwd"), check=True)
+        if not os.path.exists(path):
+            sys.exit(f"{binary} binary not found at {path}; build it or pass --build")
+        hashes[binary] = file_sha256(path)
+    return hashes
+
+
+def describe(point):
+    parts = [point["binary"], point["variant"], f"n={point['size']}"]
+    if point["block"] is not None:
+        parts.append(f"b={point['block']}")
+    if point["threads"] != 1:
+        parts.append(f"t={point['threads']}")
+    return " ".join(parts)
+
+
+def median_time(result):
+    """Median multiplication time, or the mean for variants that time
+    themselves without the harness."""
+    harness = result.get("harness", {}).get("multiplication", {})
+    if "median_time" in harness:
+        return harness["median_time"]
+    return result.get("statistics", {}).get("multiplication", {}).get("average_time")
+
+
+def measure(points, paths, hashes, cache_dir, args):
+    """
+    Runs every point that is not cached, or all with --force; returns the
+    (point, result) pairs, result None for a failed point, and how many were
+    cached.
+    """
+    num_cached = 0
+    measured = []
+
+    for index, (point, settings) in enumerate(points, start=1):
+        key = cache_key(point, hashes[point["binary"]])
+        entry_path = os.path.join(cache_dir, f"{key}.json")
+        label = f"[{index}/{len(points)}] {describe(point)}"
+
+        if not args.force and os.path.exists(entry_path):
+            with open(entry_path, "r") as f:
+                entry = json.load(f)
+            num_cached += 1
+            print(f"⏭  {label}: cached")
+            measured.append((point, entry["result"]))
+            continue
+
+        command = point_command(paths[point["binary"]], point)
+        if args.dry_run:
+            print(f"▶  {label}: {' '.join(command)}")
+            continue
+
+        cpus = pinned_cpus(point["threads"]) if settings["pin"] else None
+        started = time.time()
+        result, error = run_point(command, cpus, settings["timeout"])
+        if error is not None:
+            print(f"❌ {label}: {error}")
+            measured.append((point, None))
+            continue
+
+        write_json_atomically(entry_path, {
+            "key": key,
+            "point": point,
+            "binary_sha256": hashes[point["binary"]],
+            "command": command,
+            "pinned_cpus": sorted(cpus) if cpus else None,
+            "wall_time": time.time() - started,
+            "result": result,
+        })
+        measured.append((point, result))
+        median = result.get("harness", {}).get("multiplication", {}).get("median_time")
+        print(f"✅ {label}: median {median:.6f}s" if median is not None else f"✅ {label}")
+
+    return measured, num_cached
+
+
+def write_results(path, results):
+    # One JSON document per line: the stream `benchmark compare` reads.
+    with open(path, "w") as f:
+        for result in results:
+            f.write(json.dumps(result, sort_keys=True) + "\n")
+
+
+def sweep(args):
+    config = load_config(args.config)
+    overrides = parse_overrides(args.binary)
+    points = expand_points(config)
+    hashes = ensure_binaries(config, points, args.build, overrides)
+    paths = {binary: binary_path(config, binary, overrides) for binary in hashes}
+    cache_dir = os.path.join(args.output_dir, "cache")
+    os.makedirs(cache_dir, exist_ok=True)
+
+    stem = os.path.splitext(os.path.basename(args.config))[0]
+    results_path = os.path.join(args.output_dir, f"{stem}.json")
+
+    print(f"{len(points)} points from {args.config}")
+    measured, num_cached = measure(points, paths, hashes, cache_dir, args)
+    if args.dry_run:
+        return 0
+
+    results = [result for _, result in measured if result is not None]
+    num_failed = len(measured) - len(results)
+    write_results(results_path, results)
+
+    print(f"\n{len(results)} results ({num_cached} cached, {num_failed} failed) in {results_path}")
+    return 1 if num_failed > 0 else 0
+
+
+def geometric_mean(values):
+    return math.exp(sum(math.log(v) for v in values) / len(values)) if values else None
+
+
+def flavours(args):
+    """
+    Measures the points of one binary against each of its build flavours.
+    norm verifies every product against the reference by default, so a
+    flavour whose optimizations break a kernel fails its points instead of
+    looking fast.
+    """
+    config = load_config(args.config)
+    spec = BINARIES[args.binary]
+    points = [(point, settings) for point, settings in expand_points(config) if point["binary"] == args.binary]
+    if not points:
+        sys.exit(f"{args.config} has no {args.binary} benchmarks")
+
+    cache_dir = os.path.join(args.output_dir, "cache")
+    os.makedirs(cache_dir, exist_ok=True)
+    stem = os.path.splitext(os.path.basename(args.config))[0]
+
+    names = []
+    medians = {}
+    for flavour in args.flavour:
+        name, sep, path = flavour.partition("=")
+        path = os.path.abspath(path) if sep else os.path.join(REPO_ROOT, spec["flavour_path"].format(flavour=name))
+        if not os.path.exists(path) and args.build and not sep:
+            command = [part.format(flavour=name) for part in spec["flavour_build"]]
+            print(f"Building {args.binary} flavour {name}: {' '.join(command)}")
+            subprocess.run(command, cwd=spec.get("build_cwd"), check=True)
+        if not os.path.exists(path):
+            sys.exit(f"{args.binary} flavour {name} not found at {path}; build it or pass --build")
+
+        print(f"\n{name}: {path}")
+        hashes = {args.binary: file_sha256(path)}
+        measured, _ = measure(points, {args.binary: path}, hashes, cache_dir, args)
+        if args.dry_run:
+            continue
+
+        results = [result for _, result in measured if result is not None]
+        write_results(os.path.join(args.output_dir, f"{stem}-{name}.json"), results)
+        names.append(name)
+        medians[name] = [median_time(result) if result is not None else None for _, result in measured]
+
+    if args.dry_run:
+        return 0
+
+    # Speedups are over the first flavour, on the points both passed.
+    baseline = medians[names[0]]
+    lines = [
+        "| point | " + " | ".join(names) + " |",
+        "|---|" + "---|" * len(names),
+    ]
+    for index, (point, _) in enumerate(points):
+        cells = []
+        for name in names:
+            median = medians[name][index]
+            if median is None:
+                cells.append("failed")
+            elif name == names[0] or baseline[index] is None:
+                cells.append(f"{median:.6f}s")
+            else:
+                cells.append(f"{median:.6f}s ({baseline[index] / median:.2f}x)")
+        lines.append(f"| {describe(point)} | " + " | ".join(cells) + " |")
+
+    summary = []
+    fastest = None
+    for name in names:
+        speedups = [b / m for b, m in zip(baseline, medians[name]) if b is not None and m is not None]
+        mean = geometric_mean(speedups)
+        passed = all(m is not None for m in medians[name])
+        summary.append(f"{mean:.2f}x" if mean is not None else "-")
+        if passed and mean is not None and (fastest is None or mean > fastest[1]):
+            fastest = (name, mean)
+    lines.append("| geometric mean | " + " | ".join(summary) + " |")
+
+    table = "\n".join(lines)
+    table_path = os.path.join(args.output_dir, f"{stem}-flavours.md")
+    with open(table_path, "w") as f:
+        f.write(table + "\n")
+
+    print(f"\n{table}\n")
+    if fastest is not None:
+        print(f"Fastest flavour passing every point: {fastest[0]} ({fastest[1]:.2f}x over {names[0]})")
+    print(f"Table in {table_path}, results in {os.path.join(args.output_dir, stem)}-<flavour>.json")
+    return 0 if all(all(m is not None for m in medians[name]) for name in names) else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark driver for the norm and mmult binaries")
+    subcommands = parser.add_subparsers(dest="command", required=True)
+
+    sweep_parser = subcommands.add_parser("sweep", help="Run a declarative sweep from a config file")
+    sweep_parser.add_argument("config", help="TOML (or .json) sweep config")
+    sweep_parser.add_argument("--output-dir", default=os.path.join(REPO_ROOT, "bench", "out"),
+                              help="Where the cache and the results go (default: bench/out)")
+    sweep_parser.add_argument("--force", action="store_true", help="Rerun points that are cached")
+    sweep_parser.add_argument("--dry-run", action="store_true", help="List the points that would run")
+    sweep_parser.add_argument("--build", action="store_true", help="Build binaries that are missing")
+    sweep_parser.add_argument("--binary", action="append", default=[], metavar="NAME=PATH",
+                              help="Run NAME from PATH, ahead of [binaries] (repeatable)")
+    sweep_parser.set_defaults(handler=sweep)
+
+    flavours_parser = subcommands.add_parser("flavours", help="Compare build flavours of one binary side by side")
+    flavours_parser.add_argument("config", help="TOML (or .json) sweep config")
+    flavours_parser.add_argument("--binary", required=True, choices=sorted(BINARIES),
+                                 help="Which binary's benchmarks to run")
+    flavours_parser.add_argument("--flavour", action="append", required=True, metavar="NAME[=PATH]",
+                                 help="A build flavour, at the path its Makefile builds it unless given; "
+                                      "the first is the baseline (repeatable)")
+    flavours_parser.add_argument("--output-dir", default=os.path.join(REPO_ROOT, "bench", "out"),
+                                 help="Where the cache and the results go (default: bench/out)")
+    flavours_parser.add_argument("--force", action="store_true", help="Rerun points that are cached")
+    flavours_parser.add_argument("--dry-run", action="store_true", help="List the points that would run")
+    flavours_parser.add_argument("--build", action="store_true", help="Build flavours that are missing")
+    flavours_parser.set_defaults(handler=flavours)
+
+    args = parser.parse_args()
+    return args.handler(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
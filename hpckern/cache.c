@@ -0,0 +1,593 @@
+#include "hpckern_internal.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_FILE_MAGIC 0x31454843484b5048ull /* "HPKHCHE1" */
+#define CACHE_FILE_SUFFIX ".hkc"
+#define CACHE_MIN_BUCKETS 64
+#define CACHE_PATH_MAX 4096
+
+/* In front of the value in every disk file; the checksum catches files cut
+ * short or damaged after their rename. */
+typedef struct cache_file_header_t
+{
+    uint64_t magic;
+    uint64_t lhs;
+    uint64_t rhs;
+    uint64_t params;
+    uint64_t size;
+    uint64_t bytes;
+    uint64_t checksum;
+} cache_file_header_t;
+
+/* An entry of either tier: the memory tier keeps the value, the disk tier
+ * only what its file holds. */
+typedef struct cache_entry_t
+{
+    hpckern_cache_key_t key;
+    size_t bytes;
+    void *value;
+    struct cache_entry_t *prev;
+    struct cache_entry_t *next;
+    struct cache_entry_t *chain;
+} cache_entry_t;
+
+/* A hash table over an LRU list, most recently used first. */
+typedef struct cache_tier_t
+{
+    size_t limit;
+    size_t used;
+    size_t count;
+    cache_entry_t *head;
+    cache_entry_t *tail;
+    cache_entry_t **buckets;
+    size_t num_buckets;
+} cache_tier_t;
+
+/* One mutex guards both tiers, disk I/O included: a lookup or a store costs
+ * O(N^2) either way, against the O(N^3) of the product it saves. */
+struct hpckern_cache_t
+{
+    pthread_mutex_t mutex;
+    cache_tier_t memory;
+    cache_tier_t disk;
+    char *disk_path;
+    size_t num_writes;
+    hpckern_cache_stats_t stats;
+};
+
+typedef struct cache_file_t
+{
+    hpckern_cache_key_t key;
+    size_t bytes;
+    struct timespec mtime;
+} cache_file_t;
+
+static inline bool key_equal(const hpckern_cache_key_t *a, const hpckern_cache_key_t *b)
+{
+    return a->lhs == b->lhs && a->rhs == b->rhs && a->params == b->params && a->size == b->size;
+}
+
+static inline size_t key_bucket(const hpckern_cache_key_t *key, size_t num_buckets)
+{
+    const uint64_t h = key->lhs ^ (key->rhs * 0x9E3779B185EBCA87ull) ^ (key->params * 0xC2B2AE3D27D4EB4Full) ^ key->size;
+    return (size_t)(h ^ (h >> 32)) & (num_buckets - 1);
+}
+
+static bool tier_init(cache_tier_t *tier, size_t limit)
+{
+    tier->limit = limit;
+    tier->num_buckets = CACHE_MIN_BUCKETS;
+    tier->buckets = (cache_entry_t **)calloc(tier->num_buckets, sizeof(cache_entry_t *));
+    return tier->buckets != NULL;
+}
+
+static cache_entry_t *tier_find(const cache_tier_t *tier, const hpckern_cache_key_t *key)
+{
+    for (cache_entry_t *entry = tier->buckets[key_bucket(key, tier->num_buckets)]; entry != NULL; entry = entry->chain)
+    {
+        if (key_equal(&entry->key, key))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void tier_unlink(cache_tier_t *tier, cache_entry_t *entry)
+{
+    if (entry->prev != NULL)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        tier->head = entry->next;
+    }
+    if (entry->next != NULL)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        tier->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void tier_push_front(cache_tier_t *tier, cache_entry_t *entry)
+{
+    entry->next = tier->head;
+    if (tier->head != NULL)
+    {
+        tier->head->prev = entry;
+    }
+    tier->head = entry;
+    if (tier->tail == NULL)
+    {
+        tier->tail = entry;
+    }
+}
+
+static void tier_touch(cache_tier_t *tier, cache_entry_t *entry)
+{
+    tier_unlink(tier, entry);
+    tier_push_front(tier, entry);
+}
+
+// Without memory for a larger index the chains just grow longer.
+static void tier_grow(cache_tier_t *tier)
+{
+    const size_t num_buckets = 2 * tier->num_buckets;
+    cache_entry_t **buckets = (cache_entry_t **)calloc(num_buckets, sizeof(cache_entry_t *));
+
+    if (buckets == NULL)
+    {
+        return;
+    }
+    for (size_t b = 0; b < tier->num_buckets; b++)
+    {
+        cache_entry_t *entry = tier->buckets[b];
+        while (entry != NULL)
+        {
+            cache_entry_t *chain = entry->chain;
+            const size_t bucket = key_bucket(&entry->key, num_buckets);
+
+            entry->chain = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = chain;
+        }
+    }
+    free(tier->buckets);
+    tier->buckets = buckets;
+    tier->num_buckets = num_buckets;
+}
+
+static void tier_insert(cache_tier_t *tier, cache_entry_t *entry)
+{
+    size_t bucket;
+
+    if (tier->count >= tier->num_buckets)
+    {
+        tier_grow(tier);
+    }
+    bucket = key_bucket(&entry->key, tier->num_buckets);
+    entry->chain = tier->buckets[bucket];
+    tier->buckets[bucket] = entry;
+    tier_push_front(tier, entry);
+    tier->used += entry->bytes;
+    tier->count++;
+}
+
+static void tier_remove(cache_tier_t *tier, cache_entry_t *entry)
+{
+    cache_entry_t **link = &tier->buckets[key_bucket(&entry->key, tier->num_buckets)];
+
+    while (*link != entry)
+    {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+    tier_unlink(tier, entry);
+    tier->used -= entry->bytes;
+    tier->count--;
+}
+
+static void tier_destroy(cache_tier_t *tier)
+{
+    cache_entry_t *entry = tier->head;
+
+    while (entry != NULL)
+    {
+        cache_entry_t *next = entry->next;
+        free(entry->value);
+        free(entry);
+        entry = next;
+    }
+    free(tier->buckets);
+}
+
+static cache_entry_t *entry_create(const hpckern_cache_key_t *key, size_t bytes)
+{
+    cache_entry_t *entry = (cache_entry_t *)calloc(1, sizeof(cache_entry_t));
+
+    if (entry != NULL)
+    {
+        entry->key = *key;
+        entry->bytes = bytes;
+    }
+    return entry;
+}
+
+static void disk_file_path(const hpckern_cache_t *cache, const hpckern_cache_key_t *key, char *path, size_t path_size)
+{
+    snprintf(path, path_size, "%s/%016llx%016llx%016llx-%zu" CACHE_FILE_SUFFIX,
+             cache->disk_path,
+             (unsigned long long)key->lhs, (unsigned long long)key->rhs, (unsigned long long)key->params,
+             key->size);
+}
+
+// Drops least recently used entries until `bytes` more fit; disk entries
+// take their files with them.
+static void cache_evict(hpckern_cache_t *cache, cache_tier_t *tier, size_t bytes)
+{
+    while (tier->tail != NULL && tier->used + bytes > tier->limit)
+    {
+        cache_entry_t *victim = tier->tail;
+
+        if (tier == &cache->disk)
+        {
+            char path[CACHE_PATH_MAX];
+
+            disk_file_path(cache, &victim->key, path, sizeof(path));
+            unlink(path);
+        }
+        tier_remove(tier, victim);
+        free(victim->value);
+        free(victim);
+        cache->stats.evictions++;
+    }
+}
+
+static int compare_file_mtime(const void *lhs, const void *rhs)
+{
+    const struct timespec *a = &((const cache_file_t *)lhs)->mtime;
+    const struct timespec *b = &((const cache_file_t *)rhs)->mtime;
+
+    if (a->tv_sec != b->tv_sec)
+    {
+        return a->tv_sec < b->tv_sec ? -1 : 1;
+    }
+    return a->tv_nsec < b->tv_nsec ? -1 : a->tv_nsec > b->tv_nsec;
+}
+
+// Indexes the files earlier runs left, in the order of their last use, which
+// lookups record in the modification time. Files that do not fit in memory
+// stay unindexed; returns false only when the directory cannot be read.
+static bool disk_scan(hpckern_cache_t *cache)
+{
+    DIR *dir = opendir(cache->disk_path);
+    struct dirent *dirent;
+    cache_file_t *files = NULL;
+    size_t num_files = 0, capacity = 0;
+
+    if (dir == NULL)
+    {
+        return false;
+    }
+    while ((dirent = readdir(dir)) != NULL)
+    {
+        char path[CACHE_PATH_MAX];
+        unsigned long long lhs, rhs, params;
+        size_t size;
+        int length = 0;
+        struct stat st;
+
+        if (sscanf(dirent->d_name, "%16llx%16llx%16llx-%zu" CACHE_FILE_SUFFIX "%n", &lhs, &rhs, &params, &size, &length) != 4 ||
+            dirent->d_name[length] != '\0')
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", cache->disk_path, dirent->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            continue;
+        }
+
+        if (num_files == capacity)
+        {
+            const size_t grown = MAX(2 * capacity, (size_t)CACHE_MIN_BUCKETS);
+            cache_file_t *more = (cache_file_t *)realloc(files, grown * sizeof(cache_file_t));
+            if (more == NULL)
+            {
+                break;
+            }
+            files = more;
+            capacity = grown;
+        }
+        files[num_files].key.lhs = lhs;
+        files[num_files].key.rhs = rhs;
+        files[num_files].key.params = params;
+        files[num_files].key.size = size;
+        files[num_files].bytes = (size_t)st.st_size;
+        files[num_files].mtime = st.st_mtim;
+        num_files++;
+    }
+    closedir(dir);
+
+    qsort(files, num_files, sizeof(cache_file_t), compare_file_mtime);
+    for (size_t i = 0; i < num_files; i++)
+    {
+        cache_entry_t *entry = entry_create(&files[i].key, files[i].bytes);
+        if (entry != NULL)
+        {
+            tier_insert(&cache->disk, entry);
+        }
+    }
+    free(files);
+
+    // The limit may have shrunk since.
+    cache_evict(cache, &cache->disk, 0);
+    return true;
+}
+
+// Drops the disk entry of `key`, whose file is gone or about to be, so a
+// later store writes it again.
+static void disk_forget(hpckern_cache_t *cache, const hpckern_cache_key_t *key)
+{
+    cache_entry_t *entry = tier_find(&cache->disk, key);
+
+    if (entry != NULL)
+    {
+        tier_remove(&cache->disk, entry);
+        free(entry);
+    }
+}
+
+// Maps the file of `key` and copies its value out. A file that exists but
+// does not hold a valid value of `bytes` bytes is removed, and a file that
+// another process removed is forgotten.
+static bool disk_read(hpckern_cache_t *cache, const hpckern_cache_key_t *key, void *value, size_t bytes)
+{
+    const size_t file_bytes = sizeof(cache_file_header_t) + bytes;
+    char path[CACHE_PATH_MAX];
+    cache_file_header_t header;
+    struct stat st;
+    void *map;
+    bool is_valid = false;
+    int fd;
+
+    disk_file_path(cache, key, path, sizeof(path));
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        disk_forget(cache, key);
+        return false;
+    }
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == file_bytes &&
+        (map = mmap(NULL, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    {
+        const unsigned char *payload = (const unsigned char *)map + sizeof(cache_file_header_t);
+
+        memcpy(&header, map, sizeof(header));
+        is_valid = header.magic == CACHE_FILE_MAGIC &&
+                   header.lhs == key->lhs && header.rhs == key->rhs && header.params == key->params &&
+                   header.size == key->size && header.bytes == bytes &&
+                   header.checksum == hpckern_hash_bytes(payload, bytes, 0);
+        if (is_valid)
+        {
+            memcpy(value, payload, bytes);
+            futimens(fd, NULL);
+        }
+        munmap(map, file_bytes);
+    }
+    close(fd);
+
+    if (!is_valid)
+    {
+        unlink(path);
+        disk_forget(cache, key);
+    }
+    return is_valid;
+}
+
+// Writes through a uniquely named temporary file and renames it into place,
+// so other processes never map a file that is still being written.
+static bool disk_write(hpckern_cache_t *cache, const hpckern_cache_key_t *key, const void *value, size_t bytes)
+{
+    const size_t file_bytes = sizeof(cache_file_header_t) + bytes;
+    char path[CACHE_PATH_MAX], tmp_path[CACHE_PATH_MAX + 64];
+    cache_file_header_t header;
+    void *map;
+    bool is_written = false;
+    int fd;
+
+    disk_file_path(cache, key, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.%zu.tmp", path, (long)getpid(), cache->num_writes++);
+    fd = open(tmp_path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    header.magic = CACHE_FILE_MAGIC;
+    header.lhs = key->lhs;
+    header.rhs = key->rhs;
+    header.params = key->params;
+    header.size = key->size;
+    header.bytes = bytes;
+    header.checksum = hpckern_hash_bytes(value, bytes, 0);
+
+    if (ftruncate(fd, (off_t)file_bytes) == 0 &&
+        (map = mmap(NULL, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED)
+    {
+        memcpy(map, &header, sizeof(header));
+        memcpy((unsigned char *)map + sizeof(header), value, bytes);
+        is_written = munmap(map, file_bytes) == 0;
+    }
+    is_written = close(fd) == 0 && is_written && rename(tmp_path, path) == 0;
+
+    if (!is_written)
+    {
+        unlink(tmp_path);
+    }
+    return is_written;
+}
+
+static void memory_store(hpckern_cache_t *cache, const hpckern_cache_key_t *key, const void *value, size_t bytes)
+{
+    cache_entry_t *entry = tier_find(&cache->memory, key);
+
+    if (entry != NULL)
+    {
+        tier_touch(&cache->memory, entry);
+        return;
+    }
+    if (bytes > cache->memory.limit)
+    {
+        return;
+    }
+
+    cache_evict(cache, &cache->memory, bytes);
+    entry = entry_create(key, bytes);
+    if (entry == NULL || (entry->value = malloc(bytes)) == NULL)
+    {
+        free(entry);
+        return;
+    }
+    memcpy(entry->value, value, bytes);
+    tier_insert(&cache->memory, entry);
+}
+
+hpckern_cache_t *hpckern_cache_create(const hpckern_cache_config_t *config)
+{
+    hpckern_cache_t *cache = (hpckern_cache_t *)calloc(1, sizeof(hpckern_cache_t));
+
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_init(&cache->mutex, NULL);
+    if (!tier_init(&cache->memory, config->memory_bytes) ||
+        !tier_init(&cache->disk, config->disk_path != NULL ? config->disk_bytes : 0))
+    {
+        hpckern_cache_destroy(&cache);
+        return NULL;
+    }
+
+    if (config->disk_path != NULL &&
+        ((mkdir(config->disk_path, 0755) != 0 && errno != EEXIST) ||
+         (cache->disk_path = strdup(config->disk_path)) == NULL ||
+         !disk_scan(cache)))
+    {
+        hpckern_cache_destroy(&cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void hpckern_cache_destroy(hpckern_cache_t **cache)
+{
+    if (*cache == NULL)
+    {
+        return;
+    }
+
+    tier_destroy(&(*cache)->memory);
+    tier_destroy(&(*cache)->disk);
+    pthread_mutex_destroy(&(*cache)->mutex);
+    free((*cache)->disk_path);
+    free(*cache);
+    *cache = NULL;
+}
+
+bool hpckern_cache_lookup(hpckern_cache_t *cache, const hpckern_cache_key_t *key, void *value, size_t bytes)
+{
+    cache_entry_t *entry;
+    bool is_hit = false;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    entry = tier_find(&cache->memory, key);
+    if (entry != NULL && entry->bytes == bytes)
+    {
+        memcpy(value, entry->value, bytes);
+        tier_touch(&cache->memory, entry);
+        cache->stats.memory_hits++;
+        is_hit = true;
+    }
+    else if (cache->disk_path != NULL && disk_read(cache, key, value, bytes))
+    {
+        // The file may come from another process since the scan.
+        entry = tier_find(&cache->disk, key);
+        if (entry != NULL)
+        {
+            tier_touch(&cache->disk, entry);
+        }
+        else if ((entry = entry_create(key, sizeof(cache_file_header_t) + bytes)) != NULL)
+        {
+            cache_evict(cache, &cache->disk, entry->bytes);
+            tier_insert(&cache->disk, entry);
+        }
+        memory_store(cache, key, value, bytes);
+        cache->stats.disk_hits++;
+        is_hit = true;
+    }
+    else
+    {
+        cache->stats.misses++;
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+    return is_hit;
+}
+
+void hpckern_cache_store(hpckern_cache_t *cache, const hpckern_cache_key_t *key, const void *value, size_t bytes)
+{
+    const size_t file_bytes = sizeof(cache_file_header_t) + bytes;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    cache->stats.stores++;
+    memory_store(cache, key, value, bytes);
+    if (cache->disk_path != NULL && file_bytes <= cache->disk.limit && tier_find(&cache->disk, key) == NULL)
+    {
+        // The entry comes first, so no file is written that the index
+        // cannot account for.
+        cache_entry_t *entry = entry_create(key, file_bytes);
+
+        if (entry != NULL)
+        {
+            cache_evict(cache, &cache->disk, file_bytes);
+            if (disk_write(cache, key, value, bytes))
+            {
+                tier_insert(&cache->disk, entry);
+            }
+            else
+            {
+                free(entry);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void hpckern_cache_stats(hpckern_cache_t *cache, hpckern_cache_stats_t *stats)
+{
+    pthread_mutex_lock(&cache->mutex);
+    *stats = cache->stats;
+    stats->memory_bytes = cache->memory.used;
+    stats->disk_bytes = cache->disk.used;
+    pthread_mutex_unlock(&cache->mutex);
+}
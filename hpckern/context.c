@@ -0,0 +1,266 @@
+#include "hpckern_internal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define ARENA_MIN_CAPACITY ((size_t)1 << 20)
+
+/* Header in front of an allocation that did not fit the arena buffer. */
+typedef struct arena_overflow_t
+{
+    struct arena_overflow_t *next;
+    size_t mark;
+    _Alignas(CACHE_LINE_SIZE) char data[];
+} arena_overflow_t;
+
+struct hpckern_context_t
+{
+    size_t num_threads;
+    pthread_t *threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_start;
+    pthread_cond_t cond_done;
+    size_t generation;
+    size_t num_finished;
+    bool shutdown;
+
+    /* The parallel loop currently being executed. */
+    hpckern_task_fn_t fn;
+    void *arg;
+    size_t num_tasks;
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t next_task;
+
+    /* Arena: a bump buffer, plus overflow blocks once it is exhausted. The
+     * buffer grows to the high-water mark when the arena is fully released. */
+    char *arena;
+    size_t arena_capacity;
+    size_t arena_used;
+    size_t arena_high_water;
+    arena_overflow_t *arena_overflow;
+};
+
+static const char *const STATUS_NAMES[HPCKERN_NUM_STATUSES] = {
+    [HPCKERN_OK] = "ok",
+    [HPCKERN_ERROR_INVALID_ARGUMENT] = "invalid argument",
+    [HPCKERN_ERROR_OUT_OF_MEMORY] = "out of memory",
+};
+
+const char *hpckern_status_name(hpckern_status_t status)
+{
+    return status < HPCKERN_NUM_STATUSES ? STATUS_NAMES[status] : "unknown";
+}
+
+static void run_tasks(hpckern_context_t *ctx)
+{
+    size_t task;
+
+    while ((task = atomic_fetch_add_explicit(&ctx->next_task, 1, memory_order_relaxed)) < ctx->num_tasks)
+    {
+        ctx->fn(ctx->arg, task);
+    }
+}
+
+static void *context_worker(void *param)
+{
+    hpckern_context_t *ctx = (hpckern_context_t *)param;
+    size_t seen_generation = 0;
+
+    for (;;)
+    {
+        HPCKERN_TRACE_BEGIN("idle", HPCKERN_TRACE_NO_ARG);
+        pthread_mutex_lock(&ctx->mutex);
+        while (ctx->generation == seen_generation && !ctx->shutdown)
+        {
+            pthread_cond_wait(&ctx->cond_start, &ctx->mutex);
+        }
+        if (ctx->shutdown)
+        {
+            pthread_mutex_unlock(&ctx->mutex);
+            HPCKERN_TRACE_END("idle");
+            break;
+        }
+        seen_generation = ctx->generation;
+        pthread_mutex_unlock(&ctx->mutex);
+        HPCKERN_TRACE_END("idle");
+
+        run_tasks(ctx);
+
+        pthread_mutex_lock(&ctx->mutex);
+        ctx->num_finished++;
+        pthread_cond_signal(&ctx->cond_done);
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+
+    return NULL;
+}
+
+/* Stops and joins workers 1 .. num_started - 1. */
+static void context_stop_workers(hpckern_context_t *ctx, size_t num_started)
+{
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->shutdown = true;
+    pthread_cond_broadcast(&ctx->cond_start);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    for (size_t i = 1; i < num_started; i++)
+    {
+        pthread_join(ctx->threads[i], NULL);
+    }
+}
+
+hpckern_context_t *hpckern_context_create(size_t num_threads)
+{
+    hpckern_context_t *ctx = (hpckern_context_t *)aligned_alloc(CACHE_LINE_SIZE, sizeof(hpckern_context_t));
+
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(hpckern_context_t));
+    ctx->num_threads = MAX(num_threads, (size_t)1);
+    ctx->threads = (pthread_t *)calloc(ctx->num_threads, sizeof(pthread_t));
+    if (ctx->threads == NULL)
+    {
+        free(ctx);
+        return NULL;
+    }
+
+    pthread_mutex_init(&ctx->mutex, NULL);
+    pthread_cond_init(&ctx->cond_start, NULL);
+    pthread_cond_init(&ctx->cond_done, NULL);
+
+    /* The calling thread takes part in every loop, so only spawn the rest. */
+    for (size_t i = 1; i < ctx->num_threads; i++)
+    {
+        if (pthread_create(&ctx->threads[i], NULL, context_worker, ctx) != 0)
+        {
+            context_stop_workers(ctx, i);
+            pthread_cond_destroy(&ctx->cond_done);
+            pthread_cond_destroy(&ctx->cond_start);
+            pthread_mutex_destroy(&ctx->mutex);
+            free(ctx->threads);
+            free(ctx);
+            return NULL;
+        }
+    }
+
+    return ctx;
+}
+
+void hpckern_context_destroy(hpckern_context_t **ctx)
+{
+    hpckern_context_t *c = *ctx;
+
+    context_stop_workers(c, c->num_threads);
+
+    c->arena_high_water = 0;
+    hpckern_arena_release(c, 0);
+    pthread_cond_destroy(&c->cond_done);
+    pthread_cond_destroy(&c->cond_start);
+    pthread_mutex_destroy(&c->mutex);
+    free(c->arena);
+    free(c->threads);
+    free(c);
+    *ctx = NULL;
+}
+
+size_t hpckern_context_num_threads(const hpckern_context_t *ctx)
+{
+    return ctx->num_threads;
+}
+
+void hpckern_parallel_for(hpckern_context_t *ctx, size_t num_tasks, hpckern_task_fn_t fn, void *arg)
+{
+    if (ctx->num_threads == 1 || num_tasks <= 1)
+    {
+        for (size_t task = 0; task < num_tasks; task++)
+        {
+            fn(arg, task);
+        }
+        return;
+    }
+
+    HPCKERN_TRACE_BEGIN("parallel_for", num_tasks);
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->fn = fn;
+    ctx->arg = arg;
+    ctx->num_tasks = num_tasks;
+    ctx->num_finished = 0;
+    atomic_store_explicit(&ctx->next_task, 0, memory_order_relaxed);
+    ctx->generation++;
+    pthread_cond_broadcast(&ctx->cond_start);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    run_tasks(ctx);
+
+    /* Time the caller spends here is the imbalance of the loop. */
+    HPCKERN_TRACE_BEGIN("join", HPCKERN_TRACE_NO_ARG);
+    pthread_mutex_lock(&ctx->mutex);
+    while (ctx->num_finished < ctx->num_threads - 1)
+    {
+        pthread_cond_wait(&ctx->cond_done, &ctx->mutex);
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+    HPCKERN_TRACE_END("join");
+    HPCKERN_TRACE_END("parallel_for");
+}
+
+void *hpckern_arena_alloc(hpckern_context_t *ctx, size_t bytes)
+{
+    const size_t rounded = (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    void *ptr;
+
+    /* Once an overflow block exists, later allocations overflow as well, so
+     * releasing a mark frees exactly the blocks allocated after it. */
+    if (ctx->arena_overflow == NULL && ctx->arena_used + rounded <= ctx->arena_capacity)
+    {
+        ptr = ctx->arena + ctx->arena_used;
+    }
+    else
+    {
+        arena_overflow_t *block = (arena_overflow_t *)aligned_alloc(CACHE_LINE_SIZE, sizeof(arena_overflow_t) + rounded);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block->next = ctx->arena_overflow;
+        block->mark = ctx->arena_used;
+        ctx->arena_overflow = block;
+        ptr = block->data;
+    }
+
+    ctx->arena_used += rounded;
+    ctx->arena_high_water = MAX(ctx->arena_high_water, ctx->arena_used);
+    return ptr;
+}
+
+size_t hpckern_arena_mark(const hpckern_context_t *ctx)
+{
+    return ctx->arena_used;
+}
+
+void hpckern_arena_release(hpckern_context_t *ctx, size_t mark)
+{
+    while (ctx->arena_overflow != NULL && ctx->arena_overflow->mark >= mark)
+    {
+        arena_overflow_t *next = ctx->arena_overflow->next;
+        free(ctx->arena_overflow);
+        ctx->arena_overflow = next;
+    }
+    ctx->arena_used = mark;
+
+    /* A buffer that cannot grow leaves the arena empty; every allocation
+     * then overflows until the next full release tries again. */
+    if (mark == 0 && ctx->arena_high_water > ctx->arena_capacity)
+    {
+        free(ctx->arena);
+        ctx->arena_capacity = MAX(ctx->arena_high_water, ARENA_MIN_CAPACITY);
+        ctx->arena = (char *)aligned_alloc(CACHE_LINE_SIZE, ctx->arena_capacity);
+        if (ctx->arena == NULL)
+        {
+            ctx->arena_capacity = 0;
+        }
+    }
+}
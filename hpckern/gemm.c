@@ -0,0 +1,715 @@
+#include "hpckern_internal.h"
+
+#include <cblas.h>
+#include <math.h>
+#include <string.h>
+
+typedef struct gemm_task_t
+{
+    size_t block_size;
+    double alpha;
+    double beta;
+    const hpckern_matrix_t *lhs;
+    const hpckern_matrix_t *rhs;
+    hpckern_matrix_t *result;
+    size_t rows_per_task;
+} gemm_task_t;
+
+static const char *const VARIANT_NAMES[HPCKERN_NUM_VARIANTS] = {
+    [HPCKERN_NAIVE] = "naive",
+    [HPCKERN_SERIAL] = "serial",
+    [HPCKERN_THREADED] = "threaded",
+    [HPCKERN_CBLAS] = "cblas",
+    [HPCKERN_BLOCK] = "block",
+    [HPCKERN_BLAS_BLOCK] = "blas-block",
+    [HPCKERN_RECURSIVE] = "recursive",
+    [HPCKERN_RECURSIVE_MORTON] = "recursive-morton",
+};
+
+const char *hpckern_variant_name(hpckern_variant_t variant)
+{
+    return variant < HPCKERN_NUM_VARIANTS ? VARIANT_NAMES[variant] : "unknown";
+}
+
+bool hpckern_variant_from_name(const char *name, hpckern_variant_t *variant)
+{
+    for (size_t i = 0; i < HPCKERN_NUM_VARIANTS; i++)
+    {
+        if (strcmp(name, VARIANT_NAMES[i]) == 0)
+        {
+            *variant = (hpckern_variant_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void hpckern_matrix_scale_rows(double beta, double *data, size_t N, size_t row_start, size_t row_end)
+{
+    if (beta == 1.0)
+    {
+        return;
+    }
+
+    if (beta == 0.0)
+    {
+        memset(&data[row_start * N], 0, (row_end - row_start) * N * sizeof(double));
+        return;
+    }
+
+    for (size_t i = row_start * N; i < row_end * N; i++)
+    {
+        data[i] *= beta;
+    }
+}
+
+hpckern_status_t hpckern_matrix_gemm_naive(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result));
+
+    const size_t N = lhs->size;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = 0; j < N; j++)
+        {
+            double sum = 0.0;
+            for (size_t k = 0; k < N; k++)
+            {
+                sum += lhs->data[i * N + k] * rhs->data[k * N + j];
+            }
+            result->data[i * N + j] = alpha * sum + (beta == 0.0 ? 0.0 : beta * result->data[i * N + j]);
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+// Blocked C[row_start .. row_end) += alpha * A * B. A single k-i-j loop
+// updates result rows in place, so callers scale C by beta beforehand.
+static void gemm_blocked_rows(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double *result, size_t row_start, size_t row_end)
+{
+    const size_t N = lhs->size;
+    const hpckern_gemm_rows_fn_t fixed = hpckern_gemm_fixed_rows(block_size);
+
+    if (fixed != NULL)
+    {
+        fixed(alpha, lhs, rhs, result, row_start, row_end);
+        return;
+    }
+
+    for (size_t bi = row_start; bi < row_end; bi += block_size)
+    {
+        for (size_t bj = 0; bj < N; bj += block_size)
+        {
+            HPCKERN_TRACE_BEGIN("gemm tile", bi / block_size * ((N + block_size - 1) / block_size) + bj / block_size);
+            for (size_t bk = 0; bk < N; bk += block_size)
+            {
+                const size_t i_end = MIN(bi + block_size, row_end);
+                const size_t j_end = MIN(bj + block_size, N);
+                const size_t k_end = MIN(bk + block_size, N);
+
+                for (size_t k = bk; k < k_end; k++)
+                {
+                    for (size_t i = bi; i < i_end; i++)
+                    {
+                        register const double lhs_data = alpha * lhs->data[i * N + k];
+                        register const double *rhs_row = &rhs->data[k * N];
+                        register double *result_row = &result[i * N];
+                        register const size_t limit = j_end - ((j_end - bj) % 4);
+                        register size_t j;
+
+                        for (j = bj; j < limit; j += 4)
+                        {
+                            result_row[j] += lhs_data * rhs_row[j];
+                            result_row[j + 1] += lhs_data * rhs_row[j + 1];
+                            result_row[j + 2] += lhs_data * rhs_row[j + 2];
+                            result_row[j + 3] += lhs_data * rhs_row[j + 3];
+                        }
+
+                        for (; j < j_end; j++)
+                        {
+                            result_row[j] += lhs_data * rhs_row[j];
+                        }
+                    }
+                }
+            }
+            HPCKERN_TRACE_END("gemm tile");
+        }
+    }
+}
+
+hpckern_status_t hpckern_matrix_gemm_serial(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result) && block_size > 0);
+
+    const size_t N = lhs->size;
+
+    hpckern_matrix_scale_rows(beta, result->data, N, 0, N);
+    gemm_blocked_rows(block_size, alpha, lhs, rhs, result->data, 0, N);
+    return HPCKERN_OK;
+}
+
+// Every task owns a band of result rows and updates it in place, so there is
+// no per-thread N x N buffer and no reduction afterwards.
+static void gemm_threaded_task(void *arg, size_t task)
+{
+    const gemm_task_t *t = (const gemm_task_t *)arg;
+    const size_t N = t->lhs->size;
+    const size_t row_start = MIN(task * t->rows_per_task, N);
+    const size_t row_end = MIN(row_start + t->rows_per_task, N);
+
+    HPCKERN_TRACE_BEGIN("gemm rows", row_start);
+    hpckern_matrix_scale_rows(t->beta, t->result->data, N, row_start, row_end);
+    gemm_blocked_rows(t->block_size, t->alpha, t->lhs, t->rhs, t->result->data, row_start, row_end);
+    HPCKERN_TRACE_END("gemm rows");
+}
+
+hpckern_status_t hpckern_matrix_gemm_threaded(hpckern_context_t *ctx, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    gemm_task_t task = {
+        .block_size = block_size,
+        .alpha = alpha,
+        .beta = beta,
+        .lhs = lhs,
+        .rhs = rhs,
+        .result = result,
+        .rows_per_task = (lhs->size + num_threads - 1) / num_threads,
+    };
+
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result) && block_size > 0);
+    hpckern_parallel_for(ctx, num_threads, gemm_threaded_task, &task);
+    return HPCKERN_OK;
+}
+
+// Blocked i-j-k multiplication: each (bi, bj, bk) block adds its partial dot
+// products to C(i, j).
+hpckern_status_t hpckern_matrix_gemm_block(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result) && block_size > 0);
+
+    const size_t N = lhs->size;
+
+    hpckern_matrix_scale_rows(beta, result->data, N, 0, N);
+
+    for (size_t bi = 0; bi < N; bi += block_size)
+    {
+        for (size_t bj = 0; bj < N; bj += block_size)
+        {
+            for (size_t bk = 0; bk < N; bk += block_size)
+            {
+                const size_t i_end = MIN(bi + block_size, N);
+                const size_t j_end = MIN(bj + block_size, N);
+                const size_t k_end = MIN(bk + block_size, N);
+
+                for (size_t i = bi; i < i_end; i++)
+                {
+                    for (size_t j = bj; j < j_end; j++)
+                    {
+                        register double sum = 0;
+                        for (size_t k = bk; k < k_end; k++)
+                        {
+                            sum += lhs->data[i * N + k] * rhs->data[k * N + j];
+                        }
+                        result->data[i * N + j] += alpha * sum;
+                    }
+                }
+            }
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_gemm_cblas(bool trans_lhs, bool trans_rhs, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result));
+
+    const size_t N = lhs->size;
+
+    cblas_dgemm(
+        CblasRowMajor,
+        trans_lhs ? CblasTrans : CblasNoTrans,
+        trans_rhs ? CblasTrans : CblasNoTrans,
+        N,
+        N,
+        N,
+        alpha,
+        lhs->data,
+        N,
+        rhs->data,
+        N,
+        beta,
+        result->data,
+        N);
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_mult_cblas(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, hpckern_matrix_t *result)
+{
+    return hpckern_matrix_gemm_cblas(false, false, 1.0, lhs, rhs, 0.0, result);
+}
+
+// One cblas_dgemm per block; block (r, c) of op(X) is block (c, r) of the
+// stored X when X is transposed.
+hpckern_status_t hpckern_matrix_gemm_blas_block(size_t block_size, bool trans_lhs, bool trans_rhs, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result) && block_size > 0);
+
+    const size_t N = lhs->size;
+
+    hpckern_matrix_scale_rows(beta, result->data, N, 0, N);
+
+    for (size_t bi = 0; bi < N; bi += block_size)
+    {
+        for (size_t bj = 0; bj < N; bj += block_size)
+        {
+            for (size_t bk = 0; bk < N; bk += block_size)
+            {
+                const size_t blk_rows = MIN(block_size, N - bi);
+                const size_t blk_cols = MIN(block_size, N - bj);
+                const size_t blk_inner = MIN(block_size, N - bk);
+
+                cblas_dgemm(
+                    CblasRowMajor,
+                    trans_lhs ? CblasTrans : CblasNoTrans,
+                    trans_rhs ? CblasTrans : CblasNoTrans,
+                    blk_rows,
+                    blk_cols,
+                    blk_inner,
+                    alpha,
+                    trans_lhs ? &lhs->data[bk * N + bi] : &lhs->data[bi * N + bk],
+                    N,
+                    trans_rhs ? &rhs->data[bj * N + bk] : &rhs->data[bk * N + bj],
+                    N,
+                    1.0,
+                    &result->data[bi * N + bj],
+                    N);
+            }
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+// Unit-stride dot product with four independent partial sums.
+static double vector_dot(const double *lhs, const double *rhs, size_t len)
+{
+    register double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+    register const size_t limit = len - (len % 4);
+    register size_t k;
+
+    for (k = 0; k < limit; k += 4)
+    {
+        sum0 += lhs[k] * rhs[k];
+        sum1 += lhs[k + 1] * rhs[k + 1];
+        sum2 += lhs[k + 2] * rhs[k + 2];
+        sum3 += lhs[k + 3] * rhs[k + 3];
+    }
+
+    for (; k < len; k++)
+    {
+        sum0 += lhs[k] * rhs[k];
+    }
+
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+// Row j of `rhs_t` is column j of B, so C[i][j] is a dot product of two
+// contiguous rows instead of a walk down a column with stride N.
+hpckern_status_t hpckern_matrix_gemm_naive_bt(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs_t, result));
+
+    const size_t N = lhs->size;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = 0; j < N; j++)
+        {
+            const double sum = vector_dot(&lhs->data[i * N], &rhs_t->data[j * N], N);
+            result->data[i * N + j] = alpha * sum + (beta == 0.0 ? 0.0 : beta * result->data[i * N + j]);
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+// C[row_start .. row_end) += alpha * A * B for B given as B^T, blocked so
+// that a block_size strip of A rows and of B^T rows stays in cache.
+static void gemm_bt_rows(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double *result, size_t row_start, size_t row_end)
+{
+    const size_t N = lhs->size;
+
+    for (size_t bi = row_start; bi < row_end; bi += block_size)
+    {
+        for (size_t bj = 0; bj < N; bj += block_size)
+        {
+            HPCKERN_TRACE_BEGIN("gemm tile", bi / block_size * ((N + block_size - 1) / block_size) + bj / block_size);
+            for (size_t bk = 0; bk < N; bk += block_size)
+            {
+                const size_t i_end = MIN(bi + block_size, row_end);
+                const size_t j_end = MIN(bj + block_size, N);
+                const size_t k_len = MIN(block_size, N - bk);
+
+                for (size_t i = bi; i < i_end; i++)
+                {
+                    register const double *lhs_row = &lhs->data[i * N + bk];
+                    register double *result_row = &result[i * N];
+
+                    for (size_t j = bj; j < j_end; j++)
+                    {
+                        result_row[j] += alpha * vector_dot(lhs_row, &rhs_t->data[j * N + bk], k_len);
+                    }
+                }
+            }
+            HPCKERN_TRACE_END("gemm tile");
+        }
+    }
+}
+
+hpckern_status_t hpckern_matrix_gemm_serial_bt(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs_t, result) && block_size > 0);
+
+    const size_t N = lhs->size;
+
+    hpckern_matrix_scale_rows(beta, result->data, N, 0, N);
+    gemm_bt_rows(block_size, alpha, lhs, rhs_t, result->data, 0, N);
+    return HPCKERN_OK;
+}
+
+static void gemm_threaded_bt_task(void *arg, size_t task)
+{
+    const gemm_task_t *t = (const gemm_task_t *)arg;
+    const size_t N = t->lhs->size;
+    const size_t row_start = MIN(task * t->rows_per_task, N);
+    const size_t row_end = MIN(row_start + t->rows_per_task, N);
+
+    HPCKERN_TRACE_BEGIN("gemm rows", row_start);
+    hpckern_matrix_scale_rows(t->beta, t->result->data, N, row_start, row_end);
+    gemm_bt_rows(t->block_size, t->alpha, t->lhs, t->rhs, t->result->data, row_start, row_end);
+    HPCKERN_TRACE_END("gemm rows");
+}
+
+hpckern_status_t hpckern_matrix_gemm_threaded_bt(hpckern_context_t *ctx, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double beta, hpckern_matrix_t *result)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    gemm_task_t task = {
+        .block_size = block_size,
+        .alpha = alpha,
+        .beta = beta,
+        .lhs = lhs,
+        .rhs = rhs_t,
+        .result = result,
+        .rows_per_task = (lhs->size + num_threads - 1) / num_threads,
+    };
+
+    CHECK_ARGUMENT(dense_operands(lhs, rhs_t, result) && block_size > 0);
+    hpckern_parallel_for(ctx, num_threads, gemm_threaded_bt_task, &task);
+    return HPCKERN_OK;
+}
+
+void hpckern_matrix_gemm_leaf(size_t m, size_t n, size_t p, double alpha, const double *A, size_t lda, const double *B, size_t ldb, double *C, size_t ldc)
+{
+    for (size_t k = 0; k < p; k++)
+    {
+        for (size_t i = 0; i < m; i++)
+        {
+            register const double lhs_data = alpha * A[i * lda + k];
+            register const double *rhs_row = &B[k * ldb];
+            register double *result_row = &C[i * ldc];
+            register const size_t limit = n - (n % 4);
+            register size_t j;
+
+            for (j = 0; j < limit; j += 4)
+            {
+                result_row[j] += lhs_data * rhs_row[j];
+                result_row[j + 1] += lhs_data * rhs_row[j + 1];
+                result_row[j + 2] += lhs_data * rhs_row[j + 2];
+                result_row[j + 3] += lhs_data * rhs_row[j + 3];
+            }
+
+            for (; j < n; j++)
+            {
+                result_row[j] += lhs_data * rhs_row[j];
+            }
+        }
+    }
+}
+
+// Cache-oblivious C += alpha * A * B: halve the largest of the three
+// dimensions until the sub-problem is small. Every level of the recursion is
+// a working set that fits some cache level, so no block size needs tuning,
+// and any N works.
+static void gemm_recursive_block(size_t m, size_t n, size_t p, double alpha, const double *A, size_t lda, const double *B, size_t ldb, double *C, size_t ldc)
+{
+    if (m <= HPCKERN_RECURSIVE_LEAF_SIZE && n <= HPCKERN_RECURSIVE_LEAF_SIZE && p <= HPCKERN_RECURSIVE_LEAF_SIZE)
+    {
+        hpckern_matrix_gemm_leaf(m, n, p, alpha, A, lda, B, ldb, C, ldc);
+    }
+    else if (m >= n && m >= p)
+    {
+        const size_t half = m / 2;
+        gemm_recursive_block(half, n, p, alpha, A, lda, B, ldb, C, ldc);
+        gemm_recursive_block(m - half, n, p, alpha, A + half * lda, lda, B, ldb, C + half * ldc, ldc);
+    }
+    else if (n >= p)
+    {
+        const size_t half = n / 2;
+        gemm_recursive_block(m, half, p, alpha, A, lda, B, ldb, C, ldc);
+        gemm_recursive_block(m, n - half, p, alpha, A, lda, B + half, ldb, C + half, ldc);
+    }
+    else
+    {
+        const size_t half = p / 2;
+        gemm_recursive_block(m, n, half, alpha, A, lda, B, ldb, C, ldc);
+        gemm_recursive_block(m, n, p - half, alpha, A + half, lda, B + half * ldb, ldb, C, ldc);
+    }
+}
+
+hpckern_status_t hpckern_matrix_gemm_recursive(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result));
+
+    const size_t N = lhs->size;
+
+    hpckern_matrix_scale_rows(beta, result->data, N, 0, N);
+    gemm_recursive_block(N, N, N, alpha, lhs->data, N, rhs->data, N, result->data, N);
+    return HPCKERN_OK;
+}
+
+// Interleave the bits of the tile coordinates: row bits take the odd
+// positions, so quadrants are laid out in the order 00, 01, 10, 11.
+static size_t morton_index(size_t tile_row, size_t tile_col)
+{
+    size_t index = 0;
+    for (size_t bit = 0; bit < sizeof(size_t) * 4; bit++)
+    {
+        index |= ((tile_col >> bit) & 1) << (2 * bit);
+        index |= ((tile_row >> bit) & 1) << (2 * bit + 1);
+    }
+    return index;
+}
+
+// Copy a row-major N x N matrix into (or out of) Z-order storage made of
+// tile x tile row-major tiles on a grid x grid tile grid. Padding beyond N
+// is zero, so it does not change the product.
+static void morton_convert(size_t N, size_t tile, size_t grid, double *row_major, double *morton, bool to_morton)
+{
+    for (size_t ti = 0; ti < grid; ti++)
+    {
+        for (size_t tj = 0; tj < grid; tj++)
+        {
+            double *tile_data = &morton[morton_index(ti, tj) * tile * tile];
+            for (size_t i = 0; i < tile; i++)
+            {
+                const size_t row = ti * tile + i;
+                for (size_t j = 0; j < tile; j++)
+                {
+                    const size_t col = tj * tile + j;
+                    if (to_morton)
+                    {
+                        tile_data[i * tile + j] = row < N && col < N ? row_major[row * N + col] : 0.0;
+                    }
+                    else if (row < N && col < N)
+                    {
+                        row_major[row * N + col] = tile_data[i * tile + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// C += alpha * A * B on Z-order operands of `tiles` x `tiles` tiles. Each
+// quadrant is contiguous, so every recursion level touches one dense range.
+static void gemm_morton_block(size_t tiles, size_t tile, double alpha, const double *A, const double *B, double *C)
+{
+    if (tiles == 1)
+    {
+        hpckern_matrix_gemm_leaf(tile, tile, tile, alpha, A, tile, B, tile, C, tile);
+        return;
+    }
+
+    const size_t quadrant = (tiles / 2) * (tiles / 2) * tile * tile;
+    const double *A00 = A, *A01 = A + quadrant, *A10 = A + 2 * quadrant, *A11 = A + 3 * quadrant;
+    const double *B00 = B, *B01 = B + quadrant, *B10 = B + 2 * quadrant, *B11 = B + 3 * quadrant;
+    double *C00 = C, *C01 = C + quadrant, *C10 = C + 2 * quadrant, *C11 = C + 3 * quadrant;
+
+    gemm_morton_block(tiles / 2, tile, alpha, A00, B00, C00);
+    gemm_morton_block(tiles / 2, tile, alpha, A01, B10, C00);
+    gemm_morton_block(tiles / 2, tile, alpha, A00, B01, C01);
+    gemm_morton_block(tiles / 2, tile, alpha, A01, B11, C01);
+    gemm_morton_block(tiles / 2, tile, alpha, A10, B00, C10);
+    gemm_morton_block(tiles / 2, tile, alpha, A11, B10, C10);
+    gemm_morton_block(tiles / 2, tile, alpha, A10, B01, C11);
+    gemm_morton_block(tiles / 2, tile, alpha, A11, B11, C11);
+}
+
+// Recursive multiplication over Morton-ordered copies of the operands, kept
+// in the context arena. The tile grid is the smallest power of two that keeps
+// tiles no larger than HPCKERN_RECURSIVE_LEAF_SIZE, and the tile is shrunk to
+// fit N, so padding stays below one row of tiles.
+hpckern_status_t hpckern_matrix_gemm_recursive_morton(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result));
+
+    const size_t N = lhs->size;
+    const size_t mark = hpckern_arena_mark(ctx);
+    size_t grid = 1;
+    size_t tile, padded_len;
+    double *A_morton, *B_morton, *C_morton;
+
+    while ((N + grid - 1) / grid > HPCKERN_RECURSIVE_LEAF_SIZE)
+    {
+        grid *= 2;
+    }
+    tile = (N + grid - 1) / grid;
+    padded_len = grid * grid * tile * tile;
+
+    A_morton = (double *)hpckern_arena_alloc(ctx, padded_len * sizeof(double));
+    B_morton = (double *)hpckern_arena_alloc(ctx, padded_len * sizeof(double));
+    C_morton = (double *)hpckern_arena_alloc(ctx, padded_len * sizeof(double));
+    if (A_morton == NULL || B_morton == NULL || C_morton == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    morton_convert(N, tile, grid, lhs->data, A_morton, true);
+    morton_convert(N, tile, grid, rhs->data, B_morton, true);
+    if (beta == 0.0)
+    {
+        memset(C_morton, 0, padded_len * sizeof(double));
+    }
+    else
+    {
+        morton_convert(N, tile, grid, result->data, C_morton, true);
+        hpckern_matrix_scale_rows(beta, C_morton, padded_len, 0, 1);
+    }
+
+    gemm_morton_block(grid, tile, alpha, A_morton, B_morton, C_morton);
+
+    morton_convert(N, tile, grid, result->data, C_morton, false);
+
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
+
+static bool tiled_operands(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, const hpckern_matrix_t *result)
+{
+    return lhs->layout == HPCKERN_LAYOUT_TILED && rhs->layout == HPCKERN_LAYOUT_TILED && result->layout == HPCKERN_LAYOUT_TILED &&
+           same_size(lhs, rhs) && same_size(lhs, result) &&
+           lhs->tile_size == rhs->tile_size && lhs->tile_size == result->tile_size;
+}
+
+// C(ti, :) = alpha * sum_k A(ti, k) * B(k, :) + beta * C(ti, :) for tile
+// rows [tile_row_start, tile_row_end). Padding is zero in every operand, so
+// full-tile products are exact and the padding of C stays zero.
+static void gemm_tiled_rows(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result, size_t tile_row_start, size_t tile_row_end)
+{
+    const size_t b = lhs->tile_size;
+    const size_t T = hpckern_matrix_num_tiles(lhs->size, b);
+
+    for (size_t ti = tile_row_start; ti < tile_row_end; ti++)
+    {
+        for (size_t tj = 0; tj < T; tj++)
+        {
+            double *result_tile = hpckern_matrix_tile(result, ti, tj);
+            HPCKERN_TRACE_BEGIN("gemm tile", ti * T + tj);
+            hpckern_matrix_scale_rows(beta, result_tile, b, 0, b);
+            for (size_t tk = 0; tk < T; tk++)
+            {
+                hpckern_matrix_gemm_leaf(
+                    b, b, b, alpha,
+                    hpckern_matrix_tile((hpckern_matrix_t *)lhs, ti, tk), b,
+                    hpckern_matrix_tile((hpckern_matrix_t *)rhs, tk, tj), b,
+                    result_tile, b);
+            }
+            HPCKERN_TRACE_END("gemm tile");
+        }
+    }
+}
+
+hpckern_status_t hpckern_matrix_gemm_tiled(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(tiled_operands(lhs, rhs, result));
+    gemm_tiled_rows(alpha, lhs, rhs, beta, result, 0, hpckern_matrix_num_tiles(lhs->size, lhs->tile_size));
+    return HPCKERN_OK;
+}
+
+static void gemm_tiled_task(void *arg, size_t task)
+{
+    const gemm_task_t *t = (const gemm_task_t *)arg;
+    const size_t T = hpckern_matrix_num_tiles(t->lhs->size, t->lhs->tile_size);
+    const size_t tile_row_start = MIN(task * t->rows_per_task, T);
+    const size_t tile_row_end = MIN(tile_row_start + t->rows_per_task, T);
+
+    HPCKERN_TRACE_BEGIN("gemm tile rows", tile_row_start);
+    gemm_tiled_rows(t->alpha, t->lhs, t->rhs, t->beta, t->result, tile_row_start, tile_row_end);
+    HPCKERN_TRACE_END("gemm tile rows");
+}
+
+// Tasks own disjoint tile rows of C and write them in place.
+hpckern_status_t hpckern_matrix_gemm_tiled_threaded(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    const size_t T = hpckern_matrix_num_tiles(lhs->size, lhs->tile_size);
+    gemm_task_t task = {
+        .alpha = alpha,
+        .beta = beta,
+        .lhs = lhs,
+        .rhs = rhs,
+        .result = result,
+        .rows_per_task = (T + num_threads - 1) / num_threads,
+    };
+
+    CHECK_ARGUMENT(tiled_operands(lhs, rhs, result));
+    hpckern_parallel_for(ctx, num_threads, gemm_tiled_task, &task);
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_gemm(hpckern_context_t *ctx, hpckern_variant_t variant, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    if (lhs->layout == HPCKERN_LAYOUT_CSR)
+    {
+        return hpckern_matrix_spmm(ctx, alpha, lhs, rhs, beta, result);
+    }
+    if (lhs->layout == HPCKERN_LAYOUT_BANDED)
+    {
+        return hpckern_matrix_gbmm(ctx, alpha, lhs, rhs, beta, result);
+    }
+
+    if (lhs->layout == HPCKERN_LAYOUT_TILED || rhs->layout == HPCKERN_LAYOUT_TILED || result->layout == HPCKERN_LAYOUT_TILED)
+    {
+        if (variant == HPCKERN_THREADED)
+        {
+            return hpckern_matrix_gemm_tiled_threaded(ctx, alpha, lhs, rhs, beta, result);
+        }
+        return hpckern_matrix_gemm_tiled(alpha, lhs, rhs, beta, result);
+    }
+
+    switch (variant)
+    {
+    case HPCKERN_NAIVE:
+        return hpckern_matrix_gemm_naive(alpha, lhs, rhs, beta, result);
+    case HPCKERN_SERIAL:
+        return hpckern_matrix_gemm_serial(block_size, alpha, lhs, rhs, beta, result);
+    case HPCKERN_THREADED:
+        return hpckern_matrix_gemm_threaded(ctx, block_size, alpha, lhs, rhs, beta, result);
+    case HPCKERN_CBLAS:
+        return hpckern_matrix_gemm_cblas(false, false, alpha, lhs, rhs, beta, result);
+    case HPCKERN_BLOCK:
+        return hpckern_matrix_gemm_block(block_size, alpha, lhs, rhs, beta, result);
+    case HPCKERN_BLAS_BLOCK:
+        return hpckern_matrix_gemm_blas_block(block_size, false, false, alpha, lhs, rhs, beta, result);
+    case HPCKERN_RECURSIVE:
+        return hpckern_matrix_gemm_recursive(alpha, lhs, rhs, beta, result);
+    case HPCKERN_RECURSIVE_MORTON:
+        return hpckern_matrix_gemm_recursive_morton(ctx, alpha, lhs, rhs, beta, result);
+    default:
+        return HPCKERN_ERROR_INVALID_ARGUMENT;
+    }
+}
@@ -0,0 +1,138 @@
+#include "hpckern_internal.h"
+
+#include <string.h>
+
+/* The kernels use the vector extensions of GCC and Clang; other compilers
+ * get the generic kernel for every block size. So do unoptimized builds,
+ * where the tile helpers are not inlined and run slower than it. */
+#if (!defined(__GNUC__) || !defined(__OPTIMIZE__)) && !defined(HPCKERN_GENERIC_KERNELS)
+#define HPCKERN_GENERIC_KERNELS
+#endif
+
+#ifndef HPCKERN_GENERIC_KERNELS
+/* Register tile of the specialized kernels: GEMM_MR rows by GEMM_NR columns
+ * of C stay in vector accumulators for a whole block of k, two vectors per
+ * row, which keeps the tile within the sixteen SSE or AVX registers. */
+#define GEMM_MR 4
+#if defined(__AVX__)
+#define GEMM_VECTOR_BYTES 32
+#else
+#define GEMM_VECTOR_BYTES 16
+#endif
+#define GEMM_VECTOR_LEN (GEMM_VECTOR_BYTES / sizeof(double))
+#define GEMM_NR (2 * GEMM_VECTOR_LEN)
+
+typedef double gemm_vector_t __attribute__((vector_size(GEMM_VECTOR_BYTES)));
+
+static inline gemm_vector_t gemm_vector_load(const double *src)
+{
+    gemm_vector_t v;
+    memcpy(&v, src, sizeof(v));
+    return v;
+}
+
+// C[0 .. MR) x [0 .. NR) += alpha * A B over K columns of A. Every entry is
+// updated in the same k order and with the same alpha * a products as in
+// the generic kernel, so built with the same flags the results match it bit
+// for bit. K is a constant where the block-size kernels inline this, and
+// the explicit vectors leave the compiler no reduction over k to vectorize
+// instead of the columns.
+static inline void gemm_register_tile(size_t K, double alpha, const double *A, const double *B, double *C, size_t N)
+{
+    gemm_vector_t acc[GEMM_MR][2];
+
+    for (size_t r = 0; r < GEMM_MR; r++)
+    {
+        acc[r][0] = gemm_vector_load(&C[r * N]);
+        acc[r][1] = gemm_vector_load(&C[r * N + GEMM_VECTOR_LEN]);
+    }
+
+    for (size_t k = 0; k < K; k++)
+    {
+        const gemm_vector_t b0 = gemm_vector_load(&B[k * N]);
+        const gemm_vector_t b1 = gemm_vector_load(&B[k * N + GEMM_VECTOR_LEN]);
+        for (size_t r = 0; r < GEMM_MR; r++)
+        {
+            const double lhs_data = alpha * A[r * N + k];
+            acc[r][0] += lhs_data * b0;
+            acc[r][1] += lhs_data * b1;
+        }
+    }
+
+    for (size_t r = 0; r < GEMM_MR; r++)
+    {
+        memcpy(&C[r * N], &acc[r][0], sizeof(gemm_vector_t));
+        memcpy(&C[r * N + GEMM_VECTOR_LEN], &acc[r][1], sizeof(gemm_vector_t));
+    }
+}
+
+// Blocked C[row_start .. row_end) += alpha * A * B with a block size fixed
+// at compile time. Whole blocks run on register tiles with constant trip
+// counts; blocks cut short by row_end or N fall back to
+// hpckern_matrix_gemm_leaf.
+#define DEFINE_GEMM_FIXED_ROWS(BS)                                                                                                          \
+    static void gemm_fixed_rows_##BS(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double *result, size_t row_start, size_t row_end) \
+    {                                                                                                                                       \
+        const size_t N = lhs->size;                                                                                                         \
+                                                                                                                                            \
+        for (size_t bi = row_start; bi < row_end; bi += BS)                                                                                 \
+        {                                                                                                                                   \
+            for (size_t bj = 0; bj < N; bj += BS)                                                                                           \
+            {                                                                                                                               \
+                HPCKERN_TRACE_BEGIN("gemm tile", bi / BS * ((N + BS - 1) / BS) + bj / BS);                                                  \
+                for (size_t bk = 0; bk < N; bk += BS)                                                                                       \
+                {                                                                                                                           \
+                    const double *A = &lhs->data[bi * N + bk];                                                                              \
+                    const double *B = &rhs->data[bk * N + bj];                                                                              \
+                    double *C = &result[bi * N + bj];                                                                                       \
+                                                                                                                                            \
+                    if (bi + BS > row_end || bj + BS > N || bk + BS > N)                                                                    \
+                    {                                                                                                                       \
+                        hpckern_matrix_gemm_leaf(MIN(BS, row_end - bi), MIN(BS, N - bj), MIN(BS, N - bk), alpha, A, N, B, N, C, N);         \
+                        continue;                                                                                                           \
+                    }                                                                                                                       \
+                    for (size_t i = 0; i < BS; i += GEMM_MR)                                                                                \
+                    {                                                                                                                       \
+                        for (size_t j = 0; j < BS; j += GEMM_NR)                                                                            \
+                        {                                                                                                                   \
+                            gemm_register_tile(BS, alpha, &A[i * N], &B[j], &C[i * N + j], N);                                              \
+                        }                                                                                                                   \
+                    }                                                                                                                       \
+                }                                                                                                                           \
+                HPCKERN_TRACE_END("gemm tile");                                                                                             \
+            }                                                                                                                               \
+        }                                                                                                                                   \
+    }
+
+DEFINE_GEMM_FIXED_ROWS(32)
+DEFINE_GEMM_FIXED_ROWS(64)
+DEFINE_GEMM_FIXED_ROWS(128)
+DEFINE_GEMM_FIXED_ROWS(256)
+#endif
+
+hpckern_gemm_rows_fn_t hpckern_gemm_fixed_rows(size_t block_size)
+{
+#ifdef HPCKERN_GENERIC_KERNELS
+    (void)block_size;
+    return NULL;
+#else
+    switch (block_size)
+    {
+    case 32:
+        return gemm_fixed_rows_32;
+    case 64:
+        return gemm_fixed_rows_64;
+    case 128:
+        return gemm_fixed_rows_128;
+    case 256:
+        return gemm_fixed_rows_256;
+    default:
+        return NULL;
+    }
+#endif
+}
+
+bool hpckern_gemm_is_specialized(size_t block_size)
+{
+    return hpckern_gemm_fixed_rows(block_size) != NULL;
+}
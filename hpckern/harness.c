@@ -0,0 +1,337 @@
+#include "hpckern_internal.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Initial sample capacity; the buffer doubles as the harness keeps going. */
+#define HARNESS_MIN_CAPACITY 64
+
+struct hpckern_harness_t
+{
+    hpckern_harness_config_t config;
+    size_t num_warmup;
+    size_t num_samples;
+    size_t capacity;
+    double *samples;
+    double elapsed;
+
+    char *flush_buffer;
+    volatile char flush_sink;
+};
+
+/* Two-sided 95% quantiles of Student's t for 1 .. 30 degrees of freedom. */
+static const double T_QUANTILES_95[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static double t_quantile_95(size_t degrees_of_freedom)
+{
+    if (degrees_of_freedom == 0)
+    {
+        return INFINITY;
+    }
+    return degrees_of_freedom <= 30 ? T_QUANTILES_95[degrees_of_freedom - 1] : 1.96;
+}
+
+static int compare_doubles(const void *lhs, const void *rhs)
+{
+    const double a = *(const double *)lhs;
+    const double b = *(const double *)rhs;
+    return (a > b) - (a < b);
+}
+
+// Nearest-rank percentile of sorted values.
+static double percentile(const double *sorted, size_t n, double p)
+{
+    const size_t rank = (size_t)ceil(p * n);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static double median(const double *sorted, size_t n)
+{
+    return n % 2 == 1 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+}
+
+void hpckern_harness_config_default(hpckern_harness_config_t *config)
+{
+    memset(config, 0, sizeof(hpckern_harness_config_t));
+    config->min_iterations = 1;
+    config->max_iterations = HPCKERN_HARNESS_MAX_ITERATIONS;
+    config->outlier_k = HPCKERN_HARNESS_OUTLIER_K;
+    config->flush_bytes = HPCKERN_HARNESS_FLUSH_BYTES;
+}
+
+hpckern_harness_t *hpckern_harness_create(const hpckern_harness_config_t *config)
+{
+    hpckern_harness_t *harness;
+
+    if (config->min_iterations < 1 || (harness = (hpckern_harness_t *)calloc(1, sizeof(hpckern_harness_t))) == NULL)
+    {
+        return NULL;
+    }
+
+    harness->config = *config;
+    harness->config.max_iterations = MAX(config->max_iterations, config->min_iterations);
+    harness->capacity = HARNESS_MIN_CAPACITY;
+    harness->samples = (double *)calloc(harness->capacity, sizeof(double));
+    if (config->flush_cache)
+    {
+        harness->flush_buffer = (char *)calloc(MAX(config->flush_bytes, (size_t)1), 1);
+    }
+    if (harness->samples == NULL || (config->flush_cache && harness->flush_buffer == NULL))
+    {
+        hpckern_harness_destroy(&harness);
+    }
+    return harness;
+}
+
+void hpckern_harness_destroy(hpckern_harness_t **harness)
+{
+    free((*harness)->samples);
+    free((*harness)->flush_buffer);
+    free(*harness);
+    *harness = NULL;
+}
+
+// The stopping rule judges the same outlier-filtered samples the stats
+// report, so a run that stops as converged also reports converged.
+static bool harness_wants_more(const hpckern_harness_t *harness)
+{
+    const hpckern_harness_config_t *config = &harness->config;
+    const size_t n = harness->num_samples;
+
+    if (harness->num_warmup < config->warmup_iterations || n < config->min_iterations)
+    {
+        return true;
+    }
+    if (n >= config->max_iterations || (config->max_time > 0.0 && harness->elapsed >= config->max_time))
+    {
+        return false;
+    }
+    if (config->min_time > 0.0 && harness->elapsed < config->min_time)
+    {
+        return true;
+    }
+    if (config->target_rel_ci > 0.0)
+    {
+        hpckern_harness_stats_t stats;
+        return hpckern_harness_stats(harness, &stats) == HPCKERN_OK && !stats.converged;
+    }
+    return false;
+}
+
+// Touching a buffer larger than the last-level cache evicts the operands, so
+// the next iteration starts cold. It happens before the caller starts its
+// clock.
+bool hpckern_harness_next(hpckern_harness_t *harness)
+{
+    if (!harness_wants_more(harness))
+    {
+        return false;
+    }
+
+    if (harness->flush_buffer != NULL)
+    {
+        char sink = 0;
+        memset(harness->flush_buffer, (int)(harness->num_samples & 0xff), harness->config.flush_bytes);
+        for (size_t i = 0; i < harness->config.flush_bytes; i += CACHE_LINE_SIZE)
+        {
+            sink ^= harness->flush_buffer[i];
+        }
+        harness->flush_sink = sink;
+    }
+    return true;
+}
+
+bool hpckern_harness_is_warmup(const hpckern_harness_t *harness)
+{
+    return harness->num_warmup < harness->config.warmup_iterations;
+}
+
+// A sample that does not fit is dropped; the earlier ones are kept.
+hpckern_status_t hpckern_harness_record(hpckern_harness_t *harness, double seconds)
+{
+    if (hpckern_harness_is_warmup(harness))
+    {
+        harness->num_warmup++;
+        return HPCKERN_OK;
+    }
+
+    if (harness->num_samples == harness->capacity)
+    {
+        double *samples = (double *)realloc(harness->samples, 2 * harness->capacity * sizeof(double));
+        if (samples == NULL)
+        {
+            return HPCKERN_ERROR_OUT_OF_MEMORY;
+        }
+        harness->samples = samples;
+        harness->capacity *= 2;
+    }
+    harness->samples[harness->num_samples++] = seconds;
+    harness->elapsed += seconds;
+    return HPCKERN_OK;
+}
+
+size_t hpckern_harness_num_samples(const hpckern_harness_t *harness)
+{
+    return harness->num_samples;
+}
+
+const double *hpckern_harness_samples(const hpckern_harness_t *harness)
+{
+    return harness->samples;
+}
+
+hpckern_status_t hpckern_harness_stats(const hpckern_harness_t *harness, hpckern_harness_stats_t *stats)
+{
+    RETURN_IF_ERROR(hpckern_stats_compute(harness->samples, harness->num_samples, harness->config.outlier_k, harness->config.flops, stats));
+    stats->num_warmup = harness->num_warmup;
+    stats->converged = harness->config.target_rel_ci <= 0.0 ||
+                       (stats->num_samples >= 2 && stats->rel_ci95 <= harness->config.target_rel_ci);
+    return HPCKERN_OK;
+}
+
+// Samples further than outlier_k scaled median absolute deviations from the
+// median are dropped; 1.4826 MAD estimates the standard deviation of normal
+// data without being dragged along by the outliers themselves. Fewer than
+// two samples leave the confidence interval undefined, so it is infinite.
+hpckern_status_t hpckern_stats_compute(const double *samples, size_t num_samples, double outlier_k, double flops, hpckern_harness_stats_t *stats)
+{
+    double *sorted, *deviations;
+    size_t first = 0;
+    size_t last = num_samples;
+    size_t n;
+    double sum = 0.0;
+    double sum_squares = 0.0;
+
+    memset(stats, 0, sizeof(hpckern_harness_stats_t));
+    stats->converged = true;
+    if (num_samples == 0)
+    {
+        return HPCKERN_OK;
+    }
+
+    sorted = (double *)malloc(num_samples * sizeof(double));
+    deviations = (double *)malloc(num_samples * sizeof(double));
+    if (sorted == NULL || deviations == NULL)
+    {
+        free(sorted);
+        free(deviations);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    memcpy(sorted, samples, num_samples * sizeof(double));
+    qsort(sorted, num_samples, sizeof(double), compare_doubles);
+
+    if (outlier_k > 0.0 && num_samples >= 3)
+    {
+        const double center = median(sorted, num_samples);
+        double spread;
+
+        for (size_t i = 0; i < num_samples; i++)
+        {
+            deviations[i] = fabs(sorted[i] - center);
+        }
+        qsort(deviations, num_samples, sizeof(double), compare_doubles);
+        spread = outlier_k * 1.4826 * median(deviations, num_samples);
+
+        if (spread > 0.0)
+        {
+            while (first < last && sorted[first] < center - spread)
+            {
+                first++;
+            }
+            while (last > first && sorted[last - 1] > center + spread)
+            {
+                last--;
+            }
+        }
+    }
+
+    n = last - first;
+    for (size_t i = first; i < last; i++)
+    {
+        sum += sorted[i];
+    }
+    stats->mean = sum / n;
+    for (size_t i = first; i < last; i++)
+    {
+        sum_squares += (sorted[i] - stats->mean) * (sorted[i] - stats->mean);
+    }
+
+    stats->num_samples = n;
+    stats->num_outliers = num_samples - n;
+    stats->stddev = n > 1 ? sqrt(sum_squares / (n - 1)) : 0.0;
+    stats->min = sorted[first];
+    stats->max = sorted[last - 1];
+    stats->median = median(&sorted[first], n);
+    stats->p95 = percentile(&sorted[first], n, 0.95);
+    stats->p99 = percentile(&sorted[first], n, 0.99);
+    stats->ci95 = n > 1 ? t_quantile_95(n - 1) * stats->stddev / sqrt((double)n) : INFINITY;
+    stats->rel_ci95 = n > 1 && stats->mean > 0.0 ? stats->ci95 / stats->mean : INFINITY;
+    stats->gflops = flops > 0.0 && stats->median > 0.0 ? flops / stats->median * 1e-9 : 0.0;
+
+    free(sorted);
+    free(deviations);
+    return HPCKERN_OK;
+}
+
+// An undefined interval is written as null, which YAML and JSON both read.
+static void write_finite(FILE *file, int pad, const char *key, const char *format, double value, const char *end)
+{
+    fprintf(file, "%*s%s", pad, "", key);
+    if (isfinite(value))
+    {
+        fprintf(file, format, value);
+    }
+    else
+    {
+        fprintf(file, "null");
+    }
+    fprintf(file, "%s", end);
+}
+
+void hpckern_harness_write_yaml(FILE *file, size_t indent, const char *name, const hpckern_harness_stats_t *stats)
+{
+    const int pad = (int)indent;
+
+    fprintf(file, "%*s%s:\n", pad, "", name);
+    fprintf(file, "%*s  num_samples: %zu\n", pad, "", stats->num_samples);
+    fprintf(file, "%*s  num_warmup: %zu\n", pad, "", stats->num_warmup);
+    fprintf(file, "%*s  num_outliers: %zu\n", pad, "", stats->num_outliers);
+    fprintf(file, "%*s  mean_time: %.9f\n", pad, "", stats->mean);
+    fprintf(file, "%*s  median_time: %.9f\n", pad, "", stats->median);
+    fprintf(file, "%*s  stddev: %.9f\n", pad, "", stats->stddev);
+    fprintf(file, "%*s  min_time: %.9f\n", pad, "", stats->min);
+    fprintf(file, "%*s  max_time: %.9f\n", pad, "", stats->max);
+    fprintf(file, "%*s  p95_time: %.9f\n", pad, "", stats->p95);
+    fprintf(file, "%*s  p99_time: %.9f\n", pad, "", stats->p99);
+    write_finite(file, pad + 2, "ci95_half_width: ", "%.9f", stats->ci95, "\n");
+    write_finite(file, pad + 2, "relative_ci95: ", "%.6f", stats->rel_ci95, "\n");
+    fprintf(file, "%*s  converged: %s\n", pad, "", stats->converged ? "true" : "false");
+    fprintf(file, "%*s  gflops: %.3f\n", pad, "", stats->gflops);
+}
+
+void hpckern_harness_write_json(FILE *file, size_t indent, const char *name, const hpckern_harness_stats_t *stats)
+{
+    const int pad = (int)indent;
+
+    fprintf(file, "\"%s\": {\n", name);
+    fprintf(file, "%*s\"num_samples\": %zu,\n", pad, "", stats->num_samples);
+    fprintf(file, "%*s\"num_warmup\": %zu,\n", pad, "", stats->num_warmup);
+    fprintf(file, "%*s\"num_outliers\": %zu,\n", pad, "", stats->num_outliers);
+    fprintf(file, "%*s\"mean_time\": %.9f,\n", pad, "", stats->mean);
+    fprintf(file, "%*s\"median_time\": %.9f,\n", pad, "", stats->median);
+    fprintf(file, "%*s\"stddev\": %.9f,\n", pad, "", stats->stddev);
+    fprintf(file, "%*s\"min_time\": %.9f,\n", pad, "", stats->min);
+    fprintf(file, "%*s\"max_time\": %.9f,\n", pad, "", stats->max);
+    fprintf(file, "%*s\"p95_time\": %.9f,\n", pad, "", stats->p95);
+    fprintf(file, "%*s\"p99_time\": %.9f,\n", pad, "", stats->p99);
+    write_finite(file, pad, "\"ci95_half_width\": ", "%.9f", stats->ci95, ",\n");
+    write_finite(file, pad, "\"relative_ci95\": ", "%.6f", stats->rel_ci95, ",\n");
+    fprintf(file, "%*s\"converged\": %s,\n", pad, "", stats->converged ? "true" : "false");
+    fprintf(file, "%*s\"gflops\": %.3f\n", pad, "", stats->gflops);
+    fprintf(file, "%*s}", pad >= 2 ? pad - 2 : 0, "");
+}
@@ -0,0 +1,146 @@
+#include "hpckern_internal.h"
+
+#include <string.h>
+
+// The primes and the structure of XXH64: four lanes that each take every
+// fourth 8-byte word, so the multiplies of a stripe are independent and the
+// loop runs at close to memory bandwidth.
+#define HASH_PRIME_1 0x9E3779B185EBCA87ull
+#define HASH_PRIME_2 0xC2B2AE3D27D4EB4Full
+#define HASH_PRIME_3 0x165667B19E3779F9ull
+#define HASH_PRIME_4 0x85EBCA77C2B2AE63ull
+#define HASH_PRIME_5 0x27D4EB2F165667C5ull
+#define HASH_STRIPE_BYTES 32
+
+typedef struct hash_task_t
+{
+    const unsigned char *data;
+    size_t bytes;
+    uint64_t *segment_hashes;
+} hash_task_t;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+    acc += input * HASH_PRIME_2;
+    acc = rotl64(acc, 31);
+    return acc * HASH_PRIME_1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t lane)
+{
+    acc ^= hash_round(0, lane);
+    return acc * HASH_PRIME_1 + HASH_PRIME_4;
+}
+
+uint64_t hpckern_hash_bytes(const void *data, size_t bytes, uint64_t seed)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + bytes;
+    uint64_t h;
+
+    if (bytes >= HASH_STRIPE_BYTES)
+    {
+        const unsigned char *last_stripe = end - HASH_STRIPE_BYTES;
+        uint64_t v1 = seed + HASH_PRIME_1 + HASH_PRIME_2;
+        uint64_t v2 = seed + HASH_PRIME_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - HASH_PRIME_1;
+
+        do
+        {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+            p += HASH_STRIPE_BYTES;
+        } while (p <= last_stripe);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    }
+    else
+    {
+        h = seed + HASH_PRIME_5;
+    }
+
+    h += (uint64_t)bytes;
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)read32(p) * HASH_PRIME_1;
+        h = rotl64(h, 23) * HASH_PRIME_2 + HASH_PRIME_3;
+        p += 4;
+    }
+    for (; p < end; p++)
+    {
+        h ^= (uint64_t)*p * HASH_PRIME_5;
+        h = rotl64(h, 11) * HASH_PRIME_1;
+    }
+
+    h ^= h >> 33;
+    h *= HASH_PRIME_2;
+    h ^= h >> 29;
+    h *= HASH_PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static void hash_segment_task(void *arg, size_t task)
+{
+    const hash_task_t *t = (const hash_task_t *)arg;
+    const size_t start = task * HPCKERN_HASH_SEGMENT_BYTES;
+
+    t->segment_hashes[task] = hpckern_hash_bytes(t->data + start, MIN(HPCKERN_HASH_SEGMENT_BYTES, t->bytes - start), 0);
+}
+
+hpckern_status_t hpckern_matrix_hash(hpckern_context_t *ctx, const hpckern_matrix_t *mat, uint64_t *hash)
+{
+    const size_t bytes = mat->size * mat->size * sizeof(double);
+    const size_t num_segments = (bytes + HPCKERN_HASH_SEGMENT_BYTES - 1) / HPCKERN_HASH_SEGMENT_BYTES;
+    const size_t mark = hpckern_arena_mark(ctx);
+    hash_task_t task;
+
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+
+    task.data = (const unsigned char *)mat->data;
+    task.bytes = bytes;
+    task.segment_hashes = (uint64_t *)hpckern_arena_alloc(ctx, MAX(num_segments, 1) * sizeof(uint64_t));
+    if (task.segment_hashes == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+    hpckern_parallel_for(ctx, num_segments, hash_segment_task, &task);
+
+    // Seeded with the size, so matrices whose entries coincide as bytes but
+    // not as N x N arrays differ.
+    *hash = hpckern_hash_bytes(task.segment_hashes, num_segments * sizeof(uint64_t), (uint64_t)mat->size);
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
@@ -0,0 +1,689 @@
+#ifndef HPCKERN_H
+#define HPCKERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * libhpckern: dense matrix multiplication and norm kernels.
+ *
+ * Every multiplication computes result = alpha * lhs * rhs + beta * result
+ * with the semantics of cblas_dgemm: beta == 0 overwrites the result, so it
+ * does not need to be initialized. Matrices are square, N x N doubles.
+ *
+ * Threaded kernels run on the worker pool of an hpckern_context_t, and
+ * kernels that need scratch memory take it from the context arena. A context
+ * may be used by one caller thread at a time; create one per thread that
+ * calls into the library concurrently.
+ *
+ * Nothing in the library aborts. Functions that create an object return
+ * NULL when they fail; every other call that can fail returns an
+ * hpckern_status_t and leaves its outputs unspecified unless it is
+ * HPCKERN_OK. Invalid arguments, such as operands of different sizes, a
+ * layout a kernel does not take or a zero block size, give
+ * HPCKERN_ERROR_INVALID_ARGUMENT; failed allocations give
+ * HPCKERN_ERROR_OUT_OF_MEMORY.
+ */
+
+#define HPCKERN_VERSION_MAJOR 1
+#define HPCKERN_VERSION_MINOR 0
+
+#define HPCKERN_EPS 1e-9
+#define HPCKERN_RECURSIVE_LEAF_SIZE 32
+#define HPCKERN_TRANSPOSE_BLOCK_SIZE 32
+#define HPCKERN_POWER_MAX_ITERATIONS 100
+#define HPCKERN_POWER_TOLERANCE 1e-12
+#define HPCKERN_ESTIMATE_MAX_ITERATIONS 5
+
+/* hpckern_gemm_auto takes the CSR path at or below this density and the
+ * banded path when the band covers at most 1 / HPCKERN_BANDED_MIN_RATIO of
+ * the columns. */
+#define HPCKERN_SPARSE_MAX_DENSITY 0.10
+#define HPCKERN_BANDED_MIN_RATIO 8
+
+#define HPCKERN_HARNESS_MAX_ITERATIONS 1000
+#define HPCKERN_HARNESS_OUTLIER_K 3.0
+#define HPCKERN_HARNESS_FLUSH_BYTES ((size_t)64 << 20)
+
+/* hpckern_matrix_hash hashes segments of this many bytes in parallel. */
+#define HPCKERN_HASH_SEGMENT_BYTES ((size_t)256 << 10)
+
+/* Events kept per thread by the tracer; older ones are overwritten. */
+#define HPCKERN_TRACE_CAPACITY ((size_t)1 << 16)
+
+typedef enum hpckern_status_t
+{
+    HPCKERN_OK = 0,
+    HPCKERN_ERROR_INVALID_ARGUMENT,
+    HPCKERN_ERROR_OUT_OF_MEMORY,
+    HPCKERN_NUM_STATUSES
+} hpckern_status_t;
+
+typedef enum hpckern_matrix_layout_t
+{
+    HPCKERN_LAYOUT_ROW_MAJOR = 0,
+    HPCKERN_LAYOUT_TILED,
+    HPCKERN_LAYOUT_CSR,
+    HPCKERN_LAYOUT_BANDED
+} hpckern_matrix_layout_t;
+
+/*
+ * N x N matrix of doubles. `data` is
+ *  - HPCKERN_LAYOUT_ROW_MAJOR: N * N entries, row-major.
+ *  - HPCKERN_LAYOUT_TILED: padded to whole tile_size x tile_size tiles that
+ *    are stored one after another in row-major tile order, each tile
+ *    row-major.
+ *  - HPCKERN_LAYOUT_CSR: the nnz nonzeros row by row; row i holds entries
+ *    [row_ptr[i], row_ptr[i + 1]) with their columns in col_idx.
+ *  - HPCKERN_LAYOUT_BANDED: lower_bandwidth + 1 + upper_bandwidth entries per
+ *    row; entry (i, j) sits at data[i * width + j - i + lower_bandwidth], and
+ *    slots outside the matrix are zero.
+ */
+typedef struct hpckern_matrix_t
+{
+    size_t size;
+    double *data;
+    hpckern_matrix_layout_t layout;
+    size_t tile_size;
+    size_t nnz;
+    size_t *row_ptr;
+    size_t *col_idx;
+    size_t lower_bandwidth;
+    size_t upper_bandwidth;
+} hpckern_matrix_t;
+
+/* Sparsity of a row-major matrix, see hpckern_matrix_structure_scan. */
+typedef struct hpckern_matrix_structure_t
+{
+    size_t nnz;
+    double density;
+    size_t lower_bandwidth;
+    size_t upper_bandwidth;
+} hpckern_matrix_structure_t;
+
+/* The kernel hpckern_gemm_auto picked. */
+typedef enum hpckern_path_t
+{
+    HPCKERN_PATH_DENSE = 0,
+    HPCKERN_PATH_CSR,
+    HPCKERN_PATH_BANDED,
+    HPCKERN_PATH_UPPER_TRIANGULAR,
+    HPCKERN_PATH_LOWER_TRIANGULAR,
+    HPCKERN_NUM_PATHS
+} hpckern_path_t;
+
+typedef enum hpckern_variant_t
+{
+    HPCKERN_NAIVE = 0,
+    HPCKERN_SERIAL,
+    HPCKERN_THREADED,
+    HPCKERN_CBLAS,
+    HPCKERN_BLOCK,
+    HPCKERN_BLAS_BLOCK,
+    HPCKERN_RECURSIVE,
+    HPCKERN_RECURSIVE_MORTON,
+    HPCKERN_NUM_VARIANTS
+} hpckern_variant_t;
+
+typedef enum hpckern_norm_kind_t
+{
+    HPCKERN_NORM_INF = 0,
+    HPCKERN_NORM_ONE,
+    HPCKERN_NORM_FROBENIUS,
+    HPCKERN_NORM_MAX_ABS,
+    HPCKERN_NORM_TWO,
+    HPCKERN_NUM_NORM_KINDS
+} hpckern_norm_kind_t;
+
+/* How hpckern_matrix_compare_tolerance judges an entry: |expected - actual|,
+ * that divided by the larger magnitude, or the distance in units in the last
+ * place between the two doubles. */
+typedef enum hpckern_tolerance_t
+{
+    HPCKERN_TOLERANCE_ABS = 0,
+    HPCKERN_TOLERANCE_REL,
+    HPCKERN_TOLERANCE_ULP,
+    HPCKERN_NUM_TOLERANCES
+} hpckern_tolerance_t;
+
+/* Errors over all entries; first_row and first_col are the first mismatch
+ * in row-major order and only set when num_mismatches > 0. */
+typedef struct hpckern_matrix_compare_report_t
+{
+    size_t num_mismatches;
+    size_t first_row;
+    size_t first_col;
+    double max_abs_error;
+    double max_rel_error;
+    double max_ulp_error;
+} hpckern_matrix_compare_report_t;
+
+/*
+ * When the benchmark harness stops: after warmup_iterations untimed runs it
+ * keeps at least min_iterations samples and at most max_iterations, and in
+ * between repeats until min_time seconds were measured and the 95%
+ * confidence interval of the mean, over the samples the statistics keep
+ * after outlier rejection, is within target_rel_ci of it. Zero
+ * disables min_time, max_time (a cap on measured seconds) and
+ * target_rel_ci.
+ */
+typedef struct hpckern_harness_config_t
+{
+    size_t warmup_iterations;
+    size_t min_iterations;
+    size_t max_iterations;
+    double min_time;
+    double max_time;
+    double target_rel_ci;
+    /* Drop samples beyond outlier_k scaled MADs of the median; 0 keeps all. */
+    double outlier_k;
+    /* Write flush_bytes of memory before every iteration. */
+    bool flush_cache;
+    size_t flush_bytes;
+    /* Floating-point operations per iteration, for GFLOP/s; 0 omits them. */
+    double flops;
+} hpckern_harness_config_t;
+
+/* Statistics over the samples left after outlier rejection. ci95 is the
+ * half width of the 95% confidence interval of the mean, infinite below two
+ * samples, which never converge; gflops uses the median. */
+typedef struct hpckern_harness_stats_t
+{
+    size_t num_samples;
+    size_t num_warmup;
+    size_t num_outliers;
+    double mean;
+    double median;
+    double stddev;
+    double min;
+    double max;
+    double p95;
+    double p99;
+    double ci95;
+    double rel_ci95;
+    bool converged;
+    double gflops;
+} hpckern_harness_stats_t;
+
+/* Output formats of the benchmark binaries. */
+typedef enum hpckern_format_t
+{
+    HPCKERN_FORMAT_YAML = 0,
+    HPCKERN_FORMAT_JSON,
+    HPCKERN_FORMAT_CSV,
+    HPCKERN_NUM_FORMATS
+} hpckern_format_t;
+
+/* Where a result was measured. Cache sizes are in bytes and 0 when unknown;
+ * affinity lists the CPUs the process may run on, e.g. "0-3,8". The build
+ * fields describe libhpckern itself, which holds the kernels. */
+typedef struct hpckern_system_info_t
+{
+    char cpu_model[128];
+    size_t num_cpus;
+    size_t l1d_cache;
+    size_t l1i_cache;
+    size_t l2_cache;
+    size_t l3_cache;
+    char affinity[256];
+    const char *compiler;
+    const char *build_flags;
+    const char *git_revision;
+} hpckern_system_info_t;
+
+/* What a cached value is a function of: the content hashes of the operands,
+ * their size, and in `params` everything else the value depends on, e.g.
+ * which value it is, alpha or the norm kind. */
+typedef struct hpckern_cache_key_t
+{
+    uint64_t lhs;
+    uint64_t rhs;
+    uint64_t params;
+    size_t size;
+} hpckern_cache_key_t;
+
+/* The memory tier holds up to memory_bytes of values, 0 for none. The disk
+ * tier is a directory of one file per value, read through mmap and shared
+ * by every process that opens it, that holds up to disk_bytes; disk_path
+ * NULL leaves it out. Both evict the least recently used values. */
+typedef struct hpckern_cache_config_t
+{
+    size_t memory_bytes;
+    const char *disk_path;
+    size_t disk_bytes;
+} hpckern_cache_config_t;
+
+typedef struct hpckern_cache_stats_t
+{
+    size_t memory_hits;
+    size_t disk_hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+    size_t memory_bytes;
+    size_t disk_bytes;
+} hpckern_cache_stats_t;
+
+/* State of a splitmix64 generator; seed it with hpckern_rng_seed. The
+ * random generators take one instead of calling rand(), so they are
+ * reentrant, leave the caller's rand() sequence alone, and one seed gives the
+ * same values on every platform. A state must not be shared by threads. */
+typedef struct hpckern_rng_t
+{
+    uint64_t state;
+} hpckern_rng_t;
+
+typedef struct hpckern_context_t hpckern_context_t;
+typedef struct hpckern_cache_t hpckern_cache_t;
+typedef struct hpckern_harness_t hpckern_harness_t;
+typedef struct hpckern_incremental_t hpckern_incremental_t;
+
+/* Runs task `task` of a parallel loop; see hpckern_parallel_for. */
+typedef void (*hpckern_task_fn_t)(void *arg, size_t task);
+
+/* A short description of `status`, e.g. "out of memory". */
+const char *hpckern_status_name(hpckern_status_t status);
+
+/* ----------------------------------------------------------------------- */
+/* Context: worker pool and scratch arena                                   */
+/* ----------------------------------------------------------------------- */
+
+/* Starts num_threads - 1 workers; the calling thread acts as the last one.
+ * Returns NULL when the memory or the threads cannot be had. */
+hpckern_context_t *hpckern_context_create(size_t num_threads);
+void hpckern_context_destroy(hpckern_context_t **ctx);
+size_t hpckern_context_num_threads(const hpckern_context_t *ctx);
+
+/* Calls fn(arg, task) for every task in [0, num_tasks) on the pool and
+ * returns when all of them have finished. Tasks are handed out dynamically. */
+void hpckern_parallel_for(hpckern_context_t *ctx, size_t num_tasks, hpckern_task_fn_t fn, void *arg);
+
+/* Stack-ordered scratch memory, 64-byte aligned and not zeroed, or NULL when
+ * it cannot be allocated. Release everything allocated after a mark with
+ * hpckern_arena_release. */
+void *hpckern_arena_alloc(hpckern_context_t *ctx, size_t bytes);
+size_t hpckern_arena_mark(const hpckern_context_t *ctx);
+void hpckern_arena_release(hpckern_context_t *ctx, size_t mark);
+
+/* ----------------------------------------------------------------------- */
+/* Matrices                                                                 */
+/* ----------------------------------------------------------------------- */
+
+/* Zeroed matrices, or NULL when out of memory or tile_size is 0. */
+hpckern_matrix_t *hpckern_matrix_init(size_t size);
+hpckern_matrix_t *hpckern_matrix_init_tiled(size_t size, size_t tile_size);
+void hpckern_matrix_destroy(hpckern_matrix_t **mat);
+
+void hpckern_rng_seed(hpckern_rng_t *rng, uint64_t seed);
+uint64_t hpckern_rng_next(hpckern_rng_t *rng);
+
+/* Uniform in [min_value, max_value], which must not be empty. */
+int hpckern_rng_int(hpckern_rng_t *rng, int min_value, int max_value);
+
+/* Fills a row-major matrix with integers drawn by hpckern_rng_int. */
+hpckern_status_t hpckern_matrix_random(hpckern_rng_t *rng, hpckern_matrix_t *mat, int min_value, int max_value);
+
+/* Sets *order to 0 when every entry differs by at most HPCKERN_EPS,
+ * otherwise to the sign of the first difference. */
+hpckern_status_t hpckern_matrix_compare(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, int *order);
+
+size_t hpckern_matrix_num_tiles(size_t size, size_t tile_size);
+double *hpckern_matrix_tile(hpckern_matrix_t *mat, size_t tile_row, size_t tile_col);
+
+/* Copy between a row-major and a tiled matrix of the same size. */
+hpckern_status_t hpckern_matrix_convert_layout(const hpckern_matrix_t *src, hpckern_matrix_t *dst);
+
+/* Cache-blocked parallel transposes. */
+hpckern_status_t hpckern_matrix_transpose(hpckern_context_t *ctx, size_t block_size, const hpckern_matrix_t *src, hpckern_matrix_t *dst);
+hpckern_status_t hpckern_matrix_transpose_inplace(hpckern_context_t *ctx, size_t block_size, hpckern_matrix_t *mat);
+
+/* ----------------------------------------------------------------------- */
+/* Multiplication: result = alpha * lhs * rhs + beta * result               */
+/* ----------------------------------------------------------------------- */
+
+const char *hpckern_variant_name(hpckern_variant_t variant);
+
+/* Looks up a variant by its name ("naive", "serial", "threaded", "cblas",
+ * "block", "blas-block", "recursive", "recursive-morton"). */
+bool hpckern_variant_from_name(const char *name, hpckern_variant_t *variant);
+
+/* Dispatches to the kernel of `variant`. Tiled operands use the tiled
+ * kernels, threaded when variant is HPCKERN_THREADED. A CSR or banded lhs
+ * runs the matching sparse kernel on the pool. */
+hpckern_status_t hpckern_gemm(hpckern_context_t *ctx, hpckern_variant_t variant, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+hpckern_status_t hpckern_matrix_gemm_naive(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+/* In optimized builds, block sizes 32, 64, 128 and 256 run kernels compiled
+ * for that size, with register tiles and constant trip counts, and give the
+ * same results as the generic kernel other sizes run.
+ * -DHPCKERN_GENERIC_KERNELS turns them off for comparison. */
+hpckern_status_t hpckern_matrix_gemm_serial(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_threaded(hpckern_context_t *ctx, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+hpckern_status_t hpckern_matrix_gemm_block(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_recursive(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_recursive_morton(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_tiled(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_tiled_threaded(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+/* Whether hpckern_matrix_gemm_serial and hpckern_matrix_gemm_threaded have a
+ * kernel specialized for `block_size`. */
+bool hpckern_gemm_is_specialized(size_t block_size);
+
+/* BLAS-backed kernels; trans_* means the operand is stored transposed. */
+hpckern_status_t hpckern_matrix_gemm_cblas(bool trans_lhs, bool trans_rhs, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_blas_block(size_t block_size, bool trans_lhs, bool trans_rhs, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+/* Kernels on rhs_t = B^T: inner products are unit-stride row dot products. */
+hpckern_status_t hpckern_matrix_gemm_naive_bt(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_serial_bt(size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gemm_threaded_bt(hpckern_context_t *ctx, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs_t, double beta, hpckern_matrix_t *result);
+
+/* result = lhs * rhs through cblas; the reference the other kernels are
+ * verified against. */
+hpckern_status_t hpckern_matrix_mult_cblas(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, hpckern_matrix_t *result);
+
+/* ----------------------------------------------------------------------- */
+/* Sparse and structured operands                                           */
+/* ----------------------------------------------------------------------- */
+
+/* Dense generators: each entry is nonzero with probability `density`; only
+ * entries within the band are nonzero; only the upper or lower triangle,
+ * diagonal included, is nonzero. Nonzeros are drawn like hpckern_matrix_random,
+ * skipping 0. */
+hpckern_status_t hpckern_matrix_random_sparse(hpckern_rng_t *rng, hpckern_matrix_t *mat, double density, int min_value, int max_value);
+hpckern_status_t hpckern_matrix_random_banded(hpckern_rng_t *rng, hpckern_matrix_t *mat, size_t lower_bandwidth, size_t upper_bandwidth, int min_value, int max_value);
+hpckern_status_t hpckern_matrix_random_triangular(hpckern_rng_t *rng, hpckern_matrix_t *mat, bool upper, int min_value, int max_value);
+
+/* One parallel pass over a row-major matrix: nonzero count and bandwidths. */
+hpckern_status_t hpckern_matrix_structure_scan(hpckern_context_t *ctx, const hpckern_matrix_t *mat, hpckern_matrix_structure_t *structure);
+
+/* Compressed copies of a row-major matrix; free with
+ * hpckern_matrix_destroy. The CSR conversion counts and copies the rows on
+ * the thread pool. NULL when `mat` is not row-major or out of memory. */
+hpckern_matrix_t *hpckern_matrix_to_csr(hpckern_context_t *ctx, const hpckern_matrix_t *mat);
+hpckern_matrix_t *hpckern_matrix_to_banded(const hpckern_matrix_t *mat, size_t lower_bandwidth, size_t upper_bandwidth);
+
+const char *hpckern_path_name(hpckern_path_t path);
+
+/* result = alpha * lhs * rhs + beta * result for a CSR or banded lhs and a
+ * row-major rhs: every nonzero of a row of lhs adds a scaled row of rhs. */
+hpckern_status_t hpckern_matrix_spmm(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+hpckern_status_t hpckern_matrix_gbmm(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+/* TRMM-style: lhs is row-major and only its upper or lower triangle is
+ * read, so half of the dense work is skipped. */
+hpckern_status_t hpckern_matrix_trmm(hpckern_context_t *ctx, bool upper, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result);
+
+/* SYRK-style result = alpha * lhs * lhs^T + beta * result on the lower
+ * triangle, diagonal included, as unit-stride row dot products. Like
+ * cblas_dsyrk with CblasLower, the strict upper triangle of result is
+ * neither read nor written. */
+hpckern_status_t hpckern_matrix_syrk(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, double beta, hpckern_matrix_t *result);
+
+/* Scans lhs and runs the cheapest kernel for its structure: banded, then
+ * CSR (see HPCKERN_SPARSE_MAX_DENSITY and HPCKERN_BANDED_MIN_RATIO), then
+ * triangular, else hpckern_gemm with `variant`. The O(N^2) scan and
+ * conversion are part of the call. `path` may be NULL. */
+hpckern_status_t hpckern_gemm_auto(hpckern_context_t *ctx, hpckern_variant_t variant, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result, hpckern_path_t *path);
+
+/* ----------------------------------------------------------------------- */
+/* Verification                                                             */
+/* ----------------------------------------------------------------------- */
+
+/* The name of a tolerance mode, as hpckern_tolerance_from_name reads it. */
+const char *hpckern_tolerance_name(hpckern_tolerance_t mode);
+
+/* Looks up a tolerance mode by its name ("abs", "rel", "ulp"). */
+bool hpckern_tolerance_from_name(const char *name, hpckern_tolerance_t *mode);
+
+/* Compares two row-major matrices entry by entry in parallel, filling
+ * `report`. An entry mismatches when its `mode` error exceeds `tolerance`
+ * or is NaN. */
+hpckern_status_t hpckern_matrix_compare_tolerance(hpckern_context_t *ctx, hpckern_tolerance_t mode, double tolerance, const hpckern_matrix_t *expected, const hpckern_matrix_t *actual, hpckern_matrix_compare_report_t *report);
+
+/* Freivalds' check that result == alpha * op(lhs) * op(rhs) + beta * initial
+ * in O(num_trials * N^2), with op transposing when trans_* is set. `initial`
+ * may be NULL when beta == 0. Each +-1 vector, drawn from `rng`, misses a
+ * wrong result with probability at most 1/2; the trials share one parallel
+ * pass over each matrix. Rows agree when they are within the rounding bound
+ * 2 (N + 2) eps (|alpha| |A| |B| + |beta| |C0| + |C|) 1, which at N = 4096
+ * and entries up to 1000 lets an error of about 15 per row pass. When the
+ * operands, alpha and beta are all integers and that sum stays below 2^53,
+ * the bound is zero and the rows must match exactly. Sets *matches. */
+hpckern_status_t hpckern_matrix_verify_freivalds(hpckern_context_t *ctx, hpckern_rng_t *rng, size_t num_trials, bool trans_lhs, bool trans_rhs, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, const hpckern_matrix_t *initial, const hpckern_matrix_t *result, bool *matches);
+
+/* ----------------------------------------------------------------------- */
+/* Benchmark harness                                                        */
+/* ----------------------------------------------------------------------- */
+
+/* One iteration, warm-up or measured, per hpckern_harness_next:
+ *
+ *     while (hpckern_harness_next(harness))
+ *     {
+ *         ... time one run ...
+ *         hpckern_harness_record(harness, seconds);
+ *     }
+ */
+void hpckern_harness_config_default(hpckern_harness_config_t *config);
+
+/* NULL when out of memory or min_iterations is 0. */
+hpckern_harness_t *hpckern_harness_create(const hpckern_harness_config_t *config);
+void hpckern_harness_destroy(hpckern_harness_t **harness);
+
+/* Returns whether another iteration is due, after flushing the caches when
+ * configured. A convergence test that runs out of memory ends the run. */
+bool hpckern_harness_next(hpckern_harness_t *harness);
+
+/* Whether the iteration hpckern_harness_next just granted is a warm-up one,
+ * whose time hpckern_harness_record discards. */
+bool hpckern_harness_is_warmup(const hpckern_harness_t *harness);
+hpckern_status_t hpckern_harness_record(hpckern_harness_t *harness, double seconds);
+size_t hpckern_harness_num_samples(const hpckern_harness_t *harness);
+
+/* The measured samples in the order they were recorded, without the warm-up
+ * ones; valid until the next hpckern_harness_record. */
+const double *hpckern_harness_samples(const hpckern_harness_t *harness);
+hpckern_status_t hpckern_harness_stats(const hpckern_harness_t *harness, hpckern_harness_stats_t *stats);
+
+/* The statistics of any series of timings, e.g. a second quantity measured
+ * alongside the harnessed one. num_warmup is 0 and converged true. */
+hpckern_status_t hpckern_stats_compute(const double *samples, size_t num_samples, double outlier_k, double flops, hpckern_harness_stats_t *stats);
+
+/* Writes `name:` and the statistics below it, `indent` spaces deep. Both
+ * benchmark binaries use this, so their statistics share one schema. */
+void hpckern_harness_write_yaml(FILE *file, size_t indent, const char *name, const hpckern_harness_stats_t *stats);
+
+/* Writes `"name": { ... }` with the members `indent` spaces deep, without a
+ * trailing comma or newline, so the caller can place it in an object. */
+void hpckern_harness_write_json(FILE *file, size_t indent, const char *name, const hpckern_harness_stats_t *stats);
+
+/* ----------------------------------------------------------------------- */
+/* Run metadata and output formats                                          */
+/* ----------------------------------------------------------------------- */
+
+/* Column names of hpckern_system_info_write_csv, in order. */
+#define HPCKERN_SYSTEM_INFO_CSV_HEADER \
+    "cpu_model,num_cpus,l1d_cache,l1i_cache,l2_cache,l3_cache,affinity,compiler,build_flags,git_revision"
+
+const char *hpckern_format_name(hpckern_format_t format);
+
+/* Looks up a format by its name ("yaml", "json", "csv"). */
+bool hpckern_format_from_name(const char *name, hpckern_format_t *format);
+
+/* Reads the CPU model and the cache sizes from /proc/cpuinfo and sysfs, the
+ * probes mmult/benchmark.py uses, and the affinity of the calling thread.
+ * Fields the platform does not expose stay empty or 0. */
+void hpckern_system_info_probe(hpckern_system_info_t *info);
+
+/* `system:` with the fields below it, `indent` spaces deep. */
+void hpckern_system_info_write_yaml(FILE *file, size_t indent, const hpckern_system_info_t *info);
+
+/* `"system": { ... }` like hpckern_harness_write_json. */
+void hpckern_system_info_write_json(FILE *file, size_t indent, const hpckern_system_info_t *info);
+
+/* The fields as one CSV fragment in HPCKERN_SYSTEM_INFO_CSV_HEADER order,
+ * quoted where needed, without a newline. */
+void hpckern_system_info_write_csv(FILE *file, const hpckern_system_info_t *info);
+
+/* Writes `s` as a quoted JSON string. */
+void hpckern_write_json_string(FILE *file, const char *s);
+
+/* Writes `s` as a CSV field, quoted only when it holds a comma, a quote or
+ * a newline. */
+void hpckern_write_csv_string(FILE *file, const char *s);
+
+/* ----------------------------------------------------------------------- */
+/* Content hashing and the result cache                                     */
+/* ----------------------------------------------------------------------- */
+
+/* XXH64 of `bytes` bytes: fast and well mixed, not cryptographic. */
+uint64_t hpckern_hash_bytes(const void *data, size_t bytes, uint64_t seed);
+
+/* Hash of a row-major matrix: its HPCKERN_HASH_SEGMENT_BYTES segments are
+ * hashed in parallel on the pool, then their hashes in order, so the result
+ * does not depend on the number of threads. O(N^2) at close to memory
+ * bandwidth, against the O(N^3) of a product it can save. */
+hpckern_status_t hpckern_matrix_hash(hpckern_context_t *ctx, const hpckern_matrix_t *mat, uint64_t *hash);
+
+/* Creates the disk tier's directory when it is missing. NULL when it cannot
+ * be created or read, or out of memory. */
+hpckern_cache_t *hpckern_cache_create(const hpckern_cache_config_t *config);
+void hpckern_cache_destroy(hpckern_cache_t **cache);
+
+/* Copies the `bytes` bytes cached under `key` into `value` and returns
+ * true, looking in memory first; a disk hit is promoted to memory. Disk
+ * files that are torn or corrupt count as misses and are removed. All cache
+ * functions may be called from several threads. */
+bool hpckern_cache_lookup(hpckern_cache_t *cache, const hpckern_cache_key_t *key, void *value, size_t bytes);
+
+/* Keeps a copy in memory and writes it through to disk. Values larger than
+ * a tier's limit skip that tier; the cache is best effort, so a value that
+ * cannot be allocated or written is left out as well. */
+void hpckern_cache_store(hpckern_cache_t *cache, const hpckern_cache_key_t *key, const void *value, size_t bytes);
+
+void hpckern_cache_stats(hpckern_cache_t *cache, hpckern_cache_stats_t *stats);
+
+/* ----------------------------------------------------------------------- */
+/* Tracing                                                                  */
+/* ----------------------------------------------------------------------- */
+
+/*
+ * Built with -DHPCKERN_TRACE (make TRACE=1), the pool and the threaded
+ * kernels record begin and end events of their tasks, tiles, idle and join
+ * waits and reductions. Every thread writes into its own ring buffer of
+ * HPCKERN_TRACE_CAPACITY events, timestamped with the cycle counter, without
+ * locks. Otherwise the macros compile to nothing and the functions do
+ * nothing. Event names must outlive the trace, e.g. string literals; `arg`
+ * is recorded unless it is HPCKERN_TRACE_NO_ARG.
+ */
+#define HPCKERN_TRACE_NO_ARG ((size_t)-1)
+
+#ifdef HPCKERN_TRACE
+#define HPCKERN_TRACE_BEGIN(name, arg) hpckern_trace_begin((name), (arg))
+#define HPCKERN_TRACE_END(name) hpckern_trace_end(name)
+#else
+#define HPCKERN_TRACE_BEGIN(name, arg) ((void)0)
+#define HPCKERN_TRACE_END(name) ((void)0)
+#endif
+
+/* Whether libhpckern itself was built with tracing. */
+bool hpckern_trace_enabled(void);
+
+void hpckern_trace_begin(const char *name, size_t arg);
+void hpckern_trace_end(const char *name);
+
+/* Writes the events of every thread as Chrome trace JSON, which
+ * chrome://tracing and ui.perfetto.dev open. Call it while no traced work
+ * runs. Returns false when tracing is not built in. */
+bool hpckern_trace_write_chrome(FILE *file);
+
+/* Drops the recorded events, e.g. those of warm-up runs. */
+void hpckern_trace_clear(void);
+
+/* ----------------------------------------------------------------------- */
+/* Norms                                                                    */
+/* ----------------------------------------------------------------------- */
+
+const char *hpckern_norm_kind_name(hpckern_norm_kind_t kind);
+
+/* Looks up a norm by its name ("inf", "one", "frobenius", "max-abs",
+ * "two"). */
+bool hpckern_norm_kind_from_name(const char *name, hpckern_norm_kind_t *kind);
+
+/* Every norm is stored in *norm. Threaded for HPCKERN_THREADED, serial
+ * otherwise. Tiled matrices use the tiled kernels and only support
+ * HPCKERN_NORM_INF. */
+hpckern_status_t hpckern_norm(hpckern_context_t *ctx, hpckern_variant_t variant, hpckern_norm_kind_t kind, size_t block_size, const hpckern_matrix_t *mat, long double *norm);
+
+/* Infinity norm: the maximum absolute row sum. */
+hpckern_status_t hpckern_matrix_norm_serial(size_t block_size, const hpckern_matrix_t *mat, long double *norm);
+hpckern_status_t hpckern_matrix_norm_threaded(hpckern_context_t *ctx, size_t block_size, const hpckern_matrix_t *mat, long double *norm);
+hpckern_status_t hpckern_matrix_norm_tiled_serial(const hpckern_matrix_t *mat, long double *norm);
+hpckern_status_t hpckern_matrix_norm_tiled_threaded(hpckern_context_t *ctx, const hpckern_matrix_t *mat, long double *norm);
+
+/* The remaining norms split the rows over `num_tasks` tasks on the pool;
+ * num_tasks == 1 runs on the calling thread. */
+
+/* Maximum absolute column sum. Every task adds its rows into a private
+ * column-sum vector with unit stride, the vectors are then summed in column
+ * chunks, so no task walks a column of the row-major data. */
+hpckern_status_t hpckern_matrix_norm_one(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm);
+/* Square root of the sum of squares, kept as scale^2 * ssq like LAPACK's
+ * dlassq when the plain sum would overflow or underflow. */
+hpckern_status_t hpckern_matrix_norm_frobenius(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm);
+hpckern_status_t hpckern_matrix_norm_max_abs(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm);
+
+/* Spectral norm estimate by power iteration on A^T A from the all-ones
+ * vector: at most HPCKERN_POWER_MAX_ITERATIONS steps, stopping once the
+ * estimate changes by less than HPCKERN_POWER_TOLERANCE relatively. The
+ * estimate ||A x|| with ||x|| = 1 never exceeds the true 2-norm. */
+hpckern_status_t hpckern_matrix_norm_two(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm);
+
+/* ||lhs * rhs||_inf in O(N^2) without forming the product. For nonnegative
+ * operands it is max_i (lhs (rhs 1))_i, which is exact, and *is_exact is
+ * set. Otherwise a Hager/Higham 1-norm estimator on (lhs rhs)^T runs on
+ * matrix-vector products; it returns a lower bound that is usually exact
+ * or within a small factor. */
+hpckern_status_t hpckern_matrix_norm_product_estimate(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, long double *norm, bool *is_exact);
+
+/* ----------------------------------------------------------------------- */
+/* Incremental products: C = A * B and ||C||_inf under updates of A and B  */
+/* ----------------------------------------------------------------------- */
+
+/* Copies A and B, forms C with `variant` and keeps the absolute row sums of
+ * C in a max-heap, so the infinity norm is read in O(1). Updates change only
+ * the affected rows of C and re-key their sums; a one-row update of A costs
+ * O(N^2) instead of the O(N^3) of a new product. Updates accumulate rounding
+ * on non-integer data; hpckern_incremental_refresh recomputes everything.
+ * NULL when the product fails or out of memory; a failed update leaves A, B
+ * and C as they were. */
+hpckern_incremental_t *hpckern_incremental_create(hpckern_context_t *ctx, hpckern_variant_t variant, size_t block_size, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs);
+void hpckern_incremental_destroy(hpckern_incremental_t **inc);
+hpckern_status_t hpckern_incremental_refresh(hpckern_incremental_t *inc);
+
+long double hpckern_incremental_norm(const hpckern_incremental_t *inc);
+const hpckern_matrix_t *hpckern_incremental_lhs(const hpckern_incremental_t *inc);
+const hpckern_matrix_t *hpckern_incremental_rhs(const hpckern_incremental_t *inc);
+const hpckern_matrix_t *hpckern_incremental_product(const hpckern_incremental_t *inc);
+
+/* Replace row `row` of A or of B with the N doubles in `values`. */
+hpckern_status_t hpckern_incremental_update_lhs_row(hpckern_incremental_t *inc, size_t row, const double *values);
+hpckern_status_t hpckern_incremental_update_rhs_row(hpckern_incremental_t *inc, size_t row, const double *values);
+
+/* A += U V^T or B += U V^T for row-major N x rank matrices U and V. */
+hpckern_status_t hpckern_incremental_update_lhs_rank_k(hpckern_incremental_t *inc, size_t rank, const double *U, const double *V);
+hpckern_status_t hpckern_incremental_update_rhs_rank_k(hpckern_incremental_t *inc, size_t rank, const double *U, const double *V);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
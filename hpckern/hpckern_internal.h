@@ -0,0 +1,62 @@
+#ifndef HPCKERN_INTERNAL_H
+#define HPCKERN_INTERNAL_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hpckern.h"
+
+#define CACHE_LINE_SIZE 64
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* Misuse of the API (mismatched sizes, bad layouts) is reported to the
+ * caller: returns from the calling function unless `predicate` holds. */
+#define CHECK_ARGUMENT(predicate)                   \
+    do                                              \
+    {                                               \
+        if (!(predicate))                           \
+        {                                           \
+            return HPCKERN_ERROR_INVALID_ARGUMENT;  \
+        }                                           \
+    } while (0)
+
+#define RETURN_IF_ERROR(call)                       \
+    do                                              \
+    {                                               \
+        const hpckern_status_t status_ = (call);    \
+        if (status_ != HPCKERN_OK)                  \
+        {                                           \
+            return status_;                         \
+        }                                           \
+    } while (0)
+
+static inline bool same_size(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs)
+{
+    return lhs->size == rhs->size;
+}
+
+/* The operands of the dense kernels: row-major and of one size. */
+static inline bool dense_operands(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, const hpckern_matrix_t *result)
+{
+    return same_size(lhs, rhs) && same_size(lhs, result) &&
+           lhs->layout == HPCKERN_LAYOUT_ROW_MAJOR && rhs->layout == HPCKERN_LAYOUT_ROW_MAJOR &&
+           result->layout == HPCKERN_LAYOUT_ROW_MAJOR;
+}
+
+/* C[row_start .. row_end) *= beta; beta == 0 overwrites, so stale NaNs in C
+ * do not survive. */
+void hpckern_matrix_scale_rows(double beta, double *data, size_t N, size_t row_start, size_t row_end);
+
+/* C += alpha * A * B for an m x p by p x n sub-problem with leading
+ * dimensions `ld*`; the base case of the recursive and tiled kernels. */
+void hpckern_matrix_gemm_leaf(size_t m, size_t n, size_t p, double alpha, const double *A, size_t lda, const double *B, size_t ldb, double *C, size_t ldc);
+
+/* C[row_start .. row_end) += alpha * A * B, blocked; see gemm_fixed.c. */
+typedef void (*hpckern_gemm_rows_fn_t)(double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double *result, size_t row_start, size_t row_end);
+
+/* The kernel specialized for `block_size`, or NULL when there is none. */
+hpckern_gemm_rows_fn_t hpckern_gemm_fixed_rows(size_t block_size);
+
+#endif
@@ -0,0 +1,430 @@
+#include "hpckern_internal.h"
+
+#include <cblas.h>
+#include <math.h>
+#include <string.h>
+
+struct hpckern_incremental_t
+{
+    hpckern_context_t *ctx;
+    hpckern_variant_t variant;
+    size_t block_size;
+    hpckern_matrix_t *lhs;
+    hpckern_matrix_t *rhs;
+    hpckern_matrix_t *product;
+
+    /* Absolute row sums of the product, and a max-heap of row indices keyed
+     * by them; heap_pos[i] is the slot of row i in the heap. */
+    long double *row_sums;
+    size_t *heap;
+    size_t *heap_pos;
+};
+
+typedef struct row_sum_task_t
+{
+    hpckern_incremental_t *inc;
+    const size_t *rows;
+    size_t num_rows;
+    size_t rows_per_task;
+    long double *sums;
+} row_sum_task_t;
+
+static long double row_abs_sum(const double *row, size_t N)
+{
+    long double sum = 0.0;
+    for (size_t j = 0; j < N; j++)
+    {
+        sum += fabsl(row[j]);
+    }
+    return sum;
+}
+
+static void heap_swap(hpckern_incremental_t *inc, size_t a, size_t b)
+{
+    const size_t row_a = inc->heap[a];
+    const size_t row_b = inc->heap[b];
+
+    inc->heap[a] = row_b;
+    inc->heap[b] = row_a;
+    inc->heap_pos[row_b] = a;
+    inc->heap_pos[row_a] = b;
+}
+
+static void heap_sift_up(hpckern_incremental_t *inc, size_t slot)
+{
+    while (slot > 0)
+    {
+        const size_t parent = (slot - 1) / 2;
+        if (inc->row_sums[inc->heap[parent]] >= inc->row_sums[inc->heap[slot]])
+        {
+            break;
+        }
+        heap_swap(inc, parent, slot);
+        slot = parent;
+    }
+}
+
+static void heap_sift_down(hpckern_incremental_t *inc, size_t slot)
+{
+    const size_t N = inc->product->size;
+
+    for (;;)
+    {
+        const size_t left = 2 * slot + 1;
+        const size_t right = left + 1;
+        size_t largest = slot;
+
+        if (left < N && inc->row_sums[inc->heap[left]] > inc->row_sums[inc->heap[largest]])
+        {
+            largest = left;
+        }
+        if (right < N && inc->row_sums[inc->heap[right]] > inc->row_sums[inc->heap[largest]])
+        {
+            largest = right;
+        }
+        if (largest == slot)
+        {
+            break;
+        }
+        heap_swap(inc, slot, largest);
+        slot = largest;
+    }
+}
+
+static void heap_build(hpckern_incremental_t *inc)
+{
+    const size_t N = inc->product->size;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        inc->heap[i] = i;
+        inc->heap_pos[i] = i;
+    }
+    for (size_t slot = N / 2; slot-- > 0;)
+    {
+        heap_sift_down(inc, slot);
+    }
+}
+
+static void row_sum_task(void *arg, size_t task)
+{
+    const row_sum_task_t *t = (const row_sum_task_t *)arg;
+    hpckern_incremental_t *inc = t->inc;
+    const size_t N = inc->product->size;
+    const size_t start = MIN(task * t->rows_per_task, t->num_rows);
+    const size_t end = MIN(start + t->rows_per_task, t->num_rows);
+
+    for (size_t r = start; r < end; r++)
+    {
+        const size_t i = t->rows != NULL ? t->rows[r] : r;
+        t->sums[r] = row_abs_sum(&inc->product->data[i * N], N);
+    }
+}
+
+// Recomputes the row sums of `rows` (every row when NULL) on the pool and
+// restores the heap. Re-keying one row costs O(log N), rebuilding costs
+// O(N), so many changed rows take the rebuild. Re-keying sifts assume every
+// other key is in heap order, so the new sums go to scratch first and are
+// written back one row at a time, each sifted before the next. `sums` holds
+// num_rows of them; callers allocate it before touching the operands, so
+// nothing here can fail halfway through an update.
+static void rows_changed(hpckern_incremental_t *inc, const size_t *rows, size_t num_rows, long double *sums)
+{
+    const size_t N = inc->product->size;
+    const size_t num_threads = hpckern_context_num_threads(inc->ctx);
+    size_t log_n = 1;
+    row_sum_task_t task = {
+        .inc = inc,
+        .rows = rows,
+        .num_rows = num_rows,
+        .rows_per_task = (num_rows + num_threads - 1) / num_threads,
+        .sums = sums,
+    };
+
+    hpckern_parallel_for(inc->ctx, num_threads, row_sum_task, &task);
+
+    while (((size_t)1 << log_n) < N)
+    {
+        log_n++;
+    }
+
+    if (rows == NULL || num_rows * log_n >= N)
+    {
+        for (size_t r = 0; rows != NULL && r < num_rows; r++)
+        {
+            inc->row_sums[rows[r]] = task.sums[r];
+        }
+        heap_build(inc);
+    }
+    else
+    {
+        for (size_t r = 0; r < num_rows; r++)
+        {
+            inc->row_sums[rows[r]] = task.sums[r];
+            heap_sift_up(inc, inc->heap_pos[rows[r]]);
+            heap_sift_down(inc, inc->heap_pos[rows[r]]);
+        }
+    }
+}
+
+static hpckern_matrix_t *matrix_copy(const hpckern_matrix_t *src)
+{
+    hpckern_matrix_t *dst = hpckern_matrix_init(src->size);
+
+    if (dst != NULL)
+    {
+        memcpy(dst->data, src->data, src->size * src->size * sizeof(double));
+    }
+    return dst;
+}
+
+// Frees whatever part of `inc` has been allocated.
+static void incremental_free(hpckern_incremental_t *inc)
+{
+    hpckern_matrix_t **matrices[] = {&inc->lhs, &inc->rhs, &inc->product};
+
+    for (size_t m = 0; m < sizeof(matrices) / sizeof(matrices[0]); m++)
+    {
+        if (*matrices[m] != NULL)
+        {
+            hpckern_matrix_destroy(matrices[m]);
+        }
+    }
+    free(inc->row_sums);
+    free(inc->heap);
+    free(inc->heap_pos);
+    free(inc);
+}
+
+hpckern_incremental_t *hpckern_incremental_create(hpckern_context_t *ctx, hpckern_variant_t variant, size_t block_size, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs)
+{
+    const size_t N = lhs->size;
+    hpckern_incremental_t *inc;
+
+    if (!same_size(lhs, rhs) || lhs->layout != HPCKERN_LAYOUT_ROW_MAJOR || rhs->layout != HPCKERN_LAYOUT_ROW_MAJOR ||
+        (inc = (hpckern_incremental_t *)calloc(1, sizeof(hpckern_incremental_t))) == NULL)
+    {
+        return NULL;
+    }
+
+    inc->ctx = ctx;
+    inc->variant = variant;
+    inc->block_size = block_size;
+    inc->lhs = matrix_copy(lhs);
+    inc->rhs = matrix_copy(rhs);
+    inc->product = hpckern_matrix_init(N);
+    inc->row_sums = (long double *)calloc(MAX(N, (size_t)1), sizeof(long double));
+    inc->heap = (size_t *)calloc(MAX(N, (size_t)1), sizeof(size_t));
+    inc->heap_pos = (size_t *)calloc(MAX(N, (size_t)1), sizeof(size_t));
+
+    if (inc->lhs == NULL || inc->rhs == NULL || inc->product == NULL ||
+        inc->row_sums == NULL || inc->heap == NULL || inc->heap_pos == NULL ||
+        hpckern_incremental_refresh(inc) != HPCKERN_OK)
+    {
+        incremental_free(inc);
+        return NULL;
+    }
+    return inc;
+}
+
+void hpckern_incremental_destroy(hpckern_incremental_t **inc)
+{
+    incremental_free(*inc);
+    *inc = NULL;
+}
+
+// Every sum lands in place, since a full refresh rebuilds the heap anyway.
+hpckern_status_t hpckern_incremental_refresh(hpckern_incremental_t *inc)
+{
+    RETURN_IF_ERROR(hpckern_gemm(inc->ctx, inc->variant, inc->block_size, 1.0, inc->lhs, inc->rhs, 0.0, inc->product));
+    rows_changed(inc, NULL, inc->product->size, inc->row_sums);
+    return HPCKERN_OK;
+}
+
+long double hpckern_incremental_norm(const hpckern_incremental_t *inc)
+{
+    return inc->row_sums[inc->heap[0]];
+}
+
+const hpckern_matrix_t *hpckern_incremental_lhs(const hpckern_incremental_t *inc)
+{
+    return inc->lhs;
+}
+
+const hpckern_matrix_t *hpckern_incremental_rhs(const hpckern_incremental_t *inc)
+{
+    return inc->rhs;
+}
+
+const hpckern_matrix_t *hpckern_incremental_product(const hpckern_incremental_t *inc)
+{
+    return inc->product;
+}
+
+// Row i of A B is (row i of A) B, so only that row of C changes.
+hpckern_status_t hpckern_incremental_update_lhs_row(hpckern_incremental_t *inc, size_t row, const double *values)
+{
+    const size_t N = inc->product->size;
+    long double sum;
+
+    CHECK_ARGUMENT(row < N);
+
+    memcpy(&inc->lhs->data[row * N], values, N * sizeof(double));
+    cblas_dgemv(
+        CblasRowMajor, CblasTrans, N, N,
+        1.0, inc->rhs->data, N,
+        values, 1,
+        0.0, &inc->product->data[row * N], 1);
+
+    rows_changed(inc, &row, 1, &sum);
+    return HPCKERN_OK;
+}
+
+// Replacing row k of B by `values` adds the rank-1 term A(:, k) d^T with
+// d = values - B(k, :). Every row i with A(i, k) != 0 changes.
+hpckern_status_t hpckern_incremental_update_rhs_row(hpckern_incremental_t *inc, size_t row, const double *values)
+{
+    const size_t N = inc->product->size;
+    const size_t mark = hpckern_arena_mark(inc->ctx);
+    double *delta;
+    size_t *rows;
+    long double *sums;
+    size_t num_rows = 0;
+
+    CHECK_ARGUMENT(row < N);
+    delta = (double *)hpckern_arena_alloc(inc->ctx, N * sizeof(double));
+    rows = (size_t *)hpckern_arena_alloc(inc->ctx, N * sizeof(size_t));
+    sums = (long double *)hpckern_arena_alloc(inc->ctx, N * sizeof(long double));
+    if (delta == NULL || rows == NULL || sums == NULL)
+    {
+        hpckern_arena_release(inc->ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (size_t j = 0; j < N; j++)
+    {
+        delta[j] = values[j] - inc->rhs->data[row * N + j];
+    }
+    memcpy(&inc->rhs->data[row * N], values, N * sizeof(double));
+
+    for (size_t i = 0; i < N; i++)
+    {
+        const double a_ik = inc->lhs->data[i * N + row];
+        if (a_ik != 0.0)
+        {
+            cblas_daxpy(N, a_ik, delta, 1, &inc->product->data[i * N], 1);
+            rows[num_rows++] = i;
+        }
+    }
+
+    rows_changed(inc, rows, num_rows, sums);
+    hpckern_arena_release(inc->ctx, mark);
+    return HPCKERN_OK;
+}
+
+// A += U V^T turns C into C + U (V^T B): two O(k N^2) products. Only the
+// rows i with a nonzero U(i, :) change.
+hpckern_status_t hpckern_incremental_update_lhs_rank_k(hpckern_incremental_t *inc, size_t rank, const double *U, const double *V)
+{
+    const size_t N = inc->product->size;
+    const size_t mark = hpckern_arena_mark(inc->ctx);
+    double *W;
+    size_t *rows;
+    long double *sums;
+    size_t num_rows = 0;
+
+    CHECK_ARGUMENT(rank > 0);
+    W = (double *)hpckern_arena_alloc(inc->ctx, rank * N * sizeof(double));
+    rows = (size_t *)hpckern_arena_alloc(inc->ctx, N * sizeof(size_t));
+    sums = (long double *)hpckern_arena_alloc(inc->ctx, N * sizeof(long double));
+    if (W == NULL || rows == NULL || sums == NULL)
+    {
+        hpckern_arena_release(inc->ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* W = V^T B, computed before B is used with the new A. */
+    cblas_dgemm(
+        CblasRowMajor, CblasTrans, CblasNoTrans, rank, N, N,
+        1.0, V, rank, inc->rhs->data, N,
+        0.0, W, N);
+    cblas_dgemm(
+        CblasRowMajor, CblasNoTrans, CblasTrans, N, N, rank,
+        1.0, U, rank, V, rank,
+        1.0, inc->lhs->data, N);
+
+    for (size_t i = 0; i < N; i++)
+    {
+        bool is_zero = true;
+        for (size_t r = 0; r < rank && is_zero; r++)
+        {
+            is_zero = U[i * rank + r] == 0.0;
+        }
+        if (!is_zero)
+        {
+            cblas_dgemv(
+                CblasRowMajor, CblasTrans, rank, N,
+                1.0, W, N,
+                &U[i * rank], 1,
+                1.0, &inc->product->data[i * N], 1);
+            rows[num_rows++] = i;
+        }
+    }
+
+    rows_changed(inc, rows, num_rows, sums);
+    hpckern_arena_release(inc->ctx, mark);
+    return HPCKERN_OK;
+}
+
+// B += U V^T turns C into C + (A U) V^T: two O(k N^2) products. Rows with a
+// zero (A U)(i, :) keep their sums.
+hpckern_status_t hpckern_incremental_update_rhs_rank_k(hpckern_incremental_t *inc, size_t rank, const double *U, const double *V)
+{
+    const size_t N = inc->product->size;
+    const size_t mark = hpckern_arena_mark(inc->ctx);
+    double *W;
+    size_t *rows;
+    long double *sums;
+    size_t num_rows = 0;
+
+    CHECK_ARGUMENT(rank > 0);
+    W = (double *)hpckern_arena_alloc(inc->ctx, N * rank * sizeof(double));
+    rows = (size_t *)hpckern_arena_alloc(inc->ctx, N * sizeof(size_t));
+    sums = (long double *)hpckern_arena_alloc(inc->ctx, N * sizeof(long double));
+    if (W == NULL || rows == NULL || sums == NULL)
+    {
+        hpckern_arena_release(inc->ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* W = A U */
+    cblas_dgemm(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, N, rank, N,
+        1.0, inc->lhs->data, N, U, rank,
+        0.0, W, rank);
+    cblas_dgemm(
+        CblasRowMajor, CblasNoTrans, CblasTrans, N, N, rank,
+        1.0, U, rank, V, rank,
+        1.0, inc->rhs->data, N);
+    cblas_dgemm(
+        CblasRowMajor, CblasNoTrans, CblasTrans, N, N, rank,
+        1.0, W, rank, V, rank,
+        1.0, inc->product->data, N);
+
+    for (size_t i = 0; i < N; i++)
+    {
+        bool is_zero = true;
+        for (size_t r = 0; r < rank && is_zero; r++)
+        {
+            is_zero = W[i * rank + r] == 0.0;
+        }
+        if (!is_zero)
+        {
+            rows[num_rows++] = i;
+        }
+    }
+
+    rows_changed(inc, rows, num_rows, sums);
+    hpckern_arena_release(inc->ctx, mark);
+    return HPCKERN_OK;
+}
@@ -0,0 +1,253 @@
+#include "hpckern_internal.h"
+
+#include <math.h>
+#include <string.h>
+
+typedef struct transpose_task_t
+{
+    const double *src;
+    double *dst;
+    size_t size;
+    size_t block_size;
+    bool in_place;
+} transpose_task_t;
+
+hpckern_matrix_t *hpckern_matrix_init(size_t size)
+{
+    hpckern_matrix_t *mat = (hpckern_matrix_t *)calloc(1, sizeof(hpckern_matrix_t));
+
+    if (mat == NULL)
+    {
+        return NULL;
+    }
+    mat->size = size;
+    mat->layout = HPCKERN_LAYOUT_ROW_MAJOR;
+    mat->data = (double *)calloc(MAX(size * size, 1), sizeof(double));
+    if (mat->data == NULL)
+    {
+        free(mat);
+        return NULL;
+    }
+    return mat;
+}
+
+size_t hpckern_matrix_num_tiles(size_t size, size_t tile_size)
+{
+    return (size + tile_size - 1) / tile_size;
+}
+
+hpckern_matrix_t *hpckern_matrix_init_tiled(size_t size, size_t tile_size)
+{
+    hpckern_matrix_t *mat;
+    size_t T;
+
+    if (tile_size == 0 || (mat = (hpckern_matrix_t *)calloc(1, sizeof(hpckern_matrix_t))) == NULL)
+    {
+        return NULL;
+    }
+    T = hpckern_matrix_num_tiles(size, tile_size);
+    mat->size = size;
+    mat->layout = HPCKERN_LAYOUT_TILED;
+    mat->tile_size = tile_size;
+    mat->data = (double *)calloc(MAX(T * T * tile_size * tile_size, 1), sizeof(double));
+    if (mat->data == NULL)
+    {
+        free(mat);
+        return NULL;
+    }
+    return mat;
+}
+
+void hpckern_matrix_destroy(hpckern_matrix_t **mat)
+{
+    free((*mat)->data);
+    free((*mat)->row_ptr);
+    free((*mat)->col_idx);
+    free(*mat);
+    *mat = NULL;
+}
+
+void hpckern_rng_seed(hpckern_rng_t *rng, uint64_t seed)
+{
+    rng->state = seed;
+}
+
+uint64_t hpckern_rng_next(hpckern_rng_t *rng)
+{
+    uint64_t z = (rng->state += 0x9e3779b97f4a7c15);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// The modulo bias is below 2^-32 for any int range.
+int hpckern_rng_int(hpckern_rng_t *rng, int min_value, int max_value)
+{
+    const uint64_t range = (uint64_t)((int64_t)max_value - min_value) + 1;
+
+    return (int)((int64_t)min_value + (int64_t)(hpckern_rng_next(rng) % range));
+}
+
+hpckern_status_t hpckern_matrix_random(hpckern_rng_t *rng, hpckern_matrix_t *mat, int min_value, int max_value)
+{
+    const size_t N = mat->size;
+
+    CHECK_ARGUMENT(min_value <= max_value && mat->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = 0; j < N; j++)
+        {
+            mat->data[i * N + j] = hpckern_rng_int(rng, min_value, max_value);
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_compare(const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, int *order)
+{
+    const size_t N = lhs->size;
+
+    CHECK_ARGUMENT(
+        same_size(lhs, rhs) &&
+        lhs->layout == HPCKERN_LAYOUT_ROW_MAJOR && rhs->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = 0; j < N; j++)
+        {
+            const double diff = lhs->data[i * N + j] - rhs->data[i * N + j];
+            if (fabs(diff) > HPCKERN_EPS)
+            {
+                *order = diff < 0 ? -1 : 1;
+                return HPCKERN_OK;
+            }
+        }
+    }
+
+    *order = 0;
+    return HPCKERN_OK;
+}
+
+// A tile is one contiguous block, so a kernel working on it touches a few
+// pages and no N-strided rows, which avoids the TLB and cache-set conflicts
+// row-major storage has when N is a power of two.
+double *hpckern_matrix_tile(hpckern_matrix_t *mat, size_t tile_row, size_t tile_col)
+{
+    const size_t T = hpckern_matrix_num_tiles(mat->size, mat->tile_size);
+    return &mat->data[(tile_row * T + tile_col) * mat->tile_size * mat->tile_size];
+}
+
+hpckern_status_t hpckern_matrix_convert_layout(const hpckern_matrix_t *src, hpckern_matrix_t *dst)
+{
+    const size_t N = src->size;
+    const bool to_tiled = dst->layout == HPCKERN_LAYOUT_TILED;
+    hpckern_matrix_t *tiled = to_tiled ? dst : (hpckern_matrix_t *)src;
+    double *row_major = to_tiled ? src->data : dst->data;
+    const size_t b = tiled->tile_size;
+    size_t T;
+
+    CHECK_ARGUMENT(
+        same_size(src, dst) &&
+        (to_tiled ? src->layout == HPCKERN_LAYOUT_ROW_MAJOR
+                  : src->layout == HPCKERN_LAYOUT_TILED && dst->layout == HPCKERN_LAYOUT_ROW_MAJOR));
+
+    T = hpckern_matrix_num_tiles(N, b);
+
+    for (size_t ti = 0; ti < T; ti++)
+    {
+        for (size_t tj = 0; tj < T; tj++)
+        {
+            double *tile = hpckern_matrix_tile(tiled, ti, tj);
+            const size_t i_end = MIN(b, N - ti * b);
+            const size_t j_end = MIN(b, N - tj * b);
+            for (size_t i = 0; i < i_end; i++)
+            {
+                double *row = &row_major[(ti * b + i) * N + tj * b];
+                if (to_tiled)
+                {
+                    memcpy(&tile[i * b], row, j_end * sizeof(double));
+                }
+                else
+                {
+                    memcpy(row, &tile[i * b], j_end * sizeof(double));
+                }
+            }
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+// Transposes one block_size x block_size block (bi, bj). Out of place it
+// copies src(bi, bj)^T into dst(bj, bi); in place it swaps the pair of
+// mirrored blocks, so it must only be called with bj >= bi.
+static void transpose_block(size_t N, size_t block_size, const double *src, double *dst, size_t bi, size_t bj, bool in_place)
+{
+    const size_t i_end = MIN(bi + block_size, N);
+    const size_t j_end = MIN(bj + block_size, N);
+
+    for (size_t i = bi; i < i_end; i++)
+    {
+        for (size_t j = in_place && bi == bj ? i + 1 : bj; j < j_end; j++)
+        {
+            if (in_place)
+            {
+                const double tmp = dst[i * N + j];
+                dst[i * N + j] = dst[j * N + i];
+                dst[j * N + i] = tmp;
+            }
+            else
+            {
+                dst[j * N + i] = src[i * N + j];
+            }
+        }
+    }
+}
+
+// One task per block row. In place, block row bi only touches the upper
+// triangle bj >= bi; tasks are handed out dynamically, which keeps the
+// shrinking rows balanced.
+static void transpose_task(void *arg, size_t task)
+{
+    const transpose_task_t *t = (const transpose_task_t *)arg;
+    const size_t bi = task * t->block_size;
+
+    for (size_t bj = t->in_place ? bi : 0; bj < t->size; bj += t->block_size)
+    {
+        transpose_block(t->size, t->block_size, t->src, t->dst, bi, bj, t->in_place);
+    }
+}
+
+static hpckern_status_t transpose_run(hpckern_context_t *ctx, size_t block_size, const double *src, double *dst, size_t N, bool in_place)
+{
+    transpose_task_t task = {
+        .src = src,
+        .dst = dst,
+        .size = N,
+        .block_size = block_size,
+        .in_place = in_place,
+    };
+
+    CHECK_ARGUMENT(block_size > 0);
+    hpckern_parallel_for(ctx, hpckern_matrix_num_tiles(N, block_size), transpose_task, &task);
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_transpose(hpckern_context_t *ctx, size_t block_size, const hpckern_matrix_t *src, hpckern_matrix_t *dst)
+{
+    CHECK_ARGUMENT(
+        same_size(src, dst) &&
+        src->layout == HPCKERN_LAYOUT_ROW_MAJOR && dst->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+
+    return transpose_run(ctx, block_size, src->data, dst->data, src->size, false);
+}
+
+hpckern_status_t hpckern_matrix_transpose_inplace(hpckern_context_t *ctx, size_t block_size, hpckern_matrix_t *mat)
+{
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+
+    return transpose_run(ctx, block_size, NULL, mat->data, mat->size, true);
+}
@@ -0,0 +1,815 @@
+#include "hpckern_internal.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Per-task vectors are padded to whole cache lines so that tasks accumulating
+// neighbouring vectors never share a line.
+#define VECTOR_STRIDE(n) (((n) + CACHE_LINE_SIZE / sizeof(double) - 1) / (CACHE_LINE_SIZE / sizeof(double)) * (CACHE_LINE_SIZE / sizeof(double)))
+
+typedef struct norm_task_t
+{
+    const hpckern_matrix_t *mat;
+    size_t block_size;
+    size_t rows_per_task;
+    long double *max_sums;
+    // Tiled only: tile_size partial row sums per task.
+    long double *row_sums;
+} norm_task_t;
+
+typedef struct vector_task_t
+{
+    const hpckern_matrix_t *mat;
+    size_t rows_per_task;
+    size_t num_partials;
+    size_t stride;
+    const double *x;
+    double *y;
+    double *partials;
+    double *values;
+    // Frobenius only: values[task] is a sum of squares in units of
+    // scales[task]^2.
+    double *scales;
+} vector_task_t;
+
+static const char *const NORM_KIND_NAMES[HPCKERN_NUM_NORM_KINDS] = {
+    [HPCKERN_NORM_INF] = "inf",
+    [HPCKERN_NORM_ONE] = "one",
+    [HPCKERN_NORM_FROBENIUS] = "frobenius",
+    [HPCKERN_NORM_MAX_ABS] = "max-abs",
+    [HPCKERN_NORM_TWO] = "two",
+};
+
+const char *hpckern_norm_kind_name(hpckern_norm_kind_t kind)
+{
+    return kind < HPCKERN_NUM_NORM_KINDS ? NORM_KIND_NAMES[kind] : "unknown";
+}
+
+bool hpckern_norm_kind_from_name(const char *name, hpckern_norm_kind_t *kind)
+{
+    for (size_t i = 0; i < HPCKERN_NUM_NORM_KINDS; i++)
+    {
+        if (strcmp(name, NORM_KIND_NAMES[i]) == 0)
+        {
+            *kind = (hpckern_norm_kind_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Max row abs-sum over rows [row_start, row_end), walking each row in
+// block_size chunks.
+static long double norm_rows(size_t block_size, const hpckern_matrix_t *mat, size_t row_start, size_t row_end)
+{
+    const size_t N = mat->size;
+    const double *data = mat->data;
+    register long double row_sum;
+    register const double *row;
+    register size_t j_end;
+    register size_t j;
+    long double max_row_sum = 0.0;
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        row = &data[i * N];
+        row_sum = 0.0;
+        for (size_t bj = 0; bj < N; bj += block_size)
+        {
+            j_end = MIN(bj + block_size, N);
+            for (j = bj; j < j_end; j++)
+            {
+                row_sum += fabsl(row[j]);
+            }
+        }
+        max_row_sum = MAX(max_row_sum, row_sum);
+    }
+
+    return max_row_sum;
+}
+
+hpckern_status_t hpckern_matrix_norm_serial(size_t block_size, const hpckern_matrix_t *mat, long double *norm)
+{
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_ROW_MAJOR && block_size > 0);
+
+    *norm = norm_rows(block_size, mat, 0, mat->size);
+    return HPCKERN_OK;
+}
+
+static void norm_task(void *arg, size_t task)
+{
+    const norm_task_t *t = (const norm_task_t *)arg;
+    const size_t N = t->mat->size;
+    const size_t row_start = MIN(task * t->rows_per_task, N);
+    const size_t row_end = MIN(row_start + t->rows_per_task, N);
+
+    HPCKERN_TRACE_BEGIN("norm rows", row_start);
+    t->max_sums[task] = norm_rows(t->block_size, t->mat, row_start, row_end);
+    HPCKERN_TRACE_END("norm rows");
+}
+
+// Every task writes its own slot in an arena array instead of taking a lock
+// around a shared maximum; the caller reduces the slots afterwards.
+hpckern_status_t hpckern_matrix_norm_threaded(hpckern_context_t *ctx, size_t block_size, const hpckern_matrix_t *mat, long double *norm)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    const size_t mark = hpckern_arena_mark(ctx);
+    long double result = 0.0;
+    norm_task_t task = {
+        .mat = mat,
+        .block_size = block_size,
+        .rows_per_task = (mat->size + num_threads - 1) / num_threads,
+    };
+
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_ROW_MAJOR && block_size > 0);
+    task.max_sums = (long double *)hpckern_arena_alloc(ctx, num_threads * sizeof(long double));
+    if (task.max_sums == NULL)
+    {
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    hpckern_parallel_for(ctx, num_threads, norm_task, &task);
+
+    HPCKERN_TRACE_BEGIN("norm reduce", num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        result = MAX(result, task.max_sums[i]);
+    }
+    HPCKERN_TRACE_END("norm reduce");
+
+    hpckern_arena_release(ctx, mark);
+    *norm = result;
+    return HPCKERN_OK;
+}
+
+// Max row abs-sum over tile rows [tile_row_start, tile_row_end); rows in
+// the padding are skipped. `row_sums` holds tile_size partial sums.
+static long double norm_tiled_rows(const hpckern_matrix_t *mat, size_t tile_row_start, size_t tile_row_end, long double *row_sums)
+{
+    const size_t N = mat->size;
+    const size_t b = mat->tile_size;
+    const size_t T = hpckern_matrix_num_tiles(N, b);
+    long double max_row_sum = 0.0;
+
+    for (size_t ti = tile_row_start; ti < tile_row_end; ti++)
+    {
+        const size_t i_end = MIN(b, N - ti * b);
+
+        for (size_t i = 0; i < b; i++)
+        {
+            row_sums[i] = 0.0;
+        }
+        for (size_t tj = 0; tj < T; tj++)
+        {
+            const double *tile = hpckern_matrix_tile((hpckern_matrix_t *)mat, ti, tj);
+            for (size_t i = 0; i < i_end; i++)
+            {
+                for (size_t j = 0; j < b; j++)
+                {
+                    row_sums[i] += fabsl(tile[i * b + j]);
+                }
+            }
+        }
+        for (size_t i = 0; i < i_end; i++)
+        {
+            max_row_sum = MAX(max_row_sum, row_sums[i]);
+        }
+    }
+
+    return max_row_sum;
+}
+
+hpckern_status_t hpckern_matrix_norm_tiled_serial(const hpckern_matrix_t *mat, long double *norm)
+{
+    long double *row_sums;
+
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_TILED);
+    row_sums = (long double *)malloc(mat->tile_size * sizeof(long double));
+    if (row_sums == NULL)
+    {
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    *norm = norm_tiled_rows(mat, 0, hpckern_matrix_num_tiles(mat->size, mat->tile_size), row_sums);
+    free(row_sums);
+    return HPCKERN_OK;
+}
+
+static void norm_tiled_task(void *arg, size_t task)
+{
+    const norm_task_t *t = (const norm_task_t *)arg;
+    const size_t b = t->mat->tile_size;
+    const size_t T = hpckern_matrix_num_tiles(t->mat->size, b);
+    const size_t tile_row_start = MIN(task * t->rows_per_task, T);
+    const size_t tile_row_end = MIN(tile_row_start + t->rows_per_task, T);
+
+    HPCKERN_TRACE_BEGIN("norm tile rows", tile_row_start);
+    t->max_sums[task] = norm_tiled_rows(t->mat, tile_row_start, tile_row_end, &t->row_sums[task * b]);
+    HPCKERN_TRACE_END("norm tile rows");
+}
+
+hpckern_status_t hpckern_matrix_norm_tiled_threaded(hpckern_context_t *ctx, const hpckern_matrix_t *mat, long double *norm)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    const size_t mark = hpckern_arena_mark(ctx);
+    long double result = 0.0;
+    norm_task_t task = {
+        .mat = mat,
+    };
+
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_TILED);
+    task.rows_per_task = (hpckern_matrix_num_tiles(mat->size, mat->tile_size) + num_threads - 1) / num_threads;
+    task.max_sums = (long double *)hpckern_arena_alloc(ctx, num_threads * sizeof(long double));
+    task.row_sums = (long double *)hpckern_arena_alloc(ctx, num_threads * mat->tile_size * sizeof(long double));
+    if (task.max_sums == NULL || task.row_sums == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    hpckern_parallel_for(ctx, num_threads, norm_tiled_task, &task);
+
+    HPCKERN_TRACE_BEGIN("norm reduce", num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        result = MAX(result, task.max_sums[i]);
+    }
+    HPCKERN_TRACE_END("norm reduce");
+
+    hpckern_arena_release(ctx, mark);
+    *norm = result;
+    return HPCKERN_OK;
+}
+
+static void task_rows(const vector_task_t *t, size_t task, size_t *row_start, size_t *row_end)
+{
+    const size_t N = t->mat->size;
+    *row_start = MIN(task * t->rows_per_task, N);
+    *row_end = MIN(*row_start + t->rows_per_task, N);
+}
+
+// The loops below are kept free of loop-carried dependencies, with four
+// independent accumulators in the reductions, so the compiler vectorizes
+// them without -ffast-math.
+
+// partials[task] = |A(rows, :)| summed over the rows of the task.
+static void column_abs_sum_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    double *restrict sums = &t->partials[task * t->stride];
+    size_t row_start, row_end;
+
+    task_rows(t, task, &row_start, &row_end);
+    memset(sums, 0, N * sizeof(double));
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        const double *restrict row = &t->mat->data[i * N];
+        for (size_t j = 0; j < N; j++)
+        {
+            sums[j] += fabs(row[j]);
+        }
+    }
+}
+
+// partials[task] = A(rows, :)^T * y(rows): one axpy per row, unit stride.
+static void transposed_matvec_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    double *restrict sums = &t->partials[task * t->stride];
+    size_t row_start, row_end;
+
+    task_rows(t, task, &row_start, &row_end);
+    memset(sums, 0, N * sizeof(double));
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        const double *restrict row = &t->mat->data[i * N];
+        const double y_i = t->y[i];
+        for (size_t j = 0; j < N; j++)
+        {
+            sums[j] += y_i * row[j];
+        }
+    }
+}
+
+// values[cols] = sum of the partial vectors, for one chunk of columns.
+static void column_reduce_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    const size_t cols_per_task = (N + t->num_partials - 1) / t->num_partials;
+    const size_t col_start = MIN(task * cols_per_task, N);
+    const size_t col_end = MIN(col_start + cols_per_task, N);
+
+    memcpy(&t->values[col_start], &t->partials[col_start], (col_end - col_start) * sizeof(double));
+    for (size_t p = 1; p < t->num_partials; p++)
+    {
+        const double *restrict partial = &t->partials[p * t->stride];
+        for (size_t j = col_start; j < col_end; j++)
+        {
+            t->values[j] += partial[j];
+        }
+    }
+}
+
+// Runs `fn` to fill one partial vector per task, then sums them into
+// t->values in parallel column chunks.
+static void column_accumulate(hpckern_context_t *ctx, vector_task_t *t, hpckern_task_fn_t fn)
+{
+    hpckern_parallel_for(ctx, t->num_partials, fn, t);
+    hpckern_parallel_for(ctx, t->num_partials, column_reduce_task, t);
+}
+
+static hpckern_status_t vector_task_init(vector_task_t *t, size_t num_tasks, const hpckern_matrix_t *mat)
+{
+    const size_t N = mat->size;
+
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_ROW_MAJOR && num_tasks > 0);
+
+    memset(t, 0, sizeof(vector_task_t));
+    t->mat = mat;
+    t->num_partials = num_tasks;
+    t->rows_per_task = (N + num_tasks - 1) / num_tasks;
+    t->stride = VECTOR_STRIDE(N);
+    return HPCKERN_OK;
+}
+
+// Scratch for column_accumulate: one partial vector per task and the sum.
+// Returns whether both fit.
+static bool vector_task_alloc_columns(hpckern_context_t *ctx, vector_task_t *t)
+{
+    t->partials = (double *)hpckern_arena_alloc(ctx, t->num_partials * t->stride * sizeof(double));
+    t->values = (double *)hpckern_arena_alloc(ctx, t->mat->size * sizeof(double));
+    return t->partials != NULL && t->values != NULL;
+}
+
+static double vector_max(const double *values, size_t len)
+{
+    register double max0 = 0.0, max1 = 0.0, max2 = 0.0, max3 = 0.0;
+    register const size_t limit = len - (len % 4);
+    register size_t j;
+
+    for (j = 0; j < limit; j += 4)
+    {
+        max0 = MAX(max0, values[j]);
+        max1 = MAX(max1, values[j + 1]);
+        max2 = MAX(max2, values[j + 2]);
+        max3 = MAX(max3, values[j + 3]);
+    }
+
+    for (; j < len; j++)
+    {
+        max0 = MAX(max0, values[j]);
+    }
+
+    return MAX(MAX(max0, max1), MAX(max2, max3));
+}
+
+static double vector_dot(const double *lhs, const double *rhs, size_t len)
+{
+    register double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+    register const size_t limit = len - (len % 4);
+    register size_t k;
+
+    for (k = 0; k < limit; k += 4)
+    {
+        sum0 += lhs[k] * rhs[k];
+        sum1 += lhs[k + 1] * rhs[k + 1];
+        sum2 += lhs[k + 2] * rhs[k + 2];
+        sum3 += lhs[k + 3] * rhs[k + 3];
+    }
+
+    for (; k < len; k++)
+    {
+        sum0 += lhs[k] * rhs[k];
+    }
+
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+hpckern_status_t hpckern_matrix_norm_one(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm)
+{
+    const size_t mark = hpckern_arena_mark(ctx);
+    vector_task_t task;
+
+    RETURN_IF_ERROR(vector_task_init(&task, num_tasks, mat));
+    if (!vector_task_alloc_columns(ctx, &task))
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+    column_accumulate(ctx, &task, column_abs_sum_task);
+    *norm = vector_max(task.values, mat->size);
+
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
+
+// Squares of ordinary entries are summed directly. A sum that overflowed, or
+// came out so small that squares may have underflowed, is redone like
+// LAPACK's dlassq as scale^2 * ssq, with the entries multiplied by a power of
+// two, which is exact, that brings the largest of them near 1.
+#define FROBENIUS_SUM_MIN 0x1p-900
+#define FROBENIUS_RESCALE 0x1p600
+
+static double vector_scaled_dot(const double *data, size_t len, double factor)
+{
+    register double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+    register const size_t limit = len - (len % 4);
+    register size_t k;
+
+    for (k = 0; k < limit; k += 4)
+    {
+        const double x0 = data[k] * factor, x1 = data[k + 1] * factor;
+        const double x2 = data[k + 2] * factor, x3 = data[k + 3] * factor;
+        sum0 += x0 * x0;
+        sum1 += x1 * x1;
+        sum2 += x2 * x2;
+        sum3 += x3 * x3;
+    }
+
+    for (; k < len; k++)
+    {
+        const double x = data[k] * factor;
+        sum0 += x * x;
+    }
+
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+// values[task] and scales[task] = scaled sum of squares of the rows of the
+// task.
+static void frobenius_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    size_t row_start, row_end;
+
+    task_rows(t, task, &row_start, &row_end);
+
+    const double *data = &t->mat->data[row_start * N];
+    const size_t len = (row_end - row_start) * N;
+    double ssq = vector_dot(data, data, len);
+    double scale = 1.0;
+
+    if (!(ssq >= FROBENIUS_SUM_MIN && ssq <= DBL_MAX))
+    {
+        double amax = 0.0;
+
+        for (size_t k = 0; k < len; k++)
+        {
+            amax = MAX(amax, fabs(data[k]));
+        }
+        if (amax > 0.0)
+        {
+            scale = amax >= 1.0 ? FROBENIUS_RESCALE : 1.0 / FROBENIUS_RESCALE;
+            ssq = vector_scaled_dot(data, len, 1.0 / scale);
+        }
+    }
+
+    t->values[task] = ssq;
+    t->scales[task] = scale;
+}
+
+// The partial sums are combined in long double, whose range holds any
+// scale^2 * ssq.
+hpckern_status_t hpckern_matrix_norm_frobenius(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm)
+{
+    const size_t mark = hpckern_arena_mark(ctx);
+    vector_task_t task;
+    long double sum = 0.0;
+
+    RETURN_IF_ERROR(vector_task_init(&task, num_tasks, mat));
+    task.values = (double *)hpckern_arena_alloc(ctx, num_tasks * sizeof(double));
+    task.scales = (double *)hpckern_arena_alloc(ctx, num_tasks * sizeof(double));
+    if (task.values == NULL || task.scales == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+    hpckern_parallel_for(ctx, num_tasks, frobenius_task, &task);
+
+    for (size_t i = 0; i < num_tasks; i++)
+    {
+        sum += (long double)task.scales[i] * task.scales[i] * task.values[i];
+    }
+
+    hpckern_arena_release(ctx, mark);
+    *norm = sqrtl(sum);
+    return HPCKERN_OK;
+}
+
+// values[task] = max |a_ij| over the rows of the task.
+static void max_abs_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    register double max0 = 0.0, max1 = 0.0, max2 = 0.0, max3 = 0.0;
+    size_t row_start, row_end;
+
+    task_rows(t, task, &row_start, &row_end);
+
+    const double *data = &t->mat->data[row_start * N];
+    const size_t len = (row_end - row_start) * N;
+    const size_t limit = len - (len % 4);
+    size_t k;
+
+    for (k = 0; k < limit; k += 4)
+    {
+        max0 = MAX(max0, fabs(data[k]));
+        max1 = MAX(max1, fabs(data[k + 1]));
+        max2 = MAX(max2, fabs(data[k + 2]));
+        max3 = MAX(max3, fabs(data[k + 3]));
+    }
+
+    for (; k < len; k++)
+    {
+        max0 = MAX(max0, fabs(data[k]));
+    }
+
+    t->values[task] = MAX(MAX(max0, max1), MAX(max2, max3));
+}
+
+hpckern_status_t hpckern_matrix_norm_max_abs(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm)
+{
+    const size_t mark = hpckern_arena_mark(ctx);
+    vector_task_t task;
+
+    RETURN_IF_ERROR(vector_task_init(&task, num_tasks, mat));
+    task.values = (double *)hpckern_arena_alloc(ctx, num_tasks * sizeof(double));
+    if (task.values == NULL)
+    {
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+    hpckern_parallel_for(ctx, num_tasks, max_abs_task, &task);
+    *norm = vector_max(task.values, num_tasks);
+
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
+
+// y(rows) = A(rows, :) * x, one unit-stride dot product per row.
+static void matvec_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    size_t row_start, row_end;
+
+    task_rows(t, task, &row_start, &row_end);
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        t->y[i] = vector_dot(&t->mat->data[i * N], t->x, N);
+    }
+}
+
+// Each step computes y = A x and x' = A^T y; ||y|| is the current estimate and
+// x' / ||x'|| the next unit vector.
+hpckern_status_t hpckern_matrix_norm_two(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *mat, long double *norm)
+{
+    const size_t N = mat->size;
+    const size_t mark = hpckern_arena_mark(ctx);
+    vector_task_t task;
+    double *x;
+    double estimate = 0.0;
+
+    RETURN_IF_ERROR(vector_task_init(&task, num_tasks, mat));
+    if (!vector_task_alloc_columns(ctx, &task) ||
+        (x = (double *)hpckern_arena_alloc(ctx, N * sizeof(double))) == NULL ||
+        (task.y = (double *)hpckern_arena_alloc(ctx, N * sizeof(double))) == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+    task.x = x;
+
+    for (size_t j = 0; j < N; j++)
+    {
+        x[j] = 1.0 / sqrt((double)N);
+    }
+
+    for (size_t iteration = 0; iteration < HPCKERN_POWER_MAX_ITERATIONS; iteration++)
+    {
+        double previous = estimate;
+        double x_norm;
+
+        hpckern_parallel_for(ctx, num_tasks, matvec_task, &task);
+        estimate = sqrt(vector_dot(task.y, task.y, N));
+
+        column_accumulate(ctx, &task, transposed_matvec_task);
+        x_norm = sqrt(vector_dot(task.values, task.values, N));
+        if (x_norm == 0.0)
+        {
+            break;
+        }
+        for (size_t j = 0; j < N; j++)
+        {
+            x[j] = task.values[j] / x_norm;
+        }
+
+        if (fabs(estimate - previous) <= HPCKERN_POWER_TOLERANCE * estimate)
+        {
+            break;
+        }
+    }
+
+    hpckern_arena_release(ctx, mark);
+    *norm = estimate;
+    return HPCKERN_OK;
+}
+
+// y = A x on the pool.
+static void matvec(hpckern_context_t *ctx, vector_task_t *t, const hpckern_matrix_t *mat, const double *x, double *y)
+{
+    t->mat = mat;
+    t->x = x;
+    t->y = y;
+    hpckern_parallel_for(ctx, t->num_partials, matvec_task, t);
+}
+
+// out = A^T y through the column accumulation, so A is only read by rows.
+static void matvec_transposed(hpckern_context_t *ctx, vector_task_t *t, const hpckern_matrix_t *mat, double *y, double *out)
+{
+    t->mat = mat;
+    t->y = y;
+    column_accumulate(ctx, t, transposed_matvec_task);
+    memcpy(out, t->values, mat->size * sizeof(double));
+}
+
+// values[task] = 1 when the rows of the task hold no negative entry.
+static void nonnegative_task(void *arg, size_t task)
+{
+    const vector_task_t *t = (const vector_task_t *)arg;
+    const size_t N = t->mat->size;
+    size_t row_start, row_end;
+    double result = 1.0;
+
+    task_rows(t, task, &row_start, &row_end);
+
+    for (size_t k = row_start * N; k < row_end * N && result != 0.0; k++)
+    {
+        result = t->mat->data[k] < 0.0 ? 0.0 : result;
+    }
+
+    t->values[task] = result;
+}
+
+static bool matrix_nonnegative(hpckern_context_t *ctx, vector_task_t *t, const hpckern_matrix_t *mat)
+{
+    t->mat = mat;
+    hpckern_parallel_for(ctx, t->num_partials, nonnegative_task, t);
+    for (size_t i = 0; i < t->num_partials; i++)
+    {
+        if (t->values[i] == 0.0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hager's estimator with Higham's refinements (as in LAPACK's dlacon) for
+// ||C||_1 with C = (A B)^T, since ||A B||_inf = ||(A B)^T||_1. C x is
+// B^T (A^T x) and C^T x is A (B x), so every step costs four matrix-vector
+// products. Every candidate is ||C x||_1 / ||x||_1 for some x, so the result
+// never exceeds the true norm.
+static double product_norm_hager(hpckern_context_t *ctx, vector_task_t *t, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double *x, double *v, double *y, double *z)
+{
+    const size_t N = lhs->size;
+    double estimate = 0.0;
+    double alternative = 0.0;
+
+    for (size_t j = 0; j < N; j++)
+    {
+        x[j] = 1.0 / (double)N;
+    }
+
+    for (size_t iteration = 0; iteration < HPCKERN_ESTIMATE_MAX_ITERATIONS; iteration++)
+    {
+        double candidate = 0.0;
+        double z_dot_x = 0.0;
+        size_t j_max = 0;
+
+        matvec_transposed(ctx, t, lhs, x, v);
+        matvec_transposed(ctx, t, rhs, v, y);
+        for (size_t i = 0; i < N; i++)
+        {
+            candidate += fabs(y[i]);
+        }
+        if (iteration > 0 && candidate <= estimate)
+        {
+            break;
+        }
+        estimate = candidate;
+
+        for (size_t i = 0; i < N; i++)
+        {
+            y[i] = y[i] >= 0.0 ? 1.0 : -1.0;
+        }
+        matvec(ctx, t, rhs, y, v);
+        matvec(ctx, t, lhs, v, z);
+
+        for (size_t i = 0; i < N; i++)
+        {
+            z_dot_x += z[i] * x[i];
+            j_max = fabs(z[i]) > fabs(z[j_max]) ? i : j_max;
+        }
+        if (fabs(z[j_max]) <= z_dot_x)
+        {
+            break;
+        }
+
+        memset(x, 0, N * sizeof(double));
+        x[j_max] = 1.0;
+    }
+
+    // Higham's alternating vector catches matrices whose structure fools the
+    // unit-vector steps; its 1-norm is 3N/2.
+    for (size_t i = 0; i < N; i++)
+    {
+        x[i] = (i % 2 == 0 ? 1.0 : -1.0) * (1.0 + (N > 1 ? (double)i / (double)(N - 1) : 0.0));
+    }
+    matvec_transposed(ctx, t, lhs, x, v);
+    matvec_transposed(ctx, t, rhs, v, y);
+    for (size_t i = 0; i < N; i++)
+    {
+        alternative += fabs(y[i]);
+    }
+
+    return MAX(estimate, alternative * 2.0 / (3.0 * (double)N));
+}
+
+hpckern_status_t hpckern_matrix_norm_product_estimate(hpckern_context_t *ctx, size_t num_tasks, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, long double *norm, bool *is_exact)
+{
+    const size_t N = lhs->size;
+    const size_t mark = hpckern_arena_mark(ctx);
+    vector_task_t task;
+    double *x, *v, *y, *z;
+    long double result;
+
+    CHECK_ARGUMENT(same_size(lhs, rhs) && rhs->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+    RETURN_IF_ERROR(vector_task_init(&task, num_tasks, lhs));
+
+    const bool allocated = vector_task_alloc_columns(ctx, &task);
+    x = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    v = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    y = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    z = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    if (!allocated || x == NULL || v == NULL || y == NULL || z == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    *is_exact = matrix_nonnegative(ctx, &task, lhs) && matrix_nonnegative(ctx, &task, rhs);
+
+    if (*is_exact)
+    {
+        // |A B| = A B entrywise, so the row sums of A B are A (B 1).
+        for (size_t j = 0; j < N; j++)
+        {
+            x[j] = 1.0;
+        }
+        matvec(ctx, &task, rhs, x, v);
+        matvec(ctx, &task, lhs, v, y);
+        result = vector_max(y, N);
+    }
+    else
+    {
+        result = product_norm_hager(ctx, &task, lhs, rhs, x, v, y, z);
+    }
+
+    hpckern_arena_release(ctx, mark);
+    *norm = result;
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_norm(hpckern_context_t *ctx, hpckern_variant_t variant, hpckern_norm_kind_t kind, size_t block_size, const hpckern_matrix_t *mat, long double *norm)
+{
+    const bool is_threaded = variant == HPCKERN_THREADED;
+    const size_t num_tasks = is_threaded ? hpckern_context_num_threads(ctx) : 1;
+
+    switch (kind)
+    {
+    case HPCKERN_NORM_INF:
+        if (mat->layout == HPCKERN_LAYOUT_TILED)
+        {
+            return is_threaded ? hpckern_matrix_norm_tiled_threaded(ctx, mat, norm) : hpckern_matrix_norm_tiled_serial(mat, norm);
+        }
+        return is_threaded ? hpckern_matrix_norm_threaded(ctx, block_size, mat, norm) : hpckern_matrix_norm_serial(block_size, mat, norm);
+    case HPCKERN_NORM_ONE:
+        return hpckern_matrix_norm_one(ctx, num_tasks, mat, norm);
+    case HPCKERN_NORM_FROBENIUS:
+        return hpckern_matrix_norm_frobenius(ctx, num_tasks, mat, norm);
+    case HPCKERN_NORM_MAX_ABS:
+        return hpckern_matrix_norm_max_abs(ctx, num_tasks, mat, norm);
+    case HPCKERN_NORM_TWO:
+        return hpckern_matrix_norm_two(ctx, num_tasks, mat, norm);
+    default:
+        return HPCKERN_ERROR_INVALID_ARGUMENT;
+    }
+}
@@ -0,0 +1,335 @@
+#define _GNU_SOURCE
+
+#include "hpckern_internal.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/* The Makefile passes the revision and flags libhpckern was built from. */
+#ifndef HPCKERN_GIT_REVISION
+#define HPCKERN_GIT_REVISION "unknown"
+#endif
+#ifndef HPCKERN_BUILD_FLAGS
+#define HPCKERN_BUILD_FLAGS "unknown"
+#endif
+#if defined(__clang__)
+#define HPCKERN_COMPILER __VERSION__
+#elif defined(__GNUC__)
+#define HPCKERN_COMPILER "gcc " __VERSION__
+#else
+#define HPCKERN_COMPILER "unknown"
+#endif
+
+#define SYSFS_CACHE_DIR "/sys/devices/system/cpu/cpu0/cache"
+
+static const char *const FORMAT_NAMES[HPCKERN_NUM_FORMATS] = {
+    [HPCKERN_FORMAT_YAML] = "yaml",
+    [HPCKERN_FORMAT_JSON] = "json",
+    [HPCKERN_FORMAT_CSV] = "csv",
+};
+
+const char *hpckern_format_name(hpckern_format_t format)
+{
+    return format < HPCKERN_NUM_FORMATS ? FORMAT_NAMES[format] : "unknown";
+}
+
+bool hpckern_format_from_name(const char *name, hpckern_format_t *format)
+{
+    for (size_t i = 0; i < HPCKERN_NUM_FORMATS; i++)
+    {
+        if (strcmp(name, FORMAT_NAMES[i]) == 0)
+        {
+            *format = (hpckern_format_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reads the first line of `path` without its newline; false when missing.
+static bool read_line(const char *path, char *buf, size_t size)
+{
+    FILE *file = fopen(path, "r");
+    bool ok;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+    ok = fgets(buf, (int)size, file) != NULL;
+    fclose(file);
+    if (ok)
+    {
+        buf[strcspn(buf, "\n")] = '\0';
+    }
+    return ok;
+}
+
+// "48K", "2048K", "32M" as sysfs and /proc/cpuinfo write them.
+static size_t parse_size(const char *text)
+{
+    char *unit;
+    const unsigned long long value = strtoull(text, &unit, 10);
+
+    while (*unit == ' ')
+    {
+        unit++;
+    }
+    switch (*unit)
+    {
+    case 'K':
+    case 'k':
+        return (size_t)value << 10;
+    case 'M':
+    case 'm':
+        return (size_t)value << 20;
+    case 'G':
+    case 'g':
+        return (size_t)value << 30;
+    default:
+        return (size_t)value;
+    }
+}
+
+static void probe_cpuinfo(hpckern_system_info_t *info)
+{
+    FILE *file = fopen("/proc/cpuinfo", "r");
+    char line[512];
+
+    if (file == NULL)
+    {
+        return;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        const char *value = strchr(line, ':');
+
+        if (value == NULL)
+        {
+            continue;
+        }
+        value++;
+        while (*value == ' ' || *value == '\t')
+        {
+            value++;
+        }
+
+        if (info->cpu_model[0] == '\0' && strncmp(line, "model name", 10) == 0)
+        {
+            snprintf(info->cpu_model, sizeof(info->cpu_model), "%s", value);
+            info->cpu_model[strcspn(info->cpu_model, "\n")] = '\0';
+        }
+        else if (info->l2_cache == 0 && strncmp(line, "cache size", 10) == 0)
+        {
+            info->l2_cache = parse_size(value);
+        }
+    }
+    fclose(file);
+}
+
+// One indexN directory per cache of cpu0; these override /proc/cpuinfo,
+// whose "cache size" is the last-level cache on most x86 kernels.
+static void probe_sysfs_caches(hpckern_system_info_t *info)
+{
+    for (int index = 0;; index++)
+    {
+        char path[128];
+        char level[16];
+        char type[32];
+        char size[32];
+        size_t bytes;
+
+        snprintf(path, sizeof(path), SYSFS_CACHE_DIR "/index%d/level", index);
+        if (!read_line(path, level, sizeof(level)))
+        {
+            break;
+        }
+        snprintf(path, sizeof(path), SYSFS_CACHE_DIR "/index%d/type", index);
+        if (!read_line(path, type, sizeof(type)))
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), SYSFS_CACHE_DIR "/index%d/size", index);
+        if (!read_line(path, size, sizeof(size)))
+        {
+            continue;
+        }
+
+        bytes = parse_size(size);
+        if (strcmp(level, "1") == 0 && strcmp(type, "Data") == 0)
+        {
+            info->l1d_cache = bytes;
+        }
+        else if (strcmp(level, "1") == 0 && strcmp(type, "Instruction") == 0)
+        {
+            info->l1i_cache = bytes;
+        }
+        else if (strcmp(level, "2") == 0)
+        {
+            info->l2_cache = bytes;
+        }
+        else if (strcmp(level, "3") == 0)
+        {
+            info->l3_cache = bytes;
+        }
+    }
+}
+
+// Writes the allowed CPUs as ranges, "0-3,8".
+static void probe_affinity(hpckern_system_info_t *info)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    size_t used = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        int last = cpu;
+        int written;
+
+        if (!CPU_ISSET(cpu, &set))
+        {
+            continue;
+        }
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set))
+        {
+            last++;
+        }
+        written = last > cpu
+                      ? snprintf(&info->affinity[used], sizeof(info->affinity) - used, "%s%d-%d", used > 0 ? "," : "", cpu, last)
+                      : snprintf(&info->affinity[used], sizeof(info->affinity) - used, "%s%d", used > 0 ? "," : "", cpu);
+        if (written < 0 || (size_t)written >= sizeof(info->affinity) - used)
+        {
+            break;
+        }
+        used += (size_t)written;
+        cpu = last;
+    }
+#else
+    (void)info;
+#endif
+}
+
+void hpckern_system_info_probe(hpckern_system_info_t *info)
+{
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    memset(info, 0, sizeof(hpckern_system_info_t));
+    info->num_cpus = num_cpus > 0 ? (size_t)num_cpus : 0;
+    info->compiler = HPCKERN_COMPILER;
+    info->build_flags = HPCKERN_BUILD_FLAGS;
+    info->git_revision = HPCKERN_GIT_REVISION;
+
+    probe_cpuinfo(info);
+    probe_sysfs_caches(info);
+    probe_affinity(info);
+}
+
+void hpckern_write_json_string(FILE *file, const char *s)
+{
+    fputc('"', file);
+    for (; *s != '\0'; s++)
+    {
+        const unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\')
+        {
+            fprintf(file, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+void hpckern_write_csv_string(FILE *file, const char *s)
+{
+    if (strpbrk(s, ",\"\n") == NULL)
+    {
+        fputs(s, file);
+        return;
+    }
+
+    fputc('"', file);
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"')
+        {
+            fputc('"', file);
+        }
+        fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+void hpckern_system_info_write_yaml(FILE *file, size_t indent, const hpckern_system_info_t *info)
+{
+    const int pad = (int)indent;
+
+    // JSON strings are valid YAML scalars, and model names and flags may
+    // hold colons or quotes.
+    fprintf(file, "%*ssystem:\n", pad, "");
+    fprintf(file, "%*s  cpu_model: ", pad, "");
+    hpckern_write_json_string(file, info->cpu_model);
+    fprintf(file, "\n%*s  num_cpus: %zu\n", pad, "", info->num_cpus);
+    fprintf(file, "%*s  l1d_cache: %zu\n", pad, "", info->l1d_cache);
+    fprintf(file, "%*s  l1i_cache: %zu\n", pad, "", info->l1i_cache);
+    fprintf(file, "%*s  l2_cache: %zu\n", pad, "", info->l2_cache);
+    fprintf(file, "%*s  l3_cache: %zu\n", pad, "", info->l3_cache);
+    fprintf(file, "%*s  affinity: \"%s\"\n", pad, "", info->affinity);
+    fprintf(file, "%*s  compiler: ", pad, "");
+    hpckern_write_json_string(file, info->compiler);
+    fprintf(file, "\n%*s  build_flags: ", pad, "");
+    hpckern_write_json_string(file, info->build_flags);
+    fprintf(file, "\n%*s  git_revision: \"%s\"\n", pad, "", info->git_revision);
+}
+
+void hpckern_system_info_write_json(FILE *file, size_t indent, const hpckern_system_info_t *info)
+{
+    const int pad = (int)indent;
+
+    fprintf(file, "\"system\": {\n");
+    fprintf(file, "%*s\"cpu_model\": ", pad, "");
+    hpckern_write_json_string(file, info->cpu_model);
+    fprintf(file, ",\n%*s\"num_cpus\": %zu,\n", pad, "", info->num_cpus);
+    fprintf(file, "%*s\"l1d_cache\": %zu,\n", pad, "", info->l1d_cache);
+    fprintf(file, "%*s\"l1i_cache\": %zu,\n", pad, "", info->l1i_cache);
+    fprintf(file, "%*s\"l2_cache\": %zu,\n", pad, "", info->l2_cache);
+    fprintf(file, "%*s\"l3_cache\": %zu,\n", pad, "", info->l3_cache);
+    fprintf(file, "%*s\"affinity\": ", pad, "");
+    hpckern_write_json_string(file, info->affinity);
+    fprintf(file, ",\n%*s\"compiler\": ", pad, "");
+    hpckern_write_json_string(file, info->compiler);
+    fprintf(file, ",\n%*s\"build_flags\": ", pad, "");
+    hpckern_write_json_string(file, info->build_flags);
+    fprintf(file, ",\n%*s\"git_revision\": ", pad, "");
+    hpckern_write_json_string(file, info->git_revision);
+    fprintf(file, "\n%*s}", pad >= 2 ? pad - 2 : 0, "");
+}
+
+void hpckern_system_info_write_csv(FILE *file, const hpckern_system_info_t *info)
+{
+    hpckern_write_csv_string(file, info->cpu_model);
+    fprintf(file, ",%zu,%zu,%zu,%zu,%zu,", info->num_cpus, info->l1d_cache, info->l1i_cache, info->l2_cache, info->l3_cache);
+    hpckern_write_csv_string(file, info->affinity);
+    fputc(',', file);
+    hpckern_write_csv_string(file, info->compiler);
+    fputc(',', file);
+    hpckern_write_csv_string(file, info->build_flags);
+    fputc(',', file);
+    hpckern_write_csv_string(file, info->git_revision);
+}
@@ -0,0 +1,509 @@
+#include "hpckern_internal.h"
+
+#include <string.h>
+
+/* Rows of sparse operands vary a lot in cost, so the kernels hand out this
+ * many tasks per thread and let the pool balance them. */
+#define STRUCTURED_TASKS_PER_THREAD 4
+
+typedef struct structured_task_t
+{
+    double alpha;
+    double beta;
+    const hpckern_matrix_t *lhs;
+    const hpckern_matrix_t *rhs;
+    hpckern_matrix_t *result;
+    size_t rows_per_task;
+    bool upper;
+} structured_task_t;
+
+typedef struct scan_task_t
+{
+    const hpckern_matrix_t *mat;
+    hpckern_matrix_structure_t *partials;
+    size_t rows_per_task;
+} scan_task_t;
+
+/* Both passes of hpckern_matrix_to_csr: the first counts the nonzeros of
+ * every row into row_ptr[i + 1], the second copies them once row_ptr is a
+ * prefix sum. */
+typedef struct csr_task_t
+{
+    const hpckern_matrix_t *mat;
+    hpckern_matrix_t *csr;
+    size_t rows_per_task;
+    bool fill;
+} csr_task_t;
+
+typedef void (*structured_rows_fn_t)(const structured_task_t *t, size_t row_start, size_t row_end);
+
+static const char *const PATH_NAMES[HPCKERN_NUM_PATHS] = {
+    [HPCKERN_PATH_DENSE] = "dense",
+    [HPCKERN_PATH_CSR] = "csr",
+    [HPCKERN_PATH_BANDED] = "banded",
+    [HPCKERN_PATH_UPPER_TRIANGULAR] = "upper",
+    [HPCKERN_PATH_LOWER_TRIANGULAR] = "lower",
+};
+
+const char *hpckern_path_name(hpckern_path_t path)
+{
+    return path < HPCKERN_NUM_PATHS ? PATH_NAMES[path] : "unknown";
+}
+
+// Whether nonzero entries can be drawn from [min_value, max_value] into `mat`.
+static bool nonzero_arguments(const hpckern_matrix_t *mat, int min_value, int max_value)
+{
+    return mat->layout == HPCKERN_LAYOUT_ROW_MAJOR && min_value <= max_value && (min_value != 0 || max_value != 0);
+}
+
+static double random_nonzero(hpckern_rng_t *rng, int min_value, int max_value)
+{
+    int value;
+
+    do
+    {
+        value = hpckern_rng_int(rng, min_value, max_value);
+    } while (value == 0);
+    return value;
+}
+
+// Compares the top 53 bits of a draw, a uniform double in [0, 1), against
+// the density.
+hpckern_status_t hpckern_matrix_random_sparse(hpckern_rng_t *rng, hpckern_matrix_t *mat, double density, int min_value, int max_value)
+{
+    const size_t N = mat->size;
+
+    CHECK_ARGUMENT(nonzero_arguments(mat, min_value, max_value));
+
+    for (size_t i = 0; i < N * N; i++)
+    {
+        const double u = (hpckern_rng_next(rng) >> 11) * 0x1p-53;
+        mat->data[i] = u < density ? random_nonzero(rng, min_value, max_value) : 0.0;
+    }
+
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_random_banded(hpckern_rng_t *rng, hpckern_matrix_t *mat, size_t lower_bandwidth, size_t upper_bandwidth, int min_value, int max_value)
+{
+    const size_t N = mat->size;
+
+    CHECK_ARGUMENT(nonzero_arguments(mat, min_value, max_value));
+
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = 0; j < N; j++)
+        {
+            const bool in_band = j + lower_bandwidth >= i && j <= i + upper_bandwidth;
+            mat->data[i * N + j] = in_band ? random_nonzero(rng, min_value, max_value) : 0.0;
+        }
+    }
+
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_random_triangular(hpckern_rng_t *rng, hpckern_matrix_t *mat, bool upper, int min_value, int max_value)
+{
+    const size_t N = mat->size;
+
+    return hpckern_matrix_random_banded(rng, mat, upper ? 0 : N, upper ? N : 0, min_value, max_value);
+}
+
+static void scan_task(void *arg, size_t task)
+{
+    const scan_task_t *t = (const scan_task_t *)arg;
+    const size_t N = t->mat->size;
+    const size_t row_start = MIN(task * t->rows_per_task, N);
+    const size_t row_end = MIN(row_start + t->rows_per_task, N);
+    hpckern_matrix_structure_t *structure = &t->partials[task];
+
+    memset(structure, 0, sizeof(hpckern_matrix_structure_t));
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        for (size_t j = 0; j < N; j++)
+        {
+            if (t->mat->data[i * N + j] == 0.0)
+            {
+                continue;
+            }
+            structure->nnz++;
+            if (i > j)
+            {
+                structure->lower_bandwidth = MAX(structure->lower_bandwidth, i - j);
+            }
+            else
+            {
+                structure->upper_bandwidth = MAX(structure->upper_bandwidth, j - i);
+            }
+        }
+    }
+}
+
+hpckern_status_t hpckern_matrix_structure_scan(hpckern_context_t *ctx, const hpckern_matrix_t *mat, hpckern_matrix_structure_t *structure)
+{
+    const size_t N = mat->size;
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    const size_t mark = hpckern_arena_mark(ctx);
+    scan_task_t task = {
+        .mat = mat,
+        .rows_per_task = (N + num_threads - 1) / num_threads,
+    };
+
+    CHECK_ARGUMENT(mat->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+    task.partials = (hpckern_matrix_structure_t *)hpckern_arena_alloc(ctx, num_threads * sizeof(hpckern_matrix_structure_t));
+    if (task.partials == NULL)
+    {
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    hpckern_parallel_for(ctx, num_threads, scan_task, &task);
+    memset(structure, 0, sizeof(hpckern_matrix_structure_t));
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        structure->nnz += task.partials[i].nnz;
+        structure->lower_bandwidth = MAX(structure->lower_bandwidth, task.partials[i].lower_bandwidth);
+        structure->upper_bandwidth = MAX(structure->upper_bandwidth, task.partials[i].upper_bandwidth);
+    }
+    structure->density = N > 0 ? (double)structure->nnz / ((double)N * N) : 0.0;
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
+
+static void csr_task(void *arg, size_t task)
+{
+    const csr_task_t *t = (const csr_task_t *)arg;
+    const size_t N = t->mat->size;
+    const size_t row_start = MIN(task * t->rows_per_task, N);
+    const size_t row_end = MIN(row_start + t->rows_per_task, N);
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        const double *row = &t->mat->data[i * N];
+        size_t nnz = 0;
+
+        if (!t->fill)
+        {
+            for (size_t j = 0; j < N; j++)
+            {
+                nnz += row[j] != 0.0;
+            }
+            t->csr->row_ptr[i + 1] = nnz;
+            continue;
+        }
+
+        nnz = t->csr->row_ptr[i];
+        for (size_t j = 0; j < N; j++)
+        {
+            if (row[j] != 0.0)
+            {
+                t->csr->data[nnz] = row[j];
+                t->csr->col_idx[nnz] = j;
+                nnz++;
+            }
+        }
+    }
+}
+
+hpckern_matrix_t *hpckern_matrix_to_csr(hpckern_context_t *ctx, const hpckern_matrix_t *mat)
+{
+    const size_t N = mat->size;
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    hpckern_matrix_t *csr;
+    csr_task_t task = {
+        .mat = mat,
+        .rows_per_task = (N + num_threads - 1) / num_threads,
+        .fill = false,
+    };
+
+    if (mat->layout != HPCKERN_LAYOUT_ROW_MAJOR || (csr = (hpckern_matrix_t *)calloc(1, sizeof(hpckern_matrix_t))) == NULL)
+    {
+        return NULL;
+    }
+
+    task.csr = csr;
+    csr->size = N;
+    csr->layout = HPCKERN_LAYOUT_CSR;
+    csr->row_ptr = (size_t *)calloc(N + 1, sizeof(size_t));
+    if (csr->row_ptr == NULL)
+    {
+        hpckern_matrix_destroy(&csr);
+        return NULL;
+    }
+    hpckern_parallel_for(ctx, num_threads, csr_task, &task);
+    for (size_t i = 0; i < N; i++)
+    {
+        csr->row_ptr[i + 1] += csr->row_ptr[i];
+    }
+
+    csr->nnz = csr->row_ptr[N];
+    csr->data = (double *)calloc(MAX(csr->nnz, (size_t)1), sizeof(double));
+    csr->col_idx = (size_t *)calloc(MAX(csr->nnz, (size_t)1), sizeof(size_t));
+    if (csr->data == NULL || csr->col_idx == NULL)
+    {
+        hpckern_matrix_destroy(&csr);
+        return NULL;
+    }
+    task.fill = true;
+    hpckern_parallel_for(ctx, num_threads, csr_task, &task);
+
+    return csr;
+}
+
+// Entries outside the band are dropped, so callers pass the bandwidths
+// hpckern_matrix_structure_scan measured.
+hpckern_matrix_t *hpckern_matrix_to_banded(const hpckern_matrix_t *mat, size_t lower_bandwidth, size_t upper_bandwidth)
+{
+    const size_t N = mat->size;
+    const size_t width = lower_bandwidth + 1 + upper_bandwidth;
+    hpckern_matrix_t *banded;
+
+    if (mat->layout != HPCKERN_LAYOUT_ROW_MAJOR || (banded = (hpckern_matrix_t *)calloc(1, sizeof(hpckern_matrix_t))) == NULL)
+    {
+        return NULL;
+    }
+
+    banded->size = N;
+    banded->layout = HPCKERN_LAYOUT_BANDED;
+    banded->lower_bandwidth = lower_bandwidth;
+    banded->upper_bandwidth = upper_bandwidth;
+    banded->data = (double *)calloc(MAX(N * width, (size_t)1), sizeof(double));
+    if (banded->data == NULL)
+    {
+        free(banded);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < N; i++)
+    {
+        const size_t j_start = i > lower_bandwidth ? i - lower_bandwidth : 0;
+        const size_t j_end = MIN(i + upper_bandwidth + 1, N);
+        memcpy(
+            &banded->data[i * width + j_start + lower_bandwidth - i],
+            &mat->data[i * N + j_start],
+            (j_end - j_start) * sizeof(double));
+        banded->nnz += j_end - j_start;
+    }
+
+    return banded;
+}
+
+static inline void row_axpy(size_t N, double a, const double *x, double *y)
+{
+    for (size_t j = 0; j < N; j++)
+    {
+        y[j] += a * x[j];
+    }
+}
+
+static void spmm_rows(const structured_task_t *t, size_t row_start, size_t row_end)
+{
+    const size_t N = t->lhs->size;
+    const hpckern_matrix_t *A = t->lhs;
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        double *result_row = &t->result->data[i * N];
+        for (size_t p = A->row_ptr[i]; p < A->row_ptr[i + 1]; p++)
+        {
+            row_axpy(N, t->alpha * A->data[p], &t->rhs->data[A->col_idx[p] * N], result_row);
+        }
+    }
+}
+
+static void gbmm_rows(const structured_task_t *t, size_t row_start, size_t row_end)
+{
+    const size_t N = t->lhs->size;
+    const size_t l = t->lhs->lower_bandwidth;
+    const size_t width = l + 1 + t->lhs->upper_bandwidth;
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        const double *band = &t->lhs->data[i * width + l - i];
+        const size_t j_start = i > l ? i - l : 0;
+        const size_t j_end = MIN(i + t->lhs->upper_bandwidth + 1, N);
+        double *result_row = &t->result->data[i * N];
+
+        for (size_t k = j_start; k < j_end; k++)
+        {
+            if (band[k] != 0.0)
+            {
+                row_axpy(N, t->alpha * band[k], &t->rhs->data[k * N], result_row);
+            }
+        }
+    }
+}
+
+static void trmm_rows(const structured_task_t *t, size_t row_start, size_t row_end)
+{
+    const size_t N = t->lhs->size;
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        const size_t k_start = t->upper ? i : 0;
+        const size_t k_end = t->upper ? N : i + 1;
+        double *result_row = &t->result->data[i * N];
+
+        for (size_t k = k_start; k < k_end; k++)
+        {
+            row_axpy(N, t->alpha * t->lhs->data[i * N + k], &t->rhs->data[k * N], result_row);
+        }
+    }
+}
+
+// Row i of the lower triangle of A A^T is the dot products of row i with the
+// rows before it, so it reads both operands with unit stride.
+static void syrk_rows(const structured_task_t *t, size_t row_start, size_t row_end)
+{
+    const size_t N = t->lhs->size;
+
+    for (size_t i = row_start; i < row_end; i++)
+    {
+        const double *row_i = &t->lhs->data[i * N];
+        for (size_t j = 0; j <= i; j++)
+        {
+            const double *row_j = &t->lhs->data[j * N];
+            double *c = &t->result->data[i * N + j];
+            double sum = 0.0;
+            for (size_t k = 0; k < N; k++)
+            {
+                sum += row_i[k] * row_j[k];
+            }
+            *c = t->alpha * sum + (t->beta == 0.0 ? 0.0 : t->beta * *c);
+        }
+    }
+}
+
+typedef struct structured_run_t
+{
+    structured_task_t task;
+    structured_rows_fn_t rows;
+    bool scale;
+} structured_run_t;
+
+static void structured_task(void *arg, size_t task)
+{
+    const structured_run_t *run = (const structured_run_t *)arg;
+    const size_t N = run->task.lhs->size;
+    const size_t row_start = MIN(task * run->task.rows_per_task, N);
+    const size_t row_end = MIN(row_start + run->task.rows_per_task, N);
+
+    if (run->scale)
+    {
+        hpckern_matrix_scale_rows(run->task.beta, run->task.result->data, N, row_start, row_end);
+    }
+    run->rows(&run->task, row_start, row_end);
+}
+
+// Tasks own disjoint row ranges of C; `scale` applies beta to them first for
+// the kernels that accumulate into C.
+static hpckern_status_t structured_run(hpckern_context_t *ctx, structured_rows_fn_t rows, bool scale, bool upper, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    const size_t N = lhs->size;
+    const size_t num_tasks = MIN(hpckern_context_num_threads(ctx) * STRUCTURED_TASKS_PER_THREAD, MAX(N, (size_t)1));
+    structured_run_t run = {
+        .task = {
+            .alpha = alpha,
+            .beta = beta,
+            .lhs = lhs,
+            .rhs = rhs,
+            .result = result,
+            .rows_per_task = (N + num_tasks - 1) / num_tasks,
+            .upper = upper,
+        },
+        .rows = rows,
+        .scale = scale,
+    };
+
+    CHECK_ARGUMENT(
+        same_size(lhs, rhs) && same_size(lhs, result) &&
+        rhs->layout == HPCKERN_LAYOUT_ROW_MAJOR && result->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+    hpckern_parallel_for(ctx, num_tasks, structured_task, &run);
+    return HPCKERN_OK;
+}
+
+hpckern_status_t hpckern_matrix_spmm(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(lhs->layout == HPCKERN_LAYOUT_CSR);
+    return structured_run(ctx, spmm_rows, true, false, alpha, lhs, rhs, beta, result);
+}
+
+hpckern_status_t hpckern_matrix_gbmm(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(lhs->layout == HPCKERN_LAYOUT_BANDED);
+    return structured_run(ctx, gbmm_rows, true, false, alpha, lhs, rhs, beta, result);
+}
+
+hpckern_status_t hpckern_matrix_trmm(hpckern_context_t *ctx, bool upper, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(lhs->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+    return structured_run(ctx, trmm_rows, true, upper, alpha, lhs, rhs, beta, result);
+}
+
+hpckern_status_t hpckern_matrix_syrk(hpckern_context_t *ctx, double alpha, const hpckern_matrix_t *lhs, double beta, hpckern_matrix_t *result)
+{
+    CHECK_ARGUMENT(lhs->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+    return structured_run(ctx, syrk_rows, false, false, alpha, lhs, lhs, beta, result);
+}
+
+// The compressed copies of lhs live only for this call; a copy that cannot
+// be allocated is reported rather than falling back to the dense path.
+hpckern_status_t hpckern_gemm_auto(hpckern_context_t *ctx, hpckern_variant_t variant, size_t block_size, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result, hpckern_path_t *path)
+{
+    const size_t N = lhs->size;
+    hpckern_path_t chosen = HPCKERN_PATH_DENSE;
+    hpckern_matrix_structure_t structure;
+    hpckern_status_t status;
+
+    if (lhs->layout != HPCKERN_LAYOUT_ROW_MAJOR || rhs->layout != HPCKERN_LAYOUT_ROW_MAJOR || result->layout != HPCKERN_LAYOUT_ROW_MAJOR)
+    {
+        status = hpckern_gemm(ctx, variant, block_size, alpha, lhs, rhs, beta, result);
+        if (status == HPCKERN_OK && path != NULL)
+        {
+            *path = lhs->layout == HPCKERN_LAYOUT_CSR      ? HPCKERN_PATH_CSR
+                    : lhs->layout == HPCKERN_LAYOUT_BANDED ? HPCKERN_PATH_BANDED
+                                                           : HPCKERN_PATH_DENSE;
+        }
+        return status;
+    }
+
+    RETURN_IF_ERROR(hpckern_matrix_structure_scan(ctx, lhs, &structure));
+
+    if ((structure.lower_bandwidth + 1 + structure.upper_bandwidth) * HPCKERN_BANDED_MIN_RATIO <= N)
+    {
+        hpckern_matrix_t *banded = hpckern_matrix_to_banded(lhs, structure.lower_bandwidth, structure.upper_bandwidth);
+        if (banded == NULL)
+        {
+            return HPCKERN_ERROR_OUT_OF_MEMORY;
+        }
+        status = hpckern_matrix_gbmm(ctx, alpha, banded, rhs, beta, result);
+        hpckern_matrix_destroy(&banded);
+        chosen = HPCKERN_PATH_BANDED;
+    }
+    else if (structure.density <= HPCKERN_SPARSE_MAX_DENSITY)
+    {
+        hpckern_matrix_t *csr = hpckern_matrix_to_csr(ctx, lhs);
+        if (csr == NULL)
+        {
+            return HPCKERN_ERROR_OUT_OF_MEMORY;
+        }
+        status = hpckern_matrix_spmm(ctx, alpha, csr, rhs, beta, result);
+        hpckern_matrix_destroy(&csr);
+        chosen = HPCKERN_PATH_CSR;
+    }
+    else if (structure.lower_bandwidth == 0 || structure.upper_bandwidth == 0)
+    {
+        const bool upper = structure.lower_bandwidth == 0;
+        status = hpckern_matrix_trmm(ctx, upper, alpha, lhs, rhs, beta, result);
+        chosen = upper ? HPCKERN_PATH_UPPER_TRIANGULAR : HPCKERN_PATH_LOWER_TRIANGULAR;
+    }
+    else
+    {
+        status = hpckern_gemm(ctx, variant, block_size, alpha, lhs, rhs, beta, result);
+    }
+
+    if (status == HPCKERN_OK && path != NULL)
+    {
+        *path = chosen;
+    }
+    return status;
+}
@@ -0,0 +1,223 @@
+#include "hpckern_internal.h"
+
+#ifdef HPCKERN_TRACE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef struct trace_event_t
+{
+    uint64_t timestamp;
+    const char *name;
+    size_t arg;
+    char phase;
+} trace_event_t;
+
+/* Written by its own thread only. Buffers are never freed: a worker's events
+ * outlive it until the process dumps them. */
+typedef struct trace_buffer_t
+{
+    struct trace_buffer_t *next;
+    size_t tid;
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+    trace_event_t events[HPCKERN_TRACE_CAPACITY];
+} trace_buffer_t;
+
+static _Atomic(trace_buffer_t *) trace_buffers = NULL;
+static atomic_size_t trace_num_buffers = 0;
+static _Thread_local trace_buffer_t *trace_buffer = NULL;
+
+/* Cycle counter and monotonic clock at the first event; the dump converts
+ * ticks to microseconds with the rate measured since then. */
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static uint64_t trace_origin_ticks;
+static uint64_t trace_origin_ns;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// The TSC on x86 and the virtual counter on arm64 cost a few cycles and need
+// no system call; elsewhere the monotonic clock stands in.
+static inline uint64_t read_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return monotonic_ns();
+#endif
+}
+
+static void trace_calibrate_origin(void)
+{
+    trace_origin_ns = monotonic_ns();
+    trace_origin_ticks = read_ticks();
+}
+
+// NULL when the buffer cannot be allocated; the thread's events are dropped
+// and the next one tries again.
+static trace_buffer_t *trace_register(void)
+{
+    trace_buffer_t *buffer = (trace_buffer_t *)aligned_alloc(CACHE_LINE_SIZE, sizeof(trace_buffer_t));
+
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+    pthread_once(&trace_once, trace_calibrate_origin);
+
+    memset(buffer, 0, sizeof(trace_buffer_t));
+    buffer->tid = atomic_fetch_add_explicit(&trace_num_buffers, 1, memory_order_relaxed);
+    buffer->next = atomic_load_explicit(&trace_buffers, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&trace_buffers, &buffer->next, buffer, memory_order_release, memory_order_relaxed))
+    {
+    }
+
+    trace_buffer = buffer;
+    return buffer;
+}
+
+static inline void trace_record(char phase, const char *name, size_t arg)
+{
+    trace_buffer_t *buffer = trace_buffer != NULL ? trace_buffer : trace_register();
+    size_t head;
+    trace_event_t *event;
+
+    if (buffer == NULL)
+    {
+        return;
+    }
+    head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    event = &buffer->events[head % HPCKERN_TRACE_CAPACITY];
+    event->timestamp = read_ticks();
+    event->name = name;
+    event->arg = arg;
+    event->phase = phase;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+bool hpckern_trace_enabled(void)
+{
+    return true;
+}
+
+void hpckern_trace_begin(const char *name, size_t arg)
+{
+    trace_record('B', name, arg);
+}
+
+void hpckern_trace_end(const char *name)
+{
+    trace_record('E', name, HPCKERN_TRACE_NO_ARG);
+}
+
+// A wrapped buffer may start with end events whose begins were overwritten;
+// they are skipped, so every thread's events nest.
+bool hpckern_trace_write_chrome(FILE *file)
+{
+    const int pid = (int)getpid();
+    uint64_t elapsed_ns, elapsed_ticks;
+    double ticks_per_us;
+
+    pthread_once(&trace_once, trace_calibrate_origin);
+    elapsed_ns = monotonic_ns() - trace_origin_ns;
+    elapsed_ticks = read_ticks() - trace_origin_ticks;
+    ticks_per_us = elapsed_ns > 0 ? 1e3 * (double)elapsed_ticks / (double)elapsed_ns : 1e3;
+
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"hpckern\"}}", pid);
+
+    for (trace_buffer_t *buffer = atomic_load_explicit(&trace_buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next)
+    {
+        const size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        const size_t count = MIN(head, HPCKERN_TRACE_CAPACITY);
+        size_t depth = 0;
+
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %zu, \"args\": {\"name\": \"thread %zu\"}}",
+                pid, buffer->tid, buffer->tid);
+
+        for (size_t i = head - count; i < head; i++)
+        {
+            const trace_event_t *event = &buffer->events[i % HPCKERN_TRACE_CAPACITY];
+
+            if (event->phase == 'E')
+            {
+                if (depth == 0)
+                {
+                    continue;
+                }
+                depth--;
+            }
+            else
+            {
+                depth++;
+            }
+
+            fprintf(file, ",\n{\"name\": ");
+            hpckern_write_json_string(file, event->name);
+            fprintf(file, ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %zu",
+                    event->phase, (double)(event->timestamp - trace_origin_ticks) / ticks_per_us, pid, buffer->tid);
+            if (event->arg != HPCKERN_TRACE_NO_ARG)
+            {
+                fprintf(file, ", \"args\": {\"arg\": %zu}", event->arg);
+            }
+            fprintf(file, "}");
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return true;
+}
+
+void hpckern_trace_clear(void)
+{
+    for (trace_buffer_t *buffer = atomic_load_explicit(&trace_buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next)
+    {
+        atomic_store_explicit(&buffer->head, 0, memory_order_release);
+    }
+}
+
+#else
+
+bool hpckern_trace_enabled(void)
+{
+    return false;
+}
+
+void hpckern_trace_begin(const char *name, size_t arg)
+{
+    (void)name;
+    (void)arg;
+}
+
+void hpckern_trace_end(const char *name)
+{
+    (void)name;
+}
+
+bool hpckern_trace_write_chrome(FILE *file)
+{
+    (void)file;
+    return false;
+}
+
+void hpckern_trace_clear(void)
+{
+}
+
+#endif
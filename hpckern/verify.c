@@ -0,0 +1,376 @@
+#include "hpckern_internal.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct apply_task_t
+{
+    const hpckern_matrix_t *mat;
+    bool trans;
+    size_t num_vectors;
+    const double *x;
+    const double *abs_x;
+    double *y;
+    double *abs_y;
+    size_t rows_per_task;
+} apply_task_t;
+
+typedef struct integral_task_t
+{
+    const hpckern_matrix_t *mat;
+    bool *partials;
+    size_t rows_per_task;
+} integral_task_t;
+
+typedef struct compare_task_t
+{
+    hpckern_tolerance_t mode;
+    double tolerance;
+    const hpckern_matrix_t *expected;
+    const hpckern_matrix_t *actual;
+    hpckern_matrix_compare_report_t *partials;
+    size_t rows_per_task;
+} compare_task_t;
+
+static const char *const TOLERANCE_NAMES[HPCKERN_NUM_TOLERANCES] = {
+    [HPCKERN_TOLERANCE_ABS] = "abs",
+    [HPCKERN_TOLERANCE_REL] = "rel",
+    [HPCKERN_TOLERANCE_ULP] = "ulp",
+};
+
+const char *hpckern_tolerance_name(hpckern_tolerance_t mode)
+{
+    return mode < HPCKERN_NUM_TOLERANCES ? TOLERANCE_NAMES[mode] : "unknown";
+}
+
+bool hpckern_tolerance_from_name(const char *name, hpckern_tolerance_t *mode)
+{
+    for (size_t i = 0; i < HPCKERN_NUM_TOLERANCES; i++)
+    {
+        if (strcmp(name, TOLERANCE_NAMES[i]) == 0)
+        {
+            *mode = (hpckern_tolerance_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Maps the bits of a double onto integers that order like the doubles, so
+// -0.0 and 0.0 coincide and adjacent doubles differ by one.
+static inline int64_t ordered_bits(double x)
+{
+    int64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits < 0 ? INT64_MIN - bits : bits;
+}
+
+static inline double ulp_distance(double x, double y)
+{
+    const int64_t ix = ordered_bits(x);
+    const int64_t iy = ordered_bits(y);
+
+    if (isnan(x) || isnan(y))
+    {
+        return NAN;
+    }
+    return ix >= iy ? (double)((uint64_t)ix - (uint64_t)iy) : (double)((uint64_t)iy - (uint64_t)ix);
+}
+
+static inline double entry_error(hpckern_tolerance_t mode, double expected, double actual)
+{
+    const double abs_error = fabs(expected - actual);
+    const double scale = fmax(fabs(expected), fabs(actual));
+
+    switch (mode)
+    {
+    case HPCKERN_TOLERANCE_REL:
+        return scale > 0.0 ? abs_error / scale : abs_error;
+    case HPCKERN_TOLERANCE_ULP:
+        return ulp_distance(expected, actual);
+    default:
+        return abs_error;
+    }
+}
+
+// The row loop only counts and takes maxima, so it stays branch-free and
+// vectorizes; a row is scanned again only to locate a task's first mismatch.
+static void compare_task(void *arg, size_t task)
+{
+    const compare_task_t *t = (const compare_task_t *)arg;
+    const size_t N = t->expected->size;
+    const size_t start = MIN(task * t->rows_per_task, N);
+    const size_t end = MIN(start + t->rows_per_task, N);
+    hpckern_matrix_compare_report_t *partial = &t->partials[task];
+
+    memset(partial, 0, sizeof(hpckern_matrix_compare_report_t));
+
+    for (size_t i = start; i < end; i++)
+    {
+        const double *expected = &t->expected->data[i * N];
+        const double *actual = &t->actual->data[i * N];
+        size_t num_mismatches = 0;
+        double max_abs = partial->max_abs_error;
+        double max_rel = partial->max_rel_error;
+        double max_ulp = partial->max_ulp_error;
+
+        for (size_t j = 0; j < N; j++)
+        {
+            const double abs_error = entry_error(HPCKERN_TOLERANCE_ABS, expected[j], actual[j]);
+            const double rel_error = entry_error(HPCKERN_TOLERANCE_REL, expected[j], actual[j]);
+            const double ulp_error = entry_error(HPCKERN_TOLERANCE_ULP, expected[j], actual[j]);
+            const double error = t->mode == HPCKERN_TOLERANCE_ABS   ? abs_error
+                                 : t->mode == HPCKERN_TOLERANCE_REL ? rel_error
+                                                                    : ulp_error;
+
+            num_mismatches += !(error <= t->tolerance);
+            max_abs = abs_error > max_abs ? abs_error : max_abs;
+            max_rel = rel_error > max_rel ? rel_error : max_rel;
+            max_ulp = ulp_error > max_ulp ? ulp_error : max_ulp;
+        }
+
+        if (num_mismatches > 0 && partial->num_mismatches == 0)
+        {
+            size_t j = 0;
+            while (entry_error(t->mode, expected[j], actual[j]) <= t->tolerance)
+            {
+                j++;
+            }
+            partial->first_row = i;
+            partial->first_col = j;
+        }
+        partial->num_mismatches += num_mismatches;
+        partial->max_abs_error = max_abs;
+        partial->max_rel_error = max_rel;
+        partial->max_ulp_error = max_ulp;
+    }
+}
+
+hpckern_status_t hpckern_matrix_compare_tolerance(hpckern_context_t *ctx, hpckern_tolerance_t mode, double tolerance, const hpckern_matrix_t *expected, const hpckern_matrix_t *actual, hpckern_matrix_compare_report_t *report)
+{
+    const size_t N = expected->size;
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    const size_t mark = hpckern_arena_mark(ctx);
+    compare_task_t task = {
+        .mode = mode,
+        .tolerance = tolerance,
+        .expected = expected,
+        .actual = actual,
+        .rows_per_task = (N + num_threads - 1) / num_threads,
+    };
+
+    CHECK_ARGUMENT(
+        same_size(expected, actual) &&
+        expected->layout == HPCKERN_LAYOUT_ROW_MAJOR && actual->layout == HPCKERN_LAYOUT_ROW_MAJOR);
+    task.partials = (hpckern_matrix_compare_report_t *)hpckern_arena_alloc(ctx, num_threads * sizeof(hpckern_matrix_compare_report_t));
+    if (task.partials == NULL)
+    {
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    hpckern_parallel_for(ctx, num_threads, compare_task, &task);
+
+    // Tasks cover increasing row ranges, so the first task with a mismatch
+    // holds the first one overall.
+    memset(report, 0, sizeof(hpckern_matrix_compare_report_t));
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        const hpckern_matrix_compare_report_t *partial = &task.partials[i];
+        if (partial->num_mismatches > 0 && report->num_mismatches == 0)
+        {
+            report->first_row = partial->first_row;
+            report->first_col = partial->first_col;
+        }
+        report->num_mismatches += partial->num_mismatches;
+        report->max_abs_error = MAX(report->max_abs_error, partial->max_abs_error);
+        report->max_rel_error = MAX(report->max_rel_error, partial->max_rel_error);
+        report->max_ulp_error = MAX(report->max_ulp_error, partial->max_ulp_error);
+    }
+
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
+
+// Y[i, :] = op(M)[i, :] X and abs_y[i] = |op(M)[i, :]| abs_x for the rows i
+// of the task, with X and Y holding num_vectors columns. Without a transpose
+// this walks rows of M; with one it walks the task's column slice of every
+// row, so both read M with unit stride and tasks write disjoint rows of Y.
+static void apply_task(void *arg, size_t task)
+{
+    const apply_task_t *t = (const apply_task_t *)arg;
+    const size_t N = t->mat->size;
+    const size_t k = t->num_vectors;
+    const size_t start = MIN(task * t->rows_per_task, N);
+    const size_t end = MIN(start + t->rows_per_task, N);
+
+    memset(&t->y[start * k], 0, (end - start) * k * sizeof(double));
+    memset(&t->abs_y[start], 0, (end - start) * sizeof(double));
+
+    if (!t->trans)
+    {
+        for (size_t i = start; i < end; i++)
+        {
+            const double *row = &t->mat->data[i * N];
+            double *y = &t->y[i * k];
+            for (size_t j = 0; j < N; j++)
+            {
+                for (size_t v = 0; v < k; v++)
+                {
+                    y[v] += row[j] * t->x[j * k + v];
+                }
+                t->abs_y[i] += fabs(row[j]) * t->abs_x[j];
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < N; i++)
+    {
+        const double *row = &t->mat->data[i * N];
+        for (size_t j = start; j < end; j++)
+        {
+            for (size_t v = 0; v < k; v++)
+            {
+                t->y[j * k + v] += row[j] * t->x[i * k + v];
+            }
+            t->abs_y[j] += fabs(row[j]) * t->abs_x[i];
+        }
+    }
+}
+
+static void apply(hpckern_context_t *ctx, const hpckern_matrix_t *mat, bool trans, size_t num_vectors, const double *x, const double *abs_x, double *y, double *abs_y)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    apply_task_t task = {
+        .mat = mat,
+        .trans = trans,
+        .num_vectors = num_vectors,
+        .x = x,
+        .abs_x = abs_x,
+        .y = y,
+        .abs_y = abs_y,
+        .rows_per_task = (mat->size + num_threads - 1) / num_threads,
+    };
+
+    hpckern_parallel_for(ctx, num_threads, apply_task, &task);
+}
+
+static void integral_task(void *arg, size_t task)
+{
+    const integral_task_t *t = (const integral_task_t *)arg;
+    const size_t N = t->mat->size;
+    const size_t start = MIN(task * t->rows_per_task, N);
+    const size_t end = MIN(start + t->rows_per_task, N);
+    bool is_integral = true;
+
+    for (size_t e = start * N; e < end * N && is_integral; e++)
+    {
+        is_integral = t->mat->data[e] == nearbyint(t->mat->data[e]);
+    }
+    t->partials[task] = is_integral;
+}
+
+// Whether every entry of `mat` is an integer; NULL counts as one. Without
+// scratch memory the answer is false, which only costs the exact bound.
+static bool is_integral(hpckern_context_t *ctx, const hpckern_matrix_t *mat)
+{
+    const size_t num_threads = hpckern_context_num_threads(ctx);
+    const size_t mark = hpckern_arena_mark(ctx);
+    integral_task_t task = {
+        .mat = mat,
+        .partials = (bool *)hpckern_arena_alloc(ctx, num_threads * sizeof(bool)),
+        .rows_per_task = mat != NULL ? (mat->size + num_threads - 1) / num_threads : 0,
+    };
+    bool result = true;
+
+    if (mat == NULL || task.partials == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return mat == NULL;
+    }
+    hpckern_parallel_for(ctx, num_threads, integral_task, &task);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        result = result && task.partials[i];
+    }
+    hpckern_arena_release(ctx, mark);
+    return result;
+}
+
+// Every trial vector is a random +-1 vector, so the absolute bounds all start
+// from the ones vector. With integer operands, alpha and beta, every partial
+// sum is an integer of at most the row's absolute bound; below 2^53 all of
+// them are exact, so such rows must match exactly.
+hpckern_status_t hpckern_matrix_verify_freivalds(hpckern_context_t *ctx, hpckern_rng_t *rng, size_t num_trials, bool trans_lhs, bool trans_rhs, double alpha, const hpckern_matrix_t *lhs, const hpckern_matrix_t *rhs, double beta, const hpckern_matrix_t *initial, const hpckern_matrix_t *result, bool *matches)
+{
+    const size_t N = lhs->size;
+    const size_t k = num_trials;
+    const double gamma = 2.0 * (N + 2) * DBL_EPSILON;
+    const double exact_limit = 9007199254740992.0;
+    const size_t mark = hpckern_arena_mark(ctx);
+    double *x, *bx, *abx, *cx, *c0x;
+    double *ones, *abs_b, *abs_ab, *abs_c, *abs_c0;
+    bool is_exact;
+
+    CHECK_ARGUMENT(dense_operands(lhs, rhs, result) && num_trials > 0);
+    CHECK_ARGUMENT(beta == 0.0 || (initial != NULL && same_size(lhs, initial) && initial->layout == HPCKERN_LAYOUT_ROW_MAJOR));
+
+    x = (double *)hpckern_arena_alloc(ctx, N * k * sizeof(double));
+    bx = (double *)hpckern_arena_alloc(ctx, N * k * sizeof(double));
+    abx = (double *)hpckern_arena_alloc(ctx, N * k * sizeof(double));
+    cx = (double *)hpckern_arena_alloc(ctx, N * k * sizeof(double));
+    c0x = (double *)hpckern_arena_alloc(ctx, N * k * sizeof(double));
+    ones = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    abs_b = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    abs_ab = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    abs_c = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    abs_c0 = (double *)hpckern_arena_alloc(ctx, N * sizeof(double));
+    if (x == NULL || bx == NULL || abx == NULL || cx == NULL || c0x == NULL ||
+        ones == NULL || abs_b == NULL || abs_ab == NULL || abs_c == NULL || abs_c0 == NULL)
+    {
+        hpckern_arena_release(ctx, mark);
+        return HPCKERN_ERROR_OUT_OF_MEMORY;
+    }
+
+    is_exact = alpha == nearbyint(alpha) && beta == nearbyint(beta) &&
+               is_integral(ctx, lhs) && is_integral(ctx, rhs) && is_integral(ctx, result) &&
+               (beta == 0.0 || is_integral(ctx, initial));
+
+    for (size_t i = 0; i < N * k; i++)
+    {
+        x[i] = hpckern_rng_next(rng) >> 63 ? 1.0 : -1.0;
+    }
+    for (size_t i = 0; i < N; i++)
+    {
+        ones[i] = 1.0;
+    }
+
+    apply(ctx, rhs, trans_rhs, k, x, ones, bx, abs_b);
+    apply(ctx, lhs, trans_lhs, k, bx, abs_b, abx, abs_ab);
+    apply(ctx, result, false, k, x, ones, cx, abs_c);
+    if (beta != 0.0)
+    {
+        apply(ctx, initial, false, k, x, ones, c0x, abs_c0);
+    }
+
+    *matches = true;
+    for (size_t i = 0; i < N && *matches; i++)
+    {
+        const double magnitude = fabs(alpha) * abs_ab[i] + (beta != 0.0 ? fabs(beta) * abs_c0[i] : 0.0) + abs_c[i];
+        const double bound = is_exact && magnitude < exact_limit ? 0.0 : gamma * magnitude;
+        for (size_t v = 0; v < k; v++)
+        {
+            const double expected = alpha * abx[i * k + v] + (beta != 0.0 ? beta * c0x[i * k + v] : 0.0);
+            if (!(fabs(expected - cx[i * k + v]) <= bound))
+            {
+                *matches = false;
+                break;
+            }
+        }
+    }
+
+    hpckern_arena_release(ctx, mark);
+    return HPCKERN_OK;
+}
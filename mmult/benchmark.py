@@ -334,6 +334,7 @@ def run_benchmark_variant(variant, repeat, exec_name, test_scenarios, output_dir
             "--variant", variant,
             "--size", str(matrix_size),
             "--repeat", str(repeat),
+            "--format", "json",
         ]
 
         if block_size:
@@ -344,17 +345,19 @@ def run_benchmark_variant(variant, repeat, exec_name, test_scenarios, output_dir
             output = run_command(command)
 
         if output and output.returncode == 0:
-            runtime_match = re.search(r'\d+\.\d+', output.stdout.upper())
-            if runtime_match:
-                runtime_val = float(runtime_match.group())
-                avg_time = runtime_val / repeat
-                run = {
-                    "average": avg_time if avg_time >= 1e-6 else round(avg_time, 6),
-                    "total": runtime_val,
-                    "repeat": repeat,
-                }
-                if cache_blocking:
-                    run['block'] = block_size
+            result = json.loads(output.stdout)
+            runs = [r["multiplication_time"] for r in result["individual_runs"]]
+            runtime_val = sum(runs)
+            avg_time = result["statistics"]["multiplication"]["average_time"]
+            run = {
+                "average": avg_time if avg_time >= 1e-6 else round(avg_time, 6),
+                "total": runtime_val,
+                "repeat": len(runs),
+                "median": result["harness"]["multiplication"]["median_time"],
+                "git_revision": result["system"]["git_revision"],
+            }
+            if cache_blocking:
+                run['block'] = block_size
 
             if cache_blocking:
                 print(f"✅ Total runtime for block size {block_size}: {runtime_val:.6f}s")
@@ -1,25 +1,88 @@
 #!/usr/bin/env bash
+#
+#   ./build-mmult.sh [FLAVOUR]
+#
+# Without a flavour, builds the production binary bin/mmult.<system>. With
+# one of O0 O2 O3 Ofast native lto pgo, builds bin/flavours/mmult.<system>-
+# <flavour> for bench/hpcbench.py flavours to compare. pgo is built twice:
+# instrumented, trained on ../bench/pgo-mmult.toml, then with the profile.
 
 SYS=$(uname)
+FLAVOUR=$1
+# The production build: the fastest flavour that keeps IEEE semantics.
+OPTFLAGS="-O3 -march=native"
 
-rm -rf bin/*
+case "$FLAVOUR" in
+    "") ;;
+    O0) OPTFLAGS="-O0" ;;
+    O2) OPTFLAGS="-O2" ;;
+    O3) OPTFLAGS="-O3" ;;
+    Ofast) OPTFLAGS="-Ofast" ;;
+    native) OPTFLAGS="-O3 -march=native" ;;
+    lto|pgo) OPTFLAGS="-O3 -march=native -flto=auto" ;;
+    *)
+        echo "Unknown flavour: '$FLAVOUR'"
+        exit 1
+        ;;
+esac
 
-case "$(uname)" in
+case "$SYS" in
     Darwin*)
-        gcc -I$(brew --prefix openblas)/include \
-            -L$(brew --prefix openblas)/lib \
-            -o bin/mmult.darwin \
-            mmult.c  \
-            -lopenblas
+        TARGET=bin/mmult.darwin
+        PLATFORM_FLAGS=(-I$(brew --prefix openblas)/include -L$(brew --prefix openblas)/lib)
+        LIBS=(-lopenblas -lpthread)
         ;;
     Linux*)
-        gcc -I/usr/local/include \
-            -L/usr/local/lib \
-            -o bin/mmult.linux \
-            mmult.c \
-            -lopenblas
+        TARGET=bin/mmult.linux
+        PLATFORM_FLAGS=(-I/usr/local/include -L/usr/local/lib)
+        LIBS=(-lopenblas -lpthread -lm)
         ;;
     *)
         echo "Unsupported system: '$SYS'"
-    ;;
+        exit 1
+        ;;
 esac
+
+# Recorded in every --format result; see hpckern_system_info_probe.
+GIT_REVISION=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+build() {
+    local flags="$1" output="$2"
+
+    gcc -Wall $flags \
+        -DHPCKERN_GIT_REVISION="\"$GIT_REVISION\"" -DHPCKERN_BUILD_FLAGS="\"$flags\"" \
+        "${PLATFORM_FLAGS[@]}" \
+        -I../hpckern \
+        -o "$output" \
+        mmult.c ../hpckern/*.c \
+        "${LIBS[@]}"
+}
+
+if [ -z "$FLAVOUR" ]; then
+    # Only this system's binary, so a failed build leaves none behind.
+    rm -f "$TARGET"
+    mkdir -p bin
+    build "$OPTFLAGS" "$TARGET"
+    exit $?
+fi
+
+mkdir -p bin/flavours
+OUTPUT="bin/flavours/$(basename $TARGET)-$FLAVOUR"
+
+if [ "$FLAVOUR" != pgo ]; then
+    build "$OPTFLAGS" "$OUTPUT"
+    exit $?
+fi
+
+# GCC names profiles after the output file, so both stages build the same one.
+PGO_DIR=bin/flavours/pgo
+PROFILE_DIR="$(pwd)/$PGO_DIR/profile"
+rm -rf "$PGO_DIR"
+mkdir -p "$PGO_DIR"
+build "$OPTFLAGS -fprofile-generate -fprofile-update=prefer-atomic -fprofile-dir=$PROFILE_DIR" "$PGO_DIR/mmult" || exit 1
+../bench/hpcbench.py sweep ../bench/pgo-mmult.toml \
+    --binary mmult="$PGO_DIR/mmult" \
+    --output-dir "$PGO_DIR/sweep" \
+    --force || exit 1
+build "$OPTFLAGS -fprofile-use -fprofile-partial-training -fprofile-dir=$PROFILE_DIR" "$PGO_DIR/mmult" || exit 1
+cp "$PGO_DIR/mmult" "$OUTPUT"
@@ -1,13 +1,14 @@
 #include <assert.h>
-#include <cblas.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "hpckern.h"
+
 #define MAX_SIZE 4096
-#define min(a, b) ((a) > (b) ? (b) : (a))
+#define CHECK(call) check_status((call), #call)
 
 const char *const ARG_BLOCK = "--block";
 const char *const ARG_HELP = "--help";
@@ -16,6 +17,24 @@ const char *const ARG_VARIANT = "--variant";
 const char *const ARG_VERBOSE = "--verbose";
 const char *const ARG_VALUE_RANGE = "--value-range";
 const char *const ARG_REPEAT = "--repeat"; 
+const char *const ARG_TRANS_A = "--trans-a";
+const char *const ARG_TRANS_B = "--trans-b";
+const char *const ARG_PRETRANSPOSE_B = "--pretranspose-b";
+const char *const ARG_ALPHA = "--alpha";
+const char *const ARG_BETA = "--beta";
+const char *const ARG_WARMUP = "--warmup";
+const char *const ARG_MIN_TIME = "--min-time";
+const char *const ARG_MAX_TIME = "--max-time";
+const char *const ARG_MAX_REPEAT = "--max-repeat";
+const char *const ARG_TARGET_CI = "--target-ci";
+const char *const ARG_OUTLIER_K = "--outlier-k";
+const char *const ARG_FLUSH_CACHE = "--flush-cache";
+const char *const ARG_STATS = "--stats";
+const char *const ARG_FORMAT = "--format";
+const char *const ARG_SEED = "--seed";
+const char *const ARG_CACHE_MEMORY = "--cache-memory";
+const char *const ARG_CACHE_DIR = "--cache-dir";
+const char *const ARG_CACHE_DISK = "--cache-disk";
 
 const char *const VARIANT_BLAS = "blas";
 const char *const VARIANT_BLAS_BLOCK = "blas-block";
@@ -26,20 +45,33 @@ typedef struct
 {
     bool flag_help;
     bool flag_verbose;
+    bool flag_trans_a;
+    bool flag_trans_b;
+    bool flag_pretranspose_b;
     int flag_repeat; 
     char flag_variant[64];
     int flag_block;
     int flag_size;
     int value_min;
     int value_max;
+    double alpha;
+    double beta;
+    bool flag_flush_cache;
+    bool flag_stats;
+    int flag_warmup;
+    int flag_max_repeat;
+    double flag_min_time;
+    double flag_max_time;
+    double flag_target_ci;
+    double flag_outlier_k;
+    char flag_format[16];
+    bool flag_has_seed;
+    unsigned int flag_seed;
+    size_t flag_cache_memory;
+    const char *flag_cache_dir;
+    size_t flag_cache_disk;
 } args_t;
 
-typedef struct
-{
-    int size;
-    double *mem;
-} matrix_t;
-
 void show_help(const char *prog_nam)
 {
     printf("Usage: %s [OPTIONS]\n\n", prog_nam);
@@ -53,6 +85,32 @@ void show_help(const char *prog_nam)
     printf("  --block BLOCK          Block size for block variant (positive integer)\n");
     printf("  --value-range MIN MAX  Specify the range of matrix values (default: 0 99)\n");
     printf("  --repeat REPEAT        Number of times to run the multiplication (default: 1)\n");  
+    printf("  --trans-a              A is supplied transposed: compute A^T * B\n");
+    printf("  --trans-b              B is supplied transposed: compute A * B^T\n");
+    printf("  --pretranspose-b       Copy B^T into a scratch buffer first, so naive and block\n");
+    printf("                         multiply with unit-stride dot products\n");
+    printf("  --alpha ALPHA          Compute C = ALPHA * A * B + BETA * C (default: 1)\n");
+    printf("  --beta BETA            C starts random when BETA is not 0 and every repeat\n");
+    printf("                         updates it in place (default: 0)\n");
+    printf("  --warmup WARMUP        Untimed runs before the measured ones (default: 0)\n");
+    printf("  --min-time SECONDS     Keep running past REPEAT runs until this much time\n");
+    printf("                         has been measured\n");
+    printf("  --target-ci FRACTION   Keep running past REPEAT runs until the 95%% confidence\n");
+    printf("                         interval of the mean is within FRACTION of it\n");
+    printf("  --max-time SECONDS     Stop adaptive runs after this much measured time ...\n");
+    printf("  --max-repeat COUNT     ... or this many runs (default: %d)\n", HPCKERN_HARNESS_MAX_ITERATIONS);
+    printf("  --outlier-k K          Drop runs more than K scaled MADs from the median from\n");
+    printf("                         the statistics; 0 keeps all (default: %.1f)\n", HPCKERN_HARNESS_OUTLIER_K);
+    printf("  --flush-cache          Evict the caches before every run\n");
+    printf("  --stats                Print run statistics in YAML after the total time\n");
+    printf("  --format FORMAT        Print the result as yaml, json or csv (one row per\n");
+    printf("                         run) with system and build metadata instead of text\n");
+    printf("  --seed SEED            Seed the operands, so runs can repeat them (default: time)\n");
+    printf("  --cache-memory MIB     Serve C from a cache keyed by the content hash of A and B,\n");
+    printf("                         keeping this many MiB in memory; every run then times\n");
+    printf("                         the hashing and the lookup, or the variant on a miss\n");
+    printf("  --cache-dir DIR        Also keep products as files in DIR, shared between runs\n");
+    printf("  --cache-disk MIB       Size limit of DIR (default: 1024)\n");
     printf("\n");
     printf("Variants:\n");
     printf("  naive                  Standard triple-loop matrix multiplication\n");
@@ -66,6 +124,10 @@ void show_help(const char *prog_nam)
     printf("  %s --variant blas --size 512 --value-range 1 10\n", prog_nam);
     printf("  %s --variant blas-block --size 512 --block 128\n", prog_nam);
     printf("  %s --variant naive --size 256 --repeat 10\n", prog_nam);  
+    printf("  %s --variant block --size 512 --block 64 --trans-b\n", prog_nam);
+    printf("  %s --variant blas-block --size 512 --block 128 --beta 1 --repeat 10\n", prog_nam);
+    printf("  %s --variant blas --size 512 --warmup 2 --target-ci 0.02 --stats\n", prog_nam);
+    printf("  %s --variant block --size 512 --block 64 --repeat 10 --format json\n", prog_nam);
     printf("  %s --help\n", prog_nam);
 }
 
@@ -74,12 +136,31 @@ args_t args_parse(int argc, char *argv[])
     args_t ans = {
         .flag_help = false,
         .flag_verbose = false,
+        .flag_trans_a = false,
+        .flag_trans_b = false,
+        .flag_pretranspose_b = false,
         .flag_variant = {0},
         .flag_block = 0,
         .flag_size = 0,
         .value_min = 0,
         .value_max = 99,
         .flag_repeat = 1,  
+        .alpha = 1.0,
+        .beta = 0.0,
+        .flag_flush_cache = false,
+        .flag_stats = false,
+        .flag_warmup = 0,
+        .flag_max_repeat = HPCKERN_HARNESS_MAX_ITERATIONS,
+        .flag_min_time = 0.0,
+        .flag_max_time = 0.0,
+        .flag_target_ci = 0.0,
+        .flag_outlier_k = HPCKERN_HARNESS_OUTLIER_K,
+        .flag_format = {0},
+        .flag_has_seed = false,
+        .flag_seed = 0,
+        .flag_cache_memory = 0,
+        .flag_cache_dir = NULL,
+        .flag_cache_disk = 1024,
     };
 
     if (argc == 1)
@@ -97,14 +178,14 @@ args_t args_parse(int argc, char *argv[])
             else if (strcmp(argv[i], ARG_VARIANT) == 0)
             {
                 assert(i + 1 < argc);
-                strncpy(ans.flag_variant, argv[i + 1], sizeof ans.flag_variant);
+                snprintf(ans.flag_variant, sizeof ans.flag_variant, "%s", argv[i + 1]);
                 i++;
             }
             else if (strcmp(argv[i], ARG_SIZE) == 0)
             {
                 char ssize[64] = {0};
                 assert(i + 1 < argc);
-                strncpy(ssize, argv[i + 1], sizeof ssize);
+                snprintf(ssize, sizeof ssize, "%s", argv[i + 1]);
                 ans.flag_size = atoi(ssize);
                 i++;
             }
@@ -112,11 +193,35 @@ args_t args_parse(int argc, char *argv[])
             {
                 ans.flag_verbose = true;
             }
+            else if (strcmp(argv[i], ARG_TRANS_A) == 0)
+            {
+                ans.flag_trans_a = true;
+            }
+            else if (strcmp(argv[i], ARG_TRANS_B) == 0)
+            {
+                ans.flag_trans_b = true;
+            }
+            else if (strcmp(argv[i], ARG_PRETRANSPOSE_B) == 0)
+            {
+                ans.flag_pretranspose_b = true;
+            }
+            else if (strcmp(argv[i], ARG_ALPHA) == 0)
+            {
+                assert(i + 1 < argc);
+                ans.alpha = atof(argv[i + 1]);
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_BETA) == 0)
+            {
+                assert(i + 1 < argc);
+                ans.beta = atof(argv[i + 1]);
+                i++;
+            }
             else if (strcmp(argv[i], ARG_BLOCK) == 0)
             {
                 char bsize[64] = {0};
                 assert(i + 1 < argc);
-                strncpy(bsize, argv[i + 1], sizeof bsize);
+                snprintf(bsize, sizeof bsize, "%s", argv[i + 1]);
                 ans.flag_block = atoi(bsize);
                 i++;
             }
@@ -137,7 +242,7 @@ args_t args_parse(int argc, char *argv[])
             {
                 char repeat_str[64] = {0};
                 assert(i + 1 < argc);
-                strncpy(repeat_str, argv[i + 1], sizeof repeat_str);
+                snprintf(repeat_str, sizeof repeat_str, "%s", argv[i + 1]);
                 ans.flag_repeat = atoi(repeat_str);
                 if (ans.flag_repeat <= 0)
                 {
@@ -146,6 +251,110 @@ args_t args_parse(int argc, char *argv[])
                 }
                 i++;
             }
+            else if (strcmp(argv[i], ARG_WARMUP) == 0)
+            {
+                assert(i + 1 < argc);
+                ans.flag_warmup = atoi(argv[i + 1]);
+                if (ans.flag_warmup < 0)
+                {
+                    fprintf(stderr, "Warm-up count must not be negative (but receiving %d)\n", ans.flag_warmup);
+                    exit(-1);
+                }
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_MAX_REPEAT) == 0)
+            {
+                assert(i + 1 < argc);
+                ans.flag_max_repeat = atoi(argv[i + 1]);
+                if (ans.flag_max_repeat <= 0)
+                {
+                    fprintf(stderr, "Maximum repeat count must be positive (but receiving %d)\n", ans.flag_max_repeat);
+                    exit(-1);
+                }
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_MIN_TIME) == 0 || strcmp(argv[i], ARG_MAX_TIME) == 0 ||
+                     strcmp(argv[i], ARG_TARGET_CI) == 0 || strcmp(argv[i], ARG_OUTLIER_K) == 0)
+            {
+                double value;
+                assert(i + 1 < argc);
+                value = atof(argv[i + 1]);
+                if (value < 0.0)
+                {
+                    fprintf(stderr, "%s must not be negative (but receiving %lf)\n", argv[i], value);
+                    exit(-1);
+                }
+                if (strcmp(argv[i], ARG_MIN_TIME) == 0)
+                {
+                    ans.flag_min_time = value;
+                }
+                else if (strcmp(argv[i], ARG_MAX_TIME) == 0)
+                {
+                    ans.flag_max_time = value;
+                }
+                else if (strcmp(argv[i], ARG_TARGET_CI) == 0)
+                {
+                    ans.flag_target_ci = value;
+                }
+                else
+                {
+                    ans.flag_outlier_k = value;
+                }
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_FLUSH_CACHE) == 0)
+            {
+                ans.flag_flush_cache = true;
+            }
+            else if (strcmp(argv[i], ARG_STATS) == 0)
+            {
+                ans.flag_stats = true;
+            }
+            else if (strcmp(argv[i], ARG_FORMAT) == 0)
+            {
+                hpckern_format_t format;
+                assert(i + 1 < argc);
+                if (!hpckern_format_from_name(argv[i + 1], &format))
+                {
+                    fprintf(stderr, "Invalid format '%s'. Valid options: yaml, json, csv\n", argv[i + 1]);
+                    exit(-1);
+                }
+                snprintf(ans.flag_format, sizeof ans.flag_format, "%s", argv[i + 1]);
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_SEED) == 0)
+            {
+                assert(i + 1 < argc);
+                ans.flag_has_seed = true;
+                ans.flag_seed = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_CACHE_MEMORY) == 0 || strcmp(argv[i], ARG_CACHE_DISK) == 0)
+            {
+                int mib;
+                assert(i + 1 < argc);
+                mib = atoi(argv[i + 1]);
+                if (mib < 0)
+                {
+                    fprintf(stderr, "%s must not be negative (but receiving %d)\n", argv[i], mib);
+                    exit(-1);
+                }
+                if (strcmp(argv[i], ARG_CACHE_MEMORY) == 0)
+                {
+                    ans.flag_cache_memory = mib;
+                }
+                else
+                {
+                    ans.flag_cache_disk = mib;
+                }
+                i++;
+            }
+            else if (strcmp(argv[i], ARG_CACHE_DIR) == 0)
+            {
+                assert(i + 1 < argc);
+                ans.flag_cache_dir = argv[i + 1];
+                i++;
+            }
             else
             {
                 fprintf(stderr, "I can't recognize flag: '%s'\n", argv[i]);
@@ -164,35 +373,36 @@ double get_time()
     return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
-void matrix_random(matrix_t *C, int min_val, int max_val) {
-    int range = max_val - min_val + 1;
-    for (int i = 0; i < C->size; i++)
+/* Exits when a library call fails; `call` names it in the message. */
+void check_status(hpckern_status_t status, const char *call)
+{
+    if (status != HPCKERN_OK)
     {
-        for (int j = 0; j < C->size; j++)
-        {
-            C->mem[i * C->size + j] = (rand() % range) + min_val;
-        }
+        fprintf(stderr, "%s failed: %s\n", call, hpckern_status_name(status));
+        exit(-1);
     }
 }
 
-matrix_t *matrix_new(int N)
+/* Exits when the library could not create `what`. */
+void check_created(const void *object, const char *what)
 {
-    matrix_t *C = (matrix_t *)calloc(1, sizeof(matrix_t));
-    C->mem = (double *)calloc(N * N, sizeof(double));
-    C->size = N;
-    return C;
+    if (object == NULL)
+    {
+        fprintf(stderr, "Failed to create the %s\n", what);
+        exit(-1);
+    }
 }
 
-void matrix_print(matrix_t *m)
+void matrix_print(hpckern_matrix_t *m)
 {
-    const int N = m->size;
+    const int N = (int)m->size;
     printf("np.array([");
     for (int i = 0; i < N; i++)
     {
         printf("[");
         for (int j = 0; j < N; j++)
         {
-            printf("%lf", m->mem[i * N + j]);
+            printf("%lf", m->data[i * N + j]);
             if (j < N - 1)
             {
                 printf(", ");
@@ -207,201 +417,321 @@ void matrix_print(matrix_t *m)
     printf("])\n");
 }
 
-void matrix_mult_naive(matrix_t *A, matrix_t *B, matrix_t *C, double *runtime)
+void generate_matrices(hpckern_rng_t *rng, bool verbose, int size, int min_val, int max_val, hpckern_matrix_t **A, hpckern_matrix_t **B, hpckern_matrix_t **C)
 {
-    const int N = A->size;
-    C->size = N;
-
-    memset(C->mem, 0, sizeof(double) * N * N);
-
-    if (runtime != NULL)
+    if (verbose)
     {
-        *runtime = get_time();
+        printf("Two matrices of size %dx%d with values in range [%d, %d]\n", size, size, min_val, max_val);
     }
-    for (int i = 0; i < N; i++)
+
+    *A = hpckern_matrix_init(size);
+    check_created(*A, "matrix A");
+    CHECK(hpckern_matrix_random(rng, *A, min_val, max_val));
+    if (verbose)
     {
-        for (int j = 0; j < N; j++)
-        {
-            C->mem[i * N + j] = 0.0;
-            for (int k = 0; k < N; k++)
-            {
-                C->mem[i * N + j] += A->mem[i * N + k] * B->mem[k * N + j];
-            }
-        }
+        matrix_print(*A);
     }
-    if (runtime != NULL)
+
+    *B = hpckern_matrix_init(size);
+    check_created(*B, "matrix B");
+    CHECK(hpckern_matrix_random(rng, *B, min_val, max_val));
+    if (verbose)
     {
-        *runtime = get_time() - *runtime;
+        matrix_print(*B);
     }
+    
+    *C = hpckern_matrix_init(size);
+    check_created(*C, "matrix C");
 }
 
-void matrix_mult_block(matrix_t *A, matrix_t *B, int block_size, matrix_t *C, double *runtime)
+/*
+ * Brings the operands of the naive and block variants into the form their
+ * kernels read: a transposed A is flipped back into `A_scratch`, and B^T is
+ * used as is when B arrives transposed, or copied into `B_scratch` when
+ * pre-transposing. Returns the time spent transposing; `*Bt` is NULL when the
+ * plain kernels should run on `*A_op` and B.
+ */
+double prepare_operands(args_t args, hpckern_context_t *ctx, hpckern_matrix_t *A, hpckern_matrix_t *B, hpckern_matrix_t *A_scratch, hpckern_matrix_t *B_scratch, hpckern_matrix_t **A_op, hpckern_matrix_t **Bt)
 {
-    if (block_size <= 0)
+    double runtime = get_time();
+
+    *A_op = A;
+    *Bt = NULL;
+    if (args.flag_trans_a)
     {
-        fprintf(stderr, "Block size must be positive (receiving %d)\n", block_size);
-        exit(-1);
+        CHECK(hpckern_matrix_transpose(ctx, HPCKERN_TRANSPOSE_BLOCK_SIZE, A, A_scratch));
+        *A_op = A_scratch;
+    }
+    if (args.flag_trans_b)
+    {
+        *Bt = B;
+    }
+    else if (args.flag_pretranspose_b)
+    {
+        CHECK(hpckern_matrix_transpose(ctx, HPCKERN_TRANSPOSE_BLOCK_SIZE, B, B_scratch));
+        *Bt = B_scratch;
     }
 
-    const int N = A->size;
-    C->size = N;
-    memset(C->mem, 0, sizeof(double) * N * N);
+    return get_time() - runtime;
+}
 
-    if (runtime != NULL)
+/*
+ * Runs the variant once and returns its time, including any transposes
+ * prepare_operands does for the naive and block kernels.
+ */
+double run_variant(args_t args, hpckern_context_t *ctx, hpckern_matrix_t *A, hpckern_matrix_t *B, hpckern_matrix_t *C, hpckern_matrix_t *A_scratch, hpckern_matrix_t *B_scratch)
+{
+    hpckern_matrix_t *A_op = NULL;
+    hpckern_matrix_t *Bt = NULL;
+    double runtime = 0.0;
+    double start;
+
+    if (strcmp(args.flag_variant, VARIANT_NAIVE) == 0)
     {
-        *runtime = get_time();
+        runtime = prepare_operands(args, ctx, A, B, A_scratch, B_scratch, &A_op, &Bt);
+        start = get_time();
+        if (Bt != NULL)
+        {
+            CHECK(hpckern_matrix_gemm_naive_bt(args.alpha, A_op, Bt, args.beta, C));
+        }
+        else
+        {
+            CHECK(hpckern_matrix_gemm_naive(args.alpha, A_op, B, args.beta, C));
+        }
     }
-
-    for (int bi = 0; bi < N; bi += block_size)
+    else if (strcmp(args.flag_variant, VARIANT_BLOCK) == 0)
     {
-        for (int bj = 0; bj < N; bj += block_size)
+        runtime = prepare_operands(args, ctx, A, B, A_scratch, B_scratch, &A_op, &Bt);
+        start = get_time();
+        if (Bt != NULL)
         {
-            for (int bk = 0; bk < N; bk += block_size)
-            {
-                int i_end = min(bi + block_size, N);
-                int j_end = min(bj + block_size, N);
-                int k_end = min(bk + block_size, N);
-                
-                for (int i = bi; i < i_end; i++)
-                {
-                    for (int j = bj; j < j_end; j++)
-                    {
-                        register double sum = 0;
-                        for (int k = bk; k < k_end; k++)
-                        {
-                            sum += A->mem[i * N + k] * B->mem[k * N + j];
-                        }
-                        C->mem[i * N + j] = sum;
-                    }
-                }
-            }
+            CHECK(hpckern_matrix_gemm_serial_bt(args.flag_block, args.alpha, A_op, Bt, args.beta, C));
+        }
+        else
+        {
+            CHECK(hpckern_matrix_gemm_block(args.flag_block, args.alpha, A_op, B, args.beta, C));
         }
     }
-
-    if (runtime != NULL)
+    else if (strcmp(args.flag_variant, VARIANT_BLAS) == 0)
     {
-        *runtime = get_time() - *runtime;
+        start = get_time();
+        CHECK(hpckern_matrix_gemm_cblas(args.flag_trans_a, args.flag_trans_b, args.alpha, A, B, args.beta, C));
     }
-}
-
-void matrix_mult_cblas(matrix_t *A, matrix_t *B, matrix_t *C, double *runtime)
-{
-    const int N = A->size;
-
-    if (runtime != NULL)
+    else if (strcmp(args.flag_variant, VARIANT_BLAS_BLOCK) == 0)
     {
-        *runtime = get_time();
+        start = get_time();
+        CHECK(hpckern_matrix_gemm_blas_block(args.flag_block, args.flag_trans_a, args.flag_trans_b, args.alpha, A, B, args.beta, C));
     }
-    cblas_dgemm(
-        CblasRowMajor,
-        CblasNoTrans,
-        CblasNoTrans,
-        N,
-        N,
-        N,
-        1.0,
-        A->mem,
-        N,
-        B->mem,
-        N,
-        0.0,
-        C->mem,
-        N);
-    if (runtime != NULL)
+    else
     {
-        *runtime = get_time() - *runtime;
+        fprintf(stderr, "Unsupported variant: %s\n", args.flag_variant);
+        exit(-1);
     }
 
-    C->size = N;
+    return runtime + get_time() - start;
 }
 
-void matrix_mult_blas_block(matrix_t *A, matrix_t *B, matrix_t *C, int block_size, double *runtime)
+/*
+ * Serves C from the cache when this A and B were multiplied before, and
+ * otherwise runs the variant and stores C. The time includes hashing the
+ * operands, O(N^2) against the O(N^3) of a product. Only beta == 0 is
+ * cached, where C depends on nothing but the operands, alpha and the
+ * transposes.
+ */
+double run_cached(args_t args, hpckern_context_t *ctx, hpckern_cache_t *cache, hpckern_matrix_t *A, hpckern_matrix_t *B, hpckern_matrix_t *C, hpckern_matrix_t *A_scratch, hpckern_matrix_t *B_scratch)
 {
-    if (block_size <= 0)
+    const size_t bytes = C->size * C->size * sizeof(double);
+    const double params[3] = {args.alpha, args.flag_trans_a, args.flag_trans_b};
+    double start = get_time();
+    hpckern_cache_key_t key;
+
+    CHECK(hpckern_matrix_hash(ctx, A, &key.lhs));
+    CHECK(hpckern_matrix_hash(ctx, B, &key.rhs));
+    key.params = hpckern_hash_bytes(params, sizeof(params), 0);
+    key.size = C->size;
+    if (!hpckern_cache_lookup(cache, &key, C->data, bytes))
     {
-        fprintf(stderr, "Block size must be positive (receiving %d)\n", block_size);
-        exit(-1);
+        run_variant(args, ctx, A, B, C, A_scratch, B_scratch);
+        hpckern_cache_store(cache, &key, C->data, bytes);
     }
 
-    const int N = A->size;
-    C->size = N;
-    memset(C->mem, 0, sizeof(double) * N * N);
+    return get_time() - start;
+}
+
+/*
+ * REPEAT runs are measured after WARMUP untimed ones; --min-time and
+ * --target-ci let the harness keep going until the measurement settles.
+ */
+void harness_config_from_args(args_t args, hpckern_harness_config_t *config)
+{
+    const bool is_adaptive = args.flag_min_time > 0.0 || args.flag_target_ci > 0.0;
+    const double N = args.flag_size;
+
+    hpckern_harness_config_default(config);
+    config->warmup_iterations = args.flag_warmup;
+    config->min_iterations = args.flag_repeat;
+    config->max_iterations = is_adaptive && args.flag_max_repeat > args.flag_repeat ? args.flag_max_repeat : args.flag_repeat;
+    config->min_time = args.flag_min_time;
+    config->max_time = args.flag_max_time;
+    config->target_rel_ci = args.flag_target_ci;
+    config->outlier_k = args.flag_outlier_k;
+    config->flush_cache = args.flag_flush_cache;
+    config->flops = 2.0 * N * N * N;
+}
 
-    if (runtime != NULL)
+/*
+ * Writes the run in the schema of the norm benchmark: metadata, system,
+ * statistics and individual_runs, plus the harness statistics. Cached runs
+ * time lookups as much as products, so their mode sets them apart.
+ */
+void write_result(args_t args, hpckern_format_t format, const hpckern_harness_t *harness, const hpckern_harness_stats_t *stats, const hpckern_cache_stats_t *cache_stats)
+{
+    const char *mode = cache_stats != NULL ? "cached" : "benchmark";
+    const size_t num_runs = hpckern_harness_num_samples(harness);
+    const double *runs = hpckern_harness_samples(harness);
+    const long timestamp = time(NULL);
+    hpckern_system_info_t system;
+    double average = 0.0;
+    double min = runs[0];
+    double max = runs[0];
+
+    for (size_t i = 0; i < num_runs; i++)
     {
-        *runtime = get_time();
+        average += runs[i];
+        min = runs[i] < min ? runs[i] : min;
+        max = runs[i] > max ? runs[i] : max;
     }
+    average /= num_runs;
+    hpckern_system_info_probe(&system);
 
-    for (int bi = 0; bi < N; bi += block_size)
+    if (format == HPCKERN_FORMAT_CSV)
     {
-        for (int bj = 0; bj < N; bj += block_size)
+        printf("program,mode,implementation,trans_a,trans_b,alpha,beta,matrix_size,block_size,num_threads,num_repeats,timestamp," HPCKERN_SYSTEM_INFO_CSV_HEADER ",run,multiplication_time\n");
+        for (size_t i = 0; i < num_runs; i++)
         {
-            for (int bk = 0; bk < N; bk += block_size)
-            {
-                int blk_rows = min(block_size, N - bi);
-                int blk_cols = min(block_size, N - bj);
-                int blk_inner = min(block_size, N - bk);
-
-                cblas_dgemm(
-                    CblasRowMajor,
-                    CblasNoTrans,
-                    CblasNoTrans,
-                    blk_rows,
-                    blk_cols,
-                    blk_inner,
-                    1.0,
-                    &A->mem[bi * N + bk],
-                    N,
-                    &B->mem[bk * N + bj],
-                    N,
-                    1.0,
-                    &C->mem[bi * N + bj],
-                    N
-                );
-            }
+            printf(
+                "mmult,%s,%s,%s,%s,%g,%g,%d,%d,1,%zu,%ld,",
+                mode,
+                args.flag_variant,
+                args.flag_trans_a ? "true" : "false",
+                args.flag_trans_b ? "true" : "false",
+                args.alpha,
+                args.beta,
+                args.flag_size,
+                args.flag_block,
+                num_runs,
+                timestamp);
+            hpckern_system_info_write_csv(stdout, &system);
+            printf(",%zu,%.9f\n", i + 1, runs[i]);
         }
     }
-
-    if (runtime != NULL)
-    {
-        *runtime = get_time() - *runtime;
-    }
-}
-
-void generate_matrices(bool verbose, int size, int min_val, int max_val, matrix_t **A, matrix_t **B, matrix_t **C)
-{
-    if (verbose)
-    {
-        printf("Two matrices of size %dx%d with values in range [%d, %d]\n", size, size, min_val, max_val);
-    }
-
-    *A = matrix_new(size);
-    matrix_random(*A, min_val, max_val);
-    if (verbose)
+    else if (format == HPCKERN_FORMAT_JSON)
     {
-        matrix_print(*A);
+        printf("{\n");
+        printf("  \"metadata\": {\n");
+        printf("    \"program\": \"mmult\",\n");
+        printf("    \"mode\": \"%s\",\n", mode);
+        printf("    \"implementation\": \"%s\",\n", args.flag_variant);
+        printf("    \"trans_a\": %s,\n", args.flag_trans_a ? "true" : "false");
+        printf("    \"trans_b\": %s,\n", args.flag_trans_b ? "true" : "false");
+        printf("    \"alpha\": %g,\n", args.alpha);
+        printf("    \"beta\": %g,\n", args.beta);
+        printf("    \"matrix_size\": %d,\n", args.flag_size);
+        printf("    \"block_size\": %d,\n", args.flag_block);
+        printf("    \"num_threads\": 1,\n");
+        printf("    \"num_repeats\": %zu,\n", num_runs);
+        printf("    \"timestamp\": %ld\n", timestamp);
+        printf("  },\n  ");
+        hpckern_system_info_write_json(stdout, 4, &system);
+        printf(",\n");
+        printf("  \"statistics\": {\n");
+        printf("    \"multiplication\": {\"average_time\": %.9f, \"min_time\": %.9f, \"max_time\": %.9f}\n", average, min, max);
+        printf("  },\n");
+        printf("  \"individual_runs\": [\n");
+        for (size_t i = 0; i < num_runs; i++)
+        {
+            printf("    {\"run\": %zu, \"multiplication_time\": %.9f}%s\n", i + 1, runs[i], i + 1 < num_runs ? "," : "");
+        }
+        printf("  ],\n");
+        printf("  \"harness\": {\n    ");
+        hpckern_harness_write_json(stdout, 6, "multiplication", stats);
+        printf("\n  }");
+        if (cache_stats != NULL)
+        {
+            printf(",\n  \"cache\": {\"memory_hits\": %zu, \"disk_hits\": %zu, \"misses\": %zu, \"stores\": %zu, \"evictions\": %zu, \"memory_bytes\": %zu, \"disk_bytes\": %zu}",
+                   cache_stats->memory_hits, cache_stats->disk_hits, cache_stats->misses, cache_stats->stores,
+                   cache_stats->evictions, cache_stats->memory_bytes, cache_stats->disk_bytes);
+        }
+        printf("\n}\n");
     }
-
-    *B = matrix_new(size);
-    matrix_random(*B, min_val, max_val);
-    if (verbose)
+    else
     {
-        matrix_print(*B);
+        printf("- benchmark_results:\n");
+        printf("  metadata:\n");
+        printf("    program: \"mmult\"\n");
+        printf("    mode: \"%s\"\n", mode);
+        printf("    implementation: \"%s\"\n", args.flag_variant);
+        printf("    trans_a: %s\n", args.flag_trans_a ? "true" : "false");
+        printf("    trans_b: %s\n", args.flag_trans_b ? "true" : "false");
+        printf("    alpha: %g\n", args.alpha);
+        printf("    beta: %g\n", args.beta);
+        printf("    matrix_size: %d\n", args.flag_size);
+        printf("    block_size: %d\n", args.flag_block);
+        printf("    num_threads: 1\n");
+        printf("    num_repeats: %zu\n", num_runs);
+        printf("    timestamp: %ld\n", timestamp);
+        hpckern_system_info_write_yaml(stdout, 2, &system);
+        printf("  statistics:\n");
+        printf("    multiplication:\n");
+        printf("      average_time: %.9f\n", average);
+        printf("      min_time: %.9f\n", min);
+        printf("      max_time: %.9f\n", max);
+        printf("  individual_runs:\n");
+        for (size_t i = 0; i < num_runs; i++)
+        {
+            printf("    - run: %zu\n", i + 1);
+            printf("      multiplication_time: %.9f\n", runs[i]);
+        }
+        printf("  harness:\n");
+        hpckern_harness_write_yaml(stdout, 4, "multiplication", stats);
+        if (cache_stats != NULL)
+        {
+            printf("  cache:\n");
+            printf("    memory_hits: %zu\n", cache_stats->memory_hits);
+            printf("    disk_hits: %zu\n", cache_stats->disk_hits);
+            printf("    misses: %zu\n", cache_stats->misses);
+            printf("    stores: %zu\n", cache_stats->stores);
+            printf("    evictions: %zu\n", cache_stats->evictions);
+            printf("    memory_bytes: %zu\n", cache_stats->memory_bytes);
+            printf("    disk_bytes: %zu\n", cache_stats->disk_bytes);
+        }
     }
-    
-    *C = matrix_new(size);
 }
 
+/*
+ * The kernels live in libhpckern and compute C = alpha * A * B + beta * C
+ * with the semantics of cblas_dgemm. Every variant runs on the calling thread.
+ */
 void benchmark(args_t args)
 {
-    matrix_t *A = NULL;
-    matrix_t *B = NULL;
-    matrix_t *C = NULL;
-    double runtime = 0.0;
+    hpckern_context_t *ctx = hpckern_context_create(1);
+    hpckern_harness_config_t harness_config;
+    hpckern_harness_stats_t stats;
+    hpckern_harness_t *harness = NULL;
+    hpckern_cache_t *cache = NULL;
+    hpckern_cache_stats_t cache_stats;
+    hpckern_matrix_t *A = NULL;
+    hpckern_matrix_t *B = NULL;
+    hpckern_matrix_t *C = NULL;
+    hpckern_matrix_t *A_scratch = NULL;
+    hpckern_matrix_t *B_scratch = NULL;
     double total_runtime = 0.0;
-    const int repeat_count = args.flag_repeat;
+    hpckern_rng_t rng;
 
+    check_created(ctx, "context");
+    hpckern_rng_seed(&rng, args.flag_has_seed ? args.flag_seed : time(0));
     generate_matrices(
+        &rng,
         args.flag_verbose,
         args.flag_size,
         args.value_min,
@@ -410,42 +740,46 @@ void benchmark(args_t args)
         &B,
         &C);
 
-    if (strcmp(args.flag_variant, VARIANT_NAIVE) == 0)
+    if (args.beta != 0.0)
     {
-        for (int i = 0; i < repeat_count; i++)
-        {
-            matrix_mult_naive(A, B, C, &runtime);
-            total_runtime += runtime;
-        }
-    }
-    else if (strcmp(args.flag_variant, VARIANT_BLOCK) == 0)
-    {
-        for (int i = 0; i < repeat_count; i++)
-        {
-            matrix_mult_block(A, B, args.flag_block, C, &runtime);
-            total_runtime += runtime;
-        }
+        CHECK(hpckern_matrix_random(&rng, C, args.value_min, args.value_max));
     }
-    else if (strcmp(args.flag_variant, VARIANT_BLAS) == 0)
+
+    A_scratch = hpckern_matrix_init(args.flag_size);
+    B_scratch = hpckern_matrix_init(args.flag_size);
+    check_created(A_scratch, "scratch matrix for A");
+    check_created(B_scratch, "scratch matrix for B");
+
+    if (args.flag_cache_memory > 0 || args.flag_cache_dir != NULL)
     {
-        for (int i = 0; i < repeat_count; i++)
-        {
-            matrix_mult_cblas(A, B, C, &runtime);
-            total_runtime += runtime;
-        }
+        hpckern_cache_config_t cache_config;
+
+        cache_config.memory_bytes = args.flag_cache_memory << 20;
+        cache_config.disk_path = args.flag_cache_dir;
+        cache_config.disk_bytes = args.flag_cache_disk << 20;
+        cache = hpckern_cache_create(&cache_config);
+        check_created(cache, "result cache");
     }
-    else if (strcmp(args.flag_variant, VARIANT_BLAS_BLOCK) == 0)
+
+    harness_config_from_args(args, &harness_config);
+    harness = hpckern_harness_create(&harness_config);
+    check_created(harness, "benchmark harness");
+    while (hpckern_harness_next(harness))
     {
-        for (int i = 0; i < repeat_count; i++)
+        const bool is_warmup = hpckern_harness_is_warmup(harness);
+        const double runtime = cache != NULL ? run_cached(args, ctx, cache, A, B, C, A_scratch, B_scratch)
+                                             : run_variant(args, ctx, A, B, C, A_scratch, B_scratch);
+
+        CHECK(hpckern_harness_record(harness, runtime));
+        if (!is_warmup)
         {
-            matrix_mult_blas_block(A, B, C, args.flag_block, &runtime);
             total_runtime += runtime;
         }
     }
-    else
+    CHECK(hpckern_harness_stats(harness, &stats));
+    if (cache != NULL)
     {
-        fprintf(stderr, "Unsupported variant: %s\n", args.flag_variant);
-        exit(-1);
+        hpckern_cache_stats(cache, &cache_stats);
     }
 
     if (C == NULL)
@@ -458,11 +792,41 @@ void benchmark(args_t args)
         matrix_print(C);
     }
 
-    printf("Total time over %d runs: %lf seconds\n", repeat_count, total_runtime);
+    if (args.flag_format[0] != '\0')
+    {
+        hpckern_format_t format;
+        hpckern_format_from_name(args.flag_format, &format);
+        write_result(args, format, harness, &stats, cache != NULL ? &cache_stats : NULL);
+    }
+    else
+    {
+        /* benchmark.py reads the first number printed, so the total comes first. */
+        printf("Total time over %zu runs: %lf seconds\n", hpckern_harness_num_samples(harness), total_runtime);
+        if (args.flag_stats)
+        {
+            printf("- benchmark_results:\n");
+            printf("  metadata:\n");
+            printf("    implementation: %s\n", args.flag_variant);
+            printf("    matrix_size: %d\n", args.flag_size);
+            printf("    block_size: %d\n", args.flag_block);
+            printf("    num_repeats: %zu\n", hpckern_harness_num_samples(harness));
+            printf("  harness:\n");
+            hpckern_harness_write_yaml(stdout, 4, "multiplication", &stats);
+        }
+        if (cache != NULL)
+        {
+            printf("Cache: %zu memory hits, %zu disk hits, %zu misses\n", cache_stats.memory_hits, cache_stats.disk_hits, cache_stats.misses);
+        }
+    }
 
-    free(A);
-    free(B);
-    free(C);
+    hpckern_harness_destroy(&harness);
+    hpckern_cache_destroy(&cache);
+    hpckern_matrix_destroy(&A);
+    hpckern_matrix_destroy(&B);
+    hpckern_matrix_destroy(&C);
+    hpckern_matrix_destroy(&A_scratch);
+    hpckern_matrix_destroy(&B_scratch);
+    hpckern_context_destroy(&ctx);
 }
 
 int main(int argc, char *argv[])
@@ -480,7 +844,11 @@ int main(int argc, char *argv[])
             fprintf(stderr, "Size of matrix should not be positive (but receiving %d)\n", args.flag_size);
             return -1;
         }
-        srand(time(0));
+        if ((args.flag_cache_memory > 0 || args.flag_cache_dir != NULL) && args.beta != 0.0)
+        {
+            fprintf(stderr, "The cache only serves beta 0 (but receiving %lf)\n", args.beta);
+            return -1;
+        }
         benchmark(args);
     }
 
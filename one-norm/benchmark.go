@@ -34,6 +34,7 @@ type BenchmarkFlags struct {
 	resultsPath    *string
 	imageDirPath   *string
 	enablePlotting *bool
+	scaling        ScalingFlags
 	verbose        *bool
 	help           *bool
 }
@@ -57,37 +58,50 @@ type TestConfiguration struct {
 type BenchmarkResults []BenchmarkResult
 
 type BenchmarkResult struct {
-	Metadata       Metadata        `yaml:"metadata"`
-	Stats          Statistics      `yaml:"statistics"`
-	IndividualRuns []IndividualRun `yaml:"individual_runs"`
+	Metadata       Metadata        `yaml:"metadata" json:"metadata"`
+	Stats          Statistics      `yaml:"statistics" json:"statistics"`
+	IndividualRuns []IndividualRun `yaml:"individual_runs" json:"individual_runs"`
 }
 
+// Program and Mode tell norm from mmult results and single multiplications
+// from --jobs or --updates runs; results written before they existed leave
+// them empty, like Verify, Alpha and Beta when a run used the defaults.
 type Metadata struct {
-	Impl       string `yaml:"implementation"`
-	MatrixSize uint   `yaml:"matrix_size"`
-	BlockSize  uint   `yaml:"block_size"`
-	NumThreads uint   `yaml:"num_threads"`
-	NumRepeats uint   `yaml:"num_repeats"`
-	Timestamp  uint64 `yaml:"timestamp"`
+	Program    string   `yaml:"program" json:"program"`
+	Mode       string   `yaml:"mode" json:"mode"`
+	Impl       string   `yaml:"implementation" json:"implementation"`
+	Verify     string   `yaml:"verify" json:"verify"`
+	Alpha      *float64 `yaml:"alpha" json:"alpha"`
+	Beta       *float64 `yaml:"beta" json:"beta"`
+	Layout     string   `yaml:"layout" json:"layout"`
+	Norm       string   `yaml:"norm" json:"norm"`
+	Structure  string   `yaml:"structure" json:"structure"`
+	TransA     bool     `yaml:"trans_a" json:"trans_a"`
+	TransB     bool     `yaml:"trans_b" json:"trans_b"`
+	MatrixSize uint     `yaml:"matrix_size" json:"matrix_size"`
+	BlockSize  uint     `yaml:"block_size" json:"block_size"`
+	NumThreads uint     `yaml:"num_threads" json:"num_threads"`
+	NumRepeats uint     `yaml:"num_repeats" json:"num_repeats"`
+	Timestamp  uint64   `yaml:"timestamp" json:"timestamp"`
 }
 
 type Statistics struct {
-	Multiplication  TimingStats `yaml:"multiplication"`
-	NormComputation TimingStats `yaml:"norm_computation"`
-	Total           TimingStats `yaml:"total"`
+	Multiplication  TimingStats `yaml:"multiplication" json:"multiplication"`
+	NormComputation TimingStats `yaml:"norm_computation" json:"norm_computation"`
+	Total           TimingStats `yaml:"total" json:"total"`
 }
 
 type TimingStats struct {
-	AvgTime float64 `yaml:"average_time"`
-	MinTime float64 `yaml:"min_time"`
-	MaxTime float64 `yaml:"max_time"`
+	AvgTime float64 `yaml:"average_time" json:"average_time"`
+	MinTime float64 `yaml:"min_time" json:"min_time"`
+	MaxTime float64 `yaml:"max_time" json:"max_time"`
 }
 
 type IndividualRun struct {
-	Run                int     `yaml:"run"`
-	MultiplicationTime float64 `yaml:"multiplication_time"`
-	NormTime           float64 `yaml:"norm_time"`
-	TotalTime          float64 `yaml:"total_time"`
+	Run                int     `yaml:"run" json:"run"`
+	MultiplicationTime float64 `yaml:"multiplication_time" json:"multiplication_time"`
+	NormTime           float64 `yaml:"norm_time" json:"norm_time"`
+	TotalTime          float64 `yaml:"total_time" json:"total_time"`
 }
 
 func (options *BenchmarkFlags) parse() {
@@ -107,6 +121,8 @@ func (options *BenchmarkFlags) parse() {
 	options.enablePlotting = flag.Bool("plot", false,
 		"Enable plotting mode - creates charts from existing results instead of running benchmarks")
 
+	options.scaling.register()
+
 	options.verbose = flag.Bool("v", false,
 		"Enable verbose output during benchmarking")
 
@@ -550,6 +566,10 @@ func plotResults(serialResultsPath string, threadedResultsPath string, imageDirP
 }
 
 func main() {
+	if len(os.Args) > 1 && os.Args[1] == "compare" {
+		os.Exit(runCompare(os.Args[2:]))
+	}
+
 	const numberOfIterations = uint(50)
 	sysinfo := getCPUInfo()
 	const blockSize = uint(512)
@@ -569,7 +589,13 @@ func main() {
 		}
 	}
 
-	if *flags.enablePlotting {
+	if *flags.scaling.enabled {
+		if *flags.enablePlotting {
+			plotScalingResults(*flags.resultsPath, *flags.scaling.efficiency, *flags.imageDirPath)
+		} else {
+			runScalingStudy(flags.scaling, sysinfo.logicalCores, *flags.execPath, *flags.outputDir, *flags.imageDirPath)
+		}
+	} else if *flags.enablePlotting {
 		if *flags.verbose {
 			fmt.Printf("Creating plots from results in: %s\n", *flags.resultsPath)
 		}
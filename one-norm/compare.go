@@ -0,0 +1,394 @@
+package main
+
+import (
+	"bytes"
+	"encoding/csv"
+	"encoding/json"
+	"errors"
+	"flag"
+	"fmt"
+	"io"
+	"math"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+
+	"gopkg.in/yaml.v3"
+)
+
+const (
+	METRIC_MULTIPLICATION = "multiplication"
+	METRIC_NORM           = "norm"
+	METRIC_TOTAL          = "total"
+
+	// Exit status of `compare` when a configuration regressed; errors exit
+	// with 2 so a CI gate can tell the two apart.
+	EXIT_REGRESSION = 1
+	EXIT_ERROR      = 2
+)
+
+type CompareFlags struct {
+	threshold *float64
+	alpha     *float64
+	metric    *string
+}
+
+// Timings of one configuration, pooled over every result with its key.
+type Samples struct {
+	key   string
+	times []float64
+}
+
+type Comparison struct {
+	key            string
+	baselineMedian float64
+	candMedian     float64
+	change         float64
+	pSlower        float64
+	pFaster        float64
+	verdict        string
+}
+
+// Results pool into one sample only when every parameter that changes what
+// is timed agrees, down to the program that produced them.
+func configurationKey(m Metadata) string {
+	program, mode := m.Program, m.Mode
+	if program == "" {
+		program = "norm"
+	}
+	if mode == "" {
+		mode = "benchmark"
+	}
+	parts := []string{program, mode, m.Impl}
+	for _, extra := range []string{m.Layout, m.Norm, m.Structure} {
+		if extra != "" {
+			parts = append(parts, extra)
+		}
+	}
+	if m.TransA {
+		parts = append(parts, "trans-a")
+	}
+	if m.TransB {
+		parts = append(parts, "trans-b")
+	}
+	if m.Verify != "" {
+		parts = append(parts, "verify-"+m.Verify)
+	}
+	alpha, beta := 1.0, 0.0
+	if m.Alpha != nil {
+		alpha = *m.Alpha
+	}
+	if m.Beta != nil {
+		beta = *m.Beta
+	}
+	return fmt.Sprintf("%s alpha=%g beta=%g n=%d b=%d t=%d", strings.Join(parts, "/"), alpha, beta, m.MatrixSize, m.BlockSize, m.NumThreads)
+}
+
+func runTime(run IndividualRun, metric string) float64 {
+	switch metric {
+	case METRIC_NORM:
+		return run.NormTime
+	case METRIC_TOTAL:
+		// mmult results only carry the multiplication.
+		if run.TotalTime == 0 {
+			return run.MultiplicationTime
+		}
+		return run.TotalTime
+	default:
+		return run.MultiplicationTime
+	}
+}
+
+// Reads the YAML list norm and mmult write by default, or a stream of their
+// --format json documents.
+func readResultDocuments(data []byte) (BenchmarkResults, error) {
+	trimmed := bytes.TrimSpace(data)
+	if len(trimmed) == 0 || trimmed[0] != '{' {
+		var results BenchmarkResults
+		err := yaml.Unmarshal(data, &results)
+		return results, err
+	}
+
+	var results BenchmarkResults
+	decoder := json.NewDecoder(bytes.NewReader(trimmed))
+	for {
+		var result BenchmarkResult
+		if err := decoder.Decode(&result); errors.Is(err, io.EOF) {
+			return results, nil
+		} else if err != nil {
+			return nil, err
+		}
+		results = append(results, result)
+	}
+}
+
+// Turns --format csv rows, possibly from several appended runs with their
+// headers repeated, into one result per row.
+func readResultRows(data []byte) (BenchmarkResults, error) {
+	reader := csv.NewReader(bytes.NewReader(data))
+	reader.FieldsPerRecord = -1
+
+	header, err := reader.Read()
+	if err != nil {
+		return nil, err
+	}
+	column := make(map[string]int)
+	for i, name := range header {
+		column[name] = i
+	}
+	field := func(row []string, name string) string {
+		if i, ok := column[name]; ok && i < len(row) {
+			return row[i]
+		}
+		return ""
+	}
+	number := func(row []string, name string) float64 {
+		value, _ := strconv.ParseFloat(field(row, name), 64)
+		return value
+	}
+	optional := func(row []string, name string) *float64 {
+		value, err := strconv.ParseFloat(field(row, name), 64)
+		if err != nil {
+			return nil
+		}
+		return &value
+	}
+
+	var results BenchmarkResults
+	for {
+		row, err := reader.Read()
+		if errors.Is(err, io.EOF) {
+			return results, nil
+		} else if err != nil {
+			return nil, err
+		}
+		if len(row) > 0 && row[0] == header[0] {
+			continue
+		}
+
+		results = append(results, BenchmarkResult{
+			Metadata: Metadata{
+				Program:    field(row, "program"),
+				Mode:       field(row, "mode"),
+				Impl:       field(row, "implementation"),
+				Verify:     field(row, "verify"),
+				Alpha:      optional(row, "alpha"),
+				Beta:       optional(row, "beta"),
+				Layout:     field(row, "layout"),
+				Norm:       field(row, "norm"),
+				Structure:  field(row, "structure"),
+				TransA:     field(row, "trans_a") == "true",
+				TransB:     field(row, "trans_b") == "true",
+				MatrixSize: uint(number(row, "matrix_size")),
+				BlockSize:  uint(number(row, "block_size")),
+				NumThreads: uint(number(row, "num_threads")),
+			},
+			IndividualRuns: []IndividualRun{{
+				Run:                int(number(row, "run")),
+				MultiplicationTime: number(row, "multiplication_time"),
+				NormTime:           number(row, "norm_time"),
+				TotalTime:          number(row, "total_time"),
+			}},
+		})
+	}
+}
+
+func readResultSet(path string, metric string) (map[string]*Samples, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+
+	var results BenchmarkResults
+	if strings.EqualFold(filepath.Ext(path), ".csv") {
+		results, err = readResultRows(data)
+	} else {
+		results, err = readResultDocuments(data)
+	}
+	if err != nil {
+		return nil, fmt.Errorf("%s: %w", path, err)
+	}
+
+	sets := make(map[string]*Samples)
+	for _, result := range results {
+		key := configurationKey(result.Metadata)
+		if sets[key] == nil {
+			sets[key] = &Samples{key: key}
+		}
+		for _, run := range result.IndividualRuns {
+			sets[key].times = append(sets[key].times, runTime(run, metric))
+		}
+	}
+	return sets, nil
+}
+
+func median(values []float64) float64 {
+	sorted := append([]float64(nil), values...)
+	sort.Float64s(sorted)
+	n := len(sorted)
+	if n%2 == 1 {
+		return sorted[n/2]
+	}
+	return (sorted[n/2-1] + sorted[n/2]) / 2
+}
+
+// One-sided p-values of the Mann-Whitney U test that the candidate times
+// are stochastically larger (slower) or smaller (faster) than the baseline
+// ones, from the normal approximation with tie and continuity corrections.
+// Timings are rarely normal, so a rank test suits them better than a
+// t-test; with fewer than 4 runs a side it cannot reach p < 0.05.
+func mannWhitney(baseline []float64, candidate []float64) (pSlower float64, pFaster float64) {
+	type sample struct {
+		value       float64
+		isCandidate bool
+	}
+
+	n1 := float64(len(baseline))
+	n2 := float64(len(candidate))
+	n := n1 + n2
+	pooled := make([]sample, 0, len(baseline)+len(candidate))
+	for _, v := range baseline {
+		pooled = append(pooled, sample{v, false})
+	}
+	for _, v := range candidate {
+		pooled = append(pooled, sample{v, true})
+	}
+	sort.Slice(pooled, func(i, j int) bool { return pooled[i].value < pooled[j].value })
+
+	rankSum := 0.0
+	tieTerm := 0.0
+	for i := 0; i < len(pooled); {
+		j := i
+		for j < len(pooled) && pooled[j].value == pooled[i].value {
+			j++
+		}
+		// Tied values share the mean of ranks i+1 .. j.
+		rank := float64(i+j+1) / 2
+		for k := i; k < j; k++ {
+			if pooled[k].isCandidate {
+				rankSum += rank
+			}
+		}
+		t := float64(j - i)
+		tieTerm += t*t*t - t
+		i = j
+	}
+
+	u := rankSum - n2*(n2+1)/2
+	mean := n1 * n2 / 2
+	variance := n1 * n2 / 12 * ((n + 1) - tieTerm/(n*(n-1)))
+	if variance <= 0 {
+		return 1, 1
+	}
+	sd := math.Sqrt(variance)
+	zSlower := (u - mean - 0.5) / sd
+	zFaster := (mean - u - 0.5) / sd
+	return 0.5 * math.Erfc(zSlower/math.Sqrt2), 0.5 * math.Erfc(zFaster/math.Sqrt2)
+}
+
+func compareSamples(baseline *Samples, candidate *Samples, threshold float64, alpha float64) Comparison {
+	c := Comparison{
+		key:            baseline.key,
+		baselineMedian: median(baseline.times),
+		candMedian:     median(candidate.times),
+	}
+	c.change = c.candMedian/c.baselineMedian - 1
+	c.pSlower, c.pFaster = mannWhitney(baseline.times, candidate.times)
+
+	switch {
+	case c.change > threshold && c.pSlower < alpha:
+		c.verdict = "REGRESSION"
+	case c.change < -threshold && c.pFaster < alpha:
+		c.verdict = "improvement"
+	case c.pSlower < alpha || c.pFaster < alpha:
+		c.verdict = "within threshold"
+	default:
+		c.verdict = "no significant change"
+	}
+	return c
+}
+
+// `benchmark compare [flags] BASELINE CANDIDATE` matches the configurations
+// of two result sets and fails when any got slower by more than -threshold
+// at significance -alpha. Returns the exit status.
+func runCompare(args []string) int {
+	flags := flag.NewFlagSet("compare", flag.ExitOnError)
+	options := CompareFlags{
+		threshold: flags.Float64("threshold", 0.05,
+			"Relative slowdown of the median time that counts as a regression"),
+		alpha: flags.Float64("alpha", 0.05,
+			"Significance level of the Mann-Whitney U test"),
+		metric: flags.String("metric", METRIC_MULTIPLICATION,
+			"Timing to compare: multiplication, norm or total"),
+	}
+	flags.Usage = func() {
+		fmt.Fprintf(flags.Output(), "Usage: %s compare [flags] BASELINE CANDIDATE\n\n", os.Args[0])
+		fmt.Fprintln(flags.Output(), "Result files are YAML, --format json streams or --format csv (*.csv).")
+		flags.PrintDefaults()
+	}
+	flags.Parse(args)
+
+	if flags.NArg() != 2 {
+		flags.Usage()
+		return EXIT_ERROR
+	}
+	switch *options.metric {
+	case METRIC_MULTIPLICATION, METRIC_NORM, METRIC_TOTAL:
+	default:
+		fmt.Fprintf(os.Stderr, "Unknown metric '%s'\n", *options.metric)
+		return EXIT_ERROR
+	}
+
+	baseline, err := readResultSet(flags.Arg(0), *options.metric)
+	if err != nil {
+		fmt.Fprintln(os.Stderr, err)
+		return EXIT_ERROR
+	}
+	candidate, err := readResultSet(flags.Arg(1), *options.metric)
+	if err != nil {
+		fmt.Fprintln(os.Stderr, err)
+		return EXIT_ERROR
+	}
+
+	keys := make([]string, 0, len(baseline))
+	for key := range baseline {
+		keys = append(keys, key)
+	}
+	sort.Strings(keys)
+
+	fmt.Printf("\n## %s time: %s vs %s (threshold %.1f%%, alpha %g)\n",
+		*options.metric, flags.Arg(0), flags.Arg(1), *options.threshold*100, *options.alpha)
+	fmt.Println("| Configuration | Baseline median (s) | Candidate median (s) | Change | p (slower) | Verdict |")
+	fmt.Println("|---------------|---------------------|----------------------|--------|------------|---------|")
+
+	numRegressions := 0
+	numCompared := 0
+	for _, key := range keys {
+		cand, ok := candidate[key]
+		if !ok {
+			fmt.Printf("| %s | %.6f | - | - | - | missing in candidate |\n", key, median(baseline[key].times))
+			continue
+		}
+		c := compareSamples(baseline[key], cand, *options.threshold, *options.alpha)
+		numCompared++
+		if c.verdict == "REGRESSION" {
+			numRegressions++
+		}
+		fmt.Printf("| %s | %.6f | %.6f | %+.1f%% | %.4f | %s |\n",
+			c.key, c.baselineMedian, c.candMedian, c.change*100, c.pSlower, c.verdict)
+	}
+	fmt.Println()
+
+	if numCompared == 0 {
+		fmt.Fprintln(os.Stderr, "No configuration appears in both result sets")
+		return EXIT_ERROR
+	}
+	if numRegressions > 0 {
+		fmt.Printf("%d of %d configurations regressed\n", numRegressions, numCompared)
+		return EXIT_REGRESSION
+	}
+	fmt.Printf("No regressions in %d configurations\n", numCompared)
+	return 0
+}
@@ -1,12 +1,25 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <cblas.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "hpckern.h"
 
 #define FLAG_HELP "--help"
 #define FLAG_MATRIX_SIZE "--matrix-size"
@@ -16,11 +29,83 @@
 #define FLAG_NUMBER_OF_THREADS "--number-of-threads"
 #define FLAG_REPEATS "--repeats"
 #define FLAG_IMPL "--impl"
+#define FLAG_JOBS "--jobs"
+#define FLAG_QUEUE_DEPTH "--queue-depth"
+#define FLAG_STAGE_WORKERS "--stage-workers"
+#define FLAG_DISTINCT_JOBS "--distinct-jobs"
+#define FLAG_CACHE_MEMORY "--cache-memory"
+#define FLAG_CACHE_DIR "--cache-dir"
+#define FLAG_CACHE_DISK "--cache-disk"
+#define FLAG_PROCESSES "--processes"
+#define FLAG_TRANSPORT "--transport"
+#define FLAG_LAYOUT "--layout"
+#define FLAG_TRANS_A "--trans-a"
+#define FLAG_TRANS_B "--trans-b"
+#define FLAG_PRETRANSPOSE_B "--pretranspose-b"
+#define FLAG_ALPHA "--alpha"
+#define FLAG_BETA "--beta"
+#define FLAG_NORM "--norm"
+#define FLAG_UPDATES "--updates"
+#define FLAG_UPDATE_KIND "--update-kind"
+#define FLAG_UPDATE_RANK "--update-rank"
+#define FLAG_UPDATE_ROWS "--update-rows"
+#define FLAG_STRUCTURE "--structure"
+#define FLAG_DENSITY "--density"
+#define FLAG_BANDWIDTH "--bandwidth"
+#define FLAG_VERIFY "--verify"
+#define FLAG_VERIFY_TRIALS "--verify-trials"
+#define FLAG_COMPARE "--compare"
+#define FLAG_TOLERANCE "--tolerance"
+#define FLAG_WARMUP "--warmup"
+#define FLAG_MIN_TIME "--min-time"
+#define FLAG_MAX_TIME "--max-time"
+#define FLAG_MAX_REPEATS "--max-repeats"
+#define FLAG_TARGET_CI "--target-ci"
+#define FLAG_OUTLIER_K "--outlier-k"
+#define FLAG_FLUSH_CACHE "--flush-cache"
+#define FLAG_FORMAT "--format"
+#define FLAG_TRACE "--trace"
 
 #define IMPL_NAIVE "naive"
 #define IMPL_SERIAL "serial"
 #define IMPL_CBLAS "cblas"
 #define IMPL_THREADED "threaded"
+#define IMPL_SUMMA "summa"
+#define IMPL_RECURSIVE "recursive"
+#define IMPL_RECURSIVE_MORTON "recursive-morton"
+#define IMPL_TRANSPOSE "transpose"
+#define IMPL_ESTIMATE "estimate"
+#define IMPL_AUTO "auto"
+
+#define LAYOUT_NAME_ROW_MAJOR "row-major"
+#define LAYOUT_NAME_TILED "tiled"
+
+#define UPDATE_ROW_A "row-a"
+#define UPDATE_ROW_B "row-b"
+#define UPDATE_RANK_A "rank-a"
+#define UPDATE_RANK_B "rank-b"
+
+#define STRUCTURE_DENSE "dense"
+#define STRUCTURE_SPARSE "sparse"
+#define STRUCTURE_BANDED "banded"
+#define STRUCTURE_UPPER "upper"
+#define STRUCTURE_LOWER "lower"
+
+#define VERIFY_FULL "full"
+#define VERIFY_FREIVALDS "freivalds"
+#define VERIFY_NONE "none"
+
+// What a cached value of the pipeline is besides its operands: the product,
+// or one of the norms of the product.
+#define CACHE_PARAMS_PRODUCT 0
+#define CACHE_PARAMS_NORM(kind) (1 + (uint64_t)(kind))
+
+#define PROGRAM_NAME "norm"
+#define MODE_BENCHMARK "benchmark"
+#define MODE_JOBS "jobs"
+#define MODE_UPDATES "updates"
+#define TRANSPORT_TCP "tcp"
+#define TRANSPORT_MPI "mpi"
 
 #define EPS 1e-9
 #define DEFAULT_MATRIX_SIZE 1024
@@ -30,6 +115,44 @@
 #define DEFAULT_NUM_THREADS 4
 #define DEFAULT_REPEATS 1
 #define DEFAULT_IMPL IMPL_CBLAS
+#define DEFAULT_JOBS 0
+#define DEFAULT_QUEUE_DEPTH 2
+#define PIPELINE_NUM_STAGES 4
+#define DEFAULT_STAGE_WORKERS 1
+#define DEFAULT_DISTINCT_JOBS 0
+#define DEFAULT_CACHE_MEMORY 0
+#define DEFAULT_CACHE_DISK 1024
+#define DEFAULT_PROCESSES 4
+#define DEFAULT_LAYOUT LAYOUT_NAME_ROW_MAJOR
+#define DEFAULT_ALPHA 1.0
+#define DEFAULT_BETA 0.0
+#define DEFAULT_NORM "inf"
+#define NORM_ESTIMATE_RTOL 1e-6
+#define DEFAULT_UPDATES 0
+#define DEFAULT_UPDATE_KIND UPDATE_ROW_A
+#define DEFAULT_UPDATE_RANK 1
+#define DEFAULT_UPDATE_ROWS 0
+#define DEFAULT_STRUCTURE STRUCTURE_DENSE
+#define DEFAULT_DENSITY 0.05
+#define DEFAULT_BANDWIDTH 8
+#define DEFAULT_VERIFY VERIFY_FULL
+// SUMMA checks the distributed C in place; full gathers the whole problem.
+#define DEFAULT_SUMMA_VERIFY VERIFY_FREIVALDS
+// A full reference product per job would cost as much as the multiply stage.
+#define DEFAULT_JOBS_VERIFY VERIFY_FREIVALDS
+#define DEFAULT_VERIFY_TRIALS 8
+#define DEFAULT_COMPARE "abs"
+#define DEFAULT_REL_TOLERANCE 1e-12
+#define DEFAULT_ULP_TOLERANCE 64
+#define DEFAULT_WARMUP 0
+#define DEFAULT_MAX_REPEATS HPCKERN_HARNESS_MAX_ITERATIONS
+#define DEFAULT_OUTLIER_K HPCKERN_HARNESS_OUTLIER_K
+#define DEFAULT_FORMAT "yaml"
+#ifdef USE_MPI
+#define DEFAULT_TRANSPORT TRANSPORT_MPI
+#else
+#define DEFAULT_TRANSPORT TRANSPORT_TCP
+#endif
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -44,6 +167,7 @@
         double end_time = ts_end.tv_sec + ts_end.tv_nsec * 1e-9;       \
         result = end_time - start_time;                                \
     }
+#define CHECK(call) check_status((call), #call)
 
 typedef struct args_t
 {
@@ -55,34 +179,44 @@ typedef struct args_t
     size_t flag_number_of_threads;
     size_t flag_repeats;
     const char *flag_impl;
+    size_t flag_jobs;
+    size_t flag_queue_depth;
+    size_t flag_stage_workers[PIPELINE_NUM_STAGES];
+    size_t flag_distinct_jobs;
+    size_t flag_cache_memory;
+    const char *flag_cache_dir;
+    size_t flag_cache_disk;
+    size_t flag_processes;
+    const char *flag_transport;
+    const char *flag_layout;
+    bool flag_trans_a;
+    bool flag_trans_b;
+    bool flag_pretranspose_b;
+    double flag_alpha;
+    double flag_beta;
+    const char *flag_norm;
+    size_t flag_updates;
+    const char *flag_update_kind;
+    size_t flag_update_rank;
+    size_t flag_update_rows;
+    const char *flag_structure;
+    double flag_density;
+    size_t flag_bandwidth;
+    const char *flag_verify;
+    size_t flag_verify_trials;
+    const char *flag_compare;
+    double flag_tolerance;
+    size_t flag_warmup;
+    double flag_min_time;
+    double flag_max_time;
+    size_t flag_max_repeats;
+    double flag_target_ci;
+    double flag_outlier_k;
+    bool flag_flush_cache;
+    const char *flag_format;
+    const char *flag_trace;
 } args_t;
 
-typedef struct matrix_t
-{
-    size_t size;
-    double *data;
-} matrix_t;
-
-typedef struct matrix_mult_worker_params_t
-{
-    matrix_t *lhs;
-    matrix_t *rhs;
-    double *result;
-    size_t block_start_index;
-    size_t block_end_index;
-    size_t block_size;
-} matrix_mult_worker_params_t;
-
-typedef struct matrix_norm_worker_params_t
-{
-    matrix_t *mat;
-    long double *shared_max_sum;
-    pthread_mutex_t *mutex;
-    size_t block_size;
-    size_t start_index;
-    size_t end_index;
-} matrix_norm_worker_params_t;
-
 typedef struct benchmark_result_t
 {
     double benchmark_runtime;
@@ -92,8 +226,91 @@ typedef struct benchmark_result_t
     size_t num_threads;
     size_t matrix_size;
     const char *impl;
+    const char *layout;
+    const char *norm;
+    const char *structure;
+    const char *path;
+    const char *verify;
+    bool trans_a;
+    bool trans_b;
+    double alpha;
+    double beta;
+    // Whether --alpha or --beta asked for C = alpha A B + beta C, which the
+    // YAML and JSON results then record.
+    bool is_gemm;
+    // MODE_JOBS or MODE_UPDATES; NULL for a repeated single multiplication.
+    const char *mode;
 } benchmark_result_t;
 
+typedef struct transport_t
+{
+    int rank;
+    int size;
+    void *state;
+    void (*send)(struct transport_t *transport, int dest, const void *buf, size_t bytes);
+    void (*recv)(struct transport_t *transport, int src, void *buf, size_t bytes);
+    void (*finalize)(struct transport_t *transport);
+} transport_t;
+
+typedef struct pipeline_job_t
+{
+    size_t index;
+    hpckern_matrix_t *A;
+    hpckern_matrix_t *B;
+    hpckern_matrix_t *C;
+    long double norm;
+    uint64_t lhs_hash;
+    uint64_t rhs_hash;
+    bool is_norm_cached;
+    double mult_runtime;
+    double norm_runtime;
+} pipeline_job_t;
+
+typedef struct job_queue_t
+{
+    pipeline_job_t **slots;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    size_t num_producers;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_not_empty;
+    pthread_cond_t cond_not_full;
+} job_queue_t;
+
+typedef struct pipeline_t
+{
+    job_queue_t free_jobs;
+    job_queue_t generated;
+    job_queue_t multiplied;
+    job_queue_t normed;
+    size_t num_jobs;
+    // The generate workers claim job indices from this counter.
+    atomic_size_t next_job;
+    size_t num_threads;
+    size_t block_size;
+    int min_value;
+    int max_value;
+    // Job i draws its operands from seed + 2 i and its Freivalds vectors
+    // from seed + 2 i + 1, whichever worker runs it.
+    uint64_t seed;
+    const char *impl;
+    hpckern_norm_kind_t norm_kind;
+    // With distinct_jobs > 0, job i gets operand pair i % distinct_jobs.
+    size_t distinct_jobs;
+    hpckern_matrix_t **operands;
+    // NULL without --cache-memory or --cache-dir. needs_product is set when
+    // the verify stage reads C, so a cached norm alone does not do.
+    hpckern_cache_t *cache;
+    bool needs_product;
+    const char *norm;
+    const char *verify;
+    size_t verify_trials;
+    const char *compare;
+    double tolerance;
+    benchmark_result_t *results;
+} pipeline_t;
+
 void show_help(const char *program_name)
 {
     printf("Usage:\n");
@@ -115,7 +332,86 @@ void show_help(const char *program_name)
     printf("  %-25s Set number of benchmark repetitions\n", FLAG_REPEATS);
     printf("  %-25s (default: %d).\n", "", DEFAULT_REPEATS);
     printf("  %-25s Set implementation to use:\n", FLAG_IMPL);
-    printf("  %-25s %s, %s, %s, %s (default: %s).\n", "", IMPL_NAIVE, IMPL_SERIAL, IMPL_CBLAS, IMPL_THREADED, DEFAULT_IMPL);
+    printf("  %-25s %s, %s, %s, %s, %s,\n", "", IMPL_NAIVE, IMPL_SERIAL, IMPL_CBLAS, IMPL_THREADED, IMPL_SUMMA);
+    printf("  %-25s %s, %s, %s, %s,\n", "", IMPL_RECURSIVE, IMPL_RECURSIVE_MORTON, IMPL_TRANSPOSE, IMPL_ESTIMATE);
+    printf("  %-25s %s (default: %s).\n", "", IMPL_AUTO, DEFAULT_IMPL);
+    printf("  %-25s Process a stream of this many independent (A, B)\n", FLAG_JOBS);
+    printf("  %-25s jobs through a pipeline whose generate, multiply,\n", "");
+    printf("  %-25s norm and verify stages overlap (default: %d, off).\n", "", DEFAULT_JOBS);
+    printf("  %-25s Capacity of the queues between pipeline stages\n", FLAG_QUEUE_DEPTH);
+    printf("  %-25s (default: %d).\n", "", DEFAULT_QUEUE_DEPTH);
+    printf("  %-25s Worker threads of the generate, multiply, norm and\n", FLAG_STAGE_WORKERS);
+    printf("  %-25s verify stages as G,M,N,V (default: %d each).\n", "", DEFAULT_STAGE_WORKERS);
+    printf("  %-25s Draw the %s operands from this many (A, B) pairs,\n", FLAG_DISTINCT_JOBS, FLAG_JOBS);
+    printf("  %-25s so pairs repeat (default: %d, every job fresh).\n", "", DEFAULT_DISTINCT_JOBS);
+    printf("  %-25s MiB of products and norms the %s pipeline keeps\n", FLAG_CACHE_MEMORY, FLAG_JOBS);
+    printf("  %-25s by the content hash of A and B, evicting the least\n", "");
+    printf("  %-25s recently used (default: %d, off). A repeated pair skips\n", "", DEFAULT_CACHE_MEMORY);
+    printf("  %-25s the product, and with %s %s the norm needs no C.\n", "", FLAG_VERIFY, VERIFY_NONE);
+    printf("  %-25s Also keep them as files in this directory, shared\n", FLAG_CACHE_DIR);
+    printf("  %-25s with later runs (default: off)...\n", "");
+    printf("  %-25s ... up to this many MiB (default: %d).\n", FLAG_CACHE_DISK, DEFAULT_CACHE_DISK);
+    printf("  %-25s Number of processes for the %s implementation;\n", FLAG_PROCESSES, IMPL_SUMMA);
+    printf("  %-25s must be a perfect square (default: %d).\n", "", DEFAULT_PROCESSES);
+    printf("  %-25s Transport between processes: %s, or %s when\n", FLAG_TRANSPORT, TRANSPORT_TCP, TRANSPORT_MPI);
+    printf("  %-25s built with -DUSE_MPI (default: %s).\n", "", DEFAULT_TRANSPORT);
+    printf("  %-25s Storage layout for %s and %s: %s, or %s\n", FLAG_LAYOUT, IMPL_SERIAL, IMPL_THREADED, LAYOUT_NAME_ROW_MAJOR, LAYOUT_NAME_TILED);
+    printf("  %-25s with --block-size x --block-size tiles (default: %s).\n", "", DEFAULT_LAYOUT);
+    printf("  %-25s A is supplied transposed: compute A^T * B.\n", FLAG_TRANS_A);
+    printf("  %-25s B is supplied transposed: compute A * B^T. The %s,\n", FLAG_TRANS_B, IMPL_NAIVE);
+    printf("  %-25s %s and %s kernels use it directly as unit-stride rows.\n", "", IMPL_SERIAL, IMPL_THREADED);
+    printf("  %-25s Transpose B into a scratch buffer before multiplying,\n", FLAG_PRETRANSPOSE_B);
+    printf("  %-25s so %s, %s and %s run on unit-stride dot products.\n", "", IMPL_NAIVE, IMPL_SERIAL, IMPL_THREADED);
+    printf("  %-25s Scale A * B in C = alpha * A * B + beta * C,\n", FLAG_ALPHA);
+    printf("  %-25s computed like cblas_dgemm by any single-node\n", "");
+    printf("  %-25s implementation (default: %.1f).\n", "", DEFAULT_ALPHA);
+    printf("  %-25s Scale C in the same update; a nonzero beta starts C\n", FLAG_BETA);
+    printf("  %-25s random and every repeat updates it in place\n", "");
+    printf("  %-25s (default: %.1f).\n", "", DEFAULT_BETA);
+    printf("  %-25s Norm of the product: inf (max row sum), one (max\n", FLAG_NORM);
+    printf("  %-25s column sum), frobenius, max-abs, or two (power-iteration\n", "");
+    printf("  %-25s estimate of the spectral norm). Everything but inf needs\n", "");
+    printf("  %-25s the %s layout and no %s (default: %s).\n", "", LAYOUT_NAME_ROW_MAJOR, IMPL_SUMMA, DEFAULT_NORM);
+    printf("  %-25s Keep C = A * B and its row sums, then apply this many\n", FLAG_UPDATES);
+    printf("  %-25s random updates, refreshing only the affected rows\n", "");
+    printf("  %-25s and the max-heap of row sums (default: %d, off).\n", "", DEFAULT_UPDATES);
+    printf("  %-25s %s or %s replace a row of A or B, %s or %s add\n", FLAG_UPDATE_KIND, UPDATE_ROW_A, UPDATE_ROW_B, UPDATE_RANK_A, UPDATE_RANK_B);
+    printf("  %-25s a rank-k term U V^T to A or B (default: %s).\n", "", DEFAULT_UPDATE_KIND);
+    printf("  %-25s k for the rank updates (default: %d).\n", FLAG_UPDATE_RANK, DEFAULT_UPDATE_RANK);
+    printf("  %-25s Rows of U that are nonzero in the rank updates, which\n", FLAG_UPDATE_ROWS);
+    printf("  %-25s bounds the rows of C a %s update changes\n", "", UPDATE_RANK_A);
+    printf("  %-25s (default: %d, every row).\n", "", DEFAULT_UPDATE_ROWS);
+    printf("  %-25s Structure of A: %s, %s (random nonzeros at --density),\n", FLAG_STRUCTURE, STRUCTURE_DENSE, STRUCTURE_SPARSE);
+    printf("  %-25s %s (--bandwidth diagonals on each side of the main one),\n", "", STRUCTURE_BANDED);
+    printf("  %-25s %s or %s triangular (default: %s).\n", "", STRUCTURE_UPPER, STRUCTURE_LOWER, DEFAULT_STRUCTURE);
+    printf("  %-25s Fraction of nonzeros for %s (default: %.2f).\n", FLAG_DENSITY, STRUCTURE_SPARSE, DEFAULT_DENSITY);
+    printf("  %-25s Bandwidth for %s (default: %d).\n", FLAG_BANDWIDTH, STRUCTURE_BANDED, DEFAULT_BANDWIDTH);
+    printf("  %-25s Check C against a cblas reference (%s), with\n", FLAG_VERIFY, VERIFY_FULL);
+    printf("  %-25s Freivalds' O(k n^2) random-vector test (%s), or not\n", "", VERIFY_FREIVALDS);
+    printf("  %-25s at all (%s) (default: %s, %s for %s, which runs\n", "", VERIFY_NONE, DEFAULT_VERIFY, DEFAULT_SUMMA_VERIFY, IMPL_SUMMA);
+    printf("  %-25s it on the distributed blocks; %s gathers A, B and C,\n", "", VERIFY_FULL);
+    printf("  %-25s and %s for %s).\n", "", DEFAULT_JOBS_VERIFY, FLAG_JOBS);
+    printf("  %-25s Random vectors k for %s; a wrong C passes with\n", FLAG_VERIFY_TRIALS, VERIFY_FREIVALDS);
+    printf("  %-25s probability at most 2^-k (default: %d).\n", "", DEFAULT_VERIFY_TRIALS);
+    printf("  %-25s How %s compares C with the reference: abs, rel\n", FLAG_COMPARE, VERIFY_FULL);
+    printf("  %-25s (error over the larger magnitude) or ulp (default: %s).\n", "", DEFAULT_COMPARE);
+    printf("  %-25s Largest accepted error (default: %g for abs, %g for\n", FLAG_TOLERANCE, EPS, DEFAULT_REL_TOLERANCE);
+    printf("  %-25s rel, %d for ulp).\n", "", DEFAULT_ULP_TOLERANCE);
+    printf("  %-25s Untimed iterations before the measured ones (default: %d).\n", FLAG_WARMUP, DEFAULT_WARMUP);
+    printf("  %-25s Keep repeating past --repeats until this many seconds\n", FLAG_MIN_TIME);
+    printf("  %-25s were measured (default: 0, off).\n", "");
+    printf("  %-25s ... and until the 95%% confidence interval of the mean\n", FLAG_TARGET_CI);
+    printf("  %-25s is within this fraction of it, e.g. 0.01 (default: 0, off).\n", "");
+    printf("  %-25s Stop auto-repeating after this many seconds\n", FLAG_MAX_TIME);
+    printf("  %-25s (default: 0, no limit)...\n", "");
+    printf("  %-25s ... or this many iterations (default: %d).\n", FLAG_MAX_REPEATS, DEFAULT_MAX_REPEATS);
+    printf("  %-25s Drop samples more than k scaled MADs from the median\n", FLAG_OUTLIER_K);
+    printf("  %-25s from the harness statistics; 0 keeps all (default: %.1f).\n", "", DEFAULT_OUTLIER_K);
+    printf("  %-25s Evict the caches before every iteration.\n", FLAG_FLUSH_CACHE);
+    printf("  %-25s Result format: yaml, json or csv (one row per run),\n", FLAG_FORMAT);
+    printf("  %-25s each with the system and build metadata (default: %s).\n", "", DEFAULT_FORMAT);
+    printf("  %-25s Write a Chrome trace of every thread to this file;\n", FLAG_TRACE);
+    printf("  %-25s needs a build with make TRACE=1 (default: off).\n", "");
 
     printf("\nImplementations:\n");
     printf("  %-15s Basic O(n³) triple-nested loop matrix multiplication.\n", IMPL_NAIVE);
@@ -125,11 +421,25 @@ void show_help(const char *program_name)
     printf("  %-15s optimized assembly routines (OpenBLAS).\n", "");
     printf("  %-15s Multi-threaded blocked matrix multiplication using\n", IMPL_THREADED);
     printf("  %-15s pthreads. Requires --block-size and --number-of-threads.\n", "");
+    printf("  %-15s Distributed SUMMA over a sqrt(P) x sqrt(P) process grid\n", IMPL_SUMMA);
+    printf("  %-15s with cblas_dgemm as the local kernel. Requires --processes.\n", "");
+    printf("  %-15s Cache-oblivious divide-and-conquer multiplication; adapts\n", IMPL_RECURSIVE);
+    printf("  %-15s to every cache level without a block size, any N.\n", "");
+    printf("  %-15s Same recursion over Morton (Z-order) tiled copies of\n", IMPL_RECURSIVE_MORTON);
+    printf("  %-15s the operands, so each sub-problem is contiguous.\n", "");
+    printf("  %-15s Benchmarks the cache-blocked parallel transpose itself,\n", IMPL_TRANSPOSE);
+    printf("  %-15s out of place and in place, with --block-size tiles.\n", "");
+    printf("  %-15s ||A * B||_inf in O(n^2) without forming A * B: exact as\n", IMPL_ESTIMATE);
+    printf("  %-15s max row of A (B 1) for nonnegative data, otherwise a\n", "");
+    printf("  %-15s Hager/Higham lower-bound estimate. Uses --number-of-threads.\n", "");
+    printf("  %-15s Scans A and runs the CSR, banded or triangular kernel on\n", IMPL_AUTO);
+    printf("  %-15s --number-of-threads when it pays off, else cblas. The scan\n", "");
+    printf("  %-15s and conversion are timed with the multiplication.\n", "");
 
     printf("\nConstraints:\n");
     printf("  - Matrix size must be positive\n");
     printf("  - Min value must be ≤ max value\n");
-    printf("  - Block size must evenly divide matrix size\n");
+    printf("  - Block size must evenly divide matrix size for serial and threaded\n");
     printf("  - Number of threads must be ≥ 1 and ≤ matrix size\n");
     printf("  - Number of repeats must be > 0\n");
     printf("  - Serial and threaded implementations require valid block size\n");
@@ -141,6 +451,21 @@ void show_help(const char *program_name)
     printf("  %s --matrix-size 512 --impl cblas --repeats 3\n", program_name);
     printf("  %s --impl threaded --number-of-threads 8 --block-size 256\n", program_name);
     printf("  %s --matrix-size 2048 --min-value 1 --max-value 100 --repeats 5\n", program_name);
+    printf("  %s --matrix-size 1024 --impl threaded --block-size 128 --jobs 16\n", program_name);
+    printf("  %s --matrix-size 1024 --impl cblas --jobs 64 --distinct-jobs 8 --cache-memory 256 --verify none\n", program_name);
+    printf("  %s --matrix-size 2048 --impl summa --processes 4\n", program_name);
+    printf("  %s --matrix-size 2048 --impl threaded --block-size 64 --layout tiled\n", program_name);
+    printf("  %s --matrix-size 1024 --impl serial --block-size 64 --trans-b\n", program_name);
+    printf("  %s --matrix-size 1024 --impl threaded --block-size 64 --beta 1 --repeats 4\n", program_name);
+    printf("  %s --matrix-size 2048 --impl threaded --block-size 64 --norm one\n", program_name);
+    printf("  %s --matrix-size 2048 --impl cblas --updates 100 --update-kind row-b\n", program_name);
+    printf("  %s --matrix-size 8192 --impl estimate --number-of-threads 4\n", program_name);
+    printf("  %s --matrix-size 4096 --impl auto --structure sparse --density 0.01\n", program_name);
+    printf("  %s --matrix-size 4096 --impl cblas --verify freivalds --verify-trials 16\n", program_name);
+    printf("  %s --matrix-size 4096 --impl recursive --compare ulp --tolerance 16\n", program_name);
+    printf("  %s --matrix-size 1024 --impl cblas --warmup 2 --min-time 1 --target-ci 0.01\n", program_name);
+    printf("  %s --matrix-size 4096 --impl transpose --block-size 32 --number-of-threads 4\n", program_name);
+    printf("  mpirun -n 16 %s --matrix-size 8192 --impl summa --transport mpi\n", program_name);
     printf("  %s --help\n", program_name);
 
     printf("\nNotes:\n");
@@ -166,20 +491,63 @@ void panic_unless(bool predicate, const char *fmt, ...)
     abort();
 }
 
+void check_status(hpckern_status_t status, const char *call)
+{
+    panic_unless(status == HPCKERN_OK, "%s failed: %s\n", call, hpckern_status_name(status));
+}
+
+hpckern_matrix_t *matrix_alloc(size_t size)
+{
+    hpckern_matrix_t *mat = hpckern_matrix_init(size);
+
+    panic_unless(mat != NULL, "Failed to allocate a %zux%zu matrix\n", size, size);
+    return mat;
+}
+
+hpckern_matrix_t *matrix_alloc_tiled(size_t size, size_t tile_size)
+{
+    hpckern_matrix_t *mat = hpckern_matrix_init_tiled(size, tile_size);
+
+    panic_unless(mat != NULL, "Failed to allocate a %zux%zu matrix in %zu-wide tiles\n", size, size, tile_size);
+    return mat;
+}
+
+hpckern_context_t *context_alloc(size_t num_threads)
+{
+    hpckern_context_t *ctx = hpckern_context_create(num_threads);
+
+    panic_unless(ctx != NULL, "Failed to create a context with %zu threads\n", num_threads);
+    return ctx;
+}
+
 void args_validate(args_t *args)
 {
+    hpckern_norm_kind_t norm_kind = HPCKERN_NORM_INF;
+    hpckern_tolerance_t compare_mode = HPCKERN_TOLERANCE_ABS;
+    hpckern_format_t format = HPCKERN_FORMAT_YAML;
+
+    if (args->flag_verify == NULL)
+    {
+        if (strcmp(args->flag_impl, IMPL_SUMMA) == 0)
+        {
+            args->flag_verify = DEFAULT_SUMMA_VERIFY;
+        }
+        else if (args->flag_jobs > 0)
+        {
+            args->flag_verify = DEFAULT_JOBS_VERIFY;
+        }
+        else
+        {
+            args->flag_verify = DEFAULT_VERIFY;
+        }
+    }
+
     panic_unless(
         args->flag_min_value <= args->flag_max_value,
         "Invalid value interval of %d .. %d\n",
         args->flag_min_value,
         args->flag_max_value);
 
-    panic_unless(
-        args->flag_matrix_size % args->flag_block_size == 0,
-        "Block size (%d) must divide matrix size (%d).\n",
-        args->flag_block_size,
-        args->flag_matrix_size);
-
     panic_unless(
         args->flag_number_of_threads >= 1,
         "The number of threads (%d) must be at least 1\n",
@@ -196,13 +564,259 @@ void args_validate(args_t *args)
         "Number of repeats (%d) must be greater than 0\n",
         args->flag_repeats);
 
+    panic_unless(
+        args->flag_queue_depth > 0,
+        "Queue depth (%d) must be greater than 0\n",
+        args->flag_queue_depth);
+
+    for (size_t i = 0; i < PIPELINE_NUM_STAGES; i++)
+    {
+        panic_unless(
+            args->flag_stage_workers[i] > 0,
+            "Every pipeline stage needs at least one worker (%s)\n",
+            FLAG_STAGE_WORKERS);
+    }
+
     panic_unless(
         strcmp(args->flag_impl, IMPL_NAIVE) == 0 ||
             strcmp(args->flag_impl, IMPL_SERIAL) == 0 ||
             strcmp(args->flag_impl, IMPL_CBLAS) == 0 ||
-            strcmp(args->flag_impl, IMPL_THREADED) == 0,
-        "Invalid implementation '%s'. Valid options: %s, %s, %s, %s\n",
-        args->flag_impl, IMPL_NAIVE, IMPL_SERIAL, IMPL_CBLAS, IMPL_THREADED);
+            strcmp(args->flag_impl, IMPL_THREADED) == 0 ||
+            strcmp(args->flag_impl, IMPL_SUMMA) == 0 ||
+            strcmp(args->flag_impl, IMPL_RECURSIVE) == 0 ||
+            strcmp(args->flag_impl, IMPL_RECURSIVE_MORTON) == 0 ||
+            strcmp(args->flag_impl, IMPL_TRANSPOSE) == 0 ||
+            strcmp(args->flag_impl, IMPL_ESTIMATE) == 0 ||
+            strcmp(args->flag_impl, IMPL_AUTO) == 0,
+        "Invalid implementation '%s'. Valid options: %s, %s, %s, %s, %s, %s, %s, %s, %s, %s\n",
+        args->flag_impl, IMPL_NAIVE, IMPL_SERIAL, IMPL_CBLAS, IMPL_THREADED, IMPL_SUMMA, IMPL_RECURSIVE, IMPL_RECURSIVE_MORTON, IMPL_TRANSPOSE, IMPL_ESTIMATE, IMPL_AUTO);
+
+    panic_unless(
+        strcmp(args->flag_transport, TRANSPORT_TCP) == 0
+#ifdef USE_MPI
+            || strcmp(args->flag_transport, TRANSPORT_MPI) == 0
+#endif
+        ,
+        "Invalid transport '%s'. Valid options: %s%s\n",
+        args->flag_transport,
+        TRANSPORT_TCP,
+#ifdef USE_MPI
+        ", " TRANSPORT_MPI
+#else
+        " (rebuild with -DUSE_MPI for " TRANSPORT_MPI ")"
+#endif
+    );
+
+    panic_unless(
+        strcmp(args->flag_layout, LAYOUT_NAME_ROW_MAJOR) == 0 ||
+            (strcmp(args->flag_layout, LAYOUT_NAME_TILED) == 0 &&
+             (strcmp(args->flag_impl, IMPL_SERIAL) == 0 || strcmp(args->flag_impl, IMPL_THREADED) == 0)),
+        "Invalid layout '%s'. Valid options: %s, or %s with the %s and %s implementations\n",
+        args->flag_layout, LAYOUT_NAME_ROW_MAJOR, LAYOUT_NAME_TILED, IMPL_SERIAL, IMPL_THREADED);
+
+    panic_unless(
+        !(args->flag_trans_a || args->flag_trans_b || args->flag_pretranspose_b) ||
+            (args->flag_jobs == 0 &&
+             strcmp(args->flag_layout, LAYOUT_NAME_ROW_MAJOR) == 0 &&
+             strcmp(args->flag_impl, IMPL_SUMMA) != 0 &&
+             strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "%s, %s and %s only apply to single-node multiplication in the %s layout\n",
+        FLAG_TRANS_A, FLAG_TRANS_B, FLAG_PRETRANSPOSE_B, LAYOUT_NAME_ROW_MAJOR);
+
+    panic_unless(
+        (args->flag_alpha == DEFAULT_ALPHA && args->flag_beta == DEFAULT_BETA) ||
+            (args->flag_jobs == 0 &&
+             strcmp(args->flag_impl, IMPL_SUMMA) != 0 &&
+             strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "%s and %s only apply to single-node multiplication without %s\n",
+        FLAG_ALPHA, FLAG_BETA, FLAG_JOBS);
+
+    panic_unless(
+        hpckern_norm_kind_from_name(args->flag_norm, &norm_kind),
+        "Invalid norm '%s'. Valid options: inf, one, frobenius, max-abs, two\n",
+        args->flag_norm);
+
+    panic_unless(
+        norm_kind == HPCKERN_NORM_INF ||
+            (strcmp(args->flag_layout, LAYOUT_NAME_ROW_MAJOR) == 0 &&
+             strcmp(args->flag_impl, IMPL_SUMMA) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "The %s norm needs the %s layout and a single-node implementation\n",
+        args->flag_norm, LAYOUT_NAME_ROW_MAJOR);
+
+    panic_unless(
+        strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 || (args->flag_block_size > 0 && args->flag_jobs == 0),
+        "Implementation '%s' requires a valid block size and no %s\n",
+        IMPL_TRANSPOSE, FLAG_JOBS);
+
+    panic_unless(
+        args->flag_updates == 0 ||
+            (args->flag_jobs == 0 &&
+             strcmp(args->flag_layout, LAYOUT_NAME_ROW_MAJOR) == 0 &&
+             !(args->flag_trans_a || args->flag_trans_b || args->flag_pretranspose_b) &&
+             args->flag_alpha == DEFAULT_ALPHA && args->flag_beta == DEFAULT_BETA &&
+             norm_kind == HPCKERN_NORM_INF &&
+             strcmp(args->flag_impl, IMPL_SUMMA) != 0 &&
+             strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "%s needs a single-node implementation in the %s layout, the inf norm and no %s, transposes, alpha or beta\n",
+        FLAG_UPDATES, LAYOUT_NAME_ROW_MAJOR, FLAG_JOBS);
+
+    panic_unless(
+        strcmp(args->flag_update_kind, UPDATE_ROW_A) == 0 ||
+            strcmp(args->flag_update_kind, UPDATE_ROW_B) == 0 ||
+            strcmp(args->flag_update_kind, UPDATE_RANK_A) == 0 ||
+            strcmp(args->flag_update_kind, UPDATE_RANK_B) == 0,
+        "Invalid update kind '%s'. Valid options: %s, %s, %s, %s\n",
+        args->flag_update_kind, UPDATE_ROW_A, UPDATE_ROW_B, UPDATE_RANK_A, UPDATE_RANK_B);
+
+    panic_unless(
+        args->flag_update_rank >= 1 && args->flag_update_rank <= args->flag_matrix_size,
+        "The update rank (%zu) must be between 1 and the matrix size (%zu)\n",
+        args->flag_update_rank, args->flag_matrix_size);
+
+    panic_unless(
+        args->flag_update_rows <= args->flag_matrix_size,
+        "The update rows (%zu) must not exceed the matrix size (%zu)\n",
+        args->flag_update_rows, args->flag_matrix_size);
+
+    panic_unless(
+        strcmp(args->flag_impl, IMPL_ESTIMATE) != 0 || args->flag_jobs == 0,
+        "Implementation '%s' does not support %s\n",
+        IMPL_ESTIMATE, FLAG_JOBS);
+
+    panic_unless(
+        strcmp(args->flag_structure, STRUCTURE_DENSE) == 0 ||
+            strcmp(args->flag_structure, STRUCTURE_SPARSE) == 0 ||
+            strcmp(args->flag_structure, STRUCTURE_BANDED) == 0 ||
+            strcmp(args->flag_structure, STRUCTURE_UPPER) == 0 ||
+            strcmp(args->flag_structure, STRUCTURE_LOWER) == 0,
+        "Invalid structure '%s'. Valid options: %s, %s, %s, %s, %s\n",
+        args->flag_structure, STRUCTURE_DENSE, STRUCTURE_SPARSE, STRUCTURE_BANDED, STRUCTURE_UPPER, STRUCTURE_LOWER);
+
+    panic_unless(
+        args->flag_density > 0.0 && args->flag_density <= 1.0,
+        "The density (%g) must be in (0, 1]\n",
+        args->flag_density);
+
+    panic_unless(
+        args->flag_bandwidth < args->flag_matrix_size,
+        "The bandwidth (%zu) must be less than the matrix size (%zu)\n",
+        args->flag_bandwidth, args->flag_matrix_size);
+
+    panic_unless(
+        (strcmp(args->flag_structure, STRUCTURE_DENSE) == 0 && strcmp(args->flag_impl, IMPL_AUTO) != 0) ||
+            (args->flag_jobs == 0 &&
+             args->flag_updates == 0 &&
+             strcmp(args->flag_impl, IMPL_SUMMA) != 0 &&
+             strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "%s and implementation '%s' need a single-node implementation without %s or %s\n",
+        FLAG_STRUCTURE, IMPL_AUTO, FLAG_JOBS, FLAG_UPDATES);
+
+    panic_unless(
+        strcmp(args->flag_impl, IMPL_AUTO) != 0 ||
+            (strcmp(args->flag_layout, LAYOUT_NAME_ROW_MAJOR) == 0 &&
+             !(args->flag_trans_a || args->flag_trans_b || args->flag_pretranspose_b)),
+        "Implementation '%s' needs the %s layout and no transposes\n",
+        IMPL_AUTO, LAYOUT_NAME_ROW_MAJOR);
+
+    panic_unless(
+        strcmp(args->flag_verify, VERIFY_FULL) == 0 ||
+            strcmp(args->flag_verify, VERIFY_FREIVALDS) == 0 ||
+            strcmp(args->flag_verify, VERIFY_NONE) == 0,
+        "Invalid verification '%s'. Valid options: %s, %s, %s\n",
+        args->flag_verify, VERIFY_FULL, VERIFY_FREIVALDS, VERIFY_NONE);
+
+    panic_unless(
+        args->flag_verify_trials >= 1,
+        "The number of verification trials (%zu) must be at least 1\n",
+        args->flag_verify_trials);
+
+    panic_unless(
+        strcmp(args->flag_verify, VERIFY_FULL) == 0 ||
+            (args->flag_updates == 0 &&
+             strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "%s %s only applies to the multiplication benchmark, %s and %s\n",
+        FLAG_VERIFY, args->flag_verify, IMPL_SUMMA, FLAG_JOBS);
+
+    panic_unless(
+        hpckern_tolerance_from_name(args->flag_compare, &compare_mode),
+        "Invalid comparison '%s'. Valid options: abs, rel, ulp\n",
+        args->flag_compare);
+
+    // A negative tolerance means none was given, so take the mode's default.
+    if (args->flag_tolerance < 0.0)
+    {
+        args->flag_tolerance = compare_mode == HPCKERN_TOLERANCE_ABS   ? EPS
+                               : compare_mode == HPCKERN_TOLERANCE_REL ? DEFAULT_REL_TOLERANCE
+                                                                       : DEFAULT_ULP_TOLERANCE;
+    }
+
+    panic_unless(
+        args->flag_min_time >= 0.0 && args->flag_max_time >= 0.0 && args->flag_target_ci >= 0.0 && args->flag_outlier_k >= 0.0,
+        "%s, %s, %s and %s must not be negative\n",
+        FLAG_MIN_TIME, FLAG_MAX_TIME, FLAG_TARGET_CI, FLAG_OUTLIER_K);
+
+    panic_unless(
+        (args->flag_warmup == DEFAULT_WARMUP && args->flag_min_time == 0.0 && args->flag_target_ci == 0.0 && !args->flag_flush_cache) ||
+            (args->flag_jobs == 0 &&
+             args->flag_updates == 0 &&
+             strcmp(args->flag_impl, IMPL_SUMMA) != 0 &&
+             strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0 &&
+             strcmp(args->flag_impl, IMPL_ESTIMATE) != 0),
+        "%s, %s, %s and %s only apply to the multiplication benchmark\n",
+        FLAG_WARMUP, FLAG_MIN_TIME, FLAG_TARGET_CI, FLAG_FLUSH_CACHE);
+
+    panic_unless(
+        (args->flag_distinct_jobs == DEFAULT_DISTINCT_JOBS && args->flag_cache_memory == DEFAULT_CACHE_MEMORY && args->flag_cache_dir == NULL) ||
+            args->flag_jobs > 0,
+        "%s, %s and %s only apply to %s\n",
+        FLAG_DISTINCT_JOBS, FLAG_CACHE_MEMORY, FLAG_CACHE_DIR, FLAG_JOBS);
+
+    panic_unless(
+        hpckern_format_from_name(args->flag_format, &format),
+        "Invalid format '%s'. Valid options: yaml, json, csv\n",
+        args->flag_format);
+
+    panic_unless(
+        args->flag_trace == NULL || hpckern_trace_enabled(),
+        "%s needs libhpckern and norm built with make TRACE=1\n",
+        FLAG_TRACE);
+
+    panic_unless(
+        format == HPCKERN_FORMAT_YAML || strcmp(args->flag_impl, IMPL_TRANSPOSE) != 0,
+        "%s only writes YAML\n",
+        IMPL_TRANSPOSE);
+
+    panic_unless(
+        args->flag_processes >= 1,
+        "The number of processes (%d) must be at least 1\n",
+        args->flag_processes);
+
+    // Checked before the tcp transport forks, so it fails once. Under mpi
+    // the ranks already run, and every one of them validates.
+    if (strcmp(args->flag_impl, IMPL_SUMMA) == 0)
+    {
+        int num_processes = (int)args->flag_processes;
+        size_t grid_dim;
+
+#ifdef USE_MPI
+        if (strcmp(args->flag_transport, TRANSPORT_MPI) == 0)
+        {
+            MPI_Comm_size(MPI_COMM_WORLD, &num_processes);
+        }
+#endif
+        grid_dim = (size_t)llround(sqrt((double)num_processes));
+        panic_unless(
+            grid_dim * grid_dim == (size_t)num_processes && args->flag_matrix_size % grid_dim == 0,
+            "SUMMA needs a square number of processes (%d) whose root divides matrix size (%zu)\n",
+            num_processes,
+            args->flag_matrix_size);
+    }
 
     if (strcmp(args->flag_impl, IMPL_SERIAL) == 0 || strcmp(args->flag_impl, IMPL_THREADED) == 0)
     {
@@ -211,6 +825,12 @@ void args_validate(args_t *args)
             "Implementation '%s' requires a valid block size (current: %d)\n",
             args->flag_impl,
             args->flag_block_size);
+
+        panic_unless(
+            args->flag_matrix_size % args->flag_block_size == 0,
+            "Block size (%d) must divide matrix size (%d).\n",
+            args->flag_block_size,
+            args->flag_matrix_size);
     }
 }
 
@@ -227,6 +847,36 @@ args_t *args_parse(int argc, const char **argv)
     args->flag_number_of_threads = DEFAULT_NUM_THREADS;
     args->flag_repeats = DEFAULT_REPEATS;
     args->flag_impl = DEFAULT_IMPL;
+    args->flag_jobs = DEFAULT_JOBS;
+    args->flag_queue_depth = DEFAULT_QUEUE_DEPTH;
+    for (size_t i = 0; i < PIPELINE_NUM_STAGES; i++)
+    {
+        args->flag_stage_workers[i] = DEFAULT_STAGE_WORKERS;
+    }
+    args->flag_distinct_jobs = DEFAULT_DISTINCT_JOBS;
+    args->flag_cache_memory = DEFAULT_CACHE_MEMORY;
+    args->flag_cache_disk = DEFAULT_CACHE_DISK;
+    args->flag_processes = DEFAULT_PROCESSES;
+    args->flag_transport = DEFAULT_TRANSPORT;
+    args->flag_layout = DEFAULT_LAYOUT;
+    args->flag_alpha = DEFAULT_ALPHA;
+    args->flag_beta = DEFAULT_BETA;
+    args->flag_norm = DEFAULT_NORM;
+    args->flag_updates = DEFAULT_UPDATES;
+    args->flag_update_kind = DEFAULT_UPDATE_KIND;
+    args->flag_update_rank = DEFAULT_UPDATE_RANK;
+    args->flag_update_rows = DEFAULT_UPDATE_ROWS;
+    args->flag_structure = DEFAULT_STRUCTURE;
+    args->flag_density = DEFAULT_DENSITY;
+    args->flag_bandwidth = DEFAULT_BANDWIDTH;
+    args->flag_verify = NULL;
+    args->flag_verify_trials = DEFAULT_VERIFY_TRIALS;
+    args->flag_compare = DEFAULT_COMPARE;
+    args->flag_tolerance = -1.0;
+    args->flag_warmup = DEFAULT_WARMUP;
+    args->flag_max_repeats = DEFAULT_MAX_REPEATS;
+    args->flag_outlier_k = DEFAULT_OUTLIER_K;
+    args->flag_format = DEFAULT_FORMAT;
 
     if (argc == 1)
     {
@@ -275,65 +925,195 @@ args_t *args_parse(int argc, const char **argv)
             panic_unless(i + 1 < argc, "Implementation must be specified.\n");
             args->flag_impl = argv[i + 1];
         }
-    }
-
-    args_validate(args);
-    return args;
-}
-
-matrix_t *matrix_init(size_t size)
-{
-    matrix_t *mat = (matrix_t *)calloc(1, sizeof(matrix_t));
-    mat->size = size;
-    mat->data = (double *)calloc(size * size, sizeof(double));
-    return mat;
-}
-
-void matrix_destroy(matrix_t **mat)
-{
-    free((*mat)->data);
-    free(*mat);
-    *mat = NULL;
-}
-
-void matrix_random(matrix_t *mat, int min_value, int max_value)
-{
-    const size_t N = mat->size;
-    for (size_t i = 0; i < N; i++)
-    {
-        for (size_t j = 0; j < N; j++)
+        else if (strcmp(argv[i], FLAG_JOBS) == 0)
         {
-            mat->data[i * N + j] = min_value + rand() % (max_value - min_value + 1);
+            panic_unless(i + 1 < argc, "Number of jobs must be an unsigned integer.\n");
+            args->flag_jobs = atoi(argv[i + 1]);
         }
-    }
-}
-
-int matrix_compare(matrix_t *lhs, matrix_t *rhs)
-{
-    const size_t N = lhs->size;
-
-    panic_unless(
-        lhs->size == rhs->size,
-        "Only compare two square matrices of the same size, not %dx%d versus %dx%d\n",
-        lhs->size, lhs->size,
-        rhs->size, rhs->size);
-
-    for (size_t i = 0; i < N; i++)
-    {
-        for (size_t j = 0; j < N; j++)
+        else if (strcmp(argv[i], FLAG_QUEUE_DEPTH) == 0)
         {
-            const double diff = lhs->data[i * N + j] - rhs->data[i * N + j];
-            if (fabs(diff) > EPS)
-            {
-                return diff < 0 ? -1 : 1;
-            }
+            panic_unless(i + 1 < argc, "Queue depth must be an unsigned integer.\n");
+            args->flag_queue_depth = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_STAGE_WORKERS) == 0)
+        {
+            panic_unless(
+                i + 1 < argc &&
+                    sscanf(argv[i + 1], "%zu,%zu,%zu,%zu",
+                           &args->flag_stage_workers[0],
+                           &args->flag_stage_workers[1],
+                           &args->flag_stage_workers[2],
+                           &args->flag_stage_workers[3]) == PIPELINE_NUM_STAGES,
+                "Stage workers must be four unsigned integers G,M,N,V.\n");
+        }
+        else if (strcmp(argv[i], FLAG_DISTINCT_JOBS) == 0)
+        {
+            panic_unless(i + 1 < argc, "Number of distinct jobs must be an unsigned integer.\n");
+            args->flag_distinct_jobs = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_CACHE_MEMORY) == 0)
+        {
+            panic_unless(i + 1 < argc, "Cache memory must be an unsigned number of MiB.\n");
+            args->flag_cache_memory = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_CACHE_DIR) == 0)
+        {
+            panic_unless(i + 1 < argc, "Cache directory must be specified.\n");
+            args->flag_cache_dir = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_CACHE_DISK) == 0)
+        {
+            panic_unless(i + 1 < argc, "Cache disk size must be an unsigned number of MiB.\n");
+            args->flag_cache_disk = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_PROCESSES) == 0)
+        {
+            panic_unless(i + 1 < argc, "The number of processes must be an unsigned integer.\n");
+            args->flag_processes = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_TRANSPORT) == 0)
+        {
+            panic_unless(i + 1 < argc, "Transport must be specified.\n");
+            args->flag_transport = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_LAYOUT) == 0)
+        {
+            panic_unless(i + 1 < argc, "Layout must be specified.\n");
+            args->flag_layout = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_TRANS_A) == 0)
+        {
+            args->flag_trans_a = true;
+        }
+        else if (strcmp(argv[i], FLAG_TRANS_B) == 0)
+        {
+            args->flag_trans_b = true;
+        }
+        else if (strcmp(argv[i], FLAG_PRETRANSPOSE_B) == 0)
+        {
+            args->flag_pretranspose_b = true;
+        }
+        else if (strcmp(argv[i], FLAG_ALPHA) == 0)
+        {
+            panic_unless(i + 1 < argc, "Alpha must be a number.\n");
+            args->flag_alpha = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_BETA) == 0)
+        {
+            panic_unless(i + 1 < argc, "Beta must be a number.\n");
+            args->flag_beta = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_NORM) == 0)
+        {
+            panic_unless(i + 1 < argc, "Norm must be specified.\n");
+            args->flag_norm = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_UPDATES) == 0)
+        {
+            panic_unless(i + 1 < argc, "The number of updates must be an unsigned integer.\n");
+            args->flag_updates = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_UPDATE_KIND) == 0)
+        {
+            panic_unless(i + 1 < argc, "Update kind must be specified.\n");
+            args->flag_update_kind = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_UPDATE_RANK) == 0)
+        {
+            panic_unless(i + 1 < argc, "The update rank must be an unsigned integer.\n");
+            args->flag_update_rank = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_UPDATE_ROWS) == 0)
+        {
+            panic_unless(i + 1 < argc, "The update rows must be an unsigned integer.\n");
+            args->flag_update_rows = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_STRUCTURE) == 0)
+        {
+            panic_unless(i + 1 < argc, "Structure must be specified.\n");
+            args->flag_structure = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_DENSITY) == 0)
+        {
+            panic_unless(i + 1 < argc, "Density must be a number.\n");
+            args->flag_density = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_BANDWIDTH) == 0)
+        {
+            panic_unless(i + 1 < argc, "Bandwidth must be an unsigned integer.\n");
+            args->flag_bandwidth = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_VERIFY) == 0)
+        {
+            panic_unless(i + 1 < argc, "Verification must be specified.\n");
+            args->flag_verify = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_VERIFY_TRIALS) == 0)
+        {
+            panic_unless(i + 1 < argc, "The number of verification trials must be an unsigned integer.\n");
+            args->flag_verify_trials = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_COMPARE) == 0)
+        {
+            panic_unless(i + 1 < argc, "Comparison must be specified.\n");
+            args->flag_compare = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_TOLERANCE) == 0)
+        {
+            panic_unless(i + 1 < argc, "Tolerance must be a non-negative number.\n");
+            args->flag_tolerance = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_FORMAT) == 0)
+        {
+            panic_unless(i + 1 < argc, "Output format must be specified.\n");
+            args->flag_format = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_TRACE) == 0)
+        {
+            panic_unless(i + 1 < argc, "Trace file must be specified.\n");
+            args->flag_trace = argv[i + 1];
+        }
+        else if (strcmp(argv[i], FLAG_WARMUP) == 0)
+        {
+            panic_unless(i + 1 < argc, "The number of warm-up iterations must be an unsigned integer.\n");
+            args->flag_warmup = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_MIN_TIME) == 0)
+        {
+            panic_unless(i + 1 < argc, "Minimum time must be a number of seconds.\n");
+            args->flag_min_time = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_MAX_TIME) == 0)
+        {
+            panic_unless(i + 1 < argc, "Maximum time must be a number of seconds.\n");
+            args->flag_max_time = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_MAX_REPEATS) == 0)
+        {
+            panic_unless(i + 1 < argc, "Maximum number of repeats must be an unsigned integer.\n");
+            args->flag_max_repeats = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_TARGET_CI) == 0)
+        {
+            panic_unless(i + 1 < argc, "Target confidence interval must be a number.\n");
+            args->flag_target_ci = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_OUTLIER_K) == 0)
+        {
+            panic_unless(i + 1 < argc, "Outlier threshold must be a number.\n");
+            args->flag_outlier_k = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], FLAG_FLUSH_CACHE) == 0)
+        {
+            args->flag_flush_cache = true;
         }
     }
 
-    return 0;
+    args_validate(args);
+    return args;
 }
 
-void matrix_println(matrix_t *mat)
+void matrix_println(hpckern_matrix_t *mat)
 {
     const size_t N = mat->size;
     size_t *col_size;
@@ -378,518 +1158,2241 @@ void matrix_println(matrix_t *mat)
     free(col_size);
 }
 
-void matrix_mult_naive(matrix_t *lhs, matrix_t *rhs, matrix_t *result)
+// Maps an --impl name onto its library variant. Names the library does not
+// know fall back to cblas, as the old dispatcher did.
+hpckern_variant_t impl_variant(const char *impl)
 {
-    panic_unless(
-        lhs->size == rhs->size,
-        "I can only multiply two square matrices of the same size, not %dx%d multiply by %dx%d\n",
-        lhs->size, lhs->size,
-        rhs->size, rhs->size);
+    hpckern_variant_t variant = HPCKERN_CBLAS;
+    hpckern_variant_from_name(impl, &variant);
+    return variant;
+}
+
+// Only the blocked kernels, and the tiled layout they alone support, read
+// --block-size. Results record 0 for the others and leave it out of YAML and
+// JSON, so they show no block size that the run never used.
+size_t impl_block_size(const char *impl, size_t block_size)
+{
+    return strcmp(impl, IMPL_SERIAL) == 0 || strcmp(impl, IMPL_THREADED) == 0 ? block_size : 0;
+}
 
-    const size_t N = lhs->size;
+// The threaded and auto implementations run on num_threads workers, every
+// other one on the calling thread alone.
+hpckern_context_t *impl_context_create(const char *impl, size_t num_threads)
+{
+    const bool is_parallel = strcmp(impl, IMPL_THREADED) == 0 || strcmp(impl, IMPL_AUTO) == 0;
+    return context_alloc(is_parallel ? num_threads : 1);
+}
 
-    memset(result->data, 0, N * N * sizeof(double));
+// The harness runs exactly --repeats iterations unless --min-time or
+// --target-ci ask it to keep going, up to --max-repeats.
+void harness_config_from_args(const args_t *args, hpckern_harness_config_t *config)
+{
+    const bool is_adaptive = args->flag_min_time > 0.0 || args->flag_target_ci > 0.0;
+
+    hpckern_harness_config_default(config);
+    config->warmup_iterations = args->flag_warmup;
+    config->min_iterations = args->flag_repeats;
+    config->max_iterations = is_adaptive ? MAX(args->flag_max_repeats, args->flag_repeats) : args->flag_repeats;
+    config->min_time = args->flag_min_time;
+    config->max_time = args->flag_max_time;
+    config->target_rel_ci = args->flag_target_ci;
+    config->outlier_k = args->flag_outlier_k;
+    config->flush_cache = args->flag_flush_cache;
+}
 
-    for (int i = 0; i < N; i++)
+// Fills `mat` with random values in the shape --structure asks for.
+void matrix_random_structured(hpckern_rng_t *rng, hpckern_matrix_t *mat, const char *structure, double density, size_t bandwidth, int min_value, int max_value)
+{
+    if (strcmp(structure, STRUCTURE_SPARSE) == 0)
     {
-        for (int j = 0; j < N; j++)
-        {
-            for (int k = 0; k < N; k++)
-            {
-                result->data[i * N + j] += lhs->data[i * N + k] * rhs->data[k * N + j];
-            }
-        }
+        CHECK(hpckern_matrix_random_sparse(rng, mat, density, min_value, max_value));
+    }
+    else if (strcmp(structure, STRUCTURE_BANDED) == 0)
+    {
+        CHECK(hpckern_matrix_random_banded(rng, mat, bandwidth, bandwidth, min_value, max_value));
+    }
+    else if (strcmp(structure, STRUCTURE_UPPER) == 0 || strcmp(structure, STRUCTURE_LOWER) == 0)
+    {
+        CHECK(hpckern_matrix_random_triangular(rng, mat, strcmp(structure, STRUCTURE_UPPER) == 0, min_value, max_value));
+    }
+    else
+    {
+        CHECK(hpckern_matrix_random(rng, mat, min_value, max_value));
     }
 }
 
-void matrix_mult_serial(size_t block_size, matrix_t *lhs, matrix_t *rhs, matrix_t *result)
+// result = alpha * op(lhs) * op(rhs) + beta * result for operands supplied
+// transposed (`trans_*`). cblas consumes the transposed storage directly.
+// Otherwise a transposed A is flipped into `lhs_scratch` first. naive, serial
+// and threaded run their B^T kernels when B arrives transposed, or after
+// copying B^T into `rhs_scratch` when `pretranspose_rhs` is set; the other
+// kernels get B flipped back.
+void matrix_gemm_by_impl_trans(hpckern_context_t *ctx, const char *impl, size_t block_size, bool trans_lhs, bool trans_rhs, bool pretranspose_rhs, double alpha, hpckern_matrix_t *lhs, hpckern_matrix_t *rhs, double beta, hpckern_matrix_t *result, hpckern_matrix_t *lhs_scratch, hpckern_matrix_t *rhs_scratch)
 {
-    panic_unless(
-        lhs->size == rhs->size,
-        "I can only multiply two square matrices of the same size, not %dx%d multiply by %dx%d\n",
-        lhs->size, lhs->size,
-        rhs->size, rhs->size);
+    const hpckern_variant_t variant = impl_variant(impl);
+    hpckern_matrix_t *rhs_t;
 
-    const size_t N = lhs->size;
+    if (variant == HPCKERN_CBLAS)
+    {
+        CHECK(hpckern_matrix_gemm_cblas(trans_lhs, trans_rhs, alpha, lhs, rhs, beta, result));
+        return;
+    }
 
-    memset(result->data, 0, N * N * sizeof(double));
+    if (trans_lhs)
+    {
+        CHECK(hpckern_matrix_transpose(ctx, HPCKERN_TRANSPOSE_BLOCK_SIZE, lhs, lhs_scratch));
+        lhs = lhs_scratch;
+    }
 
-    for (size_t bi = 0; bi < N; bi += block_size)
+    if ((trans_rhs || pretranspose_rhs) &&
+        (variant == HPCKERN_NAIVE || variant == HPCKERN_SERIAL || variant == HPCKERN_THREADED))
     {
-        for (size_t bj = 0; bj < N; bj += block_size)
+        rhs_t = rhs;
+        if (!trans_rhs)
         {
-            for (size_t bk = 0; bk < N; bk += block_size)
+            CHECK(hpckern_matrix_transpose(ctx, HPCKERN_TRANSPOSE_BLOCK_SIZE, rhs, rhs_scratch));
+            rhs_t = rhs_scratch;
+        }
+
+        if (variant == HPCKERN_THREADED)
+        {
+            CHECK(hpckern_matrix_gemm_threaded_bt(ctx, block_size, alpha, lhs, rhs_t, beta, result));
+        }
+        else if (variant == HPCKERN_SERIAL)
+        {
+            CHECK(hpckern_matrix_gemm_serial_bt(block_size, alpha, lhs, rhs_t, beta, result));
+        }
+        else
+        {
+            CHECK(hpckern_matrix_gemm_naive_bt(alpha, lhs, rhs_t, beta, result));
+        }
+        return;
+    }
+
+    if (trans_rhs)
+    {
+        CHECK(hpckern_matrix_transpose(ctx, HPCKERN_TRANSPOSE_BLOCK_SIZE, rhs, rhs_scratch));
+        rhs = rhs_scratch;
+    }
+
+    CHECK(hpckern_gemm(ctx, variant, block_size, alpha, lhs, rhs, beta, result));
+}
+
+void job_queue_init(job_queue_t *queue, size_t capacity, size_t num_producers)
+{
+    queue->slots = (pipeline_job_t **)calloc(capacity, sizeof(pipeline_job_t *));
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->num_producers = num_producers;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond_not_empty, NULL);
+    pthread_cond_init(&queue->cond_not_full, NULL);
+}
+
+void job_queue_destroy(job_queue_t *queue)
+{
+    pthread_cond_destroy(&queue->cond_not_full);
+    pthread_cond_destroy(&queue->cond_not_empty);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->slots);
+}
+
+void job_queue_push(job_queue_t *queue, pipeline_job_t *job)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->capacity)
+    {
+        pthread_cond_wait(&queue->cond_not_full, &queue->mutex);
+    }
+    queue->slots[(queue->head + queue->count) % queue->capacity] = job;
+    queue->count++;
+    pthread_cond_signal(&queue->cond_not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Returns NULL once the queue is empty and every producer has closed it.
+pipeline_job_t *job_queue_pop(job_queue_t *queue)
+{
+    pipeline_job_t *job = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && queue->num_producers > 0)
+    {
+        pthread_cond_wait(&queue->cond_not_empty, &queue->mutex);
+    }
+    if (queue->count > 0)
+    {
+        job = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->cond_not_full);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    return job;
+}
+
+void job_queue_close(job_queue_t *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->num_producers--;
+    pthread_cond_broadcast(&queue->cond_not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Stage 1: fill a recycled job buffer with fresh operands.
+void *pipeline_generate_stage(void *param)
+{
+    pipeline_t *pipeline = (pipeline_t *)param;
+    size_t i;
+
+    while ((i = atomic_fetch_add(&pipeline->next_job, 1)) < pipeline->num_jobs)
+    {
+        pipeline_job_t *job = job_queue_pop(&pipeline->free_jobs);
+        job->index = i;
+        if (pipeline->distinct_jobs > 0)
+        {
+            const size_t pair = i % pipeline->distinct_jobs;
+            const size_t bytes = job->A->size * job->A->size * sizeof(double);
+
+            memcpy(job->A->data, pipeline->operands[2 * pair]->data, bytes);
+            memcpy(job->B->data, pipeline->operands[2 * pair + 1]->data, bytes);
+        }
+        else
+        {
+            hpckern_rng_t rng;
+
+            hpckern_rng_seed(&rng, pipeline->seed + 2 * i);
+            CHECK(hpckern_matrix_random(&rng, job->A, pipeline->min_value, pipeline->max_value));
+            CHECK(hpckern_matrix_random(&rng, job->B, pipeline->min_value, pipeline->max_value));
+        }
+        job_queue_push(&pipeline->generated, job);
+    }
+
+    job_queue_close(&pipeline->generated);
+    pthread_exit(NULL);
+}
+
+void pipeline_cache_key(const pipeline_job_t *job, uint64_t params, hpckern_cache_key_t *key)
+{
+    key->lhs = job->lhs_hash;
+    key->rhs = job->rhs_hash;
+    key->params = params;
+    key->size = job->A->size;
+}
+
+// Hashing A and B costs O(N^2); on a cache hit it saves the O(N^3) product,
+// copying C out of the cache instead, or skipping it when the norm is cached
+// and nothing reads C.
+void pipeline_multiply(pipeline_t *pipeline, hpckern_context_t *ctx, pipeline_job_t *job)
+{
+    const size_t bytes = job->C->size * job->C->size * sizeof(double);
+    hpckern_cache_key_t key;
+
+    job->is_norm_cached = false;
+    if (pipeline->cache == NULL)
+    {
+        CHECK(hpckern_gemm(ctx, impl_variant(pipeline->impl), pipeline->block_size, 1.0, job->A, job->B, 0.0, job->C));
+        return;
+    }
+
+    CHECK(hpckern_matrix_hash(ctx, job->A, &job->lhs_hash));
+    CHECK(hpckern_matrix_hash(ctx, job->B, &job->rhs_hash));
+    if (!pipeline->needs_product)
+    {
+        pipeline_cache_key(job, CACHE_PARAMS_NORM(pipeline->norm_kind), &key);
+        if (hpckern_cache_lookup(pipeline->cache, &key, &job->norm, sizeof(job->norm)))
+        {
+            job->is_norm_cached = true;
+            return;
+        }
+    }
+
+    pipeline_cache_key(job, CACHE_PARAMS_PRODUCT, &key);
+    if (!hpckern_cache_lookup(pipeline->cache, &key, job->C->data, bytes))
+    {
+        CHECK(hpckern_gemm(ctx, impl_variant(pipeline->impl), pipeline->block_size, 1.0, job->A, job->B, 0.0, job->C));
+        hpckern_cache_store(pipeline->cache, &key, job->C->data, bytes);
+    }
+}
+
+// The multiply stage already looked the norm up when nothing reads C.
+void pipeline_norm(pipeline_t *pipeline, hpckern_context_t *ctx, pipeline_job_t *job)
+{
+    hpckern_cache_key_t key;
+
+    if (job->is_norm_cached)
+    {
+        return;
+    }
+
+    if (pipeline->cache != NULL)
+    {
+        pipeline_cache_key(job, CACHE_PARAMS_NORM(pipeline->norm_kind), &key);
+        if (pipeline->needs_product && hpckern_cache_lookup(pipeline->cache, &key, &job->norm, sizeof(job->norm)))
+        {
+            return;
+        }
+    }
+
+    CHECK(hpckern_norm(ctx, impl_variant(pipeline->impl), pipeline->norm_kind, pipeline->block_size, job->C, &job->norm));
+    if (pipeline->cache != NULL)
+    {
+        hpckern_cache_store(pipeline->cache, &key, &job->norm, sizeof(job->norm));
+    }
+}
+
+// Stage 2: multiply with the selected implementation.
+void *pipeline_multiply_stage(void *param)
+{
+    pipeline_t *pipeline = (pipeline_t *)param;
+    hpckern_context_t *ctx = impl_context_create(pipeline->impl, pipeline->num_threads);
+    pipeline_job_t *job;
+
+    while ((job = job_queue_pop(&pipeline->generated)) != NULL)
+    {
+        MEASURE_RUNTIME(pipeline_multiply(pipeline, ctx, job), job->mult_runtime);
+        job_queue_push(&pipeline->multiplied, job);
+    }
+
+    hpckern_context_destroy(&ctx);
+    job_queue_close(&pipeline->multiplied);
+    pthread_exit(NULL);
+}
+
+// Stage 3: norm of the product.
+void *pipeline_norm_stage(void *param)
+{
+    pipeline_t *pipeline = (pipeline_t *)param;
+    hpckern_context_t *ctx = impl_context_create(pipeline->impl, pipeline->num_threads);
+    pipeline_job_t *job;
+
+    while ((job = job_queue_pop(&pipeline->multiplied)) != NULL)
+    {
+        MEASURE_RUNTIME(pipeline_norm(pipeline, ctx, job), job->norm_runtime);
+        job_queue_push(&pipeline->normed, job);
+    }
+
+    hpckern_context_destroy(&ctx);
+    job_queue_close(&pipeline->normed);
+    pthread_exit(NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Distributed SUMMA multiplication over a pluggable point-to-point transport.
+// Collectives are built on send/recv only, so a backend just moves bytes.
+// ---------------------------------------------------------------------------
+
+void transport_send_all(int fd, const void *buf, size_t bytes)
+{
+    const char *ptr = (const char *)buf;
+    while (bytes > 0)
+    {
+        ssize_t written = write(fd, ptr, bytes);
+        panic_unless(written > 0, "Transport send failed\n");
+        ptr += written;
+        bytes -= written;
+    }
+}
+
+void transport_recv_all(int fd, void *buf, size_t bytes)
+{
+    char *ptr = (char *)buf;
+    while (bytes > 0)
+    {
+        ssize_t nread = read(fd, ptr, bytes);
+        panic_unless(nread > 0, "Transport receive failed\n");
+        ptr += nread;
+        bytes -= nread;
+    }
+}
+
+void tcp_send(transport_t *transport, int dest, const void *buf, size_t bytes)
+{
+    transport_send_all(((int *)transport->state)[dest], buf, bytes);
+}
+
+void tcp_recv(transport_t *transport, int src, void *buf, size_t bytes)
+{
+    transport_recv_all(((int *)transport->state)[src], buf, bytes);
+}
+
+void tcp_finalize(transport_t *transport)
+{
+    int *fds = (int *)transport->state;
+    for (int i = 0; i < transport->size; i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+    free(fds);
+}
+
+// Connects every pair of the `num_processes` future ranks over loopback TCP,
+// then forks. Each process keeps only its own row of the connection table.
+// Returns the rank of the calling process; rank 0 is the original process.
+int transport_tcp_spawn(transport_t *transport, int num_processes, pid_t *children)
+{
+    int *pair_fds = (int *)malloc(num_processes * num_processes * sizeof(int));
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int listener, one = 1, rank = 0;
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    panic_unless(listener >= 0, "Could not create listening socket\n");
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    panic_unless(bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == 0, "Could not bind loopback socket\n");
+    panic_unless(listen(listener, num_processes) == 0, "Could not listen on loopback socket\n");
+    getsockname(listener, (struct sockaddr *)&addr, &addr_len);
+
+    for (int i = 0; i < num_processes * num_processes; i++)
+    {
+        pair_fds[i] = -1;
+    }
+    for (int i = 0; i < num_processes; i++)
+    {
+        for (int j = i + 1; j < num_processes; j++)
+        {
+            int client = socket(AF_INET, SOCK_STREAM, 0);
+            panic_unless(connect(client, (struct sockaddr *)&addr, sizeof(addr)) == 0, "Could not connect loopback socket\n");
+            pair_fds[i * num_processes + j] = client;
+            pair_fds[j * num_processes + i] = accept(listener, NULL, NULL);
+            panic_unless(pair_fds[j * num_processes + i] >= 0, "Could not accept loopback connection\n");
+            setsockopt(pair_fds[i * num_processes + j], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            setsockopt(pair_fds[j * num_processes + i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+    close(listener);
+
+    fflush(stdout);
+    for (int r = 1; r < num_processes; r++)
+    {
+        pid_t pid = fork();
+        panic_unless(pid >= 0, "Could not fork rank %d\n", r);
+        if (pid == 0)
+        {
+            rank = r;
+            break;
+        }
+        children[r] = pid;
+    }
+
+    transport->rank = rank;
+    transport->size = num_processes;
+    transport->state = malloc(num_processes * sizeof(int));
+    transport->send = tcp_send;
+    transport->recv = tcp_recv;
+    transport->finalize = tcp_finalize;
+
+    for (int i = 0; i < num_processes; i++)
+    {
+        for (int j = 0; j < num_processes; j++)
+        {
+            int fd = pair_fds[i * num_processes + j];
+            if (i == rank)
+            {
+                ((int *)transport->state)[j] = fd;
+            }
+            else if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+    free(pair_fds);
+
+    return rank;
+}
+
+#ifdef USE_MPI
+// MPI counts are ints, so large messages go out in chunks.
+#define MPI_MAX_CHUNK ((size_t)1 << 30)
+
+void mpi_send(transport_t *transport, int dest, const void *buf, size_t bytes)
+{
+    const char *ptr = (const char *)buf;
+    for (size_t offset = 0; offset < bytes; offset += MPI_MAX_CHUNK)
+    {
+        MPI_Send(ptr + offset, (int)MIN(MPI_MAX_CHUNK, bytes - offset), MPI_BYTE, dest, 0, MPI_COMM_WORLD);
+    }
+}
+
+void mpi_recv(transport_t *transport, int src, void *buf, size_t bytes)
+{
+    char *ptr = (char *)buf;
+    for (size_t offset = 0; offset < bytes; offset += MPI_MAX_CHUNK)
+    {
+        MPI_Recv(ptr + offset, (int)MIN(MPI_MAX_CHUNK, bytes - offset), MPI_BYTE, src, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+}
+
+// MPI_Finalize is left to main, which also owns MPI_Init.
+void mpi_finalize(transport_t *transport)
+{
+}
+
+void transport_mpi_init(transport_t *transport)
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &transport->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &transport->size);
+    transport->state = NULL;
+    transport->send = mpi_send;
+    transport->recv = mpi_recv;
+    transport->finalize = mpi_finalize;
+}
+#endif
+
+// Linear broadcast from `root` to the ranks in `group`. Every rank either
+// only sends or only receives, so concurrent broadcasts cannot deadlock.
+void transport_bcast(transport_t *transport, void *buf, size_t bytes, int root, const int *group, int group_size)
+{
+    if (transport->rank == root)
+    {
+        for (int i = 0; i < group_size; i++)
+        {
+            if (group[i] != root)
+            {
+                transport->send(transport, group[i], buf, bytes);
+            }
+        }
+    }
+    else
+    {
+        transport->recv(transport, root, buf, bytes);
+    }
+}
+
+// Element-wise sum or max over `group`, result available on every member.
+void transport_allreduce(transport_t *transport, long double *values, size_t count, bool use_max, const int *group, int group_size)
+{
+    const int root = group[0];
+
+    if (transport->rank == root)
+    {
+        long double *incoming = (long double *)malloc(count * sizeof(long double));
+        for (int i = 1; i < group_size; i++)
+        {
+            transport->recv(transport, group[i], incoming, count * sizeof(long double));
+            for (size_t j = 0; j < count; j++)
+            {
+                values[j] = use_max ? MAX(values[j], incoming[j]) : values[j] + incoming[j];
+            }
+        }
+        free(incoming);
+    }
+    else
+    {
+        transport->send(transport, root, values, count * sizeof(long double));
+    }
+
+    transport_bcast(transport, values, count * sizeof(long double), root, group, group_size);
+}
+
+// Deterministic value of element (i, j), so that every rank can generate its
+// own blocks and rank 0 can regenerate the full operands for verification.
+double matrix_hashed_entry(unsigned long long seed, size_t i, size_t j, int min_value, int max_value)
+{
+    unsigned long long x = seed ^ (i * 0x9E3779B97F4A7C15ULL) ^ (j * 0xBF58476D1CE4E5B9ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x = x ^ (x >> 31);
+    return min_value + (double)(x % (unsigned long long)(max_value - min_value + 1));
+}
+
+void matrix_fill_hashed(double *data, size_t rows, size_t cols, size_t row0, size_t col0, unsigned long long seed, int min_value, int max_value)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        for (size_t j = 0; j < cols; j++)
+        {
+            data[i * cols + j] = matrix_hashed_entry(seed, row0 + i, col0 + j, min_value, max_value);
+        }
+    }
+}
+
+// C_local += sum_k A(row, k) * B(k, col) on a q x q process grid. In step k
+// the owner of A(row, k) broadcasts it along its process row and the owner of
+// B(k, col) along its process column; cblas_dgemm is the local kernel.
+void matrix_mult_summa(transport_t *transport, size_t grid_dim, size_t local_size, hpckern_matrix_t *A_local, hpckern_matrix_t *B_local, hpckern_matrix_t *C_local)
+{
+    const int rank = transport->rank;
+    const size_t my_row = rank / grid_dim;
+    const size_t my_col = rank % grid_dim;
+    const size_t block_bytes = local_size * local_size * sizeof(double);
+    double *A_panel = (double *)malloc(block_bytes);
+    double *B_panel = (double *)malloc(block_bytes);
+    int *row_group = (int *)malloc(grid_dim * sizeof(int));
+    int *col_group = (int *)malloc(grid_dim * sizeof(int));
+
+    for (size_t k = 0; k < grid_dim; k++)
+    {
+        row_group[k] = my_row * grid_dim + k;
+        col_group[k] = k * grid_dim + my_col;
+    }
+
+    memset(C_local->data, 0, block_bytes);
+
+    for (size_t k = 0; k < grid_dim; k++)
+    {
+        if (my_col == k)
+        {
+            memcpy(A_panel, A_local->data, block_bytes);
+        }
+        transport_bcast(transport, A_panel, block_bytes, row_group[k], row_group, grid_dim);
+
+        if (my_row == k)
+        {
+            memcpy(B_panel, B_local->data, block_bytes);
+        }
+        transport_bcast(transport, B_panel, block_bytes, col_group[k], col_group, grid_dim);
+
+        cblas_dgemm(
+            CblasRowMajor,
+            CblasNoTrans,
+            CblasNoTrans,
+            local_size,
+            local_size,
+            local_size,
+            1.0,
+            A_panel,
+            local_size,
+            B_panel,
+            local_size,
+            1.0,
+            C_local->data,
+            local_size);
+    }
+
+    free(col_group);
+    free(row_group);
+    free(B_panel);
+    free(A_panel);
+}
+
+// Infinity norm of the distributed C: partial row sums are summed along each
+// process row, then an allreduce max over all ranks yields the norm.
+long double matrix_norm_summa(transport_t *transport, size_t grid_dim, size_t local_size, hpckern_matrix_t *C_local)
+{
+    const int rank = transport->rank;
+    const size_t my_row = rank / grid_dim;
+    long double *row_sums = (long double *)calloc(local_size, sizeof(long double));
+    int *row_group = (int *)malloc(grid_dim * sizeof(int));
+    int *all_ranks = (int *)malloc(transport->size * sizeof(int));
+    long double result = 0.0;
+
+    for (size_t k = 0; k < grid_dim; k++)
+    {
+        row_group[k] = my_row * grid_dim + k;
+    }
+    for (int r = 0; r < transport->size; r++)
+    {
+        all_ranks[r] = r;
+    }
+
+    for (size_t i = 0; i < local_size; i++)
+    {
+        for (size_t j = 0; j < local_size; j++)
+        {
+            row_sums[i] += fabsl(C_local->data[i * local_size + j]);
+        }
+    }
+
+    transport_allreduce(transport, row_sums, local_size, false, row_group, grid_dim);
+    for (size_t i = 0; i < local_size; i++)
+    {
+        result = MAX(result, row_sums[i]);
+    }
+    transport_allreduce(transport, &result, 1, true, all_ranks, transport->size);
+
+    free(all_ranks);
+    free(row_group);
+    free(row_sums);
+    return result;
+}
+
+// Freivalds' check of the distributed C = A B with `num_trials` random +-1
+// vectors X: (B X) is reduced along process rows, each diagonal rank
+// broadcasts its block of it down its process column, and A (B X) and C X
+// are reduced along process rows again, so no rank holds more than its own
+// blocks and O(N num_trials / sqrt(P)) vector entries. The operands are
+// integers and so is every partial sum while N^2 max|A| max|B| < 2^53, in
+// which case the check is exact; beyond that it allows the rounding bound
+// 2 (N + 2) eps N^2 max|A| max|B|. Every rank returns the same verdict.
+bool matrix_verify_freivalds_summa(transport_t *transport, size_t grid_dim, size_t local_size, const hpckern_matrix_t *A_local, const hpckern_matrix_t *B_local, const hpckern_matrix_t *C_local, unsigned long long seed, size_t num_trials, int min_value, int max_value)
+{
+    const int rank = transport->rank;
+    const size_t my_row = rank / grid_dim;
+    const size_t my_col = rank % grid_dim;
+    const size_t N = grid_dim * local_size;
+    const size_t count = local_size * num_trials;
+    const double max_abs = MAX(fabs((double)min_value), fabs((double)max_value));
+    const double magnitude = (double)N * N * max_abs * max_abs;
+    const double bound = magnitude < 9007199254740992.0 ? 0.0 : 2.0 * (N + 2) * DBL_EPSILON * magnitude;
+    double *X = (double *)calloc(count, sizeof(double));
+    double *panel = (double *)malloc(count * sizeof(double));
+    double *product = (double *)malloc(count * sizeof(double));
+    long double *sums = (long double *)malloc(2 * count * sizeof(long double));
+    int *row_group = (int *)malloc(grid_dim * sizeof(int));
+    int *col_group = (int *)malloc(grid_dim * sizeof(int));
+    int *all_ranks = (int *)malloc(transport->size * sizeof(int));
+    long double mismatches = 0.0;
+
+    for (size_t k = 0; k < grid_dim; k++)
+    {
+        row_group[k] = my_row * grid_dim + k;
+        col_group[k] = k * grid_dim + my_col;
+    }
+    for (int r = 0; r < transport->size; r++)
+    {
+        all_ranks[r] = r;
+    }
+
+    // Rows my_col * local_size .. of X, the ones this rank's blocks multiply.
+    for (size_t i = 0; i < local_size; i++)
+    {
+        for (size_t t = 0; t < num_trials; t++)
+        {
+            X[i * num_trials + t] = matrix_hashed_entry(seed, my_col * local_size + i, t, 0, 1) * 2.0 - 1.0;
+        }
+    }
+
+    // (B X)_my_row, then (B X)_my_col from the diagonal rank of this column.
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, local_size, num_trials, local_size, 1.0, B_local->data, local_size, X, num_trials, 0.0, product, num_trials);
+    for (size_t e = 0; e < count; e++)
+    {
+        sums[e] = product[e];
+    }
+    transport_allreduce(transport, sums, count, false, row_group, grid_dim);
+    for (size_t e = 0; e < count; e++)
+    {
+        panel[e] = (double)sums[e];
+    }
+    transport_bcast(transport, panel, count * sizeof(double), col_group[my_col], col_group, grid_dim);
+
+    // (A (B X))_my_row and (C X)_my_row side by side.
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, local_size, num_trials, local_size, 1.0, A_local->data, local_size, panel, num_trials, 0.0, product, num_trials);
+    for (size_t e = 0; e < count; e++)
+    {
+        sums[e] = product[e];
+    }
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, local_size, num_trials, local_size, 1.0, C_local->data, local_size, X, num_trials, 0.0, product, num_trials);
+    for (size_t e = 0; e < count; e++)
+    {
+        sums[count + e] = product[e];
+    }
+    transport_allreduce(transport, sums, 2 * count, false, row_group, grid_dim);
+
+    // Every rank of a process row holds the same sums; the first one counts.
+    if (my_col == 0)
+    {
+        for (size_t e = 0; e < count; e++)
+        {
+            mismatches += fabsl(sums[e] - sums[count + e]) > bound;
+        }
+    }
+    transport_allreduce(transport, &mismatches, 1, false, all_ranks, transport->size);
+
+    free(all_ranks);
+    free(col_group);
+    free(row_group);
+    free(sums);
+    free(product);
+    free(panel);
+    free(X);
+    return mismatches == 0.0;
+}
+
+// The --jobs summary, written after the per-job results.
+typedef struct pipeline_result_t
+{
+    size_t num_jobs;
+    size_t queue_depth;
+    // Workers of the generate, multiply, norm and verify stages.
+    const size_t *stage_workers;
+    size_t distinct_jobs;
+    double wall_time;
+    // NULL when the run had no cache.
+    const hpckern_cache_stats_t *cache;
+} pipeline_result_t;
+
+// The --updates summary; the runs are the individual updates.
+typedef struct incremental_result_t
+{
+    const char *update_kind;
+    size_t update_rank;
+    size_t update_rows;
+    size_t num_updates;
+    double initial_product_time;
+} incremental_result_t;
+
+// Sections a mode writes after the runs; NULL members are left out.
+typedef struct result_extras_t
+{
+    const hpckern_harness_stats_t *harness;
+    const pipeline_result_t *pipeline;
+    const incremental_result_t *incremental;
+} result_extras_t;
+
+typedef struct timing_summary_t
+{
+    double avg;
+    double min;
+    double max;
+} timing_summary_t;
+
+void summarize_results(size_t num_results, const benchmark_result_t *results, timing_summary_t *multiplication, timing_summary_t *norm)
+{
+    multiplication->avg = 0.0;
+    multiplication->min = results[0].benchmark_runtime;
+    multiplication->max = results[0].benchmark_runtime;
+    norm->avg = 0.0;
+    norm->min = results[0].norm_runtime;
+    norm->max = results[0].norm_runtime;
+
+    for (size_t i = 0; i < num_results; i++)
+    {
+        multiplication->avg += results[i].benchmark_runtime;
+        norm->avg += results[i].norm_runtime;
+
+        multiplication->min = MIN(multiplication->min, results[i].benchmark_runtime);
+        multiplication->max = MAX(multiplication->max, results[i].benchmark_runtime);
+        norm->min = MIN(norm->min, results[i].norm_runtime);
+        norm->max = MAX(norm->max, results[i].norm_runtime);
+    }
+
+    multiplication->avg /= num_results;
+    norm->avg /= num_results;
+}
+
+void write_result_in_yaml(FILE *file, size_t num_results, benchmark_result_t *results, const hpckern_system_info_t *system, const result_extras_t *extras)
+{
+    timing_summary_t multiplication;
+    timing_summary_t norm;
+
+    summarize_results(num_results, results, &multiplication, &norm);
+
+    fprintf(file, "- benchmark_results:\n");
+    fprintf(file, "  metadata:\n");
+    fprintf(file, "    program: \"%s\"\n", PROGRAM_NAME);
+    fprintf(file, "    mode: \"%s\"\n", results[0].mode != NULL ? results[0].mode : MODE_BENCHMARK);
+    fprintf(file, "    implementation: \"%s\"\n", results[0].impl);
+    fprintf(file, "    layout: \"%s\"\n", results[0].layout != NULL ? results[0].layout : LAYOUT_NAME_ROW_MAJOR);
+    fprintf(file, "    norm: \"%s\"\n", results[0].norm != NULL ? results[0].norm : DEFAULT_NORM);
+    if (results[0].structure != NULL)
+    {
+        fprintf(file, "    structure: \"%s\"\n", results[0].structure);
+    }
+    if (results[0].path != NULL)
+    {
+        fprintf(file, "    path: \"%s\"\n", results[0].path);
+    }
+    if (results[0].verify != NULL)
+    {
+        fprintf(file, "    verify: \"%s\"\n", results[0].verify);
+    }
+    fprintf(file, "    trans_a: %s\n", results[0].trans_a ? "true" : "false");
+    fprintf(file, "    trans_b: %s\n", results[0].trans_b ? "true" : "false");
+    if (results[0].is_gemm)
+    {
+        fprintf(file, "    alpha: %g\n", results[0].alpha);
+        fprintf(file, "    beta: %g\n", results[0].beta);
+    }
+    fprintf(file, "    matrix_size: %zu\n", results[0].matrix_size);
+    if (results[0].block_size > 0)
+    {
+        fprintf(file, "    block_size: %zu\n", results[0].block_size);
+    }
+    fprintf(file, "    num_threads: %zu\n", results[0].num_threads);
+    fprintf(file, "    num_repeats: %zu\n", results[0].num_repeats);
+    fprintf(file, "    timestamp: %ld\n", time(NULL));
+    hpckern_system_info_write_yaml(file, 2, system);
+
+    fprintf(file, "  statistics:\n");
+    fprintf(file, "    multiplication:\n");
+    fprintf(file, "      average_time: %.9f\n", multiplication.avg);
+    fprintf(file, "      min_time: %.9f\n", multiplication.min);
+    fprintf(file, "      max_time: %.9f\n", multiplication.max);
+    fprintf(file, "    norm_computation:\n");
+    fprintf(file, "      average_time: %.9f\n", norm.avg);
+    fprintf(file, "      min_time: %.9f\n", norm.min);
+    fprintf(file, "      max_time: %.9f\n", norm.max);
+    fprintf(file, "    total:\n");
+    fprintf(file, "      average_time: %.9f\n", multiplication.avg + norm.avg);
+    fprintf(file, "      min_time: %.9f\n", multiplication.min + norm.min);
+    fprintf(file, "      max_time: %.9f\n", multiplication.max + norm.max);
+
+    fprintf(file, "  individual_runs:\n");
+    for (size_t i = 0; i < num_results; i++)
+    {
+        fprintf(file, "    - run: %zu\n", i + 1);
+        fprintf(file, "      multiplication_time: %.9f\n", results[i].benchmark_runtime);
+        fprintf(file, "      norm_time: %.9f\n", results[i].norm_runtime);
+        fprintf(file, "      total_time: %.9f\n", results[i].benchmark_runtime + results[i].norm_runtime);
+    }
+
+    if (extras->harness != NULL)
+    {
+        fprintf(file, "  harness:\n");
+        hpckern_harness_write_yaml(file, 4, "multiplication", extras->harness);
+    }
+    if (extras->pipeline != NULL)
+    {
+        fprintf(file, "  pipeline:\n");
+        fprintf(file, "    num_jobs: %zu\n", extras->pipeline->num_jobs);
+        fprintf(file, "    queue_depth: %zu\n", extras->pipeline->queue_depth);
+        fprintf(file, "    stage_workers: [%zu, %zu, %zu, %zu]\n",
+                extras->pipeline->stage_workers[0], extras->pipeline->stage_workers[1],
+                extras->pipeline->stage_workers[2], extras->pipeline->stage_workers[3]);
+        fprintf(file, "    wall_time: %.9f\n", extras->pipeline->wall_time);
+        fprintf(file, "    jobs_per_second: %.6f\n", extras->pipeline->num_jobs / extras->pipeline->wall_time);
+        if (extras->pipeline->distinct_jobs > 0)
+        {
+            fprintf(file, "    distinct_jobs: %zu\n", extras->pipeline->distinct_jobs);
+        }
+        if (extras->pipeline->cache != NULL)
+        {
+            const hpckern_cache_stats_t *cache = extras->pipeline->cache;
+
+            fprintf(file, "    cache:\n");
+            fprintf(file, "      memory_hits: %zu\n", cache->memory_hits);
+            fprintf(file, "      disk_hits: %zu\n", cache->disk_hits);
+            fprintf(file, "      misses: %zu\n", cache->misses);
+            fprintf(file, "      stores: %zu\n", cache->stores);
+            fprintf(file, "      evictions: %zu\n", cache->evictions);
+            fprintf(file, "      memory_bytes: %zu\n", cache->memory_bytes);
+            fprintf(file, "      disk_bytes: %zu\n", cache->disk_bytes);
+        }
+    }
+    if (extras->incremental != NULL)
+    {
+        fprintf(file, "  incremental:\n");
+        fprintf(file, "    update_kind: \"%s\"\n", extras->incremental->update_kind);
+        fprintf(file, "    update_rank: %zu\n", extras->incremental->update_rank);
+        fprintf(file, "    update_rows: %zu\n", extras->incremental->update_rows);
+        fprintf(file, "    num_updates: %zu\n", extras->incremental->num_updates);
+        fprintf(file, "    initial_product_time: %.9f\n", extras->incremental->initial_product_time);
+    }
+}
+
+// One object per invocation with the keys of the YAML list item; appending
+// the output of several runs gives a stream of JSON documents.
+void write_result_in_json(FILE *file, size_t num_results, benchmark_result_t *results, const hpckern_system_info_t *system, const result_extras_t *extras)
+{
+    timing_summary_t multiplication;
+    timing_summary_t norm;
+
+    summarize_results(num_results, results, &multiplication, &norm);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"metadata\": {\n");
+    fprintf(file, "    \"program\": \"%s\",\n", PROGRAM_NAME);
+    fprintf(file, "    \"mode\": \"%s\",\n", results[0].mode != NULL ? results[0].mode : MODE_BENCHMARK);
+    fprintf(file, "    \"implementation\": \"%s\",\n", results[0].impl);
+    fprintf(file, "    \"layout\": \"%s\",\n", results[0].layout != NULL ? results[0].layout : LAYOUT_NAME_ROW_MAJOR);
+    fprintf(file, "    \"norm\": \"%s\",\n", results[0].norm != NULL ? results[0].norm : DEFAULT_NORM);
+    if (results[0].structure != NULL)
+    {
+        fprintf(file, "    \"structure\": \"%s\",\n", results[0].structure);
+    }
+    if (results[0].path != NULL)
+    {
+        fprintf(file, "    \"path\": \"%s\",\n", results[0].path);
+    }
+    if (results[0].verify != NULL)
+    {
+        fprintf(file, "    \"verify\": \"%s\",\n", results[0].verify);
+    }
+    fprintf(file, "    \"trans_a\": %s,\n", results[0].trans_a ? "true" : "false");
+    fprintf(file, "    \"trans_b\": %s,\n", results[0].trans_b ? "true" : "false");
+    if (results[0].is_gemm)
+    {
+        fprintf(file, "    \"alpha\": %g,\n", results[0].alpha);
+        fprintf(file, "    \"beta\": %g,\n", results[0].beta);
+    }
+    fprintf(file, "    \"matrix_size\": %zu,\n", results[0].matrix_size);
+    if (results[0].block_size > 0)
+    {
+        fprintf(file, "    \"block_size\": %zu,\n", results[0].block_size);
+    }
+    fprintf(file, "    \"num_threads\": %zu,\n", results[0].num_threads);
+    fprintf(file, "    \"num_repeats\": %zu,\n", results[0].num_repeats);
+    fprintf(file, "    \"timestamp\": %ld\n", time(NULL));
+    fprintf(file, "  },\n  ");
+    hpckern_system_info_write_json(file, 4, system);
+    fprintf(file, ",\n");
+
+    fprintf(file, "  \"statistics\": {\n");
+    fprintf(file, "    \"multiplication\": {\"average_time\": %.9f, \"min_time\": %.9f, \"max_time\": %.9f},\n", multiplication.avg, multiplication.min, multiplication.max);
+    fprintf(file, "    \"norm_computation\": {\"average_time\": %.9f, \"min_time\": %.9f, \"max_time\": %.9f},\n", norm.avg, norm.min, norm.max);
+    fprintf(file, "    \"total\": {\"average_time\": %.9f, \"min_time\": %.9f, \"max_time\": %.9f}\n", multiplication.avg + norm.avg, multiplication.min + norm.min, multiplication.max + norm.max);
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"individual_runs\": [\n");
+    for (size_t i = 0; i < num_results; i++)
+    {
+        fprintf(
+            file,
+            "    {\"run\": %zu, \"multiplication_time\": %.9f, \"norm_time\": %.9f, \"total_time\": %.9f}%s\n",
+            i + 1,
+            results[i].benchmark_runtime,
+            results[i].norm_runtime,
+            results[i].benchmark_runtime + results[i].norm_runtime,
+            i + 1 < num_results ? "," : "");
+    }
+    fprintf(file, "  ]");
+
+    if (extras->harness != NULL)
+    {
+        fprintf(file, ",\n  \"harness\": {\n    ");
+        hpckern_harness_write_json(file, 6, "multiplication", extras->harness);
+        fprintf(file, "\n  }");
+    }
+    if (extras->pipeline != NULL)
+    {
+        fprintf(file, ",\n  \"pipeline\": {\n");
+        fprintf(file, "    \"num_jobs\": %zu,\n", extras->pipeline->num_jobs);
+        fprintf(file, "    \"queue_depth\": %zu,\n", extras->pipeline->queue_depth);
+        fprintf(file, "    \"stage_workers\": [%zu, %zu, %zu, %zu],\n",
+                extras->pipeline->stage_workers[0], extras->pipeline->stage_workers[1],
+                extras->pipeline->stage_workers[2], extras->pipeline->stage_workers[3]);
+        fprintf(file, "    \"wall_time\": %.9f,\n", extras->pipeline->wall_time);
+        fprintf(file, "    \"jobs_per_second\": %.6f", extras->pipeline->num_jobs / extras->pipeline->wall_time);
+        if (extras->pipeline->distinct_jobs > 0)
+        {
+            fprintf(file, ",\n    \"distinct_jobs\": %zu", extras->pipeline->distinct_jobs);
+        }
+        if (extras->pipeline->cache != NULL)
+        {
+            const hpckern_cache_stats_t *cache = extras->pipeline->cache;
+
+            fprintf(file, ",\n    \"cache\": {");
+            fprintf(file, "\"memory_hits\": %zu, \"disk_hits\": %zu, \"misses\": %zu, ", cache->memory_hits, cache->disk_hits, cache->misses);
+            fprintf(file, "\"stores\": %zu, \"evictions\": %zu, ", cache->stores, cache->evictions);
+            fprintf(file, "\"memory_bytes\": %zu, \"disk_bytes\": %zu}", cache->memory_bytes, cache->disk_bytes);
+        }
+        fprintf(file, "\n  }");
+    }
+    if (extras->incremental != NULL)
+    {
+        fprintf(file, ",\n  \"incremental\": {\n");
+        fprintf(file, "    \"update_kind\": \"%s\",\n", extras->incremental->update_kind);
+        fprintf(file, "    \"update_rank\": %zu,\n", extras->incremental->update_rank);
+        fprintf(file, "    \"update_rows\": %zu,\n", extras->incremental->update_rows);
+        fprintf(file, "    \"num_updates\": %zu,\n", extras->incremental->num_updates);
+        fprintf(file, "    \"initial_product_time\": %.9f\n", extras->incremental->initial_product_time);
+        fprintf(file, "  }");
+    }
+    fprintf(file, "\n}\n");
+}
+
+// A header and one row per run with the metadata repeated, so appended
+// invocations form one table once the repeated headers are dropped. The
+// summaries of result_extras_t are left out.
+void write_result_in_csv(FILE *file, size_t num_results, benchmark_result_t *results, const hpckern_system_info_t *system)
+{
+    const long timestamp = time(NULL);
+
+    fprintf(
+        file,
+        "program,mode,implementation,layout,norm,structure,path,verify,trans_a,trans_b,alpha,beta,"
+        "matrix_size,block_size,num_threads,num_repeats,timestamp," HPCKERN_SYSTEM_INFO_CSV_HEADER ","
+        "run,multiplication_time,norm_time,total_time\n");
+
+    for (size_t i = 0; i < num_results; i++)
+    {
+        fprintf(
+            file,
+            "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%g,%g,%zu,%zu,%zu,%zu,%ld,",
+            PROGRAM_NAME,
+            results[0].mode != NULL ? results[0].mode : MODE_BENCHMARK,
+            results[0].impl,
+            results[0].layout != NULL ? results[0].layout : LAYOUT_NAME_ROW_MAJOR,
+            results[0].norm != NULL ? results[0].norm : DEFAULT_NORM,
+            results[0].structure != NULL ? results[0].structure : "",
+            results[0].path != NULL ? results[0].path : "",
+            results[0].verify != NULL ? results[0].verify : "",
+            results[0].trans_a ? "true" : "false",
+            results[0].trans_b ? "true" : "false",
+            results[0].alpha,
+            results[0].beta,
+            results[0].matrix_size,
+            results[0].block_size,
+            results[0].num_threads,
+            results[0].num_repeats,
+            timestamp);
+        hpckern_system_info_write_csv(file, system);
+        fprintf(
+            file,
+            ",%zu,%.9f,%.9f,%.9f\n",
+            i + 1,
+            results[i].benchmark_runtime,
+            results[i].norm_runtime,
+            results[i].benchmark_runtime + results[i].norm_runtime);
+    }
+}
+
+// `extras` may be NULL when the mode has no summary sections.
+void write_result(FILE *file, const char *format_name, size_t num_results, benchmark_result_t *results, const result_extras_t *extras)
+{
+    const result_extras_t no_extras = {0};
+    hpckern_format_t format = HPCKERN_FORMAT_YAML;
+    hpckern_system_info_t system;
+
+    panic_unless(file != NULL, "File could not be null");
+
+    hpckern_format_from_name(format_name, &format);
+    hpckern_system_info_probe(&system);
+    if (extras == NULL)
+    {
+        extras = &no_extras;
+    }
+
+    switch (format)
+    {
+    case HPCKERN_FORMAT_JSON:
+        write_result_in_json(file, num_results, results, &system, extras);
+        break;
+    case HPCKERN_FORMAT_CSV:
+        write_result_in_csv(file, num_results, results, &system);
+        break;
+    default:
+        write_result_in_yaml(file, num_results, results, &system, extras);
+        break;
+    }
+}
+
+// Called once the benchmark has destroyed its context, so every worker has
+// recorded the end of its last idle wait.
+void write_trace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+
+    panic_unless(file != NULL, "Failed to open trace file '%s'\n", path);
+    hpckern_trace_write_chrome(file);
+    fclose(file);
+}
+
+// The infinity norm of integer data is exact. The other norms sum in a
+// different order when threaded, and the 2-norm estimate stops within
+// HPCKERN_POWER_TOLERANCE of convergence, so those compare relatively.
+bool norm_matches(hpckern_norm_kind_t kind, long double expected, long double actual)
+{
+    switch (kind)
+    {
+    case HPCKERN_NORM_INF:
+        return fabsl(expected - actual) < EPS;
+    case HPCKERN_NORM_TWO:
+        return fabsl(expected - actual) <= NORM_ESTIMATE_RTOL * fabsl(expected);
+    default:
+        return fabsl(expected - actual) <= EPS * MAX(1.0L, fabsl(expected));
+    }
+}
+
+// Checks the serial and the threaded kernel of `kind` against norms of small
+// matrices worked out by hand, so that they do not only agree with each
+// other. The copies scaled by 2^600 and 2^-600 square to outside the double
+// range, where a plain sum of squares overflows or underflows; the 2-norm
+// estimate forms A^T A x, so it is only checked at unit scale.
+void norm_reference_check(hpckern_context_t *ctx, hpckern_norm_kind_t kind)
+{
+    // [1 -2; 3 4] and diag(2, -3, 1); the spectral norm of the first is the
+    // square root of the largest eigenvalue 15 + 5 sqrt(5) of A^T A.
+    static const double entries_2[] = {1.0, -2.0, 3.0, 4.0};
+    static const double entries_3[] = {2.0, 0.0, 0.0, 0.0, -3.0, 0.0, 0.0, 0.0, 1.0};
+    const long double expected_2[HPCKERN_NUM_NORM_KINDS] = {
+        [HPCKERN_NORM_INF] = 7.0L,
+        [HPCKERN_NORM_ONE] = 6.0L,
+        [HPCKERN_NORM_FROBENIUS] = sqrtl(30.0L),
+        [HPCKERN_NORM_MAX_ABS] = 4.0L,
+        [HPCKERN_NORM_TWO] = sqrtl(15.0L + 5.0L * sqrtl(5.0L)),
+    };
+    const long double expected_3[HPCKERN_NUM_NORM_KINDS] = {
+        [HPCKERN_NORM_INF] = 3.0L,
+        [HPCKERN_NORM_ONE] = 3.0L,
+        [HPCKERN_NORM_FROBENIUS] = sqrtl(14.0L),
+        [HPCKERN_NORM_MAX_ABS] = 3.0L,
+        [HPCKERN_NORM_TWO] = 3.0L,
+    };
+    const double scales[] = {1.0, 0x1p600, 0x1p-600};
+    const hpckern_variant_t variants[] = {HPCKERN_SERIAL, HPCKERN_THREADED};
+    const long double rtol = kind == HPCKERN_NORM_TWO ? NORM_ESTIMATE_RTOL : EPS;
+    const size_t num_scales = kind == HPCKERN_NORM_TWO ? 1 : sizeof(scales) / sizeof(scales[0]);
+
+    for (size_t size = 2; size <= 3; size++)
+    {
+        const double *entries = size == 2 ? entries_2 : entries_3;
+        hpckern_matrix_t *mat = matrix_alloc(size);
+
+        for (size_t s = 0; s < num_scales; s++)
+        {
+            const long double expected = (size == 2 ? expected_2 : expected_3)[kind] * scales[s];
+
+            for (size_t i = 0; i < size * size; i++)
             {
-                const size_t i_end = MIN(bi + block_size, N);
-                const size_t j_end = MIN(bj + block_size, N);
-                const size_t k_end = MIN(bk + block_size, N);
+                mat->data[i] = entries[i] * scales[s];
+            }
+            for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+            {
+                long double actual;
+
+                CHECK(hpckern_norm(ctx, variants[v], kind, 1, mat, &actual));
+                panic_unless(
+                    fabsl(expected - actual) <= rtol * expected,
+                    "Incorrect %s norm of a %zux%zu reference matrix scaled by %g (expected: %Lg, actual: %Lg).\n",
+                    hpckern_norm_kind_name(kind), size, size, scales[s], expected, actual);
+            }
+        }
+        hpckern_matrix_destroy(&mat);
+    }
+}
+
+// Zeroed results that record the alpha and beta of plain C = A * B;
+// benchmark overwrites them with --alpha and --beta.
+benchmark_result_t *benchmark_results_create(size_t num_results)
+{
+    benchmark_result_t *results = (benchmark_result_t *)calloc(num_results, sizeof(benchmark_result_t));
+
+    for (size_t i = 0; i < num_results; i++)
+    {
+        results[i].alpha = DEFAULT_ALPHA;
+        results[i].beta = DEFAULT_BETA;
+    }
+    return results;
+}
+
+// Compares a product with its reference in parallel and, on a mismatch,
+// reports where and by how much before aborting.
+void product_check(hpckern_context_t *ctx, const char *compare, double tolerance, const hpckern_matrix_t *expected, const hpckern_matrix_t *actual, const char *what)
+{
+    const size_t N = expected->size;
+    hpckern_tolerance_t mode = HPCKERN_TOLERANCE_ABS;
+    hpckern_matrix_compare_report_t report;
+
+    hpckern_tolerance_from_name(compare, &mode);
+    CHECK(hpckern_matrix_compare_tolerance(ctx, mode, tolerance, expected, actual, &report));
+    if (report.num_mismatches == 0)
+    {
+        return;
+    }
+
+    panic_unless(
+        false,
+        "Discrepency in %s: %zu of %zu entries exceed the %s tolerance of %g, first at (%zu, %zu) "
+        "(expected: %.17g, actual: %.17g); max abs error %g, max rel error %g, max ulp error %g\n",
+        what,
+        report.num_mismatches, N * N,
+        compare, tolerance,
+        report.first_row, report.first_col,
+        expected->data[report.first_row * N + report.first_col],
+        actual->data[report.first_row * N + report.first_col],
+        report.max_abs_error, report.max_rel_error, report.max_ulp_error);
+}
+
+// Runs the multiplication and norm under the harness and returns the number
+// of measured iterations; `results` needs room for
+// harness_config->max_iterations of them.
+size_t benchmark(const hpckern_harness_config_t *harness_config, size_t num_threads, size_t matrix_size, size_t block_size, int min_value, int max_value, hpckern_rng_t *rng, const char *impl, const char *layout, const char *norm, bool trans_a, bool trans_b, bool pretranspose_b, double alpha, double beta, const char *structure, double density, size_t bandwidth, const char *verify, size_t verify_trials, const char *compare, double tolerance, benchmark_result_t *results, hpckern_harness_stats_t *stats)
+{
+    const bool is_full = strcmp(verify, VERIFY_FULL) == 0;
+    const bool is_freivalds = strcmp(verify, VERIFY_FREIVALDS) == 0;
+    const bool is_auto = strcmp(impl, IMPL_AUTO) == 0;
+    const bool is_structured = strcmp(structure, STRUCTURE_DENSE) != 0;
+    const bool is_tiled = strcmp(layout, LAYOUT_NAME_TILED) == 0;
+    const bool is_transposed = trans_a || trans_b || pretranspose_b;
+    const bool is_gemm = alpha != DEFAULT_ALPHA || beta != DEFAULT_BETA;
+    const bool is_threaded = strcmp(impl, IMPL_THREADED) == 0;
+    const hpckern_variant_t variant = impl_variant(impl);
+    hpckern_norm_kind_t norm_kind = HPCKERN_NORM_INF;
+    hpckern_path_t path = HPCKERN_PATH_DENSE;
+    hpckern_context_t *ctx;
+    hpckern_harness_config_t config = *harness_config;
+    hpckern_harness_t *harness;
+    hpckern_matrix_t *A, *B, *C, *initial = NULL;
+    hpckern_matrix_t *lhs, *rhs, *res;
+    hpckern_matrix_t *A_scratch = NULL, *B_scratch = NULL;
+    size_t i, num_samples, num_calls = 0;
+    long double mat_norm, expected_norm;
+
+    hpckern_norm_kind_from_name(norm, &norm_kind);
+    ctx = impl_context_create(impl, num_threads);
+
+    // GFLOP/s count the dense 2 N^3, also for structured operands.
+    config.flops = 2.0 * matrix_size * matrix_size * matrix_size;
+
+    A = matrix_alloc(matrix_size);
+    B = matrix_alloc(matrix_size);
+    C = matrix_alloc(matrix_size);
+
+    matrix_random_structured(rng, A, structure, density, bandwidth, min_value, max_value);
+    CHECK(hpckern_matrix_random(rng, B, min_value, max_value));
+
+    // With beta != 0 every call applies the update to the previous C, as an
+    // iterative solver would, warm-up calls included. Verification starts
+    // from a copy of the initial C once the number of calls is known.
+    if (beta != 0.0)
+    {
+        CHECK(hpckern_matrix_random(rng, C, min_value, max_value));
+        if (is_full || is_freivalds)
+        {
+            initial = matrix_alloc(matrix_size);
+            memcpy(initial->data, C->data, matrix_size * matrix_size * sizeof(double));
+        }
+    }
+
+    lhs = A;
+    rhs = B;
+    res = C;
+    if (is_tiled)
+    {
+        // Operands are stored tile-major; conversion is not part of the timing.
+        lhs = matrix_alloc_tiled(matrix_size, block_size);
+        rhs = matrix_alloc_tiled(matrix_size, block_size);
+        res = matrix_alloc_tiled(matrix_size, block_size);
+
+        CHECK(hpckern_matrix_convert_layout(A, lhs));
+        CHECK(hpckern_matrix_convert_layout(B, rhs));
+        CHECK(hpckern_matrix_convert_layout(C, res));
+    }
+    if (is_transposed)
+    {
+        // Flipping operands into scratch is part of the multiplication time.
+        A_scratch = matrix_alloc(matrix_size);
+        B_scratch = matrix_alloc(matrix_size);
+    }
+
+    mat_norm = 0.0;
+    expected_norm = 0.0;
+
+    harness = hpckern_harness_create(&config);
+    panic_unless(harness != NULL, "Failed to create the benchmark harness\n");
+    while (hpckern_harness_next(harness))
+    {
+        const bool is_warmup = hpckern_harness_is_warmup(harness);
+        double mult_runtime, norm_runtime;
+
+        HPCKERN_TRACE_BEGIN("multiplication", num_calls);
+        if (is_transposed)
+        {
+            MEASURE_RUNTIME(
+                matrix_gemm_by_impl_trans(ctx, impl, block_size, trans_a, trans_b, pretranspose_b, alpha, A, B, beta, C, A_scratch, B_scratch),
+                mult_runtime);
+        }
+        else if (is_auto)
+        {
+            MEASURE_RUNTIME(
+                CHECK(hpckern_gemm_auto(ctx, variant, block_size, alpha, lhs, rhs, beta, res, &path)),
+                mult_runtime);
+        }
+        else
+        {
+            MEASURE_RUNTIME(CHECK(hpckern_gemm(ctx, variant, block_size, alpha, lhs, rhs, beta, res)), mult_runtime);
+        }
+        HPCKERN_TRACE_END("multiplication");
+        HPCKERN_TRACE_BEGIN("norm", num_calls);
+        MEASURE_RUNTIME(CHECK(hpckern_norm(ctx, variant, norm_kind, block_size, res, &mat_norm)), norm_runtime);
+        HPCKERN_TRACE_END("norm");
+        CHECK(hpckern_harness_record(harness, mult_runtime));
+        num_calls++;
+        if (is_warmup)
+        {
+            continue;
+        }
 
-                for (size_t k = bk; k < k_end; k++)
-                {
-                    for (size_t i = bi; i < i_end; i++)
-                    {
-                        register const double lhs_data = lhs->data[i * N + k];
-                        register double *rhs_row = &rhs->data[k * N];
-                        register double *result_row = &result->data[i * N];
-                        register const size_t limit = j_end - ((j_end - bj) % 4);
-                        register size_t j;
-
-                        for (j = bj; j < limit; j += 4)
-                        {
-                            result_row[j] += lhs_data * rhs_row[j];
-                            result_row[j + 1] += lhs_data * rhs_row[j + 1];
-                            result_row[j + 2] += lhs_data * rhs_row[j + 2];
-                            result_row[j + 3] += lhs_data * rhs_row[j + 3];
-                        }
-
-                        for (; j < j_end; j++)
-                        {
-                            result_row[j] += lhs_data * rhs_row[j];
-                        }
-                    }
-                }
-            }
+        i = hpckern_harness_num_samples(harness) - 1;
+        results[i].benchmark_runtime = mult_runtime;
+        results[i].norm_runtime = norm_runtime;
+        results[i].block_size = impl_block_size(impl, block_size);
+        results[i].impl = impl;
+        results[i].norm = norm;
+        results[i].matrix_size = matrix_size;
+        results[i].num_threads = hpckern_context_num_threads(ctx);
+        results[i].trans_a = trans_a;
+        results[i].trans_b = trans_b;
+        if (is_tiled)
+        {
+            results[i].layout = layout;
         }
+        if (is_structured || is_auto)
+        {
+            results[i].structure = structure;
+        }
+        if (is_auto)
+        {
+            results[i].path = hpckern_path_name(path);
+        }
+        if (!is_full)
+        {
+            results[i].verify = verify;
+        }
+        results[i].alpha = alpha;
+        results[i].beta = beta;
+        results[i].is_gemm = is_gemm;
     }
-}
 
-void matrix_mult_cblas(matrix_t *lhs, matrix_t *rhs, matrix_t *result)
-{
-    panic_unless(
-        lhs->size == rhs->size,
-        "I can only multiply two square matrices of the same size, not %dx%d multiply by %dx%d\n",
-        lhs->size, lhs->size,
-        rhs->size, rhs->size);
+    num_samples = hpckern_harness_num_samples(harness);
+    for (i = 0; i < num_samples; i++)
+    {
+        results[i].num_repeats = num_samples;
+    }
+    CHECK(hpckern_harness_stats(harness, stats));
+    hpckern_harness_destroy(&harness);
 
-    const size_t N = lhs->size;
+    if (is_tiled)
+    {
+        CHECK(hpckern_matrix_convert_layout(res, C));
 
-    memset(result->data, 0, N * N * sizeof(double));
+        hpckern_matrix_destroy(&lhs);
+        hpckern_matrix_destroy(&rhs);
+        hpckern_matrix_destroy(&res);
+    }
+    if (is_transposed)
+    {
+        hpckern_matrix_destroy(&A_scratch);
+        hpckern_matrix_destroy(&B_scratch);
+    }
 
-    cblas_dgemm(
-        CblasRowMajor,
-        CblasNoTrans,
-        CblasNoTrans,
-        N,
-        N,
-        N,
-        1.0,
-        lhs->data,
-        N,
-        rhs->data,
-        N,
-        0.0,
-        result->data,
-        N);
-}
+    if (is_full || is_freivalds)
+    {
+        hpckern_context_t *verify_ctx = context_alloc(num_threads);
 
-void *matrix_mult_worker(void *param)
-{
-    matrix_mult_worker_params_t *worker_params = (matrix_mult_worker_params_t *)param;
-    matrix_t *lhs = worker_params->lhs;
-    matrix_t *rhs = worker_params->rhs;
-    double *result = worker_params->result;
-    const size_t N = lhs->size;
-    const size_t block_size = worker_params->block_size;
-    const size_t bi = worker_params->block_start_index;
+        const size_t num_updates = beta != 0.0 ? num_calls : 1;
 
-    for (size_t bj = 0; bj < N; bj += block_size)
-    {
-        for (size_t bk = 0; bk < N; bk += block_size)
+        if (is_full)
         {
-            const size_t i_end = worker_params->block_end_index;
-            const size_t j_end = MIN(bj + block_size, N);
-            const size_t k_end = MIN(bk + block_size, N);
+            // The reference continues from the initial C in place.
+            hpckern_matrix_t *expected_mult_result = initial != NULL ? initial : matrix_alloc(matrix_size);
 
-            for (size_t k = bk; k < k_end; k++)
+            initial = NULL;
+            for (i = 0; i < num_updates; i++)
             {
-                for (size_t i = bi; i < i_end; i++)
-                {
-                    register const double lhs_data = lhs->data[i * N + k];
-                    register double *rhs_row = &rhs->data[k * N];
-                    register double *result_row = &result[i * N];
-                    register const size_t limit = j_end - ((j_end - bj) % 4);
-                    register size_t j;
-
-                    for (j = bj; j < limit; j += 4)
-                    {
-                        result_row[j] += lhs_data * rhs_row[j];
-                        result_row[j + 1] += lhs_data * rhs_row[j + 1];
-                        result_row[j + 2] += lhs_data * rhs_row[j + 2];
-                        result_row[j + 3] += lhs_data * rhs_row[j + 3];
-                    }
-
-                    for (; j < j_end; j++)
-                    {
-                        result_row[j] += lhs_data * rhs_row[j];
-                    }
-                }
+                CHECK(hpckern_matrix_gemm_cblas(trans_a, trans_b, alpha, A, B, beta, expected_mult_result));
+            }
+            product_check(verify_ctx, compare, tolerance, expected_mult_result, C, "matrix multiplication results");
+            hpckern_matrix_destroy(&expected_mult_result);
+        }
+        else
+        {
+            // n updates C <- alpha A B + beta C compose to
+            // C_n = alpha (1 + beta + ... + beta^(n-1)) A B + beta^n C_0.
+            double alpha_total = 0.0;
+            double beta_total = 1.0;
+            bool matches;
+
+            for (i = 0; i < num_updates; i++)
+            {
+                alpha_total += alpha * beta_total;
+                beta_total *= beta;
             }
+            CHECK(hpckern_matrix_verify_freivalds(verify_ctx, rng, verify_trials, trans_a, trans_b, alpha_total, A, B, beta_total, initial, C, &matches));
+            panic_unless(
+                matches,
+                "Discrepency in matrix multiplication results (Freivalds' check, %zu trials)\n",
+                verify_trials);
         }
+
+        // The reference norm runs threaded when the benchmark ran serial and
+        // vice versa, so the two code paths check each other. Both read the
+        // verified C: the reference product may differ from it within the
+        // comparison tolerance, which the inf norm check does not allow.
+        CHECK(hpckern_norm(
+            verify_ctx,
+            is_threaded ? HPCKERN_SERIAL : HPCKERN_THREADED,
+            norm_kind,
+            block_size,
+            C,
+            &expected_norm));
+        norm_reference_check(verify_ctx, norm_kind);
+        hpckern_context_destroy(&verify_ctx);
+
+        panic_unless(
+            norm_matches(norm_kind, expected_norm, mat_norm),
+            "Incorrect matrix norm estimation (expected: %Lf, actual: %Lf).",
+            expected_norm,
+            mat_norm);
     }
 
-    pthread_exit(NULL);
+    hpckern_matrix_destroy(&A);
+    hpckern_matrix_destroy(&B);
+    hpckern_matrix_destroy(&C);
+    if (initial != NULL)
+    {
+        hpckern_matrix_destroy(&initial);
+    }
+    hpckern_context_destroy(&ctx);
+    return num_samples;
 }
 
-void matrix_mult_threaded(size_t num_threads, size_t block_size, matrix_t *lhs, matrix_t *rhs, matrix_t *result)
+// Times the out-of-place and the in-place blocked transpose of a random
+// matrix and checks both against the definition. The out-of-place time is
+// reported as `benchmark_runtime`, the in-place time as `norm_runtime`.
+void transpose_benchmark(size_t num_repeats, size_t num_threads, size_t matrix_size, size_t block_size, int min_value, int max_value, hpckern_rng_t *rng, benchmark_result_t *results)
 {
-    const size_t N = lhs->size;
-    const size_t PARTITION_SIZE = (size_t)ceil((double)N / (double)num_threads);
-    pthread_t *threads;
-    matrix_mult_worker_params_t *worker_params;
-    pthread_mutex_t *mutex;
+    const size_t N = matrix_size;
+    hpckern_context_t *ctx = context_alloc(num_threads);
+    hpckern_matrix_t *A, *A_t, *A_in_place;
 
-    panic_unless(
-        lhs->size == rhs->size,
-        "I can only multiply two square matrices of the same size, not %dx%d multiply by %dx%d\n",
-        lhs->size, lhs->size,
-        rhs->size, rhs->size);
-
-    memset(result->data, 0, N * N * sizeof(double));
+    A = matrix_alloc(matrix_size);
+    A_t = matrix_alloc(matrix_size);
+    A_in_place = matrix_alloc(matrix_size);
 
-    threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
-    worker_params = (matrix_mult_worker_params_t *)calloc(num_threads, sizeof(matrix_mult_worker_params_t));
-    mutex = (pthread_mutex_t *)calloc(1, sizeof(pthread_mutex_t));
+    CHECK(hpckern_matrix_random(rng, A, min_value, max_value));
+    memcpy(A_in_place->data, A->data, N * N * sizeof(double));
 
-    pthread_mutex_init(mutex, NULL);
-
-    for (size_t i = 0; i < num_threads; i++)
+    for (size_t i = 0; i < num_repeats; i++)
     {
-        worker_params[i].lhs = lhs;
-        worker_params[i].rhs = rhs;
-        worker_params[i].result = (double *)calloc(N * N, sizeof(double));
-        worker_params[i].block_start_index = i * PARTITION_SIZE;
-        worker_params[i].block_end_index = MIN((i + 1) * PARTITION_SIZE, N);
-        worker_params[i].block_size = block_size;
-
-        pthread_create(
-            &threads[i],
-            NULL,
-            matrix_mult_worker,
-            (void *)&worker_params[i]);
+        MEASURE_RUNTIME(CHECK(hpckern_matrix_transpose(ctx, block_size, A, A_t)), results[i].benchmark_runtime);
+        MEASURE_RUNTIME(CHECK(hpckern_matrix_transpose_inplace(ctx, block_size, A_in_place)), results[i].norm_runtime);
+        results[i].block_size = block_size;
+        results[i].impl = IMPL_TRANSPOSE;
+        results[i].matrix_size = matrix_size;
+        results[i].num_repeats = num_repeats;
+        results[i].num_threads = num_threads;
     }
 
-    for (size_t i = 0; i < num_threads; i++)
+    // An even number of in-place transposes restores A.
+    for (size_t i = 0; i < N; i++)
     {
-        pthread_join(threads[i], NULL);
-        for (size_t j = 0; j < N * N; j++)
+        for (size_t j = 0; j < N; j++)
         {
-            result->data[j] += worker_params[i].result[j];
+            panic_unless(
+                A_t->data[j * N + i] == A->data[i * N + j] &&
+                    A_in_place->data[(num_repeats % 2 == 0 ? i : j) * N + (num_repeats % 2 == 0 ? j : i)] == A->data[i * N + j],
+                "Discrepency in transpose results at (%zu, %zu)\n",
+                i, j);
         }
-        free(worker_params[i].result);
-        worker_params[i].result = NULL;
     }
 
-    free(threads);
-    free(worker_params);
-    pthread_mutex_destroy(mutex);
-    free(mutex);
+    hpckern_matrix_destroy(&A);
+    hpckern_matrix_destroy(&A_t);
+    hpckern_matrix_destroy(&A_in_place);
+    hpckern_context_destroy(&ctx);
 }
 
-void *matrix_norm_worker(void *params)
+// Times the O(N^2) estimate of ||A * B||_inf; no product is formed, so the
+// multiplication time stays zero. The estimate is checked against the norm
+// of a cblas product: it must match exactly for nonnegative operands, and
+// must not exceed it otherwise.
+void estimate_benchmark(size_t num_repeats, size_t num_threads, size_t matrix_size, size_t block_size, int min_value, int max_value, hpckern_rng_t *rng, benchmark_result_t *results)
 {
-    matrix_norm_worker_params_t *worker_params = (matrix_norm_worker_params_t *)params;
-    const size_t N = worker_params->mat->size;
-    const size_t start_index = worker_params->start_index;
-    const size_t end_index = worker_params->end_index;
-    const size_t block_size = worker_params->block_size;
-    double *data = worker_params->mat->data;
-    register long double row_sum;
-    register double *row;
-    register size_t j_end;
-    register size_t j;
-    long double local_max_sum = 0.0;
+    hpckern_context_t *ctx = context_alloc(num_threads);
+    hpckern_matrix_t *A, *B, *expected_mult_result;
+    long double estimate = 0.0, expected_norm;
+    bool is_exact = false;
+
+    A = matrix_alloc(matrix_size);
+    B = matrix_alloc(matrix_size);
+    expected_mult_result = matrix_alloc(matrix_size);
+
+    CHECK(hpckern_matrix_random(rng, A, min_value, max_value));
+    CHECK(hpckern_matrix_random(rng, B, min_value, max_value));
 
-    for (size_t i = start_index; i < end_index; i++)
+    for (size_t i = 0; i < num_repeats; i++)
     {
-        row = &data[i * N];
-        row_sum = 0.0;
-        for (size_t bj = 0; bj < N; bj += block_size)
-        {
-            j_end = MIN(bj + block_size, N);
-            for (j = bj; j < j_end; j++)
-            {
-                row_sum += fabsl(row[j]);
-            }
-        }
-        local_max_sum = MAX(local_max_sum, row_sum);
+        results[i].benchmark_runtime = 0.0;
+        MEASURE_RUNTIME(
+            CHECK(hpckern_matrix_norm_product_estimate(ctx, num_threads, A, B, &estimate, &is_exact)),
+            results[i].norm_runtime);
+        results[i].impl = IMPL_ESTIMATE;
+        results[i].matrix_size = matrix_size;
+        results[i].num_repeats = num_repeats;
+        results[i].num_threads = num_threads;
     }
 
-    pthread_mutex_lock(worker_params->mutex);
-    *(worker_params->shared_max_sum) = MAX(*(worker_params->shared_max_sum), local_max_sum);
-    pthread_mutex_unlock(worker_params->mutex);
+    CHECK(hpckern_matrix_mult_cblas(A, B, expected_mult_result));
+    CHECK(hpckern_norm(ctx, HPCKERN_THREADED, HPCKERN_NORM_INF, block_size, expected_mult_result, &expected_norm));
+    panic_unless(
+        is_exact ? norm_matches(HPCKERN_NORM_INF, expected_norm, estimate)
+                 : estimate <= expected_norm * (1.0 + EPS),
+        "Incorrect %s matrix norm estimate (expected: %Lf, actual: %Lf).",
+        is_exact ? "exact" : "lower-bound",
+        expected_norm,
+        estimate);
 
-    pthread_exit(NULL);
+    hpckern_matrix_destroy(&A);
+    hpckern_matrix_destroy(&B);
+    hpckern_matrix_destroy(&expected_mult_result);
+    hpckern_context_destroy(&ctx);
 }
 
-long double matrix_norm_serial(size_t block_size, matrix_t *mat)
+// Keeps C = A * B and its row sums in an incremental product across
+// `num_updates` random updates of `update_kind`, instead of recomputing the
+// product. Each result times one update as its multiplication and one norm
+// read. Rank updates use U and V with entries in {-1, 0, 1}, so integer data
+// stays exact; with `update_rows` > 0 only that many random rows of U are
+// nonzero, so several rows change at once without a heap rebuild. After every
+// update the norm is checked against a full recompute over the maintained C,
+// outside the timings, and the final C and norm against a cblas product of the
+// updated operands. Returns the time of the initial full product.
+double incremental_benchmark(size_t num_updates, size_t num_threads, size_t matrix_size, size_t block_size, int min_value, int max_value, hpckern_rng_t *rng, const char *impl, const char *update_kind, size_t update_rank, size_t update_rows, const char *compare, double tolerance, benchmark_result_t *results)
 {
-    size_t N;
-    double *data;
-    register long double row_sum;
-    register double *row;
-    register size_t j_end;
-    register size_t j;
-    long double max_row_sum;
-    size_t i, bj;
-
-    N = mat->size;
-    data = mat->data;
-    max_row_sum = 0.0;
-
-    for (i = 0; i < N; i++)
+    const size_t N = matrix_size;
+    const bool is_rank = strcmp(update_kind, UPDATE_RANK_A) == 0 || strcmp(update_kind, UPDATE_RANK_B) == 0;
+    hpckern_context_t *ctx = impl_context_create(impl, num_threads);
+    hpckern_incremental_t *inc;
+    hpckern_matrix_t *A, *B, *expected_mult_result;
+    double *values, *U, *V;
+    long double mat_norm = 0.0, expected_norm;
+    double initial_time;
+
+    A = matrix_alloc(matrix_size);
+    B = matrix_alloc(matrix_size);
+    expected_mult_result = matrix_alloc(matrix_size);
+    values = (double *)calloc(N, sizeof(double));
+    U = (double *)calloc(N * update_rank, sizeof(double));
+    V = (double *)calloc(N * update_rank, sizeof(double));
+
+    CHECK(hpckern_matrix_random(rng, A, min_value, max_value));
+    CHECK(hpckern_matrix_random(rng, B, min_value, max_value));
+
+    MEASURE_RUNTIME(inc = hpckern_incremental_create(ctx, impl_variant(impl), block_size, A, B), initial_time);
+    panic_unless(inc != NULL, "Failed to create the incremental product\n");
+
+    for (size_t i = 0; i < num_updates; i++)
     {
-        row = &data[i * N];
-        row_sum = 0.0;
-        for (bj = 0; bj < N; bj += block_size)
+        const size_t row = hpckern_rng_next(rng) % N;
+
+        if (is_rank)
+        {
+            for (size_t k = 0; k < N * update_rank; k++)
+            {
+                U[k] = update_rows == 0 ? hpckern_rng_int(rng, -1, 1) : 0.0;
+                V[k] = hpckern_rng_int(rng, -1, 1);
+            }
+            for (size_t r = 0; r < update_rows; r++)
+            {
+                const size_t u_row = hpckern_rng_next(rng) % N;
+                for (size_t k = 0; k < update_rank; k++)
+                {
+                    U[u_row * update_rank + k] = hpckern_rng_int(rng, -1, 1);
+                }
+            }
+        }
+        else
         {
-            j_end = MIN(bj + block_size, N);
-            for (j = bj; j < j_end; j++)
+            for (size_t j = 0; j < N; j++)
             {
-                row_sum += fabsl(row[j]);
+                values[j] = hpckern_rng_int(rng, min_value, max_value);
             }
         }
-        max_row_sum = MAX(max_row_sum, row_sum);
+
+        if (strcmp(update_kind, UPDATE_ROW_A) == 0)
+        {
+            MEASURE_RUNTIME(CHECK(hpckern_incremental_update_lhs_row(inc, row, values)), results[i].benchmark_runtime);
+        }
+        else if (strcmp(update_kind, UPDATE_ROW_B) == 0)
+        {
+            MEASURE_RUNTIME(CHECK(hpckern_incremental_update_rhs_row(inc, row, values)), results[i].benchmark_runtime);
+        }
+        else if (strcmp(update_kind, UPDATE_RANK_A) == 0)
+        {
+            MEASURE_RUNTIME(CHECK(hpckern_incremental_update_lhs_rank_k(inc, update_rank, U, V)), results[i].benchmark_runtime);
+        }
+        else
+        {
+            MEASURE_RUNTIME(CHECK(hpckern_incremental_update_rhs_rank_k(inc, update_rank, U, V)), results[i].benchmark_runtime);
+        }
+        MEASURE_RUNTIME(mat_norm = hpckern_incremental_norm(inc), results[i].norm_runtime);
+        CHECK(hpckern_matrix_norm_serial(block_size, hpckern_incremental_product(inc), &expected_norm));
+        panic_unless(
+            norm_matches(HPCKERN_NORM_INF, expected_norm, mat_norm),
+            "Incorrect incrementally updated matrix norm after update %zu (expected: %Lf, actual: %Lf).",
+            i,
+            expected_norm,
+            mat_norm);
+        results[i].block_size = impl_block_size(impl, block_size);
+        results[i].impl = impl;
+        results[i].matrix_size = matrix_size;
+        results[i].num_repeats = num_updates;
+        results[i].num_threads = hpckern_context_num_threads(ctx);
+        results[i].mode = MODE_UPDATES;
     }
 
-    return max_row_sum;
+    CHECK(hpckern_matrix_mult_cblas(hpckern_incremental_lhs(inc), hpckern_incremental_rhs(inc), expected_mult_result));
+    product_check(ctx, compare, tolerance, expected_mult_result, hpckern_incremental_product(inc), "incrementally updated matrix multiplication results");
+
+    CHECK(hpckern_matrix_norm_serial(block_size, expected_mult_result, &expected_norm));
+    panic_unless(
+        norm_matches(HPCKERN_NORM_INF, expected_norm, mat_norm),
+        "Incorrect incrementally updated matrix norm (expected: %Lf, actual: %Lf).",
+        expected_norm,
+        mat_norm);
+
+    hpckern_incremental_destroy(&inc);
+    hpckern_matrix_destroy(&A);
+    hpckern_matrix_destroy(&B);
+    hpckern_matrix_destroy(&expected_mult_result);
+    free(values);
+    free(U);
+    free(V);
+    hpckern_context_destroy(&ctx);
+
+    return initial_time;
 }
 
-long double matrix_norm_threaded(size_t num_threads, size_t block_size, matrix_t *mat)
+// Stage 4: check the product and its norm, record the job and recycle its
+// buffers. Every job writes its own result slot.
+void *pipeline_verify_stage(void *param)
 {
-    const size_t N = mat->size;
-    const size_t PARTITION_SIZE = (size_t)ceil((double)N / (double)num_threads);
-    pthread_t *threads;
-    matrix_norm_worker_params_t *worker_params;
-    pthread_mutex_t mutex;
-    long double shared_result = 0.0;
+    pipeline_t *pipeline = (pipeline_t *)param;
+    const bool is_full = strcmp(pipeline->verify, VERIFY_FULL) == 0;
+    const bool is_freivalds = strcmp(pipeline->verify, VERIFY_FREIVALDS) == 0;
+    hpckern_context_t *ctx = context_alloc(1);
+    hpckern_matrix_t *expected_mult_result = NULL;
+    long double expected_norm;
+    pipeline_job_t *job;
+
+    while ((job = job_queue_pop(&pipeline->normed)) != NULL)
+    {
+        benchmark_result_t *result = &pipeline->results[job->index];
+
+        if (is_full)
+        {
+            char what[64];
 
-    threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
-    worker_params = (matrix_norm_worker_params_t *)calloc(num_threads, sizeof(matrix_norm_worker_params_t));
+            if (expected_mult_result == NULL)
+            {
+                expected_mult_result = matrix_alloc(job->C->size);
+            }
+            snprintf(what, sizeof(what), "matrix multiplication results of job %zu", job->index);
+            CHECK(hpckern_matrix_mult_cblas(job->A, job->B, expected_mult_result));
+            product_check(ctx, pipeline->compare, pipeline->tolerance, expected_mult_result, job->C, what);
+        }
+        else if (is_freivalds)
+        {
+            hpckern_rng_t rng;
+            bool matches;
+
+            hpckern_rng_seed(&rng, pipeline->seed + 2 * job->index + 1);
+            CHECK(hpckern_matrix_verify_freivalds(ctx, &rng, pipeline->verify_trials, false, false, 1.0, job->A, job->B, 0.0, NULL, job->C, &matches));
+            panic_unless(
+                matches,
+                "Discrepency in matrix multiplication results of job %zu (Freivalds' check)\n",
+                job->index);
+        }
 
-    pthread_mutex_init(&mutex, NULL);
+        if (is_full || is_freivalds)
+        {
+            CHECK(hpckern_norm(ctx, HPCKERN_SERIAL, pipeline->norm_kind, pipeline->block_size, job->C, &expected_norm));
+            panic_unless(
+                norm_matches(pipeline->norm_kind, expected_norm, job->norm),
+                "Incorrect matrix norm estimation of job %zu (expected: %Lf, actual: %Lf).",
+                job->index,
+                expected_norm,
+                job->norm);
+        }
 
-    for (size_t i = 0; i < num_threads; i++)
-    {
-        worker_params[i].mat = mat;
-        worker_params[i].shared_max_sum = &shared_result;
-        worker_params[i].mutex = &mutex;
-        worker_params[i].start_index = i * PARTITION_SIZE;
-        worker_params[i].end_index = MIN((i + 1) * PARTITION_SIZE, N);
-        worker_params[i].block_size = block_size;
+        result->benchmark_runtime = job->mult_runtime;
+        result->norm_runtime = job->norm_runtime;
+        result->block_size = impl_block_size(pipeline->impl, pipeline->block_size);
+        result->impl = pipeline->impl;
+        result->mode = MODE_JOBS;
+        result->norm = pipeline->norm;
+        result->matrix_size = job->C->size;
+        result->num_repeats = pipeline->num_jobs;
+        result->num_threads = strcmp(pipeline->impl, IMPL_THREADED) == 0 ? pipeline->num_threads : 1;
+        if (!is_full)
+        {
+            result->verify = pipeline->verify;
+        }
 
-        pthread_create(
-            &threads[i],
-            NULL,
-            matrix_norm_worker,
-            (void *)&worker_params[i]);
+        job_queue_push(&pipeline->free_jobs, job);
     }
 
-    for (size_t i = 0; i < num_threads; i++)
+    if (expected_mult_result != NULL)
     {
-        pthread_join(threads[i], NULL);
+        hpckern_matrix_destroy(&expected_mult_result);
     }
-
-    pthread_mutex_destroy(&mutex);
-    free(threads);
-    free(worker_params);
-
-    return shared_result;
+    hpckern_context_destroy(&ctx);
+    pthread_exit(NULL);
 }
 
-void write_result_in_yaml(FILE *file, size_t num_results, benchmark_result_t *results)
+// Runs `num_jobs` independent (A, B) products through four overlapping stages:
+// generate -> multiply -> norm -> verify, with stage_workers[s] threads in
+// stage s. Stages are connected by bounded queues of depth `queue_depth`, and
+// job buffers are recycled through a free list, so at most one operand set
+// per worker plus `queue_depth` are alive. The distinct_jobs operand pairs
+// are generated before the clock starts; `cache` may be NULL. Returns the
+// wall time of the stream.
+double pipeline_benchmark(size_t num_jobs, size_t queue_depth, const size_t *stage_workers, size_t num_threads, size_t matrix_size, size_t block_size, int min_value, int max_value, uint64_t seed, const char *impl, const char *norm, const char *verify, size_t verify_trials, const char *compare, double tolerance, size_t distinct_jobs, hpckern_cache_t *cache, benchmark_result_t *results)
 {
-    size_t i;
-    double avg_benchmark_runtime, avg_norm_runtime;
-    double min_benchmark_runtime, max_benchmark_runtime;
-    double min_norm_runtime, max_norm_runtime;
-
-    panic_unless(file != NULL, "File could not be null");
-
-    avg_benchmark_runtime = 0.0;
-    avg_norm_runtime = 0.0;
-    min_benchmark_runtime = results[0].benchmark_runtime;
-    max_benchmark_runtime = results[0].benchmark_runtime;
-    min_norm_runtime = results[0].norm_runtime;
-    max_norm_runtime = results[0].norm_runtime;
-
-    for (i = 0; i < num_results; i++)
+    void *(*const stages[PIPELINE_NUM_STAGES])(void *) = {
+        pipeline_generate_stage,
+        pipeline_multiply_stage,
+        pipeline_norm_stage,
+        pipeline_verify_stage,
+    };
+    size_t num_workers = 0;
+    size_t num_buffers;
+    pipeline_t pipeline;
+    pipeline_job_t *jobs;
+    pthread_t *workers;
+    double wall_time;
+    struct timespec ts_start, ts_end;
+
+    for (size_t s = 0; s < PIPELINE_NUM_STAGES; s++)
+    {
+        num_workers += stage_workers[s];
+    }
+    num_buffers = num_workers + queue_depth;
+
+    pipeline.num_jobs = num_jobs;
+    atomic_init(&pipeline.next_job, 0);
+    pipeline.num_threads = num_threads;
+    pipeline.block_size = block_size;
+    pipeline.min_value = min_value;
+    pipeline.max_value = max_value;
+    pipeline.seed = seed;
+    pipeline.impl = impl;
+    pipeline.norm_kind = HPCKERN_NORM_INF;
+    hpckern_norm_kind_from_name(norm, &pipeline.norm_kind);
+    pipeline.distinct_jobs = distinct_jobs;
+    pipeline.operands = NULL;
+    pipeline.cache = cache;
+    pipeline.needs_product = strcmp(verify, VERIFY_NONE) != 0;
+    pipeline.norm = norm;
+    pipeline.verify = verify;
+    pipeline.verify_trials = verify_trials;
+    pipeline.compare = compare;
+    pipeline.tolerance = tolerance;
+    pipeline.results = results;
+
+    if (distinct_jobs > 0)
     {
-        avg_benchmark_runtime += results[i].benchmark_runtime;
-        avg_norm_runtime += results[i].norm_runtime;
+        hpckern_rng_t rng;
 
-        min_benchmark_runtime = MIN(min_benchmark_runtime, results[i].benchmark_runtime);
-        max_benchmark_runtime = MAX(max_benchmark_runtime, results[i].benchmark_runtime);
-        min_norm_runtime = MIN(min_norm_runtime, results[i].norm_runtime);
-        max_norm_runtime = MAX(max_norm_runtime, results[i].norm_runtime);
+        hpckern_rng_seed(&rng, seed);
+        pipeline.operands = (hpckern_matrix_t **)calloc(2 * distinct_jobs, sizeof(hpckern_matrix_t *));
+        for (size_t i = 0; i < 2 * distinct_jobs; i++)
+        {
+            pipeline.operands[i] = matrix_alloc(matrix_size);
+            CHECK(hpckern_matrix_random(&rng, pipeline.operands[i], min_value, max_value));
+        }
     }
 
-    avg_benchmark_runtime /= num_results;
-    avg_norm_runtime /= num_results;
+    // Each queue stays open until the last worker of the stage feeding it
+    // closes it.
+    job_queue_init(&pipeline.free_jobs, num_buffers, 1);
+    job_queue_init(&pipeline.generated, queue_depth, stage_workers[0]);
+    job_queue_init(&pipeline.multiplied, queue_depth, stage_workers[1]);
+    job_queue_init(&pipeline.normed, queue_depth, stage_workers[2]);
 
-    fprintf(file, "- benchmark_results:\n");
-    fprintf(file, "  metadata:\n");
-    fprintf(file, "    implementation: \"%s\"\n", results[0].impl);
-    fprintf(file, "    matrix_size: %zu\n", results[0].matrix_size);
-    fprintf(file, "    block_size: %zu\n", results[0].block_size);
-    fprintf(file, "    num_threads: %zu\n", results[0].num_threads);
-    fprintf(file, "    num_repeats: %zu\n", results[0].num_repeats);
-    fprintf(file, "    timestamp: %ld\n", time(NULL));
+    jobs = (pipeline_job_t *)calloc(num_buffers, sizeof(pipeline_job_t));
+    for (size_t i = 0; i < num_buffers; i++)
+    {
+        jobs[i].A = matrix_alloc(matrix_size);
+        jobs[i].B = matrix_alloc(matrix_size);
+        jobs[i].C = matrix_alloc(matrix_size);
+        job_queue_push(&pipeline.free_jobs, &jobs[i]);
+    }
+    workers = (pthread_t *)malloc(num_workers * sizeof(pthread_t));
 
-    fprintf(file, "  statistics:\n");
-    fprintf(file, "    multiplication:\n");
-    fprintf(file, "      average_time: %.9f\n", avg_benchmark_runtime);
-    fprintf(file, "      min_time: %.9f\n", min_benchmark_runtime);
-    fprintf(file, "      max_time: %.9f\n", max_benchmark_runtime);
-    fprintf(file, "    norm_computation:\n");
-    fprintf(file, "      average_time: %.9f\n", avg_norm_runtime);
-    fprintf(file, "      min_time: %.9f\n", min_norm_runtime);
-    fprintf(file, "      max_time: %.9f\n", max_norm_runtime);
-    fprintf(file, "    total:\n");
-    fprintf(file, "      average_time: %.9f\n", avg_benchmark_runtime + avg_norm_runtime);
-    fprintf(file, "      min_time: %.9f\n", min_benchmark_runtime + min_norm_runtime);
-    fprintf(file, "      max_time: %.9f\n", max_benchmark_runtime + max_norm_runtime);
+    clock_gettime(CLOCK_MONOTONIC, &ts_start);
 
-    fprintf(file, "  individual_runs:\n");
-    for (i = 0; i < num_results; i++)
+    for (size_t s = 0, w = 0; s < PIPELINE_NUM_STAGES; s++)
     {
-        fprintf(file, "    - run: %zu\n", i + 1);
-        fprintf(file, "      multiplication_time: %.9f\n", results[i].benchmark_runtime);
-        fprintf(file, "      norm_time: %.9f\n", results[i].norm_runtime);
-        fprintf(file, "      total_time: %.9f\n", results[i].benchmark_runtime + results[i].norm_runtime);
+        for (size_t i = 0; i < stage_workers[s]; i++, w++)
+        {
+            pthread_create(&workers[w], NULL, stages[s], &pipeline);
+        }
+    }
+    for (size_t w = 0; w < num_workers; w++)
+    {
+        pthread_join(workers[w], NULL);
     }
-}
-
-void benchmark(size_t num_repeats, size_t num_threads, size_t matrix_size, size_t block_size, int min_value, int max_value, const char *impl, benchmark_result_t *results)
-{
-    const bool is_naive = strcmp(impl, IMPL_NAIVE) == 0;
-    const bool is_cblas = strcmp(impl, IMPL_CBLAS) == 0;
-    const bool is_serial = strcmp(impl, IMPL_SERIAL) == 0;
-    const bool is_threaded = strcmp(impl, IMPL_THREADED) == 0;
-    matrix_t *A, *B, *C, *expected_mult_result;
-    size_t i;
-    long double mat_norm, expected_norm;
 
-    A = matrix_init(matrix_size);
-    B = matrix_init(matrix_size);
-    C = matrix_init(matrix_size);
-    expected_mult_result = matrix_init(matrix_size);
+    clock_gettime(CLOCK_MONOTONIC, &ts_end);
+    wall_time = (ts_end.tv_sec - ts_start.tv_sec) + (ts_end.tv_nsec - ts_start.tv_nsec) * 1e-9;
 
-    matrix_random(A, min_value, max_value);
-    matrix_random(B, min_value, max_value);
+    free(workers);
+    for (size_t i = 0; i < num_buffers; i++)
+    {
+        hpckern_matrix_destroy(&jobs[i].A);
+        hpckern_matrix_destroy(&jobs[i].B);
+        hpckern_matrix_destroy(&jobs[i].C);
+    }
+    free(jobs);
+    for (size_t i = 0; i < 2 * distinct_jobs; i++)
+    {
+        hpckern_matrix_destroy(&pipeline.operands[i]);
+    }
+    free(pipeline.operands);
 
-    matrix_mult_cblas(A, B, expected_mult_result);
+    job_queue_destroy(&pipeline.normed);
+    job_queue_destroy(&pipeline.multiplied);
+    job_queue_destroy(&pipeline.generated);
+    job_queue_destroy(&pipeline.free_jobs);
 
-    mat_norm = 0.0;
-    expected_norm = 0.0;
+    return wall_time;
+}
 
-    if (is_naive)
+// Distributed benchmark. With the tcp transport the calling process forks
+// `num_processes - 1` ranks; with mpi the ranks come from mpirun. Every rank
+// generates its own blocks of A and B. Times are the maximum over all ranks.
+// Returns true on rank 0, which owns the results. `verify` freivalds checks
+// the distributed C in place; full has rank 0 regenerate the operands and
+// check the norm against a single-node cblas multiply, which needs the
+// whole problem in its memory.
+bool summa_benchmark(size_t num_repeats, size_t num_processes, const char *transport_name, size_t matrix_size, size_t block_size, int min_value, int max_value, const char *impl, const char *verify, size_t verify_trials, benchmark_result_t *results)
+{
+    transport_t transport;
+    pid_t *children = (pid_t *)calloc(num_processes, sizeof(pid_t));
+    unsigned long long shared_seed = (unsigned long long)time(NULL);
+    size_t grid_dim, local_size;
+    hpckern_matrix_t *A_local, *B_local, *C_local;
+    int *all_ranks;
+    long double mat_norm = 0.0;
+    bool is_root;
+
+#ifdef USE_MPI
+    if (strcmp(transport_name, TRANSPORT_MPI) == 0)
     {
-        for (i = 0; i < num_repeats; i++)
-        {
-            MEASURE_RUNTIME(matrix_mult_naive(A, B, C), results[i].benchmark_runtime);
-            MEASURE_RUNTIME(mat_norm = matrix_norm_serial(block_size, C), results[i].norm_runtime);
-            results[i].block_size = block_size;
-            results[i].impl = impl;
-            results[i].matrix_size = matrix_size;
-            results[i].num_repeats = num_repeats;
-            results[i].num_threads = 1;
-        }
+        transport_mpi_init(&transport);
     }
-    else if (is_cblas)
+    else
+#endif
     {
-        for (i = 0; i < num_repeats; i++)
-        {
-            MEASURE_RUNTIME(matrix_mult_cblas(A, B, C), results[i].benchmark_runtime);
-            MEASURE_RUNTIME(mat_norm = matrix_norm_serial(block_size, C), results[i].norm_runtime);
-            results[i].block_size = block_size;
-            results[i].impl = impl;
-            results[i].matrix_size = matrix_size;
-            results[i].num_repeats = num_repeats;
-            results[i].num_threads = 1;
-        }
+        transport_tcp_spawn(&transport, (int)num_processes, children);
     }
-    else if (is_serial)
+
+    // args_validate checked the grid.
+    is_root = transport.rank == 0;
+    grid_dim = (size_t)llround(sqrt((double)transport.size));
+    local_size = matrix_size / grid_dim;
+
+    all_ranks = (int *)malloc(transport.size * sizeof(int));
+    for (int r = 0; r < transport.size; r++)
     {
-        for (i = 0; i < num_repeats; i++)
-        {
-            MEASURE_RUNTIME(matrix_mult_serial(block_size, A, B, C), results[i].benchmark_runtime);
-            MEASURE_RUNTIME(mat_norm = matrix_norm_serial(block_size, C), results[i].norm_runtime);
-            results[i].block_size = block_size;
-            results[i].impl = impl;
-            results[i].matrix_size = matrix_size;
-            results[i].num_repeats = num_repeats;
-            results[i].num_threads = 1;
-        }
+        all_ranks[r] = r;
     }
-    else if (is_threaded)
+    transport_bcast(&transport, &shared_seed, sizeof(shared_seed), 0, all_ranks, transport.size);
+
+    A_local = matrix_alloc(local_size);
+    B_local = matrix_alloc(local_size);
+    C_local = matrix_alloc(local_size);
+    matrix_fill_hashed(A_local->data, local_size, local_size, (transport.rank / grid_dim) * local_size, (transport.rank % grid_dim) * local_size, shared_seed, min_value, max_value);
+    matrix_fill_hashed(B_local->data, local_size, local_size, (transport.rank / grid_dim) * local_size, (transport.rank % grid_dim) * local_size, shared_seed + 1, min_value, max_value);
+
+    for (size_t i = 0; i < num_repeats; i++)
     {
-        for (i = 0; i < num_repeats; i++)
+        long double times[2];
+        double mult_runtime, norm_runtime;
+
+        MEASURE_RUNTIME(matrix_mult_summa(&transport, grid_dim, local_size, A_local, B_local, C_local), mult_runtime);
+        MEASURE_RUNTIME(mat_norm = matrix_norm_summa(&transport, grid_dim, local_size, C_local), norm_runtime);
+
+        times[0] = mult_runtime;
+        times[1] = norm_runtime;
+        transport_allreduce(&transport, times, 2, true, all_ranks, transport.size);
+
+        if (is_root)
         {
-            MEASURE_RUNTIME(matrix_mult_threaded(num_threads, block_size, A, B, C), results[i].benchmark_runtime);
-            MEASURE_RUNTIME(mat_norm = matrix_norm_threaded(num_threads, block_size, C), results[i].norm_runtime);
-            results[i].block_size = block_size;
+            results[i].benchmark_runtime = (double)times[0];
+            results[i].norm_runtime = (double)times[1];
             results[i].impl = impl;
             results[i].matrix_size = matrix_size;
             results[i].num_repeats = num_repeats;
-            results[i].num_threads = num_threads;
+            results[i].num_threads = transport.size;
+            if (strcmp(verify, VERIFY_FULL) != 0)
+            {
+                results[i].verify = verify;
+            }
         }
     }
 
-    panic_unless(
-        matrix_compare(C, expected_mult_result) == 0,
-        "Discrepency in matrix multiplication results\n");
+    if (strcmp(verify, VERIFY_FREIVALDS) == 0)
+    {
+        const bool is_correct = matrix_verify_freivalds_summa(
+            &transport, grid_dim, local_size, A_local, B_local, C_local,
+            shared_seed + 2, verify_trials, min_value, max_value);
 
-    if (is_threaded)
+        panic_unless(
+            is_correct || !is_root,
+            "Discrepency in distributed matrix multiplication results (Freivalds' check, %zu trials)\n",
+            verify_trials);
+    }
+    else if (is_root && strcmp(verify, VERIFY_FULL) == 0)
     {
-        expected_norm = matrix_norm_serial(block_size, expected_mult_result);
+        hpckern_matrix_t *A = matrix_alloc(matrix_size);
+        hpckern_matrix_t *B = matrix_alloc(matrix_size);
+        hpckern_matrix_t *C = matrix_alloc(matrix_size);
+        long double expected_norm;
+
+        matrix_fill_hashed(A->data, matrix_size, matrix_size, 0, 0, shared_seed, min_value, max_value);
+        matrix_fill_hashed(B->data, matrix_size, matrix_size, 0, 0, shared_seed + 1, min_value, max_value);
+        CHECK(hpckern_matrix_mult_cblas(A, B, C));
+        CHECK(hpckern_matrix_norm_serial(matrix_size, C, &expected_norm));
+        panic_unless(
+            fabsl(expected_norm - mat_norm) < EPS,
+            "Incorrect distributed matrix norm (expected: %Lf, actual: %Lf).",
+            expected_norm,
+            mat_norm);
+
+        hpckern_matrix_destroy(&A);
+        hpckern_matrix_destroy(&B);
+        hpckern_matrix_destroy(&C);
     }
-    else
+
+    hpckern_matrix_destroy(&A_local);
+    hpckern_matrix_destroy(&B_local);
+    hpckern_matrix_destroy(&C_local);
+    free(all_ranks);
+    transport.finalize(&transport);
+
+    if (strcmp(transport_name, TRANSPORT_TCP) == 0)
     {
-        expected_norm = matrix_norm_threaded(num_threads, block_size, expected_mult_result);
+        if (!is_root)
+        {
+            exit(0);
+        }
+        for (size_t r = 1; r < num_processes; r++)
+        {
+            int status;
+            waitpid(children[r], &status, 0);
+            panic_unless(WIFEXITED(status) && WEXITSTATUS(status) == 0, "Rank %zu failed\n", r);
+        }
     }
-    panic_unless(
-        fabsl(expected_norm - mat_norm) < EPS,
-        "Incorrect matrix norm estimation (expected: %Lf, actual: %Lf).",
-        expected_norm,
-        mat_norm);
+    free(children);
 
-    matrix_destroy(&A);
-    matrix_destroy(&B);
-    matrix_destroy(&C);
-    matrix_destroy(&expected_mult_result);
+    return is_root;
 }
 
 int main(int argc, const char **argv)
 {
     args_t *args;
     benchmark_result_t *results;
+    hpckern_rng_t rng;
+
+#ifdef USE_MPI
+    MPI_Init(&argc, (char ***)&argv);
+#endif
 
     args = args_parse(argc, argv);
-    srand(time(NULL));
+    hpckern_rng_seed(&rng, time(NULL));
 
     if (args->flag_help)
     {
         show_help(argv[0]);
     }
-    else
+    else if (strcmp(args->flag_impl, IMPL_SUMMA) == 0)
+    {
+        results = benchmark_results_create(args->flag_repeats);
+
+        if (summa_benchmark(
+                args->flag_repeats,
+                args->flag_processes,
+                args->flag_transport,
+                args->flag_matrix_size,
+                args->flag_block_size,
+                args->flag_min_value,
+                args->flag_max_value,
+                args->flag_impl,
+                args->flag_verify,
+                args->flag_verify_trials,
+                results))
+        {
+            write_result(stdout, args->flag_format, args->flag_repeats, results, NULL);
+        }
+
+        free(results);
+    }
+    else if (strcmp(args->flag_impl, IMPL_TRANSPOSE) == 0)
+    {
+        const double bytes_moved = 2.0 * args->flag_matrix_size * args->flag_matrix_size * sizeof(double);
+
+        results = benchmark_results_create(args->flag_repeats);
+
+        transpose_benchmark(
+            args->flag_repeats,
+            args->flag_number_of_threads,
+            args->flag_matrix_size,
+            args->flag_block_size,
+            args->flag_min_value,
+            args->flag_max_value,
+            &rng,
+            results);
+
+        fprintf(stdout, "- transpose_results:\n");
+        fprintf(stdout, "    matrix_size: %zu\n", args->flag_matrix_size);
+        fprintf(stdout, "    block_size: %zu\n", args->flag_block_size);
+        fprintf(stdout, "    num_threads: %zu\n", args->flag_number_of_threads);
+        fprintf(stdout, "    num_repeats: %zu\n", args->flag_repeats);
+        fprintf(stdout, "    individual_runs:\n");
+        for (size_t i = 0; i < args->flag_repeats; i++)
+        {
+            fprintf(stdout, "      - run: %zu\n", i + 1);
+            fprintf(stdout, "        out_of_place_time: %.9f\n", results[i].benchmark_runtime);
+            fprintf(stdout, "        out_of_place_gb_per_second: %.3f\n", bytes_moved / results[i].benchmark_runtime * 1e-9);
+            fprintf(stdout, "        in_place_time: %.9f\n", results[i].norm_runtime);
+            fprintf(stdout, "        in_place_gb_per_second: %.3f\n", bytes_moved / results[i].norm_runtime * 1e-9);
+        }
+
+        free(results);
+    }
+    else if (strcmp(args->flag_impl, IMPL_ESTIMATE) == 0)
     {
-        results = (benchmark_result_t *)calloc(args->flag_repeats, sizeof(benchmark_result_t));
+        results = benchmark_results_create(args->flag_repeats);
 
-        benchmark(
+        estimate_benchmark(
             args->flag_repeats,
             args->flag_number_of_threads,
             args->flag_matrix_size,
             args->flag_block_size,
             args->flag_min_value,
             args->flag_max_value,
+            &rng,
+            results);
+
+        write_result(stdout, args->flag_format, args->flag_repeats, results, NULL);
+
+        free(results);
+    }
+    else if (args->flag_updates > 0)
+    {
+        incremental_result_t incremental;
+        result_extras_t extras = {0};
+        double initial_time;
+
+        results = benchmark_results_create(args->flag_updates);
+
+        initial_time = incremental_benchmark(
+            args->flag_updates,
+            args->flag_number_of_threads,
+            args->flag_matrix_size,
+            args->flag_block_size,
+            args->flag_min_value,
+            args->flag_max_value,
+            &rng,
+            args->flag_impl,
+            args->flag_update_kind,
+            args->flag_update_rank,
+            args->flag_update_rows,
+            args->flag_compare,
+            args->flag_tolerance,
+            results);
+
+        incremental.update_kind = args->flag_update_kind;
+        incremental.update_rank = args->flag_update_rank;
+        incremental.update_rows = args->flag_update_rows;
+        incremental.num_updates = args->flag_updates;
+        incremental.initial_product_time = initial_time;
+        extras.incremental = &incremental;
+        write_result(stdout, args->flag_format, args->flag_updates, results, &extras);
+
+        free(results);
+    }
+    else if (args->flag_jobs > 0)
+    {
+        pipeline_result_t pipeline;
+        result_extras_t extras = {0};
+        hpckern_cache_t *cache = NULL;
+        hpckern_cache_stats_t cache_stats;
+        double wall_time;
+
+        results = benchmark_results_create(args->flag_jobs);
+        if (args->flag_cache_memory > 0 || args->flag_cache_dir != NULL)
+        {
+            hpckern_cache_config_t cache_config;
+
+            cache_config.memory_bytes = args->flag_cache_memory << 20;
+            cache_config.disk_path = args->flag_cache_dir;
+            cache_config.disk_bytes = args->flag_cache_disk << 20;
+            cache = hpckern_cache_create(&cache_config);
+            panic_unless(cache != NULL, "Failed to create the result cache\n");
+        }
+
+        wall_time = pipeline_benchmark(
+            args->flag_jobs,
+            args->flag_queue_depth,
+            args->flag_stage_workers,
+            args->flag_number_of_threads,
+            args->flag_matrix_size,
+            args->flag_block_size,
+            args->flag_min_value,
+            args->flag_max_value,
+            hpckern_rng_next(&rng),
             args->flag_impl,
+            args->flag_norm,
+            args->flag_verify,
+            args->flag_verify_trials,
+            args->flag_compare,
+            args->flag_tolerance,
+            args->flag_distinct_jobs,
+            cache,
             results);
 
-        write_result_in_yaml(stdout, args->flag_repeats, results);
+        pipeline.num_jobs = args->flag_jobs;
+        pipeline.queue_depth = args->flag_queue_depth;
+        pipeline.stage_workers = args->flag_stage_workers;
+        pipeline.distinct_jobs = args->flag_distinct_jobs;
+        pipeline.wall_time = wall_time;
+        pipeline.cache = NULL;
+        if (cache != NULL)
+        {
+            hpckern_cache_stats(cache, &cache_stats);
+            pipeline.cache = &cache_stats;
+        }
+        extras.pipeline = &pipeline;
+        write_result(stdout, args->flag_format, args->flag_jobs, results, &extras);
+
+        hpckern_cache_destroy(&cache);
+        free(results);
+    }
+    else
+    {
+        hpckern_harness_config_t harness_config;
+        hpckern_harness_stats_t harness_stats;
+        result_extras_t extras = {0};
+        size_t num_results;
+
+        harness_config_from_args(args, &harness_config);
+        results = benchmark_results_create(harness_config.max_iterations);
+
+        num_results = benchmark(
+            &harness_config,
+            args->flag_number_of_threads,
+            args->flag_matrix_size,
+            args->flag_block_size,
+            args->flag_min_value,
+            args->flag_max_value,
+            &rng,
+            args->flag_impl,
+            args->flag_layout,
+            args->flag_norm,
+            args->flag_trans_a,
+            args->flag_trans_b,
+            args->flag_pretranspose_b,
+            args->flag_alpha,
+            args->flag_beta,
+            args->flag_structure,
+            args->flag_density,
+            args->flag_bandwidth,
+            args->flag_verify,
+            args->flag_verify_trials,
+            args->flag_compare,
+            args->flag_tolerance,
+            results,
+            &harness_stats);
+
+        extras.harness = &harness_stats;
+        write_result(stdout, args->flag_format, num_results, results, &extras);
 
         free(results);
     }
 
+    if (args->flag_trace != NULL)
+    {
+        write_trace(args->flag_trace);
+    }
+
     free(args);
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif
     return 0;
 }
@@ -0,0 +1,521 @@
+package main
+
+import (
+	"bytes"
+	"flag"
+	"fmt"
+	"image/color"
+	"log"
+	"math"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+
+	"gonum.org/v1/plot"
+	"gonum.org/v1/plot/plotter"
+	"gonum.org/v1/plot/plotutil"
+	"gonum.org/v1/plot/vg"
+	"gopkg.in/yaml.v3"
+)
+
+const (
+	SCALING_STRONG_RESULTS_FILE = "scaling-strong.yaml"
+	SCALING_WEAK_RESULTS_FILE   = "scaling-weak.yaml"
+
+	SYSFS_CPU_DIR = "/sys/devices/system/cpu"
+)
+
+type ScalingFlags struct {
+	enabled    *bool
+	matrixSize *uint
+	blockSize  *uint
+	repeats    *uint
+	threads    *string
+	efficiency *float64
+}
+
+// A kernel of the threaded implementation and how its work grows with N.
+type ScalingKernel struct {
+	name         string
+	metric       string
+	workExponent float64
+}
+
+var scalingKernels = []ScalingKernel{
+	{"matrix_mult_threaded", METRIC_MULTIPLICATION, 3},
+	{"matrix_norm_threaded", METRIC_NORM, 2},
+}
+
+// Logical CPUs in the order the study adds them: one hardware thread per
+// physical core of the first socket, then of the next sockets, and only then
+// the SMT siblings. Boundaries label the thread counts where that changes.
+type CPUTopology struct {
+	order         []int
+	physicalCores uint
+	sockets       uint
+	boundaries    map[uint]string
+}
+
+type ScalingPoint struct {
+	threads    uint
+	matrixSize uint
+	times      map[string][]float64
+}
+
+type ScalingRow struct {
+	threads    uint
+	matrixSize uint
+	median     float64
+	speedup    float64
+	efficiency float64
+}
+
+func (options *ScalingFlags) register() {
+	options.enabled = flag.Bool("scaling", false,
+		"Run the strong and weak thread scaling study of the threaded implementation (with -plot, plot saved results)")
+
+	options.matrixSize = flag.Uint("scaling-size", 2048,
+		"Matrix size of the strong scaling runs, and of the single-thread weak scaling run")
+
+	options.blockSize = flag.Uint("scaling-block-size", 64,
+		"Block size of the scaling runs; weak scaling sizes are rounded to multiples of it")
+
+	options.repeats = flag.Uint("scaling-repeats", 10,
+		"Repeats per thread count in the scaling study")
+
+	options.threads = flag.String("scaling-threads", "",
+		"Comma-separated thread counts of the scaling study (default: 1 up to every logical CPU)")
+
+	options.efficiency = flag.Float64("scaling-efficiency", 0.7,
+		"Parallel efficiency below which scaling counts as flattened")
+}
+
+// Parses a sysfs CPU list like "0-3,8-11".
+func parseCPUList(list string) ([]int, error) {
+	var cpus []int
+	for _, part := range strings.Split(strings.TrimSpace(list), ",") {
+		if part == "" {
+			continue
+		}
+		bounds := strings.SplitN(part, "-", 2)
+		first, err := strconv.Atoi(bounds[0])
+		if err != nil {
+			return nil, err
+		}
+		last := first
+		if len(bounds) == 2 {
+			if last, err = strconv.Atoi(bounds[1]); err != nil {
+				return nil, err
+			}
+		}
+		for cpu := first; cpu <= last; cpu++ {
+			cpus = append(cpus, cpu)
+		}
+	}
+	return cpus, nil
+}
+
+func formatCPUList(cpus []int) string {
+	parts := make([]string, len(cpus))
+	for i, cpu := range cpus {
+		parts[i] = strconv.Itoa(cpu)
+	}
+	return strings.Join(parts, ",")
+}
+
+func readSysfsInt(path string) (int, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return 0, err
+	}
+	return strconv.Atoi(strings.TrimSpace(string(data)))
+}
+
+// Reads the topology from sysfs on Linux. Elsewhere every logical CPU counts
+// as a core of one socket and the study runs unpinned.
+func getCPUTopology(logicalCores uint) CPUTopology {
+	type cpuPlace struct {
+		cpu, socket, core, sibling int
+	}
+
+	topology := CPUTopology{boundaries: make(map[uint]string)}
+	if runtime.GOOS == "linux" {
+		data, err := os.ReadFile(filepath.Join(SYSFS_CPU_DIR, "online"))
+		if err == nil {
+			cpus, err := parseCPUList(string(data))
+			if err == nil {
+				places := make([]cpuPlace, 0, len(cpus))
+				siblings := make(map[[2]int]int)
+				socketCores := make(map[int]uint)
+				for _, cpu := range cpus {
+					dir := filepath.Join(SYSFS_CPU_DIR, fmt.Sprintf("cpu%d", cpu), "topology")
+					socket, socketErr := readSysfsInt(filepath.Join(dir, "physical_package_id"))
+					core, coreErr := readSysfsInt(filepath.Join(dir, "core_id"))
+					if socketErr != nil || coreErr != nil {
+						socket, core = 0, cpu
+					}
+					key := [2]int{socket, core}
+					if siblings[key] == 0 {
+						socketCores[socket]++
+					}
+					places = append(places, cpuPlace{cpu, socket, core, siblings[key]})
+					siblings[key]++
+				}
+
+				sort.Slice(places, func(i, j int) bool {
+					a, b := places[i], places[j]
+					if a.sibling != b.sibling {
+						return a.sibling < b.sibling
+					}
+					if a.socket != b.socket {
+						return a.socket < b.socket
+					}
+					if a.core != b.core {
+						return a.core < b.core
+					}
+					return a.cpu < b.cpu
+				})
+				for _, place := range places {
+					topology.order = append(topology.order, place.cpu)
+				}
+				topology.physicalCores = uint(len(siblings))
+				topology.sockets = uint(len(socketCores))
+
+				sockets := make([]int, 0, len(socketCores))
+				for socket := range socketCores {
+					sockets = append(sockets, socket)
+				}
+				sort.Ints(sockets)
+				filled := uint(0)
+				for _, socket := range sockets[:len(sockets)-1] {
+					filled += socketCores[socket]
+					topology.boundaries[filled] = fmt.Sprintf("socket %d full", socket)
+				}
+			}
+		}
+	}
+
+	if len(topology.order) == 0 {
+		for cpu := 0; cpu < int(max(logicalCores, 1)); cpu++ {
+			topology.order = append(topology.order, cpu)
+		}
+		topology.physicalCores = uint(len(topology.order))
+		topology.sockets = 1
+	}
+
+	if uint(len(topology.order)) > topology.physicalCores {
+		topology.boundaries[topology.physicalCores] = "physical cores full"
+	}
+	topology.boundaries[uint(len(topology.order))] = "all hardware threads"
+	return topology
+}
+
+func scalingThreadCounts(list string, topology CPUTopology) ([]uint, error) {
+	var counts []uint
+	if list == "" {
+		for threads := uint(1); threads <= uint(len(topology.order)); threads++ {
+			counts = append(counts, threads)
+		}
+		return counts, nil
+	}
+
+	for _, field := range strings.Split(list, ",") {
+		threads, err := strconv.ParseUint(strings.TrimSpace(field), 10, 32)
+		if err != nil || threads == 0 {
+			return nil, fmt.Errorf("invalid thread count '%s'", field)
+		}
+		counts = append(counts, uint(threads))
+	}
+	sort.Slice(counts, func(i, j int) bool { return counts[i] < counts[j] })
+	if counts[0] != 1 {
+		counts = append([]uint{1}, counts...)
+	}
+	return counts, nil
+}
+
+// Weak scaling keeps the multiplication's N^3 work per thread constant:
+// N grows with the cube root of the thread count, rounded to a multiple of
+// the block size, which the threaded implementation requires.
+func weakScalingSize(baseSize uint, blockSize uint, threads uint) uint {
+	size := float64(baseSize) * math.Cbrt(float64(threads))
+	blocks := uint(math.Round(size / float64(blockSize)))
+	return max(blocks, 1) * blockSize
+}
+
+// Runs the threaded implementation pinned to the first `threads` CPUs of the
+// topology order, appends its YAML to outputFile and returns its timings.
+func runScalingPoint(execPath string, matrixSize uint, blockSize uint, threads uint, repeats uint, topology CPUTopology, outputFile *os.File) (ScalingPoint, error) {
+	args := []string{
+		execPath,
+		"--matrix-size", fmt.Sprint(matrixSize),
+		"--block-size", fmt.Sprint(blockSize),
+		"--number-of-threads", fmt.Sprint(threads),
+		"--repeats", fmt.Sprint(repeats),
+		"--warmup", "1",
+		"--impl", IMPL_THREADED,
+	}
+	if taskset, err := exec.LookPath("taskset"); err == nil && runtime.GOOS == "linux" {
+		cpus := topology.order[:min(int(threads), len(topology.order))]
+		args = append([]string{taskset, "-c", formatCPUList(cpus)}, args...)
+	}
+
+	var output bytes.Buffer
+	cmd := exec.Command(args[0], args[1:]...)
+	cmd.Stderr = os.Stderr
+	cmd.Stdout = &output
+	fmt.Println(cmd)
+	if err := cmd.Run(); err != nil {
+		return ScalingPoint{}, err
+	}
+	outputFile.Write(output.Bytes())
+
+	var results BenchmarkResults
+	if err := yaml.Unmarshal(output.Bytes(), &results); err != nil {
+		return ScalingPoint{}, err
+	}
+	return scalingPointsFromResults(results)[0], nil
+}
+
+func scalingPointsFromResults(results BenchmarkResults) []ScalingPoint {
+	points := make([]ScalingPoint, 0, len(results))
+	for _, result := range results {
+		point := ScalingPoint{
+			threads:    result.Metadata.NumThreads,
+			matrixSize: result.Metadata.MatrixSize,
+			times:      make(map[string][]float64),
+		}
+		for _, kernel := range scalingKernels {
+			for _, run := range result.IndividualRuns {
+				point.times[kernel.metric] = append(point.times[kernel.metric], runTime(run, kernel.metric))
+			}
+		}
+		points = append(points, point)
+	}
+	sort.Slice(points, func(i, j int) bool { return points[i].threads < points[j].threads })
+	return points
+}
+
+// Strong scaling: speedup T(1) / T(p) at a fixed N, and efficiency speedup / p.
+// Weak scaling: efficiency T(1) / T(p) with the work per thread held
+// constant. Rounding N to whole blocks and the norm's N^2 work make that only
+// approximate, so the times are normalized by the work each thread did.
+func scalingRows(points []ScalingPoint, kernel ScalingKernel, weak bool) []ScalingRow {
+	if len(points) == 0 || points[0].threads != 1 {
+		return nil
+	}
+
+	base := points[0]
+	baseTime := median(base.times[kernel.metric])
+	rows := make([]ScalingRow, 0, len(points))
+	for _, point := range points {
+		row := ScalingRow{
+			threads:    point.threads,
+			matrixSize: point.matrixSize,
+			median:     median(point.times[kernel.metric]),
+		}
+		p := float64(point.threads)
+		if weak {
+			work := math.Pow(float64(point.matrixSize)/float64(base.matrixSize), kernel.workExponent)
+			row.speedup = baseTime * work / row.median
+		} else {
+			row.speedup = baseTime / row.median
+		}
+		row.efficiency = row.speedup / p
+		rows = append(rows, row)
+	}
+	return rows
+}
+
+func printScalingTable(title string, kernel ScalingKernel, rows []ScalingRow, topology *CPUTopology, efficiencyTarget float64) {
+	fmt.Printf("\n## %s: %s\n", title, kernel.name)
+	fmt.Println("| Threads | Matrix Size | Median Time (s) | Speedup | Efficiency | Note |")
+	fmt.Println("|---------|-------------|-----------------|---------|------------|------|")
+
+	flattensAt := uint(0)
+	for _, row := range rows {
+		note := ""
+		if topology != nil {
+			note = topology.boundaries[row.threads]
+		}
+		fmt.Printf("| %-7d | %-11d | %-15.6f | %-6.2fx | %-9.1f%% | %s |\n",
+			row.threads, row.matrixSize, row.median, row.speedup, row.efficiency*100, note)
+		if flattensAt == 0 && row.efficiency < efficiencyTarget {
+			flattensAt = row.threads
+		}
+	}
+
+	if flattensAt == 0 {
+		fmt.Printf("\nEfficiency stays at or above %.0f%% up to %d threads\n", efficiencyTarget*100, rows[len(rows)-1].threads)
+	} else {
+		fmt.Printf("\nEfficiency first drops below %.0f%% at %d threads\n", efficiencyTarget*100, flattensAt)
+	}
+}
+
+// Dashed vertical lines at the socket and SMT boundaries of the topology.
+func addBoundaryLines(p *plot.Plot, topology *CPUTopology, yMax float64) {
+	if topology == nil {
+		return
+	}
+	for threads, label := range topology.boundaries {
+		line, err := plotter.NewLine(plotter.XYs{{X: float64(threads), Y: 0}, {X: float64(threads), Y: yMax}})
+		if err != nil {
+			log.Fatal(err)
+		}
+		line.Color = color.Gray{Y: 128}
+		line.Dashes = []vg.Length{vg.Points(4), vg.Points(4)}
+		p.Add(line)
+		if label != "all hardware threads" {
+			p.Legend.Add(fmt.Sprintf("%s (%d threads)", label, threads), line)
+		}
+	}
+}
+
+func rowsToXYs(rows []ScalingRow, value func(ScalingRow) float64) plotter.XYs {
+	pts := make(plotter.XYs, len(rows))
+	for i, row := range rows {
+		pts[i].X = float64(row.threads)
+		pts[i].Y = value(row)
+	}
+	return pts
+}
+
+func plotStrongScalingSpeedup(strong map[string][]ScalingRow, topology *CPUTopology, imageDirPath string) {
+	p := plot.New()
+	p.Title.Text = "Strong Scaling: Speedup vs Threads"
+	p.X.Label.Text = "Threads"
+	p.Y.Label.Text = "Speedup over 1 thread"
+
+	maxThreads := 1.0
+	for _, rows := range strong {
+		if len(rows) > 0 {
+			maxThreads = max(maxThreads, float64(rows[len(rows)-1].threads))
+		}
+	}
+
+	speedup := func(row ScalingRow) float64 { return row.speedup }
+	err := plotutil.AddLinePoints(p,
+		"Ideal", plotter.XYs{{X: 1, Y: 1}, {X: maxThreads, Y: maxThreads}},
+		scalingKernels[0].name, rowsToXYs(strong[scalingKernels[0].name], speedup),
+		scalingKernels[1].name, rowsToXYs(strong[scalingKernels[1].name], speedup))
+	if err != nil {
+		log.Fatal(err)
+	}
+	addBoundaryLines(p, topology, maxThreads)
+	p.Legend.Top = true
+	p.Legend.Left = true
+	p.Y.Min = 0
+
+	imagePath := filepath.Join(imageDirPath, "strong_scaling_speedup.png")
+	if err := p.Save(12*vg.Inch, 8*vg.Inch, imagePath); err != nil {
+		log.Fatal(err)
+	}
+}
+
+func plotScalingEfficiency(strong map[string][]ScalingRow, weak map[string][]ScalingRow, topology *CPUTopology, imageDirPath string) {
+	p := plot.New()
+	p.Title.Text = "Parallel Efficiency vs Threads"
+	p.X.Label.Text = "Threads"
+	p.Y.Label.Text = "Efficiency"
+
+	efficiency := func(row ScalingRow) float64 { return row.efficiency }
+	err := plotutil.AddLinePoints(p,
+		"Strong, "+scalingKernels[0].name, rowsToXYs(strong[scalingKernels[0].name], efficiency),
+		"Strong, "+scalingKernels[1].name, rowsToXYs(strong[scalingKernels[1].name], efficiency),
+		"Weak, "+scalingKernels[0].name, rowsToXYs(weak[scalingKernels[0].name], efficiency),
+		"Weak, "+scalingKernels[1].name, rowsToXYs(weak[scalingKernels[1].name], efficiency))
+	if err != nil {
+		log.Fatal(err)
+	}
+	addBoundaryLines(p, topology, 1.2)
+	p.Legend.Top = false
+	p.Legend.Left = true
+	p.Y.Min = 0
+	p.Y.Max = 1.2
+
+	imagePath := filepath.Join(imageDirPath, "scaling_efficiency.png")
+	if err := p.Save(12*vg.Inch, 8*vg.Inch, imagePath); err != nil {
+		log.Fatal(err)
+	}
+}
+
+// Prints the strong and weak scaling tables of both kernels and plots them
+// into imageDirPath. The topology marks its boundaries, and is nil when
+// replotting saved results that may come from another machine.
+func reportScaling(strongPoints []ScalingPoint, weakPoints []ScalingPoint, topology *CPUTopology, efficiencyTarget float64, imageDirPath string) {
+	strong := make(map[string][]ScalingRow)
+	weak := make(map[string][]ScalingRow)
+	for _, kernel := range scalingKernels {
+		strong[kernel.name] = scalingRows(strongPoints, kernel, false)
+		weak[kernel.name] = scalingRows(weakPoints, kernel, true)
+		if strong[kernel.name] == nil || weak[kernel.name] == nil {
+			log.Fatal("Scaling results need a single-thread run as their baseline")
+		}
+		printScalingTable("Strong Scaling", kernel, strong[kernel.name], topology, efficiencyTarget)
+		printScalingTable("Weak Scaling", kernel, weak[kernel.name], topology, efficiencyTarget)
+	}
+	fmt.Println()
+
+	os.MkdirAll(imageDirPath, 0755)
+	plotStrongScalingSpeedup(strong, topology, imageDirPath)
+	plotScalingEfficiency(strong, weak, topology, imageDirPath)
+}
+
+func runScalingStudy(options ScalingFlags, logicalCores uint, execPath string, outputDir string, imageDirPath string) {
+	topology := getCPUTopology(logicalCores)
+	counts, err := scalingThreadCounts(*options.threads, topology)
+	if err != nil {
+		log.Fatal(err)
+	}
+	if *options.blockSize == 0 || *options.matrixSize%*options.blockSize != 0 {
+		log.Fatalf("-scaling-size %d must be a multiple of -scaling-block-size %d", *options.matrixSize, *options.blockSize)
+	}
+	if counts[len(counts)-1] > uint(len(topology.order)) {
+		fmt.Printf("Warning: %d threads oversubscribe the %d hardware threads\n", counts[len(counts)-1], len(topology.order))
+	}
+	fmt.Printf("Topology: %d sockets, %d physical cores, %d hardware threads, CPU order %s\n",
+		topology.sockets, topology.physicalCores, len(topology.order), formatCPUList(topology.order))
+
+	strongOutputFile := ensureOutputFile(filepath.Join(outputDir, SCALING_STRONG_RESULTS_FILE))
+	defer strongOutputFile.Close()
+
+	weakOutputFile := ensureOutputFile(filepath.Join(outputDir, SCALING_WEAK_RESULTS_FILE))
+	defer weakOutputFile.Close()
+
+	// Runs go one after another: concurrent runs would compete for the cores
+	// being measured.
+	var strongPoints, weakPoints []ScalingPoint
+	for _, threads := range counts {
+		point, err := runScalingPoint(execPath, *options.matrixSize, *options.blockSize, threads, *options.repeats, topology, strongOutputFile)
+		if err != nil {
+			log.Fatal(err)
+		}
+		strongPoints = append(strongPoints, point)
+
+		weakSize := weakScalingSize(*options.matrixSize, *options.blockSize, threads)
+		point, err = runScalingPoint(execPath, weakSize, *options.blockSize, threads, *options.repeats, topology, weakOutputFile)
+		if err != nil {
+			log.Fatal(err)
+		}
+		weakPoints = append(weakPoints, point)
+	}
+
+	reportScaling(strongPoints, weakPoints, &topology, *options.efficiency, imageDirPath)
+}
+
+func plotScalingResults(resultsPath string, efficiencyTarget float64, imageDirPath string) {
+	strongResults, err := readBenchmarkResults(filepath.Join(resultsPath, SCALING_STRONG_RESULTS_FILE))
+	if err != nil {
+		panic(err)
+	}
+
+	weakResults, err := readBenchmarkResults(filepath.Join(resultsPath, SCALING_WEAK_RESULTS_FILE))
+	if err != nil {
+		panic(err)
+	}
+
+	reportScaling(scalingPointsFromResults(strongResults), scalingPointsFromResults(weakResults), nil, efficiencyTarget, imageDirPath)
+}
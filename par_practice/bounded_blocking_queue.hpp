@@ -0,0 +1,135 @@
+#ifndef BOUNDED_BLOCKING_QUEUE_HPP
+#define BOUNDED_BLOCKING_QUEUE_HPP
+
+#include <pthread.h>
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+// Mutex/condition-variable queue over any movable payload, including
+// move-only ones such as std::unique_ptr buffers or tile descriptors.
+// The bulk operations move several elements per lock acquisition.
+template <typename T>
+class BoundedBlockingQueue {
+private:
+    std::deque<T> _mem;
+    size_t _cap;
+    pthread_cond_t _cond_not_full;
+    pthread_cond_t _cond_not_empty;
+    mutable pthread_mutex_t _mut;
+
+public:
+
+    // Initialize the queue with a maximum capacity limit.
+    BoundedBlockingQueue(size_t capacity) {
+        this->_cap = capacity;
+        pthread_cond_init(&this->_cond_not_full, nullptr);
+        pthread_cond_init(&this->_cond_not_empty, nullptr);
+        pthread_mutex_init(&this->_mut, nullptr);
+    }
+
+    BoundedBlockingQueue(const BoundedBlockingQueue &) = delete;
+    BoundedBlockingQueue &operator=(const BoundedBlockingQueue &) = delete;
+
+    ~BoundedBlockingQueue() {
+        pthread_mutex_destroy(&this->_mut);
+        pthread_cond_destroy(&this->_cond_not_empty);
+        pthread_cond_destroy(&this->_cond_not_full);
+        this->_mem.clear();
+    }
+
+    // Add an element to the queue.
+    // The key requirement is that if the queue is already at full capacity,
+    // the calling thread must block (wait) until space becomes available in the queue.
+    void enqueue(T element) {
+        this->enqueue_bulk(&element, 1);
+    }
+
+    // Remove and return an element from the queue.
+    // If the queue is empty, the calling thread
+    // must block (wait) until an element becomes available.
+    T dequeue() {
+        pthread_mutex_lock(&this->_mut);
+        while (this->_mem.empty()) {
+            pthread_cond_wait(&this->_cond_not_empty, &this->_mut);
+        }
+        T result = std::move(this->_mem.front());
+        this->_mem.pop_front();
+        pthread_mutex_unlock(&this->_mut);
+
+        pthread_cond_signal(&this->_cond_not_full);
+
+        return result;
+    }
+
+    // Move up to `count` elements from `items` into the queue under a single
+    // lock acquisition. Blocks until at least one slot is free, then returns
+    // how many elements were moved; the caller resubmits the remainder.
+    size_t enqueue_bulk(T *items, size_t count) {
+        size_t moved = 0;
+
+        if (count == 0) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&this->_mut);
+        while (this->_mem.size() >= this->_cap) {
+            pthread_cond_wait(&this->_cond_not_full, &this->_mut);
+        }
+        for (; moved < count && this->_mem.size() < this->_cap; moved++) {
+            this->_mem.push_back(std::move(items[moved]));
+        }
+        pthread_mutex_unlock(&this->_mut);
+
+        if (moved == 1) {
+            pthread_cond_signal(&this->_cond_not_empty);
+        } else {
+            pthread_cond_broadcast(&this->_cond_not_empty);
+        }
+
+        return moved;
+    }
+
+    // Move up to `max_count` elements into `out` under a single lock
+    // acquisition. Blocks until at least one element is available and
+    // returns how many were moved.
+    size_t dequeue_bulk(T *out, size_t max_count) {
+        size_t moved = 0;
+
+        if (max_count == 0) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&this->_mut);
+        while (this->_mem.empty()) {
+            pthread_cond_wait(&this->_cond_not_empty, &this->_mut);
+        }
+        for (; moved < max_count && !this->_mem.empty(); moved++) {
+            out[moved] = std::move(this->_mem.front());
+            this->_mem.pop_front();
+        }
+        pthread_mutex_unlock(&this->_mut);
+
+        if (moved == 1) {
+            pthread_cond_signal(&this->_cond_not_full);
+        } else {
+            pthread_cond_broadcast(&this->_cond_not_full);
+        }
+
+        return moved;
+    }
+
+    // Return the current number of elements in the queue.
+    size_t size() const {
+        pthread_mutex_lock(&this->_mut);
+        size_t result = this->_mem.size();
+        pthread_mutex_unlock(&this->_mut);
+        return result;
+    }
+
+    size_t cap() const {
+        return this->_cap;
+    }
+};
+
+#endif
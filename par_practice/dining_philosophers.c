@@ -1,102 +1,242 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
-#include <semaphore.h>
+#include <stdatomic.h>
+#include <time.h>
 #include <unistd.h>
+#include "multi_lock.h"
+
+#define DEFAULT_NUM_PHILOSOPHERS ((size_t)5)
+#define DEFAULT_CHOPSTICKS_PER_MEAL ((size_t)2)
+#define DEFAULT_HOLD_US ((size_t)10)
+#define DEFAULT_THINK_US ((size_t)10)
+#define DEFAULT_DURATION_S 2.0
+#define PHILOSOPHER_STACK_SIZE ((size_t)64 * 1024)
+
+typedef struct
+{
+    size_t num_philosophers;
+    size_t num_chopsticks;
+    size_t chopsticks_per_meal;
+    size_t hold_us;
+    size_t think_us;
+    double duration_s;
+    const char *strategy;
+} args_t;
+
+typedef struct
+{
+    size_t index;
+    multi_lock_t *table;
+    const args_t *args;
+    atomic_bool *stop;
+    pthread_barrier_t *start;
+    size_t meals;
+    size_t retries;
+} parameter_t;
 
-#define N ((size_t)5)
+double get_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-typedef enum { 
-    IDLE,
-    THINKING,
-    EATING,    
-    SATIATED
-} state_t;
+/* Busy-wait so hold times model computation on the locked buffers. */
+void spin_for_us(size_t us)
+{
+    const double end = get_time() + us * 1e-6;
+    while (get_time() < end)
+    {
+    }
+}
 
-typedef struct {
-    state_t state;
-    int index;
-} parameter_t;
+void show_help(const char *prog_name)
+{
+    printf("Usage: %s [OPTIONS]\n\n", prog_name);
+    printf("Dining philosophers contention benchmark for multi_lock.\n");
+    printf("Philosopher i needs chopsticks i, i+1, ..., i+K-1 (mod number of chopsticks).\n\n");
+    printf("Options:\n");
+    printf("  --philosophers P      Number of philosopher threads (default: %zu)\n", DEFAULT_NUM_PHILOSOPHERS);
+    printf("  --chopsticks R        Number of shared resources (default: same as philosophers)\n");
+    printf("  --per-meal K          Resources locked per meal (default: %zu)\n", DEFAULT_CHOPSTICKS_PER_MEAL);
+    printf("  --hold-us US          Time spent eating while holding the locks (default: %zu)\n", DEFAULT_HOLD_US);
+    printf("  --think-us US         Time spent thinking between meals (default: %zu)\n", DEFAULT_THINK_US);
+    printf("  --duration S          Benchmark duration in seconds (default: %.1f)\n", DEFAULT_DURATION_S);
+    printf("  --strategy NAME       ordered, backoff or all (default: all)\n");
+    printf("  --help                Show this help message\n");
+}
 
-pthread_mutex_t chopsticks[N];
-pthread_t philosophers[N];
-parameter_t params[N];
-sem_t gate_keeper;
-
-void update_param(parameter_t *param) {
-    if (param->state == IDLE) {
-        param->state = THINKING;
-    } else if (param->state == THINKING) {
-        param->state = EATING;
-    } else if (param->state == EATING) {
-        param->state = SATIATED;
-    }
-    printf("[");
-    for (size_t i = 0; i < N; i++) {
-        state_t state = params[i].state;
-        char state_str[64];
-        if (i > 0) {
-            printf(" ");
+args_t args_parse(int argc, char **argv)
+{
+    args_t args = {
+        .num_philosophers = DEFAULT_NUM_PHILOSOPHERS,
+        .num_chopsticks = 0,
+        .chopsticks_per_meal = DEFAULT_CHOPSTICKS_PER_MEAL,
+        .hold_us = DEFAULT_HOLD_US,
+        .think_us = DEFAULT_THINK_US,
+        .duration_s = DEFAULT_DURATION_S,
+        .strategy = "all",
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--philosophers") == 0 && i + 1 < argc)
+        {
+            args.num_philosophers = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--chopsticks") == 0 && i + 1 < argc)
+        {
+            args.num_chopsticks = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--per-meal") == 0 && i + 1 < argc)
+        {
+            args.chopsticks_per_meal = strtoull(argv[++i], NULL, 10);
         }
-        if (state == IDLE) {
-            sprintf(state_str, "IDLE");
-        } else if (state == THINKING) {
-            sprintf(state_str, "THINKING");
-        } else if (state == EATING) {
-            sprintf(state_str, "EATING");
-        } else {
-            sprintf(state_str, "SATIATED");
-        }        
-        printf("%10s", state_str);
+        else if (strcmp(argv[i], "--hold-us") == 0 && i + 1 < argc)
+        {
+            args.hold_us = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--think-us") == 0 && i + 1 < argc)
+        {
+            args.think_us = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+        {
+            args.duration_s = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--strategy") == 0 && i + 1 < argc)
+        {
+            args.strategy = argv[++i];
+        }
+        else
+        {
+            show_help(argv[0]);
+            exit(strcmp(argv[i], "--help") == 0 ? 0 : -1);
+        }
+    }
+
+    if (args.num_chopsticks == 0)
+    {
+        args.num_chopsticks = args.num_philosophers;
+    }
+    if (args.num_philosophers == 0 || args.chopsticks_per_meal == 0 || args.chopsticks_per_meal > args.num_chopsticks)
+    {
+        fprintf(stderr, "Need at least one philosopher and 1 <= per-meal <= chopsticks\n");
+        exit(-1);
     }
-    printf("]\n");
+    return args;
 }
 
-void *do_work(void *args) {
+void *do_work(void *args)
+{
     parameter_t *param = (parameter_t *)args;
-    int left_index = (param->index - 1 + N) % N;
-    int right_index = (param->index + 1 + N) % N;
-
-    update_param(param);
-
-    sem_wait(&gate_keeper);
-
-    pthread_mutex_lock(&chopsticks[left_index]);
-    pthread_mutex_lock(&chopsticks[right_index]);
+    const args_t *cfg = param->args;
+    size_t *chopsticks = (size_t *)calloc(cfg->chopsticks_per_meal, sizeof(size_t));
+
+    pthread_barrier_wait(param->start);
+    while (!atomic_load_explicit(param->stop, memory_order_acquire))
+    {
+        for (size_t k = 0; k < cfg->chopsticks_per_meal; k++)
+        {
+            chopsticks[k] = (param->index + k) % cfg->num_chopsticks;
+        }
 
-    update_param(param);
-    
-    pthread_mutex_unlock(&chopsticks[left_index]);
-    pthread_mutex_unlock(&chopsticks[right_index]);
+        param->retries += multi_lock_acquire(param->table, chopsticks, cfg->chopsticks_per_meal);
+        spin_for_us(cfg->hold_us);
+        multi_lock_release(param->table, chopsticks, cfg->chopsticks_per_meal);
 
-    update_param(param);
+        param->meals++;
+        spin_for_us(cfg->think_us);
+    }
 
+    free(chopsticks);
     return NULL;
 }
 
-int main(int argc, char **argv) {
-    sem_init(&gate_keeper, 0, N);
-
-    for (size_t i = 0; i < N; i++) {
-        pthread_mutex_init(&chopsticks[i], NULL);
-        params[i].state = IDLE;
+void run_strategy(const args_t *args, multi_lock_strategy_t strategy, const char *name)
+{
+    const size_t N = args->num_philosophers;
+    pthread_t *philosophers = (pthread_t *)calloc(N, sizeof(pthread_t));
+    parameter_t *params = (parameter_t *)calloc(N, sizeof(parameter_t));
+    multi_lock_t *table = multi_lock_create(args->num_chopsticks, strategy);
+    atomic_bool stop;
+    pthread_barrier_t start;
+    pthread_attr_t attr;
+    size_t total_meals = 0, total_retries = 0;
+    size_t min_meals = (size_t)-1, max_meals = 0;
+    double start_time, elapsed;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, PHILOSOPHER_STACK_SIZE);
+    pthread_barrier_init(&start, NULL, N + 1);
+    atomic_init(&stop, false);
+
+    for (size_t i = 0; i < N; i++)
+    {
         params[i].index = i;
+        params[i].table = table;
+        params[i].args = args;
+        params[i].stop = &stop;
+        params[i].start = &start;
+        if (pthread_create(&philosophers[i], &attr, do_work, &params[i]) != 0)
+        {
+            fprintf(stderr, "Failed to create philosopher %zu\n", i);
+            exit(-1);
+        }
     }
 
-    for (size_t i = 0; i < N; i++) {
-        pthread_create(&philosophers[i], NULL, do_work, &params[i]);
-    }
-
-    sleep(2);
+    /* Everyone starts eating together, and thread creation is not timed. */
+    pthread_barrier_wait(&start);
+    start_time = get_time();
+    usleep((useconds_t)(args->duration_s * 1e6));
+    atomic_store_explicit(&stop, true, memory_order_release);
 
-    for (size_t i = 0; i < N; i++) {
+    /* Meals in progress at the stop still count, so the clock runs until
+     * the last philosopher leaves the table. */
+    for (size_t i = 0; i < N; i++)
+    {
         pthread_join(philosophers[i], NULL);
     }
+    elapsed = get_time() - start_time;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        total_meals += params[i].meals;
+        total_retries += params[i].retries;
+        min_meals = params[i].meals < min_meals ? params[i].meals : min_meals;
+        max_meals = params[i].meals > max_meals ? params[i].meals : max_meals;
+    }
+
+    printf("%-10s %-14zu %-14.0f %-12zu %-12zu %-12zu\n",
+           name, total_meals, total_meals / elapsed, min_meals, max_meals, total_retries);
+
+    pthread_barrier_destroy(&start);
+    pthread_attr_destroy(&attr);
+    multi_lock_destroy(&table);
+    free(params);
+    free(philosophers);
+}
 
-    sem_destroy(&gate_keeper);
-    for (size_t i = 0; i < N; i++) {
-        pthread_mutex_unlock(&chopsticks[i]);
-        pthread_mutex_destroy(&chopsticks[i]);
+int main(int argc, char **argv)
+{
+    args_t args = args_parse(argc, argv);
+    const bool run_all = strcmp(args.strategy, "all") == 0;
+
+    printf("philosophers = %zu, chopsticks = %zu, per meal = %zu, hold = %zu us, think = %zu us\n",
+           args.num_philosophers, args.num_chopsticks, args.chopsticks_per_meal, args.hold_us, args.think_us);
+    printf("%-10s %-14s %-14s %-12s %-12s %-12s\n", "strategy", "meals", "meals/s", "min meals", "max meals", "retries");
+
+    if (run_all || strcmp(args.strategy, "ordered") == 0)
+    {
+        run_strategy(&args, MULTI_LOCK_ORDERED, "ordered");
     }
+    if (run_all || strcmp(args.strategy, "backoff") == 0)
+    {
+        run_strategy(&args, MULTI_LOCK_BACKOFF, "backoff");
+    }
+
     return 0;
 }
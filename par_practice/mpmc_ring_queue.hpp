@@ -0,0 +1,252 @@
+#ifndef MPMC_RING_QUEUE_HPP
+#define MPMC_RING_QUEUE_HPP
+
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+const size_t CACHE_LINE_SIZE = 64;
+
+// Bounded multi-producer/multi-consumer queue after Dmitry Vyukov's design.
+// Every cell carries a sequence number that tells producers and consumers
+// whose turn it is, so the fast path is one CAS on the shared position plus
+// one release store on the cell. Blocking callers spin briefly and only then
+// park on a futex, which is woken solely when somebody is actually sleeping.
+// Checking for sleepers costs the fast path no fence: a sleeper forces one
+// onto every thread with membarrier before it re-checks the ring.
+template <typename T>
+class MpmcRingQueue {
+private:
+    static const int SPIN_LIMIT = 128;
+
+    struct cell_t {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Futex word plus a count of sleepers, so that the wake-up syscall is
+    // skipped whenever nobody waits on this side of the queue.
+    struct alignas(CACHE_LINE_SIZE) waitpoint_t {
+        std::atomic<uint32_t> epoch;
+        std::atomic<uint32_t> waiters;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueue_pos;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeue_pos;
+    waitpoint_t _not_full;
+    waitpoint_t _not_empty;
+    alignas(CACHE_LINE_SIZE) cell_t *_cells;
+    size_t _mask;
+    size_t _cap;
+    bool _has_membarrier;
+
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static void futex_wait(std::atomic<uint32_t> *addr, uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    static void futex_wake_one(std::atomic<uint32_t> *addr) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    // Run by a sleeper between registering in `waiters` and re-checking the
+    // ring. With membarrier every running thread of the process executes a
+    // full barrier, which stands in for the fence notify leaves out.
+    void sleeper_barrier() {
+        if (this->_has_membarrier) {
+            syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+        }
+    }
+
+    void notify(waitpoint_t &wp) {
+        // Pairs with sleeper_barrier: either the sleeper sees our cell update
+        // or we see it in `waiters`. Kernels without membarrier get the full
+        // fence here instead.
+        if (this->_has_membarrier) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } else {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        if (wp.waiters.load(std::memory_order_relaxed) != 0) {
+            wp.epoch.fetch_add(1, std::memory_order_release);
+            futex_wake_one(&wp.epoch);
+        }
+    }
+
+    bool try_push(T &element) {
+        cell_t *cell;
+        size_t pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &this->_cells[pos & this->_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+            if (dif == 0) {
+                if (this->_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (cell->storage) T(std::move(element));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &result) {
+        cell_t *cell;
+        size_t pos = this->_dequeue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &this->_cells[pos & this->_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (dif == 0) {
+                if (this->_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = this->_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        T *slot = std::launder(reinterpret_cast<T *>(cell->storage));
+        result = std::move(*slot);
+        slot->~T();
+        cell->seq.store(pos + this->_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+public:
+    // The capacity is rounded up to the next power of two.
+    MpmcRingQueue(size_t capacity) {
+        this->_cap = round_up_pow2(capacity);
+        this->_mask = this->_cap - 1;
+        this->_has_membarrier = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+        this->_cells = new cell_t[this->_cap];
+        for (size_t i = 0; i < this->_cap; i++) {
+            this->_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        this->_enqueue_pos.store(0, std::memory_order_relaxed);
+        this->_dequeue_pos.store(0, std::memory_order_relaxed);
+        this->_not_full.epoch.store(0, std::memory_order_relaxed);
+        this->_not_full.waiters.store(0, std::memory_order_relaxed);
+        this->_not_empty.epoch.store(0, std::memory_order_relaxed);
+        this->_not_empty.waiters.store(0, std::memory_order_relaxed);
+    }
+
+    MpmcRingQueue(const MpmcRingQueue &) = delete;
+    MpmcRingQueue &operator=(const MpmcRingQueue &) = delete;
+
+    ~MpmcRingQueue() {
+        size_t pos = this->_dequeue_pos.load(std::memory_order_relaxed);
+        size_t end = this->_enqueue_pos.load(std::memory_order_relaxed);
+        for (; pos != end; pos++) {
+            std::launder(reinterpret_cast<T *>(this->_cells[pos & this->_mask].storage))->~T();
+        }
+        delete[] this->_cells;
+    }
+
+    // Non-blocking variants: return false instead of waiting.
+    // `element` is only moved from when the call succeeds.
+    bool try_enqueue(T &&element) {
+        if (!this->try_push(element)) {
+            return false;
+        }
+        notify(this->_not_empty);
+        return true;
+    }
+
+    bool try_enqueue(const T &element) {
+        T copy(element);
+        return this->try_enqueue(std::move(copy));
+    }
+
+    bool try_dequeue(T &result) {
+        if (!this->try_pop(result)) {
+            return false;
+        }
+        notify(this->_not_full);
+        return true;
+    }
+
+    // Add an element, blocking while the queue is full.
+    void enqueue(T element) {
+        for (int spin = 0; spin < SPIN_LIMIT; spin++) {
+            if (this->try_enqueue(std::move(element))) {
+                return;
+            }
+        }
+
+        for (;;) {
+            this->_not_full.waiters.fetch_add(1, std::memory_order_seq_cst);
+            this->sleeper_barrier();
+            uint32_t epoch = this->_not_full.epoch.load(std::memory_order_acquire);
+            if (this->try_push(element)) {
+                this->_not_full.waiters.fetch_sub(1, std::memory_order_relaxed);
+                notify(this->_not_empty);
+                return;
+            }
+            futex_wait(&this->_not_full.epoch, epoch);
+            this->_not_full.waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Remove and return an element, blocking while the queue is empty.
+    T dequeue() {
+        T result;
+
+        for (int spin = 0; spin < SPIN_LIMIT; spin++) {
+            if (this->try_dequeue(result)) {
+                return result;
+            }
+        }
+
+        for (;;) {
+            this->_not_empty.waiters.fetch_add(1, std::memory_order_seq_cst);
+            this->sleeper_barrier();
+            uint32_t epoch = this->_not_empty.epoch.load(std::memory_order_acquire);
+            if (this->try_pop(result)) {
+                this->_not_empty.waiters.fetch_sub(1, std::memory_order_relaxed);
+                notify(this->_not_full);
+                return result;
+            }
+            futex_wait(&this->_not_empty.epoch, epoch);
+            this->_not_empty.waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Approximate number of elements; exact only when the queue is quiescent.
+    size_t size() const {
+        size_t tail = this->_enqueue_pos.load(std::memory_order_relaxed);
+        size_t head = this->_dequeue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t cap() const {
+        return this->_cap;
+    }
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "multi_lock.h"
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BACKOFF_MIN_NS 200L
+#define BACKOFF_MAX_NS 100000L
+
+multi_lock_t *multi_lock_create(size_t num_resources, multi_lock_strategy_t strategy)
+{
+    multi_lock_t *ml = (multi_lock_t *)calloc(1, sizeof(multi_lock_t));
+
+    ml->num_resources = num_resources;
+    ml->strategy = strategy;
+    ml->locks = (pthread_mutex_t *)calloc(num_resources, sizeof(pthread_mutex_t));
+    for (size_t i = 0; i < num_resources; i++)
+    {
+        pthread_mutex_init(&ml->locks[i], NULL);
+    }
+    return ml;
+}
+
+void multi_lock_destroy(multi_lock_t **ml)
+{
+    for (size_t i = 0; i < (*ml)->num_resources; i++)
+    {
+        pthread_mutex_destroy(&(*ml)->locks[i]);
+    }
+    free((*ml)->locks);
+    free(*ml);
+    *ml = NULL;
+}
+
+/* Requests are a handful of indices, so insertion sort is the cheapest. */
+static void sort_ids(size_t *ids, size_t count)
+{
+    for (size_t i = 1; i < count; i++)
+    {
+        size_t id = ids[i];
+        size_t j = i;
+        while (j > 0 && ids[j - 1] > id)
+        {
+            ids[j] = ids[j - 1];
+            j--;
+        }
+        ids[j] = id;
+    }
+}
+
+static bool is_duplicate(const size_t *ids, size_t i)
+{
+    return i > 0 && ids[i] == ids[i - 1];
+}
+
+static void backoff(long *delay_ns, unsigned int *seed)
+{
+    struct timespec ts = {0, BACKOFF_MIN_NS + rand_r(seed) % *delay_ns};
+
+    if (*delay_ns <= BACKOFF_MIN_NS)
+    {
+        sched_yield();
+    }
+    else
+    {
+        nanosleep(&ts, NULL);
+    }
+    *delay_ns = *delay_ns * 2 < BACKOFF_MAX_NS ? *delay_ns * 2 : BACKOFF_MAX_NS;
+}
+
+static size_t acquire_backoff(multi_lock_t *ml, size_t *ids, size_t count)
+{
+    unsigned int seed = (unsigned int)(size_t)ids ^ (unsigned int)ids[0];
+    long delay_ns = BACKOFF_MIN_NS;
+    size_t first = 0;
+    size_t retries = 0;
+
+    for (;;)
+    {
+        size_t busy = count;
+
+        pthread_mutex_lock(&ml->locks[ids[first]]);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (i == first || is_duplicate(ids, i) || ids[i] == ids[first])
+            {
+                continue;
+            }
+            if (pthread_mutex_trylock(&ml->locks[ids[i]]) != 0)
+            {
+                busy = i;
+                break;
+            }
+        }
+
+        if (busy == count)
+        {
+            return retries;
+        }
+
+        /* Release the locks taken so far (those before `busy`) and `first`. */
+        for (size_t i = 0; i < busy; i++)
+        {
+            if (i != first && !is_duplicate(ids, i) && ids[i] != ids[first])
+            {
+                pthread_mutex_unlock(&ml->locks[ids[i]]);
+            }
+        }
+        pthread_mutex_unlock(&ml->locks[ids[first]]);
+
+        retries++;
+        first = busy;
+        backoff(&delay_ns, &seed);
+    }
+}
+
+size_t multi_lock_acquire(multi_lock_t *ml, size_t *ids, size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (ids[i] >= ml->num_resources)
+        {
+            fprintf(stderr, "Resource %zu is out of range (only %zu resources)\n", ids[i], ml->num_resources);
+            abort();
+        }
+    }
+
+    sort_ids(ids, count);
+
+    if (ml->strategy == MULTI_LOCK_BACKOFF)
+    {
+        return acquire_backoff(ml, ids, count);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_duplicate(ids, i))
+        {
+            pthread_mutex_lock(&ml->locks[ids[i]]);
+        }
+    }
+    return 0;
+}
+
+void multi_lock_release(multi_lock_t *ml, const size_t *ids, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_duplicate(ids, i))
+        {
+            pthread_mutex_unlock(&ml->locks[ids[i]]);
+        }
+    }
+}
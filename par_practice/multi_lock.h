@@ -0,0 +1,43 @@
+#ifndef MULTI_LOCK_H
+#define MULTI_LOCK_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+/*
+ * Deadlock-free acquisition of several mutex-protected resources at once.
+ *
+ * MULTI_LOCK_ORDERED locks the requested resources in ascending index order,
+ * which rules out the circular wait behind the dining philosophers deadlock.
+ *
+ * MULTI_LOCK_BACKOFF blocks only on one resource and try-locks the others.
+ * If one is busy it releases everything, backs off for a randomized,
+ * exponentially growing time and retries, starting with the resource that was
+ * busy. No thread ever holds a lock while waiting for another one.
+ */
+
+typedef enum
+{
+    MULTI_LOCK_ORDERED,
+    MULTI_LOCK_BACKOFF
+} multi_lock_strategy_t;
+
+typedef struct
+{
+    size_t num_resources;
+    multi_lock_strategy_t strategy;
+    pthread_mutex_t *locks;
+} multi_lock_t;
+
+multi_lock_t *multi_lock_create(size_t num_resources, multi_lock_strategy_t strategy);
+void multi_lock_destroy(multi_lock_t **ml);
+
+/*
+ * Acquire every resource in `ids`. The array is sorted in place and duplicate
+ * indices are tolerated; pass the same array and count to multi_lock_release.
+ * Returns how many times the backoff strategy had to give up and retry.
+ */
+size_t multi_lock_acquire(multi_lock_t *ml, size_t *ids, size_t count);
+void multi_lock_release(multi_lock_t *ml, const size_t *ids, size_t count);
+
+#endif
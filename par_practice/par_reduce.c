@@ -0,0 +1,322 @@
+#include "par_reduce.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CACHE_LINE_SIZE 64
+#define NUM_LANES 8
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) double value;
+} padded_slot_t;
+
+typedef struct
+{
+    reduce_pool_t *pool;
+    size_t index;
+} worker_arg_t;
+
+struct reduce_pool_t
+{
+    size_t num_workers;
+    bool deterministic;
+    pthread_t *threads;
+    worker_arg_t *worker_args;
+    padded_slot_t *slots;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_start;
+    pthread_cond_t cond_done;
+    size_t generation;
+    size_t num_finished;
+    bool shutdown;
+
+    /* Description of the reduction currently being executed. */
+    reduce_op_t op;
+    const double *x;
+    const double *y;
+    size_t len;
+    size_t num_chunks;
+    double *chunk_results;
+    size_t chunk_results_cap;
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t next_chunk;
+};
+
+static double reduce_identity(reduce_op_t op)
+{
+    (void)op;
+    return 0.0;
+}
+
+static double reduce_combine(reduce_op_t op, double lhs, double rhs)
+{
+    return op == REDUCE_AMAX ? MAX(lhs, rhs) : lhs + rhs;
+}
+
+/*
+ * Reduce x[0 .. len) (and y for dot) with NUM_LANES independent partials.
+ * The lane loop has no loop-carried dependency across lanes, which lets the
+ * compiler vectorize it without -ffast-math.
+ */
+static double reduce_chunk(reduce_op_t op, const double *x, const double *y, size_t len)
+{
+    double acc[NUM_LANES] = {0};
+    const size_t limit = len - len % NUM_LANES;
+    size_t i, k;
+    double result;
+
+    switch (op)
+    {
+    case REDUCE_SUM:
+        for (i = 0; i < limit; i += NUM_LANES)
+            for (k = 0; k < NUM_LANES; k++)
+                acc[k] += x[i + k];
+        for (; i < len; i++)
+            acc[0] += x[i];
+        break;
+    case REDUCE_DOT:
+        for (i = 0; i < limit; i += NUM_LANES)
+            for (k = 0; k < NUM_LANES; k++)
+                acc[k] += x[i + k] * y[i + k];
+        for (; i < len; i++)
+            acc[0] += x[i] * y[i];
+        break;
+    case REDUCE_ASUM:
+        for (i = 0; i < limit; i += NUM_LANES)
+            for (k = 0; k < NUM_LANES; k++)
+                acc[k] += fabs(x[i + k]);
+        for (; i < len; i++)
+            acc[0] += fabs(x[i]);
+        break;
+    case REDUCE_SUMSQ:
+        for (i = 0; i < limit; i += NUM_LANES)
+            for (k = 0; k < NUM_LANES; k++)
+                acc[k] += x[i + k] * x[i + k];
+        for (; i < len; i++)
+            acc[0] += x[i] * x[i];
+        break;
+    case REDUCE_AMAX:
+        for (i = 0; i < limit; i += NUM_LANES)
+            for (k = 0; k < NUM_LANES; k++)
+                acc[k] = MAX(acc[k], fabs(x[i + k]));
+        for (; i < len; i++)
+            acc[0] = MAX(acc[0], fabs(x[i]));
+        break;
+    }
+
+    result = acc[0];
+    for (k = 1; k < NUM_LANES; k++)
+    {
+        result = reduce_combine(op, result, acc[k]);
+    }
+    return result;
+}
+
+/* Pairwise combination in index order: independent of who computed what. */
+static double reduce_tree(reduce_op_t op, double *values, size_t count)
+{
+    if (count == 0)
+    {
+        return reduce_identity(op);
+    }
+
+    for (size_t stride = 1; stride < count; stride *= 2)
+    {
+        for (size_t i = 0; i + stride < count; i += 2 * stride)
+        {
+            values[i] = reduce_combine(op, values[i], values[i + stride]);
+        }
+    }
+    return values[0];
+}
+
+static void reduce_work(reduce_pool_t *pool, size_t worker_index)
+{
+    double local = reduce_identity(pool->op);
+    size_t chunk;
+
+    while ((chunk = atomic_fetch_add_explicit(&pool->next_chunk, 1, memory_order_relaxed)) < pool->num_chunks)
+    {
+        const size_t start = chunk * REDUCE_CHUNK_LEN;
+        const size_t len = MIN(REDUCE_CHUNK_LEN, pool->len - start);
+        const double partial = reduce_chunk(
+            pool->op,
+            pool->x + start,
+            pool->y != NULL ? pool->y + start : NULL,
+            len);
+
+        if (pool->deterministic)
+        {
+            pool->chunk_results[chunk] = partial;
+        }
+        else
+        {
+            local = reduce_combine(pool->op, local, partial);
+        }
+    }
+
+    pool->slots[worker_index].value = local;
+}
+
+static void *reduce_worker(void *args)
+{
+    worker_arg_t *worker_arg = (worker_arg_t *)args;
+    reduce_pool_t *pool = worker_arg->pool;
+    size_t seen_generation = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->generation == seen_generation && !pool->shutdown)
+        {
+            pthread_cond_wait(&pool->cond_start, &pool->mutex);
+        }
+        if (pool->shutdown)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        reduce_work(pool, worker_arg->index);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->num_finished++;
+        pthread_cond_signal(&pool->cond_done);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return NULL;
+}
+
+reduce_pool_t *reduce_pool_create(size_t num_workers, bool deterministic)
+{
+    reduce_pool_t *pool = (reduce_pool_t *)calloc(1, sizeof(reduce_pool_t));
+
+    pool->num_workers = MAX(num_workers, (size_t)1);
+    pool->deterministic = deterministic;
+    pool->slots = (padded_slot_t *)aligned_alloc(CACHE_LINE_SIZE, pool->num_workers * sizeof(padded_slot_t));
+    pool->threads = (pthread_t *)calloc(pool->num_workers, sizeof(pthread_t));
+    pool->worker_args = (worker_arg_t *)calloc(pool->num_workers, sizeof(worker_arg_t));
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond_start, NULL);
+    pthread_cond_init(&pool->cond_done, NULL);
+
+    /* The calling thread acts as worker 0, so only spawn the others. */
+    for (size_t i = 1; i < pool->num_workers; i++)
+    {
+        pool->worker_args[i].pool = pool;
+        pool->worker_args[i].index = i;
+        if (pthread_create(&pool->threads[i], NULL, reduce_worker, &pool->worker_args[i]) != 0)
+        {
+            fprintf(stderr, "Failed to create reduction worker %zu\n", i);
+            exit(-1);
+        }
+    }
+
+    return pool;
+}
+
+void reduce_pool_destroy(reduce_pool_t **pool)
+{
+    reduce_pool_t *p = *pool;
+
+    pthread_mutex_lock(&p->mutex);
+    p->shutdown = true;
+    pthread_cond_broadcast(&p->cond_start);
+    pthread_mutex_unlock(&p->mutex);
+
+    for (size_t i = 1; i < p->num_workers; i++)
+    {
+        pthread_join(p->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&p->cond_done);
+    pthread_cond_destroy(&p->cond_start);
+    pthread_mutex_destroy(&p->mutex);
+    free(p->chunk_results);
+    free(p->worker_args);
+    free(p->threads);
+    free(p->slots);
+    free(p);
+    *pool = NULL;
+}
+
+double reduce_run(reduce_pool_t *pool, reduce_op_t op, const double *x, const double *y, size_t len)
+{
+    const size_t num_chunks = (len + REDUCE_CHUNK_LEN - 1) / REDUCE_CHUNK_LEN;
+    double result;
+
+    if (pool->deterministic && num_chunks > pool->chunk_results_cap)
+    {
+        free(pool->chunk_results);
+        pool->chunk_results = (double *)malloc(num_chunks * sizeof(double));
+        pool->chunk_results_cap = num_chunks;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->op = op;
+    pool->x = x;
+    pool->y = op == REDUCE_DOT ? y : NULL;
+    pool->len = len;
+    pool->num_chunks = num_chunks;
+    pool->num_finished = 0;
+    atomic_store_explicit(&pool->next_chunk, 0, memory_order_relaxed);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->cond_start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    reduce_work(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->num_finished < pool->num_workers - 1)
+    {
+        pthread_cond_wait(&pool->cond_done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (pool->deterministic)
+    {
+        return reduce_tree(op, pool->chunk_results, num_chunks);
+    }
+
+    result = pool->slots[0].value;
+    for (size_t i = 1; i < pool->num_workers; i++)
+    {
+        result = reduce_combine(op, result, pool->slots[i].value);
+    }
+    return result;
+}
+
+double reduce_sum(reduce_pool_t *pool, const double *x, size_t len)
+{
+    return reduce_run(pool, REDUCE_SUM, x, NULL, len);
+}
+
+double reduce_dot(reduce_pool_t *pool, const double *x, const double *y, size_t len)
+{
+    return reduce_run(pool, REDUCE_DOT, x, y, len);
+}
+
+double reduce_norm1(reduce_pool_t *pool, const double *x, size_t len)
+{
+    return reduce_run(pool, REDUCE_ASUM, x, NULL, len);
+}
+
+double reduce_norm2(reduce_pool_t *pool, const double *x, size_t len)
+{
+    return sqrt(reduce_run(pool, REDUCE_SUMSQ, x, NULL, len));
+}
+
+double reduce_norm_inf(reduce_pool_t *pool, const double *x, size_t len)
+{
+    return reduce_run(pool, REDUCE_AMAX, x, NULL, len);
+}
@@ -0,0 +1,48 @@
+#ifndef PAR_REDUCE_H
+#define PAR_REDUCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Parallel reductions over large double vectors (heap or mmap'd).
+ *
+ * A pool owns a fixed set of worker threads that are reused by every call,
+ * so the thread count does not depend on the vector length. Work is split
+ * into REDUCE_CHUNK_LEN-element chunks that workers claim dynamically; each
+ * chunk is reduced with several independent accumulators so the compiler can
+ * keep them in SIMD registers.
+ *
+ * In deterministic mode every chunk result is stored separately and the
+ * chunks are combined with a pairwise tree in index order, so the result is
+ * bit-identical for any number of workers. Otherwise each worker folds its
+ * chunks into its own cache-line padded slot and the slots are combined
+ * after the join, which is cheaper but depends on scheduling.
+ */
+
+#define REDUCE_CHUNK_LEN ((size_t)1 << 16)
+
+typedef enum
+{
+    REDUCE_SUM,
+    REDUCE_DOT,
+    REDUCE_ASUM,
+    REDUCE_SUMSQ,
+    REDUCE_AMAX
+} reduce_op_t;
+
+typedef struct reduce_pool_t reduce_pool_t;
+
+reduce_pool_t *reduce_pool_create(size_t num_workers, bool deterministic);
+void reduce_pool_destroy(reduce_pool_t **pool);
+
+/* Generic entry point; `y` is only read by REDUCE_DOT. */
+double reduce_run(reduce_pool_t *pool, reduce_op_t op, const double *x, const double *y, size_t len);
+
+double reduce_sum(reduce_pool_t *pool, const double *x, size_t len);
+double reduce_dot(reduce_pool_t *pool, const double *x, const double *y, size_t len);
+double reduce_norm1(reduce_pool_t *pool, const double *x, size_t len);
+double reduce_norm2(reduce_pool_t *pool, const double *x, size_t len);
+double reduce_norm_inf(reduce_pool_t *pool, const double *x, size_t len);
+
+#endif
@@ -1,38 +1,31 @@
-#include <pthread.h>
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "par_reduce.h"
 
-#define min(a, b) ((a) > (b) ? (b) : (a))
-#define N ((size_t) 100000)
-#define SEGLEN (10000)
-#define NTHREAD ((size_t)(N / SEGLEN) + (N % SEGLEN ? 1 : 0))
+#define DEFAULT_LEN ((size_t)100000)
+#define DEFAULT_NUM_WORKERS ((size_t)4)
 
 typedef struct
 {
-    double *x;
-    double *y;
-    int len;
-    pthread_mutex_t *lock;
-    double local_result;
-    double *global_result;
-} dot_product_t;
-
-void *perform_dot_product(void *args)
-{
-    dot_product_t *dp = (dot_product_t *)args;
-
-    dp->local_result = 0.0;
-    for (size_t i = 0; i < dp->len; i++)
-    {
-        dp->local_result += dp->x[i] * dp->y[i];
-    }
-    
-    pthread_mutex_lock(dp->lock);
-    *(dp->global_result) += dp->local_result;
-    pthread_mutex_unlock(dp->lock);
+    size_t len;
+    size_t num_workers;
+    bool deterministic;
+    const char *file;
+} args_t;
 
-    pthread_exit(0);
-}
+typedef struct
+{
+    double *data;
+    size_t len;
+    bool mapped_file;
+} vector_t;
 
 void fail_if_nonzero(int return_code)
 {
@@ -43,68 +36,185 @@ void fail_if_nonzero(int return_code)
     }
 }
 
-void print_vector(double *vec, size_t len)
+double get_time()
 {
-    printf("[");
-    for (size_t i = 0; i < len; i++)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void show_help(const char *prog_name)
+{
+    printf("Usage: %s [OPTIONS]\n\n", prog_name);
+    printf("Dot product, sum and norms of large vectors with a fixed-size worker pool.\n\n");
+    printf("Options:\n");
+    printf("  --length N          Number of elements per vector (default: %zu)\n", DEFAULT_LEN);
+    printf("  --threads T         Number of workers, including the caller (default: %zu)\n", DEFAULT_NUM_WORKERS);
+    printf("  --deterministic     Combine partial results in a fixed order, so the result\n");
+    printf("                      does not depend on the number of workers\n");
+    printf("  --file PATH         mmap raw doubles from PATH as x (and y) instead of\n");
+    printf("                      generating random vectors; --length defaults to the file size\n");
+    printf("  --help              Show this help message\n");
+}
+
+args_t args_parse(int argc, char **argv)
+{
+    args_t args = {
+        .len = 0,
+        .num_workers = DEFAULT_NUM_WORKERS,
+        .deterministic = false,
+        .file = NULL,
+    };
+
+    for (int i = 1; i < argc; i++)
     {
-        if (i > 0)
+        if (strcmp(argv[i], "--length") == 0 && i + 1 < argc)
+        {
+            args.len = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            args.num_workers = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--deterministic") == 0)
+        {
+            args.deterministic = true;
+        }
+        else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+        {
+            args.file = argv[++i];
+        }
+        else
         {
-            printf(", ");
+            show_help(argv[0]);
+            exit(strcmp(argv[i], "--help") == 0 ? 0 : -1);
         }
-        printf("%.3lf", vec[i]);
     }
-    printf("]");
+
+    if (args.file == NULL && args.len == 0)
+    {
+        args.len = DEFAULT_LEN;
+    }
+
+    return args;
 }
 
-void print_vector_line(double *vec, size_t len)
+/* Anonymous mappings let the kernel back 10^9-element vectors lazily. */
+vector_t vector_random(size_t len)
 {
-    print_vector(vec, len);
-    printf("\n");
+    vector_t vec = {.len = len, .mapped_file = false};
+
+    vec.data = (double *)mmap(NULL, len * sizeof(double), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (vec.data == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(-1);
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        vec.data[i] = rand() % 1000;
+    }
+    return vec;
 }
 
-int main(int argc, char **argv)
+vector_t vector_map_file(const char *path, size_t len)
 {
-    dot_product_t dp[NTHREAD];
-    pthread_mutex_t lock;
-    pthread_t threads[NTHREAD];
-    double x[N];
-    double y[N];
-    double result;
-
-    pthread_mutex_init(&lock, NULL);
-    srand(0);
-    for (size_t i = 0; i < N; i++)
+    vector_t vec = {.mapped_file = true};
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(path);
+        exit(-1);
+    }
+
+    vec.len = len > 0 ? len : (size_t)st.st_size / sizeof(double);
+    if (vec.len * sizeof(double) > (size_t)st.st_size)
+    {
+        fprintf(stderr, "'%s' holds fewer than %zu doubles\n", path, vec.len);
+        exit(-1);
+    }
+
+    /* mmap rejects a zero length; an empty vector needs no mapping. */
+    if (vec.len == 0)
     {
-        x[i] = rand() % 1000;
-        y[i] = rand() % 1000;
+        close(fd);
+        vec.data = NULL;
+        return vec;
     }
 
-    result = 0.0;
-    for (size_t i = 0; i < NTHREAD; i++)
+    vec.data = (double *)mmap(NULL, vec.len * sizeof(double), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (vec.data == MAP_FAILED)
     {
-        dp[i].global_result = &result;
-        dp[i].local_result = 0.0;
-        dp[i].x = x + i * SEGLEN;
-        dp[i].y = y + i * SEGLEN;
-        dp[i].len = min(N - i * SEGLEN, SEGLEN);
-        dp[i].lock = &lock;
+        perror("mmap");
+        exit(-1);
     }
+    madvise(vec.data, vec.len * sizeof(double), MADV_SEQUENTIAL);
+    return vec;
+}
 
-    for (size_t i = 0; i < NTHREAD; i++)
+void vector_destroy(vector_t *vec)
+{
+    if (vec->data == NULL)
     {
-        int return_code = pthread_create(threads + i, NULL, perform_dot_product, &dp[i]);
-        fail_if_nonzero(return_code);
+        return;
     }
+    fail_if_nonzero(munmap(vec->data, vec->len * sizeof(double)));
+    vec->data = NULL;
+}
+
+int main(int argc, char **argv)
+{
+    args_t args = args_parse(argc, argv);
+    reduce_pool_t *pool;
+    vector_t x, y;
+    double start_time, result;
 
-    for (size_t i = 0; i < NTHREAD; i++)
+    srand(0);
+    if (args.file != NULL)
+    {
+        x = vector_map_file(args.file, args.len);
+        y = x;
+    }
+    else
     {
-        int return_code = pthread_join(threads[i], NULL);
-        fail_if_nonzero(return_code);
+        x = vector_random(args.len);
+        y = vector_random(args.len);
     }
 
-    printf("sum = %.3f\n", result);
+    pool = reduce_pool_create(args.num_workers, args.deterministic);
 
-    pthread_mutex_destroy(&lock);
+    printf("length = %zu, workers = %zu, deterministic = %s\n",
+           x.len, args.num_workers, args.deterministic ? "yes" : "no");
+
+    start_time = get_time();
+    result = reduce_dot(pool, x.data, y.data, x.len);
+    printf("dot      = %.3f (%.6f s)\n", result, get_time() - start_time);
+
+    start_time = get_time();
+    result = reduce_sum(pool, x.data, x.len);
+    printf("sum      = %.3f (%.6f s)\n", result, get_time() - start_time);
+
+    start_time = get_time();
+    result = reduce_norm1(pool, x.data, x.len);
+    printf("norm1    = %.3f (%.6f s)\n", result, get_time() - start_time);
+
+    start_time = get_time();
+    result = reduce_norm2(pool, x.data, x.len);
+    printf("norm2    = %.3f (%.6f s)\n", result, get_time() - start_time);
+
+    start_time = get_time();
+    result = reduce_norm_inf(pool, x.data, x.len);
+    printf("norm_inf = %.3f (%.6f s)\n", result, get_time() - start_time);
+
+    reduce_pool_destroy(&pool);
+    vector_destroy(&x);
+    if (args.file == NULL)
+    {
+        vector_destroy(&y);
+    }
     return 0;
 }
@@ -0,0 +1,180 @@
+#include <pthread.h>
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "bounded_blocking_queue.hpp"
+#include "mpmc_ring_queue.hpp"
+
+using namespace std;
+
+const size_t DEFAULT_OPS = 1000000;
+const size_t DEFAULT_CAPACITY = 1024;
+const size_t DEFAULT_BATCH = 32;
+const size_t THREAD_COUNTS[] = {1, 2, 4, 8};
+
+template <typename Queue>
+struct bench_param {
+    Queue *q;
+    size_t ops;
+    size_t batch;
+    pthread_barrier_t *start;
+};
+
+double get_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+template <typename Queue>
+void *produce(void *args) {
+    bench_param<Queue> *p = (bench_param<Queue> *)args;
+    pthread_barrier_wait(p->start);
+    for (size_t i = 0; i < p->ops; i++) {
+        p->q->enqueue((int)i);
+    }
+    return nullptr;
+}
+
+template <typename Queue>
+void *consume(void *args) {
+    bench_param<Queue> *p = (bench_param<Queue> *)args;
+    volatile int sink = 0;
+    pthread_barrier_wait(p->start);
+    for (size_t i = 0; i < p->ops; i++) {
+        sink = p->q->dequeue();
+    }
+    (void)sink;
+    return nullptr;
+}
+
+template <typename Queue>
+void *produce_bulk(void *args) {
+    bench_param<Queue> *p = (bench_param<Queue> *)args;
+    int *items = new int[p->batch];
+    pthread_barrier_wait(p->start);
+    for (size_t i = 0; i < p->ops;) {
+        size_t count = p->ops - i < p->batch ? p->ops - i : p->batch;
+        for (size_t j = 0; j < count; j++) {
+            items[j] = (int)(i + j);
+        }
+        for (size_t sent = 0; sent < count;) {
+            sent += p->q->enqueue_bulk(items + sent, count - sent);
+        }
+        i += count;
+    }
+    delete[] items;
+    return nullptr;
+}
+
+template <typename Queue>
+void *consume_bulk(void *args) {
+    bench_param<Queue> *p = (bench_param<Queue> *)args;
+    int *items = new int[p->batch];
+    pthread_barrier_wait(p->start);
+    for (size_t i = 0; i < p->ops;) {
+        size_t want = p->ops - i < p->batch ? p->ops - i : p->batch;
+        i += p->q->dequeue_bulk(items, want);
+    }
+    delete[] items;
+    return nullptr;
+}
+
+// Split `total` operations over `n` threads, giving the remainder to the first ones.
+size_t share_of(size_t total, size_t n, size_t index) {
+    return total / n + (index < total % n ? 1 : 0);
+}
+
+// Run `ops` transfers through the queue with the given number of producers
+// and consumers, and return the throughput in operations per second.
+// With `Bulk` set, elements move `batch` at a time through the bulk operations.
+template <typename Queue, bool Bulk = false>
+double run_bench(Queue *q, size_t ops, size_t producers, size_t consumers, size_t batch = 1) {
+    size_t num_threads = producers + consumers;
+    pthread_t *threads = new pthread_t[num_threads];
+    bench_param<Queue> *params = new bench_param<Queue>[num_threads];
+    pthread_barrier_t start;
+    double begin, end;
+
+    pthread_barrier_init(&start, nullptr, num_threads + 1);
+
+    for (size_t i = 0; i < num_threads; i++) {
+        bool is_producer = i < producers;
+        params[i].q = q;
+        params[i].start = &start;
+        params[i].batch = batch;
+        params[i].ops = is_producer ? share_of(ops, producers, i) : share_of(ops, consumers, i - producers);
+        if constexpr (Bulk) {
+            pthread_create(&threads[i], nullptr, is_producer ? produce_bulk<Queue> : consume_bulk<Queue>, &params[i]);
+        } else {
+            pthread_create(&threads[i], nullptr, is_producer ? produce<Queue> : consume<Queue>, &params[i]);
+        }
+    }
+
+    pthread_barrier_wait(&start);
+    begin = get_time();
+    for (size_t i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    end = get_time();
+
+    pthread_barrier_destroy(&start);
+    delete[] params;
+    delete[] threads;
+
+    return ops / (end - begin);
+}
+
+void show_help(const char *prog_name) {
+    printf("Usage: %s [--ops N] [--capacity C] [--batch K]\n\n", prog_name);
+    printf("Compares BoundedBlockingQueue (single and bulk transfers) against\n");
+    printf("MpmcRingQueue for every combination of 1, 2, 4 and 8 producers and consumers.\n\n");
+    printf("  --ops N        Number of elements pushed through each queue (default: %zu)\n", DEFAULT_OPS);
+    printf("  --capacity C   Queue capacity (default: %zu)\n", DEFAULT_CAPACITY);
+    printf("  --batch K      Elements per enqueue_bulk/dequeue_bulk call (default: %zu)\n", DEFAULT_BATCH);
+}
+
+int main(int argc, char **argv) {
+    size_t ops = DEFAULT_OPS;
+    size_t capacity = DEFAULT_CAPACITY;
+    size_t batch = DEFAULT_BATCH;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = strtoull(argv[++i], nullptr, 10);
+        } else {
+            show_help(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : -1;
+        }
+    }
+
+    if (batch == 0) {
+        batch = 1;
+    }
+
+    char bulk_label[64];
+    snprintf(bulk_label, sizeof bulk_label, "bulk x%zu (Mops/s)", batch);
+
+    printf("%-10s %-10s %-20s %-20s %-20s\n", "producers", "consumers", "blocking (Mops/s)", bulk_label, "mpmc ring (Mops/s)");
+    for (size_t producers : THREAD_COUNTS) {
+        for (size_t consumers : THREAD_COUNTS) {
+            BoundedBlockingQueue<int> blocking(capacity);
+            BoundedBlockingQueue<int> bulk(capacity);
+            MpmcRingQueue<int> ring(capacity);
+
+            double blocking_ops = run_bench(&blocking, ops, producers, consumers);
+            double bulk_ops = run_bench<BoundedBlockingQueue<int>, true>(&bulk, ops, producers, consumers, batch);
+            double ring_ops = run_bench(&ring, ops, producers, consumers);
+
+            printf("%-10zu %-10zu %-20.3f %-20.3f %-20.3f\n",
+                   producers, consumers, blocking_ops * 1e-6, bulk_ops * 1e-6, ring_ops * 1e-6);
+        }
+    }
+
+    return 0;
+}